@@ -1,5 +1,7 @@
 #include "kmod_test.hpp"
+#include "scheduler.hpp"
 #include <cassert>
+#include <sstream>
 
 KMOD_TEST(test_vfs_operations) {
     // Test virtual filesystem operations
@@ -7,6 +9,35 @@ KMOD_TEST(test_vfs_operations) {
     return true;
 }
 
-int main() {
-    return KernelModuleTester::instance().run_all_tests() ? 0 : 1;
+KMOD_TEST(scheduler_fcfs_accumulates_waiting_time) {
+    Scheduler scheduler;
+    std::ostringstream out;
+    scheduler.addProcess(Process(1, 5));
+    scheduler.addProcess(Process(2, 3));
+    scheduler.addProcess(Process(3, 1));
+    scheduler.schedule(out);
+
+    const Process& last = scheduler.processes.back();
+    return scheduler.processes[0].waitingTime == 0 && scheduler.processes[1].waitingTime == 5 &&
+           last.waitingTime == 8 && last.turnaroundTime == 9 &&
+           out.str().find("Process 3 finished. Turnaround Time: 9\n") != std::string::npos;
+}
+
+KMOD_BENCH(scheduler_fcfs_1000_processes) {
+    Scheduler scheduler;
+    std::ostringstream out;
+    for (int i = 0; i < 1000; i++) {
+        scheduler.addProcess(Process(i, 1 + i % 7));
+    }
+
+    bench_reset_timer(bench);
+    for (uint64_t i = 0; i < bench->iterations; i++) {
+        out.str("");
+        scheduler.schedule(out);
+    }
+    BENCH_KEEP(scheduler);
+}
+
+int main(int argc, char** argv) {
+    return KernelModuleTester::instance().run_main(argc, argv);
 }
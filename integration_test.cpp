@@ -1,5 +1,92 @@
 #include "integration_test.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <exception>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+thread_local std::ostringstream* current_output = nullptr;
+
+struct CallResult {
+    IntegrationOutcome outcome;
+    std::chrono::nanoseconds duration;
+    std::string message;
+    std::string output;
+};
+
+// Shared with the thread making the call, which outlives run_timed() when the call times out.
+struct CallState {
+    std::promise<bool> done;
+    std::ostringstream output;
+};
+
+CallResult run_timed(std::function<bool()> body, std::chrono::milliseconds timeout) {
+    auto state = std::make_shared<CallState>();
+    std::future<bool> finished = state->done.get_future();
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread caller([state, body = std::move(body)]() {
+        current_output = &state->output;
+        try {
+            state->done.set_value(body());
+        } catch (...) {
+            state->done.set_exception(std::current_exception());
+        }
+        current_output = nullptr;
+    });
+    if (finished.wait_for(timeout) != std::future_status::ready) {
+        caller.detach();
+        return {IntegrationOutcome::TIMED_OUT,
+                std::chrono::steady_clock::now() - start,
+                "timed out after " + std::to_string(timeout.count()) + " ms",
+                ""};
+    }
+    caller.join();
+
+    CallResult result{IntegrationOutcome::FAILED, std::chrono::steady_clock::now() - start, "", state->output.str()};
+    try {
+        if (finished.get()) {
+            result.outcome = IntegrationOutcome::PASSED;
+        }
+    } catch (const std::exception& error) {
+        result.message = std::string("exception: ") + error.what();
+    } catch (...) {
+        result.message = "unknown exception";
+    }
+    return result;
+}
+
+std::string format_ms(std::chrono::nanoseconds duration) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.1f ms", static_cast<double>(duration.count()) / 1e6);
+    return text;
+}
+
+void print_result(std::ostringstream& text, const IntegrationTestResult& result) {
+    text << "  " << result.test << "... " << IntegrationTestRunner::outcome_name(result.outcome);
+    if (result.outcome != IntegrationOutcome::SKIPPED) {
+        text << " (" << format_ms(result.duration) << ")";
+    }
+    if (!result.message.empty()) {
+        text << ": " << result.message;
+    }
+    text << '\n';
+
+    std::istringstream lines(result.output);
+    for (std::string line; std::getline(lines, line);) {
+        text << "    | " << line << '\n';
+    }
+}
+
+} // namespace
 
 IntegrationTestRunner& IntegrationTestRunner::instance() {
     static IntegrationTestRunner instance;
@@ -11,49 +98,178 @@ void IntegrationTestRunner::add_test_suite(
     std::function<void()> setup,
     std::function<void()> teardown,
     const std::vector<std::pair<std::string, std::function<bool()>>>& tests) {
-    
+
     test_suites.push_back({name, setup, teardown, tests});
 }
 
+std::ostream& IntegrationTestRunner::output() {
+    if (current_output) {
+        return *current_output;
+    }
+    return std::clog;
+}
+
+const char* IntegrationTestRunner::outcome_name(IntegrationOutcome outcome) {
+    switch (outcome) {
+        case IntegrationOutcome::PASSED:
+            return "PASSED";
+        case IntegrationOutcome::FAILED:
+            return "FAILED";
+        case IntegrationOutcome::TIMED_OUT:
+            return "TIMED OUT";
+        case IntegrationOutcome::SKIPPED:
+            return "SKIPPED";
+    }
+    return "UNKNOWN";
+}
+
+/*
+ * A failed setup skips the suite's tests but still runs teardown to undo
+ * whatever setup managed; a timed-out call skips everything after it.
+ * Setup and teardown appear in the results only when they do not pass.
+ */
+IntegrationTestRunner::SuiteReport IntegrationTestRunner::run_suite(const TestSuite& suite,
+                                                                    const IntegrationRunOptions& options) const {
+    SuiteReport report;
+    std::ostringstream text;
+    std::vector<const std::pair<std::string, std::function<bool()>>*> selected;
+
+    for (const auto& test : suite.tests) {
+        if ((suite.name + "/" + test.first).find(options.filter) != std::string::npos) {
+            selected.push_back(&test);
+        }
+    }
+    if (selected.empty()) {
+        return report;
+    }
+
+    auto record = [&](const std::string& name, CallResult call) {
+        IntegrationTestResult result{suite.name, name, call.outcome, call.duration,
+                                     std::move(call.message), std::move(call.output)};
+        print_result(text, result);
+        report.results.push_back(std::move(result));
+        return report.results.back().outcome;
+    };
+    // Fixtures only count as results when they fail; their output is shown either way.
+    auto record_fixture = [&](const std::string& name, CallResult call) {
+        if (call.outcome != IntegrationOutcome::PASSED) {
+            return record(name, std::move(call));
+        }
+        if (!call.output.empty()) {
+            print_result(text, {suite.name, name, call.outcome, call.duration, "", std::move(call.output)});
+        }
+        return call.outcome;
+    };
+    auto skip_rest = [&](size_t from, const std::string& reason) {
+        for (size_t i = from; i < selected.size(); i++) {
+            record(selected[i]->first, {IntegrationOutcome::SKIPPED, std::chrono::nanoseconds(0), reason, ""});
+        }
+    };
+
+    text << "Test Suite: " << suite.name << '\n';
+    auto suite_start = std::chrono::steady_clock::now();
+    bool stuck = false;
+
+    if (suite.setup) {
+        CallResult setup = run_timed([&setup_call = suite.setup]() {
+            setup_call();
+            return true;
+        }, options.timeout);
+        IntegrationOutcome outcome = record_fixture("(setup)", std::move(setup));
+        if (outcome != IntegrationOutcome::PASSED) {
+            stuck = outcome == IntegrationOutcome::TIMED_OUT;
+            skip_rest(0, "setup did not complete");
+            selected.clear();
+        }
+    }
+
+    for (size_t i = 0; i < selected.size(); i++) {
+        if (record(selected[i]->first, run_timed(selected[i]->second, options.timeout)) ==
+            IntegrationOutcome::TIMED_OUT) {
+            stuck = true;
+            skip_rest(i + 1, "an earlier test timed out");
+            break;
+        }
+    }
+
+    if (stuck) {
+        text << "  (teardown skipped: a call is still running)\n";
+    } else if (suite.teardown) {
+        CallResult teardown = run_timed([&teardown_call = suite.teardown]() {
+            teardown_call();
+            return true;
+        }, options.timeout);
+        record_fixture("(teardown)", std::move(teardown));
+    }
+
+    size_t passed = static_cast<size_t>(std::count_if(report.results.begin(), report.results.end(), [](const auto& r) {
+        return r.outcome == IntegrationOutcome::PASSED;
+    }));
+    text << "  Suite results: " << passed << " of " << report.results.size() << " passed in "
+         << format_ms(std::chrono::steady_clock::now() - suite_start) << "\n\n";
+    report.text = text.str();
+    return report;
+}
+
 bool IntegrationTestRunner::run_all_tests() {
-    int total_passed = 0;
-    int total_failed = 0;
-    
-    std::cout << "Running integration tests...\n" << std::endl;
-    
-    for (const auto& suite : test_suites) {
-        std::cout << "Test Suite: " << suite.name << std::endl;
-        suite.setup();
-        
-        int suite_passed = 0;
-        int suite_failed = 0;
-        
-        for (const auto& test : suite.tests) {
-            std::cout << "  " << test.first << "... ";
-            bool result = test.second();
-            
-            if (result) {
-                std::cout << "PASSED" << std::endl;
-                suite_passed++;
-            } else {
-                std::cout << "FAILED" << std::endl;
-                suite_failed++;
+    return run_all_tests(IntegrationRunOptions{});
+}
+
+/**
+ * Runs the suites on options.jobs worker threads, the calling thread
+ * included, and prints each suite's report as it completes.
+ *
+ * @param options Worker count, per-call timeout and filter.
+ * @param results Receives every result in registration order when not null.
+ * @return true when nothing failed or timed out.
+ */
+bool IntegrationTestRunner::run_all_tests(const IntegrationRunOptions& options,
+                                          std::vector<IntegrationTestResult>* results) {
+    size_t jobs = options.jobs > 0 ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::max<size_t>(1, std::min(jobs, test_suites.size()));
+    std::vector<SuiteReport> reports(test_suites.size());
+    std::atomic<size_t> next_suite{0};
+    std::mutex print_lock;
+    auto start = std::chrono::steady_clock::now();
+
+    std::cout << "Running integration tests on " << jobs << (jobs == 1 ? " worker" : " workers") << "...\n\n"
+              << std::flush;
+
+    auto work = [&]() {
+        for (size_t i = next_suite++; i < test_suites.size(); i = next_suite++) {
+            reports[i] = run_suite(test_suites[i], options);
+            if (!reports[i].text.empty()) {
+                std::lock_guard<std::mutex> lock(print_lock);
+                std::cout << reports[i].text << std::flush;
             }
         }
-        
-        suite.teardown();
-        
-        std::cout << "\n  Suite results:" << std::endl;
-        std::cout << "    Passed: " << suite_passed << std::endl;
-        std::cout << "    Failed: " << suite_failed << std::endl << std::endl;
-        
-        total_passed += suite_passed;
-        total_failed += suite_failed;
-    }
-    
-    std::cout << "Integration test summary:" << std::endl;
-    std::cout << "  Total passed: " << total_passed << std::endl;
-    std::cout << "  Total failed: " << total_failed << std::endl;
-    
-    return total_failed == 0;
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < jobs; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    size_t counts[4] = {0, 0, 0, 0};
+    for (auto& report : reports) {
+        for (auto& result : report.results) {
+            counts[static_cast<size_t>(result.outcome)]++;
+            if (results) {
+                results->push_back(std::move(result));
+            }
+        }
+    }
+
+    std::cout << "Integration test summary:\n";
+    std::cout << "  Total passed: " << counts[static_cast<size_t>(IntegrationOutcome::PASSED)] << '\n';
+    std::cout << "  Total failed: " << counts[static_cast<size_t>(IntegrationOutcome::FAILED)] << '\n';
+    std::cout << "  Timed out:    " << counts[static_cast<size_t>(IntegrationOutcome::TIMED_OUT)] << '\n';
+    std::cout << "  Skipped:      " << counts[static_cast<size_t>(IntegrationOutcome::SKIPPED)] << '\n';
+    std::cout << "  Wall:         " << format_ms(std::chrono::steady_clock::now() - start) << '\n' << std::flush;
+
+    return counts[static_cast<size_t>(IntegrationOutcome::FAILED)] == 0 &&
+           counts[static_cast<size_t>(IntegrationOutcome::TIMED_OUT)] == 0;
 }
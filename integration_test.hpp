@@ -1,31 +1,88 @@
 #ifndef OS_INTEGRATION_TEST_HPP
 #define OS_INTEGRATION_TEST_HPP
 
+#include <chrono>
+#include <functional>
+#include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
-#include <functional>
+
+/*
+ * Suites run concurrently on a fixed pool of worker threads, one suite per
+ * worker at a time. The worker runs the suite's setup, each test in order
+ * and teardown, every call on a new thread of its own that it waits for
+ * before starting the next. Calls of one suite therefore never overlap and
+ * a suite can keep state (a spawned server, a temp directory) between them
+ * without locking, but not in thread_local variables.
+ *
+ * A call that outlives the timeout is marked TIMED_OUT and its thread is
+ * detached: it keeps running in the background, alongside the tests of the
+ * other suites, until it returns or the process exits, and anything it
+ * writes to output() after that is dropped. The rest of its suite is
+ * skipped, teardown included, since teardown could race the stuck call.
+ * Exceptions are caught and reported.
+ *
+ * Anything a test writes to IntegrationTestRunner::output() is buffered and
+ * printed under the test's result line; each suite's report is written in
+ * one piece when the suite finishes, so parallel suites do not interleave.
+ */
+enum class IntegrationOutcome {
+    PASSED,
+    FAILED,
+    TIMED_OUT,
+    SKIPPED
+};
+
+struct IntegrationTestResult {
+    std::string suite;
+    std::string test;
+    IntegrationOutcome outcome = IntegrationOutcome::SKIPPED;
+    std::chrono::nanoseconds duration{0};
+    std::string message;
+    std::string output;
+};
+
+struct IntegrationRunOptions {
+    unsigned jobs = 0; // 0: one per hardware thread, capped at the suite count
+    std::chrono::milliseconds timeout{60000};
+    std::string filter; // substring of "suite/test"; empty runs everything
+};
 
 class IntegrationTestRunner {
 public:
     static IntegrationTestRunner& instance();
-    
-    void add_test_suite(const std::string& name, 
+
+    void add_test_suite(const std::string& name,
                       std::function<void()> setup,
                       std::function<void()> teardown,
                       const std::vector<std::pair<std::string, std::function<bool()>>>& tests);
-    
+
     bool run_all_tests();
+    bool run_all_tests(const IntegrationRunOptions& options, std::vector<IntegrationTestResult>* results = nullptr);
+
+    // Output buffer of the setup, test or teardown running on this thread; std::clog elsewhere.
+    static std::ostream& output();
+
+    static const char* outcome_name(IntegrationOutcome outcome);
 
 private:
     IntegrationTestRunner() = default;
-    
+
     struct TestSuite {
         std::string name;
         std::function<void()> setup;
         std::function<void()> teardown;
         std::vector<std::pair<std::string, std::function<bool()>>> tests;
     };
-    
+
+    struct SuiteReport {
+        std::vector<IntegrationTestResult> results;
+        std::string text;
+    };
+
+    SuiteReport run_suite(const TestSuite& suite, const IntegrationRunOptions& options) const;
+
     std::vector<TestSuite> test_suites;
 };
 
@@ -0,0 +1,200 @@
+#include "kmod_test.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+std::string format_ms(std::chrono::nanoseconds duration) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.2f ms", static_cast<double>(duration.count()) / 1e6);
+    return text;
+}
+
+void print_usage(const char* program) {
+    std::printf("Usage: %s [--jobs N] [--filter PATTERNS] [--list]\n", program);
+    std::printf("       %s --bench [benchmark options]\n", program);
+}
+
+/* Same bounds as the C runner's --jobs: a whole number from 1 to 1000000. */
+bool parse_jobs(const char* text, unsigned& out) {
+    char* end = nullptr;
+    errno = 0;
+    long value = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || value < 1 || value > 1000000) {
+        return false;
+    }
+    out = static_cast<unsigned>(value);
+    return true;
+}
+
+} // namespace
+
+KernelModuleTester& KernelModuleTester::instance() {
+    static KernelModuleTester instance;
+    return instance;
+}
+
+bool KernelModuleTester::register_test(const std::string& name, std::function<bool()> test) {
+    for (const auto& existing : tests) {
+        if (existing.name == name) {
+            duplicates.push_back(name);
+            return false;
+        }
+    }
+    tests.push_back({name, std::move(test)});
+    return true;
+}
+
+bool KernelModuleTester::register_bench(const std::string& name, void (*bench)(BenchState* bench)) {
+    for (const auto& existing : benches) {
+        if (existing.name == name) {
+            duplicates.push_back(name);
+            return false;
+        }
+    }
+    benches.push_back({name, bench});
+    return true;
+}
+
+bool KernelModuleTester::run_all_tests() {
+    return run_all_tests(KmodRunOptions{});
+}
+
+/**
+ * Runs the selected tests in name order across options.jobs threads,
+ * printing each result with its wall time as it completes.
+ *
+ * @param options Worker count, filter and list-only mode.
+ * @param results Receives the results in name order when not null.
+ * @return true when every selected test passed and no name was registered twice.
+ */
+bool KernelModuleTester::run_all_tests(const KmodRunOptions& options, std::vector<KmodTestResult>* results) {
+    std::vector<const TestCase*> selected;
+    for (const auto& test : tests) {
+        if (test_matches_filter(test.name.c_str(), options.filter.c_str())) {
+            selected.push_back(&test);
+        }
+    }
+    std::sort(selected.begin(), selected.end(), [](const TestCase* a, const TestCase* b) {
+        return a->name < b->name;
+    });
+
+    if (options.list_only) {
+        for (const TestCase* test : selected) {
+            std::printf("%s\n", test->name.c_str());
+        }
+        return true;
+    }
+
+    size_t jobs = options.jobs > 0 ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::max<size_t>(1, std::min(jobs, selected.size()));
+    std::vector<KmodTestResult> outcomes(selected.size());
+    std::atomic<size_t> next_test{0};
+    std::mutex print_lock;
+    auto start = std::chrono::steady_clock::now();
+
+    std::printf("Running %zu kernel module tests on %zu %s...\n",
+                selected.size(),
+                jobs,
+                jobs == 1 ? "thread" : "threads");
+    auto work = [&]() {
+        for (size_t i = next_test++; i < selected.size(); i = next_test++) {
+            KmodTestResult& result = outcomes[i];
+            result.name = selected[i]->name;
+            auto test_start = std::chrono::steady_clock::now();
+            try {
+                result.passed = selected[i]->test_func();
+            } catch (const std::exception& error) {
+                result.message = std::string("exception: ") + error.what();
+            } catch (...) {
+                result.message = "unknown exception";
+            }
+            result.duration = std::chrono::steady_clock::now() - test_start;
+
+            std::lock_guard<std::mutex> lock(print_lock);
+            std::printf("  %s... %s (%s)%s%s\n",
+                        result.name.c_str(),
+                        result.passed ? "PASSED" : "FAILED",
+                        format_ms(result.duration).c_str(),
+                        result.message.empty() ? "" : ": ",
+                        result.message.c_str());
+            std::fflush(stdout);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < jobs; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    size_t passed = static_cast<size_t>(std::count_if(outcomes.begin(), outcomes.end(), [](const KmodTestResult& r) {
+        return r.passed;
+    }));
+    for (const auto& name : duplicates) {
+        std::printf("  %s: registered more than once\n", name.c_str());
+    }
+    std::printf("\nKernel module test results:\n");
+    std::printf("  Passed: %zu\n", passed);
+    std::printf("  Failed: %zu\n", outcomes.size() - passed);
+    std::printf("  Wall:   %s\n", format_ms(std::chrono::steady_clock::now() - start).c_str());
+
+    bool all_passed = passed == outcomes.size() && duplicates.empty();
+    if (results) {
+        *results = std::move(outcomes);
+    }
+    return all_passed;
+}
+
+/* Benchmarks go through run_bench_suite_main(), which takes the same options as the C test binaries' --bench. */
+int KernelModuleTester::run_benches(int argc, char** argv) {
+    std::vector<BenchEntry> sorted = benches;
+    std::sort(sorted.begin(), sorted.end(), [](const BenchEntry& a, const BenchEntry& b) {
+        return a.name < b.name;
+    });
+
+    std::vector<BenchCase> cases;
+    for (const auto& bench : sorted) {
+        cases.push_back({bench.name.c_str(), bench.bench_func});
+    }
+    if (!duplicates.empty()) {
+        std::fprintf(stderr, "%s: registered more than once\n", duplicates.front().c_str());
+        return 2;
+    }
+    return run_bench_suite_main(cases.data(), static_cast<int>(cases.size()), argc, argv);
+}
+
+int KernelModuleTester::run_main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        return run_benches(argc, argv);
+    }
+
+    KmodRunOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "--jobs" || arg == "-j") && i + 1 < argc) {
+            if (!parse_jobs(argv[++i], options.jobs)) {
+                std::fprintf(stderr, "%s expects a positive count\n", arg.c_str());
+                print_usage(argv[0]);
+                return 2;
+            }
+        } else if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (arg == "--list") {
+            options.list_only = true;
+        } else {
+            print_usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 2;
+        }
+    }
+    return run_all_tests(options) ? 0 : 1;
+}
@@ -1,30 +1,83 @@
 #ifndef OS_KMOD_TEST_HPP
 #define OS_KMOD_TEST_HPP
 
+#include <chrono>
 #include <vector>
 #include <functional>
 #include <string>
 
+#include "test_framework.h"
+
+/*
+ * Static-registration tests and benchmarks for the C++ code.
+ *
+ * KMOD_TEST and KMOD_BENCH register from static initialisers, possibly in
+ * several translation units whose initialisation order is unspecified, so
+ * instance() is a function-local static that exists before the first
+ * registration, and the runner sorts by name: the run order and the report
+ * do not depend on link order. A name registered twice fails the run.
+ *
+ * Tests run in parallel on worker threads, in-process, and return true to
+ * pass; an exception fails the test with its message. Benchmarks are
+ * handed to the C benchmark runner in test_framework.c, so they get the
+ * same iteration scaling, percentiles and --baseline comparison as
+ * BENCH_CASE, with BenchState, bench_reset_timer() and BENCH_KEEP.
+ */
+struct KmodTestResult {
+    std::string name;
+    bool passed = false;
+    std::chrono::nanoseconds duration{0};
+    std::string message;
+};
+
+struct KmodRunOptions {
+    unsigned jobs = 0; // 0: one per hardware thread
+    std::string filter; // comma-separated globs or substrings, as in test_framework
+    bool list_only = false;
+};
+
 class KernelModuleTester {
 public:
-    void register_test(const std::string& name, std::function<bool()> test);
+    static KernelModuleTester& instance();
+
+    bool register_test(const std::string& name, std::function<bool()> test);
+    bool register_bench(const std::string& name, void (*bench)(BenchState* bench));
+
     bool run_all_tests();
-    
+    bool run_all_tests(const KmodRunOptions& options, std::vector<KmodTestResult>* results = nullptr);
+    int run_benches(int argc, char** argv);
+
+    // Runs the benchmarks when argv[1] is --bench, the tests otherwise; returns the exit code.
+    int run_main(int argc, char** argv);
+
 private:
+    KernelModuleTester() = default;
+
     struct TestCase {
         std::string name;
         std::function<bool()> test_func;
     };
-    
+
+    struct BenchEntry {
+        std::string name;
+        void (*bench_func)(BenchState* bench);
+    };
+
     std::vector<TestCase> tests;
+    std::vector<BenchEntry> benches;
+    std::vector<std::string> duplicates;
 };
 
 #define KMOD_TEST(name) \
 bool name##_test(); \
-static bool name##_registered = []() { \
+[[maybe_unused]] static const bool name##_registered = \
     KernelModuleTester::instance().register_test(#name, name##_test); \
-    return true; \
-}(); \
 bool name##_test()
 
+#define KMOD_BENCH(name) \
+void name##_bench(BenchState* bench); \
+[[maybe_unused]] static const bool name##_bench_registered = \
+    KernelModuleTester::instance().register_bench(#name, name##_bench); \
+void name##_bench(BenchState* bench)
+
 #endif // OS_KMOD_TEST_HPP
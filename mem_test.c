@@ -1,10 +1,18 @@
+#define _GNU_SOURCE
+
 #include "mem_test.h"
+#include <execinfo.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
-static size_t allocated_bytes = 0;
-static int tracking_enabled = 0;
+static atomic_size_t allocated_bytes = 0;
+static atomic_int tracking_enabled = 0;
 
 void* test_malloc(size_t size) {
     size_t total_size = size + sizeof(size_t);
@@ -14,8 +22,8 @@ void* test_malloc(size_t size) {
     }
 
     memcpy(raw, &size, sizeof(size_t));
-    if (tracking_enabled) {
-        allocated_bytes += size;
+    if (atomic_load(&tracking_enabled)) {
+        atomic_fetch_add(&allocated_bytes, size);
     }
     return raw + sizeof(size_t);
 }
@@ -28,31 +36,376 @@ void test_free(void* ptr) {
     unsigned char* raw = (unsigned char*)ptr - sizeof(size_t);
     size_t size = 0;
     memcpy(&size, raw, sizeof(size_t));
-    if (tracking_enabled) {
-        if (allocated_bytes >= size) {
-            allocated_bytes -= size;
-        } else {
-            allocated_bytes = 0;
+    if (atomic_load(&tracking_enabled)) {
+        size_t current = atomic_load(&allocated_bytes);
+        while (!atomic_compare_exchange_weak(&allocated_bytes, &current, current >= size ? current - size : 0)) {
         }
     }
     free(raw);
 }
 
 void enable_memory_tracking() {
-    tracking_enabled = 1;
+    atomic_store(&tracking_enabled, 1);
 }
 
 void disable_memory_tracking() {
-    tracking_enabled = 0;
+    atomic_store(&tracking_enabled, 0);
 }
 
 size_t get_allocated_bytes() {
-    return allocated_bytes;
+    return atomic_load(&allocated_bytes);
 }
 
 void check_for_leaks() {
-    if (allocated_bytes > 0) {
-        fprintf(stderr, "Memory leak detected: %zu bytes not freed\n", allocated_bytes);
+    size_t leaked = atomic_load(&allocated_bytes);
+    if (leaked > 0) {
+        fprintf(stderr, "Memory leak detected: %zu bytes not freed\n", leaked);
         exit(EXIT_FAILURE);
     }
 }
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+void* __wrap_malloc(size_t size);
+void* __wrap_calloc(size_t count, size_t size);
+void* __wrap_realloc(void* ptr, size_t size);
+void __wrap_free(void* ptr);
+
+typedef struct {
+    AllocCounters counters;
+    long long scope_peak;
+    unsigned sample_countdown;
+    bool in_hook;
+} ThreadAllocState;
+
+static _Thread_local ThreadAllocState thread_state;
+
+static atomic_ullong total_allocations;
+static atomic_ullong total_reallocations;
+static atomic_ullong total_frees;
+static atomic_ullong total_bytes_allocated;
+static atomic_llong total_in_use;
+static atomic_llong total_peak;
+static atomic_uint sample_period;
+
+/*
+ * Blocks the wrappers handed out, keyed by address. Frees of anything else
+ * (memory libc allocated internally, such as strdup() or getline() buffers)
+ * are passed through uncounted. Slots go from empty to an address to a
+ * tombstone and are reused from there, never emptied again, so a lookup can
+ * stop at the first empty slot. Lock free, so the wrappers stay safe in a
+ * child forked while another thread was allocating.
+ */
+enum { TRACKED_CAPACITY = 1 << 16, TRACKED_PROBES = 64 };
+#define TRACKED_TOMBSTONE ((uintptr_t)1)
+
+typedef struct {
+    atomic_uintptr_t address;
+    long long bytes;
+} TrackedBlock;
+
+static TrackedBlock tracked_blocks[TRACKED_CAPACITY];
+
+static pthread_mutex_t sites_lock = PTHREAD_MUTEX_INITIALIZER;
+static AllocSite sites[MEM_TEST_MAX_SITES];
+static unsigned long long dropped_samples;
+
+static void raise_peak(atomic_llong* peak, long long value) {
+    long long current = atomic_load_explicit(peak, memory_order_relaxed);
+    while (value > current &&
+           !atomic_compare_exchange_weak_explicit(peak, &current, value, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+static uint64_t hash_frames(void* const* frames, int depth) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (int i = 0; i < depth; i++) {
+        hash = (hash ^ (uint64_t)(uintptr_t)frames[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static size_t tracked_home(const void* ptr) {
+    return (size_t)((((uintptr_t)ptr >> 4) * 11400714819323198485ULL) >> 48) & (TRACKED_CAPACITY - 1);
+}
+
+/* Returns false when every slot within TRACKED_PROBES of the home slot is taken. */
+static bool track_block(void* ptr, long long bytes) {
+    size_t home = tracked_home(ptr);
+    for (size_t probe = 0; probe < TRACKED_PROBES; probe++) {
+        TrackedBlock* block = &tracked_blocks[(home + probe) & (TRACKED_CAPACITY - 1)];
+        uintptr_t current = atomic_load_explicit(&block->address, memory_order_relaxed);
+        if ((current == 0 || current == TRACKED_TOMBSTONE) &&
+            atomic_compare_exchange_strong_explicit(&block->address, &current, (uintptr_t)ptr,
+                                                    memory_order_acquire, memory_order_relaxed)) {
+            block->bytes = bytes;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Returns the bytes recorded for ptr and forgets it, or -1 if the wrappers did not hand it out. */
+static long long untrack_block(void* ptr) {
+    size_t home = tracked_home(ptr);
+    for (size_t probe = 0; probe < TRACKED_PROBES; probe++) {
+        TrackedBlock* block = &tracked_blocks[(home + probe) & (TRACKED_CAPACITY - 1)];
+        uintptr_t current = atomic_load_explicit(&block->address, memory_order_relaxed);
+        if (current == 0) {
+            return -1;
+        }
+        if (current == (uintptr_t)ptr) {
+            long long bytes = block->bytes;
+            atomic_store_explicit(&block->address, TRACKED_TOMBSTONE, memory_order_release);
+            return bytes;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Called with in_hook set, so allocations made by backtrace() itself are
+ * not counted. Kept out of line with note_allocation() so the frames to
+ * skip before the caller are always these two and the wrapper.
+ */
+__attribute__((noinline)) static void record_site(size_t bytes) {
+    enum { SKIPPED_FRAMES = 3 };
+    void* frames[MEM_TEST_STACK_DEPTH + SKIPPED_FRAMES];
+    int depth = backtrace(frames, MEM_TEST_STACK_DEPTH + SKIPPED_FRAMES);
+
+    depth = depth > SKIPPED_FRAMES ? depth - SKIPPED_FRAMES : 0;
+    void** caller = frames + SKIPPED_FRAMES;
+    size_t slot = (size_t)(hash_frames(caller, depth) % MEM_TEST_MAX_SITES);
+
+    pthread_mutex_lock(&sites_lock);
+    for (size_t probe = 0; probe < MEM_TEST_MAX_SITES; probe++) {
+        AllocSite* site = &sites[(slot + probe) % MEM_TEST_MAX_SITES];
+        if (site->samples == 0) {
+            memcpy(site->frames, caller, (size_t)depth * sizeof(void*));
+            site->depth = depth;
+        } else if (site->depth != depth || memcmp(site->frames, caller, (size_t)depth * sizeof(void*)) != 0) {
+            continue;
+        }
+        site->samples++;
+        site->bytes += bytes;
+        pthread_mutex_unlock(&sites_lock);
+        return;
+    }
+    dropped_samples++;
+    pthread_mutex_unlock(&sites_lock);
+}
+
+__attribute__((noinline)) static void note_allocation(void* ptr, size_t requested, bool reallocation) {
+    ThreadAllocState* state = &thread_state;
+    if (!ptr || state->in_hook) {
+        return;
+    }
+
+    long long bytes = (long long)malloc_usable_size(ptr);
+    if (reallocation) {
+        state->counters.reallocations++;
+        atomic_fetch_add_explicit(&total_reallocations, 1, memory_order_relaxed);
+    } else {
+        state->counters.allocations++;
+        atomic_fetch_add_explicit(&total_allocations, 1, memory_order_relaxed);
+    }
+    state->counters.bytes_allocated += (unsigned long long)bytes;
+    atomic_fetch_add_explicit(&total_bytes_allocated, (unsigned long long)bytes, memory_order_relaxed);
+    if (!track_block(ptr, bytes)) {
+        bytes = 0;
+    }
+    state->counters.bytes_in_use += bytes;
+    if (state->counters.bytes_in_use > state->counters.peak_bytes) {
+        state->counters.peak_bytes = state->counters.bytes_in_use;
+    }
+    if (state->counters.bytes_in_use > state->scope_peak) {
+        state->scope_peak = state->counters.bytes_in_use;
+    }
+    raise_peak(&total_peak, atomic_fetch_add_explicit(&total_in_use, bytes, memory_order_relaxed) + bytes);
+
+    unsigned period = atomic_load_explicit(&sample_period, memory_order_relaxed);
+    if (period > 0 && (state->sample_countdown == 0 || --state->sample_countdown == 0)) {
+        state->sample_countdown = period;
+        state->in_hook = true;
+        record_site(requested);
+        state->in_hook = false;
+    }
+}
+
+static void release_bytes(long long bytes, bool count_free) {
+    ThreadAllocState* state = &thread_state;
+    if (bytes < 0) {
+        return;
+    }
+
+    if (count_free) {
+        state->counters.frees++;
+        atomic_fetch_add_explicit(&total_frees, 1, memory_order_relaxed);
+    }
+    state->counters.bytes_in_use -= bytes;
+    atomic_fetch_sub_explicit(&total_in_use, bytes, memory_order_relaxed);
+}
+
+void* __wrap_malloc(size_t size) {
+    void* ptr = __real_malloc(size);
+    note_allocation(ptr, size, false);
+    return ptr;
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    void* ptr = __real_calloc(count, size);
+    note_allocation(ptr, count * size, false);
+    return ptr;
+}
+
+/*
+ * realloc(NULL, n) counts as an allocation and realloc(p, 0) that frees as a
+ * free. The old block is forgotten before the real call, since once it moves
+ * another thread may be handed the same address.
+ */
+void* __wrap_realloc(void* ptr, size_t size) {
+    if (!ptr) {
+        void* allocated = __real_realloc(NULL, size);
+        note_allocation(allocated, size, false);
+        return allocated;
+    }
+
+    long long old_bytes = untrack_block(ptr);
+    void* grown = __real_realloc(ptr, size);
+    if (grown) {
+        release_bytes(old_bytes, false);
+        note_allocation(grown, size, true);
+    } else if (size == 0) {
+        release_bytes(old_bytes, true);
+    } else if (old_bytes >= 0) {
+        track_block(ptr, old_bytes);
+    }
+    return grown;
+}
+
+/* Only blocks the wrappers handed out are counted; see tracked_blocks. */
+void __wrap_free(void* ptr) {
+    if (ptr) {
+        release_bytes(untrack_block(ptr), true);
+    }
+    __real_free(ptr);
+}
+
+void alloc_thread_counters(AllocCounters* out) {
+    *out = thread_state.counters;
+}
+
+void alloc_profile_totals(AllocCounters* out) {
+    out->allocations = atomic_load(&total_allocations);
+    out->reallocations = atomic_load(&total_reallocations);
+    out->frees = atomic_load(&total_frees);
+    out->bytes_allocated = atomic_load(&total_bytes_allocated);
+    out->bytes_in_use = atomic_load(&total_in_use);
+    out->peak_bytes = atomic_load(&total_peak);
+}
+
+void alloc_scope_begin(AllocScope* scope) {
+    memset(scope, 0, sizeof(*scope));
+    scope->start = thread_state.counters;
+    scope->outer_peak = thread_state.scope_peak;
+    thread_state.scope_peak = thread_state.counters.bytes_in_use;
+}
+
+/**
+ * Stores the thread's activity since alloc_scope_begin() in
+ * scope->counters, and in scope->peak_bytes the highest bytes in use above
+ * the level at begin.
+ */
+void alloc_scope_end(AllocScope* scope) {
+    const AllocCounters* now = &thread_state.counters;
+
+    scope->counters.allocations = now->allocations - scope->start.allocations;
+    scope->counters.reallocations = now->reallocations - scope->start.reallocations;
+    scope->counters.frees = now->frees - scope->start.frees;
+    scope->counters.bytes_allocated = now->bytes_allocated - scope->start.bytes_allocated;
+    scope->counters.bytes_in_use = now->bytes_in_use - scope->start.bytes_in_use;
+    scope->peak_bytes = thread_state.scope_peak - scope->start.bytes_in_use;
+    scope->counters.peak_bytes = scope->peak_bytes;
+    if (scope->outer_peak > thread_state.scope_peak) {
+        thread_state.scope_peak = scope->outer_peak;
+    }
+}
+
+/**
+ * Samples the call stack of every period-th allocation on each thread;
+ * 0 stops sampling. The first call loads the unwinder, which allocates.
+ */
+void alloc_profile_set_sample_period(unsigned period) {
+    if (period > 0) {
+        void* frame[1];
+        thread_state.in_hook = true;
+        backtrace(frame, 1);
+        thread_state.in_hook = false;
+    }
+    thread_state.sample_countdown = 0;
+    atomic_store(&sample_period, period);
+}
+
+static int compare_sites(const void* a, const void* b) {
+    const AllocSite* x = a;
+    const AllocSite* y = b;
+    return (x->samples < y->samples) - (x->samples > y->samples);
+}
+
+/**
+ * Copies the sampled call sites, most sampled first.
+ *
+ * @return Number of sites written.
+ */
+size_t alloc_profile_sites(AllocSite* out, size_t capacity) {
+    size_t count = 0;
+
+    pthread_mutex_lock(&sites_lock);
+    for (size_t i = 0; i < MEM_TEST_MAX_SITES; i++) {
+        if (sites[i].samples == 0) {
+            continue;
+        }
+        if (count < capacity) {
+            out[count] = sites[i];
+        }
+        count++;
+    }
+    pthread_mutex_unlock(&sites_lock);
+
+    count = count < capacity ? count : capacity;
+    qsort(out, count, sizeof(AllocSite), compare_sites);
+    return count;
+}
+
+/* Symbolizes with backtrace_symbols_fd(), which does not allocate; link with -rdynamic for names. */
+void alloc_profile_report(FILE* out, size_t top) {
+    AllocSite ranked[MEM_TEST_MAX_SITES];
+    AllocCounters totals;
+    size_t count = alloc_profile_sites(ranked, MEM_TEST_MAX_SITES);
+
+    alloc_profile_totals(&totals);
+    fprintf(out,
+            "Allocations: %llu (+%llu reallocs), frees: %llu, %llu bytes, peak %lld in use\n",
+            totals.allocations,
+            totals.reallocations,
+            totals.frees,
+            totals.bytes_allocated,
+            totals.peak_bytes);
+    for (size_t i = 0; i < count && i < top; i++) {
+        fprintf(out, "  site %zu: %llu samples, %llu bytes\n", i + 1, ranked[i].samples, ranked[i].bytes);
+        fflush(out);
+        backtrace_symbols_fd(ranked[i].frames, ranked[i].depth, fileno(out));
+    }
+    if (dropped_samples > 0) {
+        fprintf(out, "  %llu samples dropped: site table full\n", dropped_samples);
+    }
+}
+
+void alloc_profile_reset_sites(void) {
+    pthread_mutex_lock(&sites_lock);
+    memset(sites, 0, sizeof(sites));
+    dropped_samples = 0;
+    pthread_mutex_unlock(&sites_lock);
+}
@@ -2,6 +2,7 @@
 #define OS_MEM_TEST_H
 
 #include <stddef.h>
+#include <stdio.h>
 
 void* test_malloc(size_t size);
 void test_free(void* ptr);
@@ -10,4 +11,65 @@ void disable_memory_tracking();
 size_t get_allocated_bytes();
 void check_for_leaks();
 
+/*
+ * Allocation profiler. Binaries linked with
+ *   -Wl,--wrap=malloc,--wrap=free,--wrap=calloc,--wrap=realloc
+ * route every heap call made from their own objects (including static
+ * libraries such as server_monitor_lib) through mem_test.c, which counts
+ * it per thread and process-wide before calling the real allocator, so the
+ * profiler stacks on top of ASan. Calls made inside libc itself (fopen,
+ * strdup, ...) are not seen, and freeing such memory is not counted either:
+ * only blocks the wrappers handed out are. Sizes are malloc_usable_size(),
+ * so bytes freed on another thread can leave a thread's bytes_in_use
+ * negative.
+ *
+ * With a non-zero sample period, every Nth allocation on a thread records
+ * its call stack into a small table of sites.
+ */
+#define MEM_TEST_STACK_DEPTH 8
+#define MEM_TEST_MAX_SITES 128
+
+typedef struct {
+    unsigned long long allocations;
+    unsigned long long reallocations;
+    unsigned long long frees;
+    unsigned long long bytes_allocated;
+    long long bytes_in_use;
+    long long peak_bytes;
+} AllocCounters;
+
+/* Counts the calling thread's heap activity between begin and end. Scopes nest. */
+typedef struct {
+    AllocCounters counters;
+    long long peak_bytes;
+    AllocCounters start;
+    long long outer_peak;
+} AllocScope;
+
+typedef struct {
+    void* frames[MEM_TEST_STACK_DEPTH];
+    int depth;
+    unsigned long long samples;
+    unsigned long long bytes;
+} AllocSite;
+
+void alloc_scope_begin(AllocScope* scope);
+void alloc_scope_end(AllocScope* scope);
+void alloc_thread_counters(AllocCounters* out);
+void alloc_profile_totals(AllocCounters* out);
+void alloc_profile_set_sample_period(unsigned period);
+size_t alloc_profile_sites(AllocSite* out, size_t capacity);
+void alloc_profile_report(FILE* out, size_t top);
+void alloc_profile_reset_sites(void);
+
+/* For test_framework.h tests: fails unless statement allocates nothing on this thread. */
+#define ASSERT_NO_ALLOCATIONS(statement) \
+    do { \
+        AllocScope alloc_scope_; \
+        alloc_scope_begin(&alloc_scope_); \
+        statement; \
+        alloc_scope_end(&alloc_scope_); \
+        ASSERT(alloc_scope_.counters.allocations == 0 && alloc_scope_.counters.reallocations == 0); \
+    } while (0)
+
 #endif // OS_MEM_TEST_H
@@ -1,28 +1,56 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "monitor.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 enum {
-    CPU_FIELD_COUNT = 10
+    CPU_FIELD_COUNT = 10,
+    CPU_LINE_SIZE = 256,
+    MEMINFO_BUFFER_SIZE = 8192,
+    MEMINFO_TABLE_SIZE = 64
 };
 
 static const double KILOBYTES_PER_GIGABYTE = 1024.0 * 1024.0;
 static const double MAX_USAGE_PERCENT = 100.0;
 
-static MonitorStatus read_cpu_fields(unsigned long long* fields, size_t count) {
-    FILE* file = fopen("/proc/stat", "r");
-    if (!file) {
-        return MONITOR_STATUS_IO_ERROR;
+const char* monitor_metric_name(MonitorMetric metric) {
+    switch (metric) {
+        case MONITOR_METRIC_CPU_PERCENT:
+            return "CPU Usage";
+        case MONITOR_METRIC_RAM_PERCENT:
+            return "RAM Usage";
+        case MONITOR_METRIC_RAM_USED_GB:
+            return "RAM Used (GB)";
+        default:
+            return "unknown";
     }
+}
 
-    int scanned = fscanf(file, "cpu  %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
+/* Field name used for the metric in config files and machine-readable output. */
+const char* monitor_metric_key(MonitorMetric metric) {
+    switch (metric) {
+        case MONITOR_METRIC_CPU_PERCENT:
+            return "cpu_percent";
+        case MONITOR_METRIC_RAM_PERCENT:
+            return "ram_percent";
+        case MONITOR_METRIC_RAM_USED_GB:
+            return "ram_used_gb";
+        default:
+            return "unknown";
+    }
+}
+
+static MonitorStatus parse_cpu_fields(const char* text, unsigned long long* fields, size_t count) {
+    int scanned = sscanf(text, "cpu  %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
                          &fields[0], &fields[1], &fields[2], &fields[3], &fields[4],
                          &fields[5], &fields[6], &fields[7], &fields[8], &fields[9]);
-    fclose(file);
-
     if (scanned < 4) {
-        return MONITOR_STATUS_PARSE_ERROR;
+        return monitor_error_set(MONITOR_STATUS_PARSE_ERROR, 0, "/proc/stat", 1, 0);
     }
 
     for (int i = scanned; i < (int)count; i++) {
@@ -32,28 +60,28 @@ static MonitorStatus read_cpu_fields(unsigned long long* fields, size_t count) {
     return MONITOR_STATUS_OK;
 }
 
-/**
- * Reads CPU usage as a percentage based on deltas from the previous sample.
- *
- * @param tracker CPU tracker storing the previous totals.
- * @param out_percent Receives the calculated CPU usage percentage.
- * @return MonitorStatus indicating success or error state.
- */
-MonitorStatus monitor_read_cpu_usage(CpuTracker* tracker, double* out_percent) {
-    unsigned long long fields[CPU_FIELD_COUNT] = {0};
-    unsigned long long total = 0ULL;
-    unsigned long long idle = 0ULL;
-    MonitorStatus status = MONITOR_STATUS_OK;
-
-    if (!tracker || !out_percent) {
-        return MONITOR_STATUS_INVALID_ARGUMENT;
+static MonitorStatus read_cpu_fields(unsigned long long* fields, size_t count) {
+    char line[CPU_LINE_SIZE];
+    FILE* file = fopen("/proc/stat", "r");
+    if (!file) {
+        return monitor_error_set(MONITOR_STATUS_IO_ERROR, errno, "/proc/stat", 0, -1);
     }
 
-    status = read_cpu_fields(fields, CPU_FIELD_COUNT);
-    if (status != MONITOR_STATUS_OK) {
-        return status;
+    char* read = fgets(line, sizeof(line), file);
+    int read_error = ferror(file) ? errno : 0;
+    fclose(file);
+    if (!read) {
+        return read_error ? monitor_error_set(MONITOR_STATUS_IO_ERROR, read_error, "/proc/stat", 1, 0)
+                          : monitor_error_set(MONITOR_STATUS_PARSE_ERROR, 0, "/proc/stat", 1, 0);
     }
 
+    return parse_cpu_fields(line, fields, count);
+}
+
+static MonitorStatus update_cpu_usage(CpuTracker* tracker, const unsigned long long* fields, double* out_percent) {
+    unsigned long long total = 0ULL;
+    unsigned long long idle = 0ULL;
+
     for (size_t i = 0; i < CPU_FIELD_COUNT; i++) {
         total += fields[i];
     }
@@ -90,69 +118,270 @@ MonitorStatus monitor_read_cpu_usage(CpuTracker* tracker, double* out_percent) {
 }
 
 /**
- * Reads system memory usage from /proc/meminfo.
+ * Reads CPU usage as a percentage based on deltas from the previous sample.
  *
- * @param usage Receives total, used, and percentage values in gigabytes.
+ * @param tracker CPU tracker storing the previous totals.
+ * @param out_percent Receives the calculated CPU usage percentage.
  * @return MonitorStatus indicating success or error state.
  */
-MonitorStatus monitor_read_memory_usage(MemoryUsage* usage) {
-    FILE* file = NULL;
-    char label[64] = {0};
-    unsigned long long value_kb = 0ULL;
-    unsigned long long total_kb = 0ULL;
-    unsigned long long available_kb = 0ULL;
-    unsigned long long free_kb = 0ULL;
-    unsigned long long buffers_kb = 0ULL;
-    unsigned long long cached_kb = 0ULL;
+MonitorStatus monitor_read_cpu_usage(CpuTracker* tracker, double* out_percent) {
+    unsigned long long fields[CPU_FIELD_COUNT] = {0};
 
-    if (!usage) {
+    if (!tracker || !out_percent) {
         return MONITOR_STATUS_INVALID_ARGUMENT;
     }
 
-    file = fopen("/proc/meminfo", "r");
-    if (!file) {
-        return MONITOR_STATUS_IO_ERROR;
-    }
-
-    while (fscanf(file, "%63s %llu kB", label, &value_kb) == 2) {
-        if (strcmp(label, "MemTotal:") == 0) {
-            total_kb = value_kb;
-        } else if (strcmp(label, "MemAvailable:") == 0) {
-            available_kb = value_kb;
-        } else if (strcmp(label, "MemFree:") == 0) {
-            free_kb = value_kb;
-        } else if (strcmp(label, "Buffers:") == 0) {
-            buffers_kb = value_kb;
-        } else if (strcmp(label, "Cached:") == 0) {
-            cached_kb = value_kb;
+    MonitorStatus status = read_cpu_fields(fields, CPU_FIELD_COUNT);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    return update_cpu_usage(tracker, fields, out_percent);
+}
+
+/**
+ * Same as monitor_read_cpu_usage() for /proc/stat contents that were
+ * already read, e.g. by a ReadBatch.
+ *
+ * @param tracker CPU tracker storing the previous totals.
+ * @param text NUL-terminated /proc/stat contents; only the first line is used.
+ * @param out_percent Receives the calculated CPU usage percentage.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_cpu_usage_from_stat(CpuTracker* tracker, const char* text, double* out_percent) {
+    unsigned long long fields[CPU_FIELD_COUNT] = {0};
+
+    if (!tracker || !text || !out_percent) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    MonitorStatus status = parse_cpu_fields(text, fields, CPU_FIELD_COUNT);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    return update_cpu_usage(tracker, fields, out_percent);
+}
+
+typedef struct {
+    const char* key;
+    size_t length;
+    size_t offset;
+} MeminfoKey;
+
+#define MEMINFO_KEY(name, field) {name, sizeof(name) - 1, offsetof(MemoryBreakdown, field)}
+
+/*
+ * Perfect hash over the /proc/meminfo keys we keep. The slots below are the
+ * values of meminfo_hash() for each key; no two keys collide, so a lookup is
+ * one hash and one memcmp. Keys outside the set hash to an empty slot or fail
+ * the compare and are skipped.
+ */
+static const MeminfoKey MEMINFO_KEYS[MEMINFO_TABLE_SIZE] = {
+    [1] = MEMINFO_KEY("SUnreclaim", slab_unreclaimable_kb),
+    [3] = MEMINFO_KEY("AnonHugePages", anon_huge_pages_kb),
+    [6] = MEMINFO_KEY("Hugetlb", hugetlb_kb),
+    [7] = MEMINFO_KEY("Cached", cached_kb),
+    [9] = MEMINFO_KEY("SwapFree", swap_free_kb),
+    [11] = MEMINFO_KEY("MemFree", free_kb),
+    [14] = MEMINFO_KEY("Buffers", buffers_kb),
+    [20] = MEMINFO_KEY("Dirty", dirty_kb),
+    [24] = MEMINFO_KEY("SReclaimable", slab_reclaimable_kb),
+    [25] = MEMINFO_KEY("SwapTotal", swap_total_kb),
+    [26] = MEMINFO_KEY("HugePages_Rsvd", huge_pages_reserved),
+    [27] = MEMINFO_KEY("MemTotal", total_kb),
+    [28] = MEMINFO_KEY("MemAvailable", available_kb),
+    [34] = MEMINFO_KEY("Active", active_kb),
+    [35] = MEMINFO_KEY("Slab", slab_kb),
+    [37] = MEMINFO_KEY("Writeback", writeback_kb),
+    [39] = MEMINFO_KEY("HugePages_Free", huge_pages_free),
+    [43] = MEMINFO_KEY("Mapped", mapped_kb),
+    [47] = MEMINFO_KEY("SwapCached", swap_cached_kb),
+    [49] = MEMINFO_KEY("Committed_AS", committed_as_kb),
+    [51] = MEMINFO_KEY("Shmem", shmem_kb),
+    [53] = MEMINFO_KEY("CommitLimit", commit_limit_kb),
+    [54] = MEMINFO_KEY("Inactive", inactive_kb),
+    [55] = MEMINFO_KEY("HugePages_Total", huge_pages_total),
+    [56] = MEMINFO_KEY("Hugepagesize", huge_page_size_kb),
+    [57] = MEMINFO_KEY("ShmemHugePages", shmem_huge_pages_kb),
+    [59] = MEMINFO_KEY("AnonPages", anon_pages_kb),
+    [62] = MEMINFO_KEY("HugePages_Surp", huge_pages_surplus),
+};
+
+static size_t meminfo_hash(const char* key, size_t length) {
+    size_t first = (unsigned char)key[0];
+    size_t last = (unsigned char)key[length - 1];
+    size_t penultimate = (unsigned char)key[length - 2];
+    return (length * 2 + first * 10 + last * 30 + penultimate) & (MEMINFO_TABLE_SIZE - 1);
+}
+
+static unsigned long long* meminfo_field(MemoryBreakdown* out, const char* key, size_t length) {
+    if (length < 2) {
+        return NULL;
+    }
+
+    const MeminfoKey* entry = &MEMINFO_KEYS[meminfo_hash(key, length)];
+    if (entry->length != length || memcmp(entry->key, key, length) != 0) {
+        return NULL;
+    }
+
+    return (unsigned long long*)(void*)((char*)out + entry->offset);
+}
+
+/* Points the error at the MemTotal value, or at the end of the text when the line is missing. */
+MONITOR_COLD static MonitorStatus meminfo_total_error(const char* text, size_t length) {
+    static const char key[] = "MemTotal:";
+    const char* position = text + length;
+
+    for (const char* cursor = text; cursor + sizeof(key) - 1 <= text + length; cursor++) {
+        if ((cursor == text || cursor[-1] == '\n') && memcmp(cursor, key, sizeof(key) - 1) == 0) {
+            position = cursor + sizeof(key) - 1;
+            while (position < text + length && *position == ' ') {
+                position++;
+            }
+            break;
+        }
+    }
+    return monitor_error_set_at(MONITOR_STATUS_PARSE_ERROR, "/proc/meminfo", text, position);
+}
+
+/**
+ * Parses /proc/meminfo text in a single pass.
+ *
+ * Each "Key: value [kB]" line is looked up through a perfect hash, so the
+ * cost does not grow with the number of fields kept.
+ *
+ * @param text meminfo contents (need not be NUL-terminated).
+ * @param length Number of bytes in text.
+ * @param out Receives the parsed fields; missing keys are left at zero.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_parse_meminfo(const char* text, size_t length, MemoryBreakdown* out) {
+    if (!text || !out) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    memset(out, 0, sizeof(*out));
+
+    const char* cursor = text;
+    const char* end = text + length;
+    while (cursor < end) {
+        const char* line_end = memchr(cursor, '\n', (size_t)(end - cursor));
+        if (!line_end) {
+            line_end = end;
         }
 
-        if (total_kb > 0 && available_kb > 0) {
+        const char* colon = memchr(cursor, ':', (size_t)(line_end - cursor));
+        unsigned long long* field = colon ? meminfo_field(out, cursor, (size_t)(colon - cursor)) : NULL;
+        if (field) {
+            const char* digit = colon + 1;
+            unsigned long long value = 0ULL;
+            while (digit < line_end && *digit == ' ') {
+                digit++;
+            }
+            while (digit < line_end && *digit >= '0' && *digit <= '9') {
+                value = value * 10ULL + (unsigned long long)(*digit - '0');
+                digit++;
+            }
+            *field = value;
+        }
+
+        cursor = line_end + 1;
+    }
+
+    return out->total_kb > 0 ? MONITOR_STATUS_OK : meminfo_total_error(text, length);
+}
+
+/**
+ * Reads and parses /proc/meminfo with a single read into a stack buffer.
+ *
+ * @param out Receives the parsed fields.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_read_memory_breakdown(MemoryBreakdown* out) {
+    char buffer[MEMINFO_BUFFER_SIZE];
+    size_t length = 0;
+
+    if (!out) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    int fd = open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return monitor_error_set(MONITOR_STATUS_IO_ERROR, errno, "/proc/meminfo", 0, -1);
+    }
+
+    int read_error = 0;
+    while (length < sizeof(buffer)) {
+        ssize_t count = read(fd, buffer + length, sizeof(buffer) - length);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            read_error = count < 0 ? errno : 0;
             break;
         }
+        length += (size_t)count;
     }
+    close(fd);
 
-    fclose(file);
+    if (length == 0) {
+        return monitor_error_set(MONITOR_STATUS_IO_ERROR, read_error, "/proc/meminfo", 0, 0);
+    }
+
+    return monitor_parse_meminfo(buffer, length, out);
+}
+
+/**
+ * Derives used/total/percentage figures from a meminfo breakdown.
+ *
+ * Falls back to MemFree + Buffers + Cached on kernels without MemAvailable.
+ *
+ * @param breakdown Parsed meminfo fields.
+ * @param usage Receives total, used, and percentage values in gigabytes.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_memory_usage_from_breakdown(const MemoryBreakdown* breakdown, MemoryUsage* usage) {
+    if (!breakdown || !usage) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
 
-    if (available_kb == 0 && (free_kb > 0 || buffers_kb > 0 || cached_kb > 0)) {
-        available_kb = free_kb + buffers_kb + cached_kb;
+    unsigned long long total_kb = breakdown->total_kb;
+    unsigned long long available_kb = breakdown->available_kb;
+    if (available_kb == 0) {
+        available_kb = breakdown->free_kb + breakdown->buffers_kb + breakdown->cached_kb;
     }
 
     if (total_kb == 0 || available_kb == 0 || available_kb > total_kb) {
-        return MONITOR_STATUS_PARSE_ERROR;
+        return monitor_error_set(MONITOR_STATUS_PARSE_ERROR, 0, "/proc/meminfo", 0, -1);
     }
 
     double total_gb = (double)total_kb / KILOBYTES_PER_GIGABYTE;
     double available_gb = (double)available_kb / KILOBYTES_PER_GIGABYTE;
-    if (total_gb <= 0.0) {
-        return MONITOR_STATUS_PARSE_ERROR;
-    }
     double used_gb = total_gb - available_gb;
-    double usage_percent = (used_gb / total_gb) * MAX_USAGE_PERCENT;
 
     usage->total_gb = total_gb;
     usage->used_gb = used_gb;
-    usage->usage_percent = usage_percent;
+    usage->usage_percent = (used_gb / total_gb) * MAX_USAGE_PERCENT;
 
     return MONITOR_STATUS_OK;
 }
+
+/**
+ * Reads system memory usage from /proc/meminfo.
+ *
+ * @param usage Receives total, used, and percentage values in gigabytes.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_read_memory_usage(MemoryUsage* usage) {
+    MemoryBreakdown breakdown;
+
+    if (!usage) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    MonitorStatus status = monitor_read_memory_breakdown(&breakdown);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+
+    return monitor_memory_usage_from_breakdown(&breakdown, usage);
+}
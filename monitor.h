@@ -2,6 +2,7 @@
 #define MONITOR_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "monitor_status.h"
 
@@ -21,8 +22,57 @@ typedef struct {
     double usage_percent;
 } MemoryUsage;
 
+/*
+ * Full /proc/meminfo breakdown. Values are in kilobytes except the
+ * huge_pages_* counters, which are page counts.
+ */
+typedef struct {
+    unsigned long long total_kb;
+    unsigned long long free_kb;
+    unsigned long long available_kb;
+    unsigned long long buffers_kb;
+    unsigned long long cached_kb;
+    unsigned long long swap_cached_kb;
+    unsigned long long active_kb;
+    unsigned long long inactive_kb;
+    unsigned long long swap_total_kb;
+    unsigned long long swap_free_kb;
+    unsigned long long dirty_kb;
+    unsigned long long writeback_kb;
+    unsigned long long anon_pages_kb;
+    unsigned long long mapped_kb;
+    unsigned long long shmem_kb;
+    unsigned long long slab_kb;
+    unsigned long long slab_reclaimable_kb;
+    unsigned long long slab_unreclaimable_kb;
+    unsigned long long commit_limit_kb;
+    unsigned long long committed_as_kb;
+    unsigned long long anon_huge_pages_kb;
+    unsigned long long shmem_huge_pages_kb;
+    unsigned long long huge_pages_total;
+    unsigned long long huge_pages_free;
+    unsigned long long huge_pages_reserved;
+    unsigned long long huge_pages_surplus;
+    unsigned long long huge_page_size_kb;
+    unsigned long long hugetlb_kb;
+} MemoryBreakdown;
+
+typedef enum {
+    MONITOR_METRIC_CPU_PERCENT = 0,
+    MONITOR_METRIC_RAM_PERCENT,
+    MONITOR_METRIC_RAM_USED_GB,
+    MONITOR_METRIC_COUNT
+} MonitorMetric;
+
+const char* monitor_metric_name(MonitorMetric metric);
+const char* monitor_metric_key(MonitorMetric metric);
+
 MonitorStatus monitor_read_cpu_usage(CpuTracker* tracker, double* out_percent);
+MonitorStatus monitor_cpu_usage_from_stat(CpuTracker* tracker, const char* text, double* out_percent);
 MonitorStatus monitor_read_memory_usage(MemoryUsage* usage);
+MonitorStatus monitor_parse_meminfo(const char* text, size_t length, MemoryBreakdown* out);
+MonitorStatus monitor_read_memory_breakdown(MemoryBreakdown* out);
+MonitorStatus monitor_memory_usage_from_breakdown(const MemoryBreakdown* breakdown, MemoryUsage* usage);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,241 @@
+#include "monitor_alert.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+MonitorStatus monitor_alert_engine_init(AlertEngine* engine, size_t capacity) {
+    if (!engine || capacity == 0) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    memset(engine, 0, sizeof(*engine));
+    engine->rules = calloc(capacity, sizeof(AlertRule));
+    engine->states = calloc(capacity, sizeof(AlertState));
+    if (!engine->rules || !engine->states) {
+        monitor_alert_engine_free(engine);
+        return MONITOR_STATUS_INTERNAL_ERROR;
+    }
+
+    engine->capacity = capacity;
+    return MONITOR_STATUS_OK;
+}
+
+void monitor_alert_engine_free(AlertEngine* engine) {
+    if (!engine) {
+        return;
+    }
+
+    free(engine->rules);
+    free(engine->states);
+    memset(engine, 0, sizeof(*engine));
+}
+
+/**
+ * Returns every rule to the OK state without touching the rule table.
+ *
+ * @param engine Engine to reset.
+ */
+void monitor_alert_engine_reset(AlertEngine* engine) {
+    if (!engine || !engine->states) {
+        return;
+    }
+
+    memset(engine->states, 0, engine->capacity * sizeof(AlertState));
+    engine->suppressed_notifications = 0;
+    engine->dropped_events = 0;
+}
+
+MonitorStatus monitor_alert_engine_add_rule(AlertEngine* engine, const AlertRule* rule, size_t* out_index) {
+    if (!engine || !rule) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (rule->critical_threshold < rule->warning_threshold || rule->hysteresis < 0.0 ||
+        rule->for_ms < 0 || rule->min_notify_interval_ms < 0) {
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+
+    if (engine->count >= engine->capacity) {
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+
+    engine->rules[engine->count] = *rule;
+    memset(&engine->states[engine->count], 0, sizeof(AlertState));
+    if (out_index) {
+        *out_index = engine->count;
+    }
+    engine->count++;
+    return MONITOR_STATUS_OK;
+}
+
+static AlertLevel target_level(const AlertRule* rule, AlertLevel current, double value) {
+    double critical_exit = rule->critical_threshold;
+    double warning_exit = rule->warning_threshold;
+
+    if (current == ALERT_LEVEL_CRITICAL) {
+        critical_exit -= rule->hysteresis;
+    }
+    if (current != ALERT_LEVEL_OK) {
+        warning_exit -= rule->hysteresis;
+    }
+
+    if (value > critical_exit) {
+        return ALERT_LEVEL_CRITICAL;
+    }
+    if (value > warning_exit) {
+        return ALERT_LEVEL_WARNING;
+    }
+    return ALERT_LEVEL_OK;
+}
+
+/**
+ * Evaluates every rule against the current sample values in a single pass.
+ * Escalations wait for the rule's for_ms window; de-escalations apply as soon
+ * as the value leaves the hysteresis band. A level reached while the rule's
+ * notification window is closed is reported on the first tick after it
+ * reopens, as a change from the level last notified.
+ *
+ * @param engine Engine holding the rule and state tables.
+ * @param values Current value per metric, indexed by AlertRule.metric.
+ * @param value_count Number of entries in values.
+ * @param now_ms Monotonic timestamp of this tick.
+ * @param events Receives notifications for state changes (may be NULL).
+ * @param event_capacity Number of entries available in events.
+ * @return Number of events written.
+ */
+size_t monitor_alert_engine_evaluate(AlertEngine* engine,
+                                     const double* values,
+                                     size_t value_count,
+                                     long long now_ms,
+                                     AlertEvent* events,
+                                     size_t event_capacity) {
+    size_t emitted = 0;
+
+    if (!engine || !values) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < engine->count; i++) {
+        const AlertRule* rule = &engine->rules[i];
+        AlertState* state = &engine->states[i];
+
+        if (rule->metric >= value_count || isnan(values[rule->metric])) {
+            continue;
+        }
+
+        double value = values[rule->metric];
+        AlertLevel current = (AlertLevel)state->level;
+        AlertLevel target = target_level(rule, current, value);
+        AlertLevel reached = target;
+
+        /* Each level's timer runs while the value stays at or above it, whatever it does in between. */
+        if (target <= current) {
+            state->pending = 0;
+            state->critical_pending = 0;
+        } else if (rule->for_ms > 0) {
+            if (!state->pending) {
+                state->pending = 1;
+                state->pending_since_ms = now_ms;
+            }
+            if (target != ALERT_LEVEL_CRITICAL) {
+                state->critical_pending = 0;
+            } else if (!state->critical_pending) {
+                state->critical_pending = 1;
+                state->critical_since_ms = now_ms;
+            }
+            reached = current;
+            if (now_ms - state->pending_since_ms >= rule->for_ms) {
+                reached = (AlertLevel)(current + 1);
+            }
+            if (state->critical_pending && now_ms - state->critical_since_ms >= rule->for_ms) {
+                reached = ALERT_LEVEL_CRITICAL;
+            }
+            /* Reaching WARNING leaves a CRITICAL still pending on its own timer. */
+            if (reached != current && reached < target) {
+                state->pending_since_ms = state->critical_since_ms;
+            }
+        }
+        bool changed = reached != current;
+        if (changed) {
+            state->level = (uint8_t)reached;
+            if (reached >= target) {
+                state->pending = 0;
+                state->critical_pending = 0;
+            }
+        }
+
+        if (state->level == state->notified_level) {
+            continue;
+        }
+        if (state->notified && now_ms - state->last_notified_ms < rule->min_notify_interval_ms) {
+            engine->suppressed_notifications += changed;
+            continue;
+        }
+        AlertLevel previous = (AlertLevel)state->notified_level;
+        state->notified = 1;
+        state->notified_level = state->level;
+        state->last_notified_ms = now_ms;
+
+        if (!events || emitted >= event_capacity) {
+            engine->dropped_events++;
+            continue;
+        }
+        events[emitted].rule_index = i;
+        events[emitted].previous_level = previous;
+        events[emitted].level = (AlertLevel)state->level;
+        events[emitted].value = value;
+        emitted++;
+    }
+
+    return emitted;
+}
+
+/**
+ * Gives a rule the level, pending timers and notification history of a rule
+ * in another engine, so a rebuilt rule set (a config reload) continues an
+ * active alert instead of dropping it to OK and raising it again.
+ *
+ * @param engine Engine receiving the state.
+ * @param rule_index Rule in engine.
+ * @param source Engine the state comes from.
+ * @param source_index Rule in source.
+ * @return MONITOR_STATUS_OK, INVALID_ARGUMENT for an unknown rule, or
+ *         UNSUPPORTED when the two rules watch different metrics.
+ */
+MonitorStatus monitor_alert_engine_carry_state(AlertEngine* engine,
+                                              size_t rule_index,
+                                              const AlertEngine* source,
+                                              size_t source_index) {
+    if (!engine || !source || rule_index >= engine->count || source_index >= source->count) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+    if (engine->rules[rule_index].metric != source->rules[source_index].metric) {
+        return MONITOR_STATUS_UNSUPPORTED;
+    }
+
+    engine->states[rule_index] = source->states[source_index];
+    return MONITOR_STATUS_OK;
+}
+
+AlertLevel monitor_alert_engine_level(const AlertEngine* engine, size_t rule_index) {
+    if (!engine || rule_index >= engine->count) {
+        return ALERT_LEVEL_OK;
+    }
+
+    return (AlertLevel)engine->states[rule_index].level;
+}
+
+const char* monitor_alert_level_name(AlertLevel level) {
+    switch (level) {
+        case ALERT_LEVEL_OK:
+            return "OK";
+        case ALERT_LEVEL_WARNING:
+            return "WARNING";
+        case ALERT_LEVEL_CRITICAL:
+            return "CRITICAL";
+        default:
+            return "UNKNOWN";
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef MONITOR_ALERT_H
+#define MONITOR_ALERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "monitor_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    ALERT_LEVEL_OK = 0,
+    ALERT_LEVEL_WARNING,
+    ALERT_LEVEL_CRITICAL
+} AlertLevel;
+
+/*
+ * A rule raises WARNING/CRITICAL when its metric exceeds the threshold for at
+ * least for_ms, and only clears once the value drops hysteresis below the
+ * threshold. A value swinging between WARNING and CRITICAL keeps counting
+ * toward WARNING; CRITICAL needs for_ms above its own threshold. Notifications for a rule are emitted at most once per
+ * min_notify_interval_ms; a change inside that window is counted on the
+ * engine as suppressed and reported once the window expires, if the level
+ * still differs from the one last notified.
+ */
+typedef struct {
+    uint32_t metric;
+    double warning_threshold;
+    double critical_threshold;
+    double hysteresis;
+    int for_ms;
+    int min_notify_interval_ms;
+} AlertRule;
+
+typedef struct {
+    long long pending_since_ms;  // since the value first went above level, while pending
+    long long critical_since_ms; // since the value first reached CRITICAL, while critical_pending
+    long long last_notified_ms;
+    uint8_t level;
+    uint8_t pending;
+    uint8_t critical_pending;
+    uint8_t notified_level; // level in the last notification, OK before the first
+    uint8_t notified;
+} AlertState;
+
+typedef struct {
+    size_t rule_index;
+    AlertLevel previous_level;
+    AlertLevel level;
+    double value;
+} AlertEvent;
+
+typedef struct {
+    AlertRule* rules;
+    AlertState* states;
+    size_t count;
+    size_t capacity;
+    unsigned long long suppressed_notifications;
+    unsigned long long dropped_events;
+} AlertEngine;
+
+MonitorStatus monitor_alert_engine_init(AlertEngine* engine, size_t capacity);
+void monitor_alert_engine_free(AlertEngine* engine);
+void monitor_alert_engine_reset(AlertEngine* engine);
+MonitorStatus monitor_alert_engine_add_rule(AlertEngine* engine, const AlertRule* rule, size_t* out_index);
+size_t monitor_alert_engine_evaluate(AlertEngine* engine,
+                                     const double* values,
+                                     size_t value_count,
+                                     long long now_ms,
+                                     AlertEvent* events,
+                                     size_t event_capacity);
+MonitorStatus monitor_alert_engine_carry_state(AlertEngine* engine,
+                                              size_t rule_index,
+                                              const AlertEngine* source,
+                                              size_t source_index);
+AlertLevel monitor_alert_engine_level(const AlertEngine* engine, size_t rule_index);
+const char* monitor_alert_level_name(AlertLevel level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_ALERT_H
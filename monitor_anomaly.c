@@ -0,0 +1,244 @@
+#include "monitor_anomaly.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const AnomalyParams DEFAULT_PARAMS = {
+    .threshold = 4.0,
+    .alpha = 0.05,
+    .season_alpha = 0.1,
+    .cusum_slack = 1.0,
+    .cusum_limit = 10.0,
+    .min_relative_stddev = 0.02,
+    .season_ms = 86400000,
+    .warmup_samples = 30
+};
+
+void monitor_anomaly_default_params(AnomalyParams* params) {
+    if (params) {
+        *params = DEFAULT_PARAMS;
+    }
+}
+
+static double clamp(double value, double limit) {
+    return value > limit ? limit : value < -limit ? -limit : value;
+}
+
+static size_t season_slot(const AnomalyParams* params, int64_t timestamp_ms) {
+    int64_t phase = timestamp_ms % params->season_ms;
+    if (phase < 0) {
+        phase += params->season_ms;
+    }
+    return (size_t)(phase * MONITOR_ANOMALY_SEASON_SLOTS / params->season_ms);
+}
+
+/**
+ * Allocates one model per metric; the detector never allocates again.
+ *
+ * @param detector Detector to initialise.
+ * @param metric_count Number of metrics fed to each update.
+ * @param params Tuning, or NULL for monitor_anomaly_default_params().
+ * @return MONITOR_STATUS_RANGE_ERROR for out-of-range parameters.
+ */
+MonitorStatus monitor_anomaly_init(AnomalyDetector* detector, size_t metric_count, const AnomalyParams* params) {
+    if (!detector || metric_count == 0) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+    if (!params) {
+        params = &DEFAULT_PARAMS;
+    }
+    if (!(params->threshold > 0.0) || !(params->alpha > 0.0 && params->alpha <= 1.0) ||
+        !(params->season_alpha >= 0.0 && params->season_alpha <= 1.0) || params->cusum_slack < 0.0 ||
+        !(params->cusum_limit > 0.0) || params->min_relative_stddev < 0.0 || params->season_ms < 0) {
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+
+    memset(detector, 0, sizeof(*detector));
+    detector->models = calloc(metric_count, sizeof(AnomalyModel));
+    if (!detector->models) {
+        return MONITOR_STATUS_INTERNAL_ERROR;
+    }
+
+    detector->count = metric_count;
+    detector->params = *params;
+    return MONITOR_STATUS_OK;
+}
+
+void monitor_anomaly_free(AnomalyDetector* detector) {
+    if (!detector) {
+        return;
+    }
+
+    free(detector->models);
+    memset(detector, 0, sizeof(*detector));
+}
+
+/**
+ * Forgets everything learned while keeping the parameters.
+ *
+ * @param detector Detector to reset.
+ */
+void monitor_anomaly_reset(AnomalyDetector* detector) {
+    if (!detector || !detector->models) {
+        return;
+    }
+
+    memset(detector->models, 0, detector->count * sizeof(AnomalyModel));
+    detector->anomalies = 0;
+    detector->dropped_events = 0;
+}
+
+/* Scores one sample against its model and folds it in; returns the AnomalyKind flags raised. */
+static uint32_t model_update(AnomalyModel* model,
+                             const AnomalyParams* params,
+                             size_t slot,
+                             double value,
+                             double* out_expected,
+                             double* out_score) {
+    if (model->samples == 0) {
+        model->level = value;
+        model->samples = 1;
+        *out_expected = value;
+        *out_score = 0.0;
+        return ANOMALY_NONE;
+    }
+
+    const uint32_t slot_bit = 1u << slot;
+    const bool seasonal = params->season_ms > 0 && (model->seeded_slots & slot_bit) != 0;
+    const bool warm = model->samples >= params->warmup_samples;
+    const double deviation = value - model->level;
+    /* The closer baseline wins, so a stale seasonal offset cannot raise an alarm on its own. */
+    const bool excused = seasonal && fabs(deviation - model->season[slot]) < fabs(deviation);
+    const double expected = model->level + (excused ? model->season[slot] : 0.0);
+
+    const double residual = value - expected;
+    const double stddev_floor = params->min_relative_stddev * fmax(fabs(model->level), 1.0);
+    const double stddev = fmax(sqrt(model->variance), stddev_floor);
+    const double score = residual / stddev;
+    const double limit = params->threshold * stddev;
+    uint32_t flags = ANOMALY_NONE;
+
+    if (warm) {
+        /* Clipping keeps one wild sample from tripping the CUSUM or dragging the baselines. */
+        const double clipped = clamp(score, params->threshold);
+        model->cusum_high = fmax(0.0, model->cusum_high + clipped - params->cusum_slack);
+        model->cusum_low = fmax(0.0, model->cusum_low - clipped - params->cusum_slack);
+        if (fabs(score) >= params->threshold) {
+            flags |= ANOMALY_SPIKE;
+        }
+        if (model->cusum_high > params->cusum_limit) {
+            flags |= ANOMALY_SHIFT_UP;
+        } else if (model->cusum_low > params->cusum_limit) {
+            flags |= ANOMALY_SHIFT_DOWN;
+        }
+
+        if (seasonal) {
+            model->season[slot] += params->season_alpha * clamp(deviation - model->season[slot], limit);
+        } else if (params->season_ms > 0) {
+            model->season[slot] = deviation;
+            model->seeded_slots |= slot_bit;
+        }
+    }
+
+    if (flags & (ANOMALY_SHIFT_UP | ANOMALY_SHIFT_DOWN)) {
+        model->level += residual;
+        model->cusum_high = 0.0;
+        model->cusum_low = 0.0;
+    } else {
+        const double step = clamp(residual, limit);
+        const double increment = params->alpha * step;
+        if (!excused) {
+            model->level += increment;
+        }
+        model->variance = (1.0 - params->alpha) * (model->variance + step * increment);
+    }
+
+    if (model->samples < UINT32_MAX) {
+        model->samples++;
+    }
+    *out_expected = expected;
+    *out_score = score;
+    return flags;
+}
+
+/**
+ * Scores values[i] against model i and updates the model. NaN values are
+ * skipped. Metrics beyond the detector's count are ignored.
+ *
+ * @param detector Detector to update.
+ * @param values Latest sample of each metric.
+ * @param value_count Number of values.
+ * @param timestamp_ms Wall-clock sample time in ms since the epoch, used to
+ *                     pick the seasonal slot; only its phase in the period matters.
+ * @param events Receives one event per anomalous metric; may be NULL.
+ * @param event_capacity Number of events the buffer can hold.
+ * @return Number of events written; the rest are counted as dropped.
+ */
+size_t monitor_anomaly_update(AnomalyDetector* detector,
+                              const double* values,
+                              size_t value_count,
+                              int64_t timestamp_ms,
+                              AnomalyEvent* events,
+                              size_t event_capacity) {
+    if (!detector || !detector->models || !values) {
+        return 0;
+    }
+
+    const AnomalyParams* params = &detector->params;
+    const size_t slot = params->season_ms > 0 ? season_slot(params, timestamp_ms) : 0;
+    const size_t count = value_count < detector->count ? value_count : detector->count;
+    size_t emitted = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        AnomalyModel* model = &detector->models[i];
+        double expected = 0.0;
+        double score = 0.0;
+
+        if (isnan(values[i])) {
+            continue;
+        }
+        uint32_t flags = model_update(model, params, slot, values[i], &expected, &score);
+        model->last_flags = flags;
+        model->last_score = (float)score;
+        if (flags == ANOMALY_NONE) {
+            continue;
+        }
+
+        detector->anomalies++;
+        if (!events || emitted >= event_capacity) {
+            detector->dropped_events++;
+            continue;
+        }
+        events[emitted].metric = i;
+        events[emitted].flags = flags;
+        events[emitted].value = values[i];
+        events[emitted].expected = expected;
+        events[emitted].score = score;
+        emitted++;
+    }
+
+    return emitted;
+}
+
+uint32_t monitor_anomaly_flags(const AnomalyDetector* detector, size_t metric) {
+    if (!detector || !detector->models || metric >= detector->count) {
+        return ANOMALY_NONE;
+    }
+    return detector->models[metric].last_flags;
+}
+
+/* A sample that is both a spike and the end of a shift is reported as the shift. */
+const char* monitor_anomaly_kind_name(uint32_t flags) {
+    if (flags & ANOMALY_SHIFT_UP) {
+        return "shift_up";
+    }
+    if (flags & ANOMALY_SHIFT_DOWN) {
+        return "shift_down";
+    }
+    if (flags & ANOMALY_SPIKE) {
+        return "spike";
+    }
+    return "none";
+}
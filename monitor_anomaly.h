@@ -0,0 +1,94 @@
+#ifndef MONITOR_ANOMALY_H
+#define MONITOR_ANOMALY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "monitor_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Online anomaly detection with a fixed-size model per metric.
+ *
+ * Each model tracks an exponentially weighted level and residual variance,
+ * plus a learned offset from that level for each slot of a repeating period
+ * (for example the hour of the day). Slots are taken from the update's
+ * timestamp modulo the period, so with a day-long period and wall-clock
+ * (CLOCK_REALTIME) milliseconds, slot 0 starts at midnight UTC. A sample is scored against the level
+ * with or without its slot's offset, whichever is closer, so a regular
+ * pattern such as a nightly batch job stops looking unusual once seen. A
+ * sample threshold standard deviations away is a spike; a two-sided CUSUM
+ * over the same z-scores detects sustained level shifts, after which the
+ * level jumps to the new value.
+ * Updates are O(1) per sample and allocate nothing after
+ * monitor_anomaly_init().
+ */
+#define MONITOR_ANOMALY_SEASON_SLOTS 24
+
+typedef enum {
+    ANOMALY_NONE = 0,
+    ANOMALY_SPIKE = 1u << 0,
+    ANOMALY_SHIFT_UP = 1u << 1,
+    ANOMALY_SHIFT_DOWN = 1u << 2
+} AnomalyKind;
+
+typedef struct {
+    double threshold;
+    double alpha;
+    double season_alpha;
+    double cusum_slack;
+    double cusum_limit;
+    double min_relative_stddev;
+    int64_t season_ms;
+    uint32_t warmup_samples;
+} AnomalyParams;
+
+typedef struct {
+    double level;
+    double variance;
+    double cusum_high;
+    double cusum_low;
+    double season[MONITOR_ANOMALY_SEASON_SLOTS];
+    uint32_t seeded_slots;
+    uint32_t samples;
+    uint32_t last_flags;
+    float last_score;
+} AnomalyModel;
+
+typedef struct {
+    size_t metric;
+    uint32_t flags;
+    double value;
+    double expected;
+    double score;
+} AnomalyEvent;
+
+typedef struct {
+    AnomalyModel* models;
+    size_t count;
+    AnomalyParams params;
+    unsigned long long anomalies;
+    unsigned long long dropped_events;
+} AnomalyDetector;
+
+void monitor_anomaly_default_params(AnomalyParams* params);
+MonitorStatus monitor_anomaly_init(AnomalyDetector* detector, size_t metric_count, const AnomalyParams* params);
+void monitor_anomaly_free(AnomalyDetector* detector);
+void monitor_anomaly_reset(AnomalyDetector* detector);
+size_t monitor_anomaly_update(AnomalyDetector* detector,
+                              const double* values,
+                              size_t value_count,
+                              int64_t timestamp_ms,
+                              AnomalyEvent* events,
+                              size_t event_capacity);
+uint32_t monitor_anomaly_flags(const AnomalyDetector* detector, size_t metric);
+const char* monitor_anomaly_kind_name(uint32_t flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_ANOMALY_H
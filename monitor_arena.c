@@ -0,0 +1,211 @@
+#include "monitor_arena.h"
+
+#include <limits.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Allocates a block of capacity bytes for the arena to hand out.
+ *
+ * @param arena Arena to initialise.
+ * @param capacity Bytes available between resets.
+ * @return MONITOR_STATUS_INTERNAL_ERROR when the block cannot be allocated.
+ */
+MonitorStatus monitor_arena_init(MonitorArena* arena, size_t capacity) {
+    if (!arena || capacity == 0) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    unsigned char* block = malloc(capacity);
+    if (!block) {
+        return MONITOR_STATUS_INTERNAL_ERROR;
+    }
+    monitor_arena_init_buffer(arena, block, capacity);
+    arena->owns_memory = true;
+    return MONITOR_STATUS_OK;
+}
+
+/* Serves allocations from a caller-owned buffer, such as a static array. */
+void monitor_arena_init_buffer(MonitorArena* arena, void* buffer, size_t size) {
+    if (!arena) {
+        return;
+    }
+
+    memset(arena, 0, sizeof(*arena));
+    arena->base = buffer;
+    arena->capacity = buffer ? size : 0;
+}
+
+/**
+ * Returns size bytes aligned to alignment, valid until the next reset or a
+ * rewind past them. The memory is not cleared.
+ *
+ * @param arena Arena to allocate from.
+ * @param size Bytes requested.
+ * @param alignment Power of two; 0 means alignof(max_align_t).
+ * @return NULL when the arena is full; the failure is counted.
+ */
+void* monitor_arena_alloc(MonitorArena* arena, size_t size, size_t alignment) {
+    if (!arena || !arena->base) {
+        return NULL;
+    }
+    if (alignment == 0) {
+        alignment = alignof(max_align_t);
+    }
+    if ((alignment & (alignment - 1)) != 0) {
+        arena->failures++;
+        return NULL;
+    }
+
+    uintptr_t start = (uintptr_t)(arena->base + arena->used);
+    size_t padding = (size_t)((alignment - (start & (alignment - 1))) & (alignment - 1));
+    if (padding > arena->capacity - arena->used || size > arena->capacity - arena->used - padding) {
+        arena->failures++;
+        return NULL;
+    }
+
+    void* block = arena->base + arena->used + padding;
+    arena->used += padding + size;
+    arena->allocations++;
+    if (arena->used > arena->high_water) {
+        arena->high_water = arena->used;
+    }
+    return block;
+}
+
+/* Marks the current position so a nested phase can give its scratch back with monitor_arena_rewind(). */
+size_t monitor_arena_mark(const MonitorArena* arena) {
+    return arena ? arena->used : 0;
+}
+
+void monitor_arena_rewind(MonitorArena* arena, size_t mark) {
+    if (arena && mark <= arena->used) {
+        arena->used = mark;
+    }
+}
+
+/* Releases everything allocated since the last reset; high_water and failures are kept. */
+void monitor_arena_reset(MonitorArena* arena) {
+    if (!arena) {
+        return;
+    }
+
+    arena->used = 0;
+    arena->allocations = 0;
+}
+
+void monitor_arena_free(MonitorArena* arena) {
+    if (!arena) {
+        return;
+    }
+
+    if (arena->owns_memory) {
+        free(arena->base);
+    }
+    memset(arena, 0, sizeof(*arena));
+}
+
+/**
+ * Allocates capacity records of object_size bytes, each aligned for any
+ * type, and threads them onto the free list.
+ *
+ * @param pool Pool to initialise.
+ * @param object_size Size of one record.
+ * @param capacity Number of records.
+ * @return MONITOR_STATUS_INTERNAL_ERROR when the records cannot be allocated.
+ */
+MonitorStatus monitor_pool_init(MonitorPool* pool, size_t object_size, size_t capacity) {
+    const size_t align = alignof(max_align_t);
+
+    if (!pool || object_size == 0 || capacity == 0) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+    size_t slot_size = object_size < sizeof(void*) ? sizeof(void*) : object_size;
+    slot_size = (slot_size + align - 1) / align * align;
+    size_t map_size = (capacity + CHAR_BIT - 1) / CHAR_BIT;
+    if (capacity > (SIZE_MAX - map_size) / slot_size) {
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+    pool->slots = calloc(1, capacity * slot_size + map_size);
+    if (!pool->slots) {
+        return MONITOR_STATUS_INTERNAL_ERROR;
+    }
+
+    pool->acquired = pool->slots + capacity * slot_size;
+    pool->slot_size = slot_size;
+    pool->capacity = capacity;
+    for (size_t i = capacity; i > 0; i--) {
+        void* slot = pool->slots + (i - 1) * slot_size;
+        memcpy(slot, &pool->free_list, sizeof(void*));
+        pool->free_list = slot;
+    }
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Takes a zeroed record from the pool.
+ *
+ * @return NULL when every record is in use; the failure is counted.
+ */
+void* monitor_pool_acquire(MonitorPool* pool) {
+    if (!pool || !pool->free_list) {
+        if (pool) {
+            pool->failures++;
+        }
+        return NULL;
+    }
+
+    void* object = pool->free_list;
+    size_t index = (size_t)((unsigned char*)object - pool->slots) / pool->slot_size;
+    memcpy(&pool->free_list, object, sizeof(void*));
+    memset(object, 0, pool->slot_size);
+    pool->acquired[index / CHAR_BIT] |= (unsigned char)(1U << (index % CHAR_BIT));
+    pool->in_use++;
+    if (pool->in_use > pool->high_water) {
+        pool->high_water = pool->in_use;
+    }
+    return object;
+}
+
+/*
+ * Returns a record to the pool. Pointers the pool did not hand out and records
+ * already released are ignored and counted in bad_releases.
+ */
+void monitor_pool_release(MonitorPool* pool, void* object) {
+    if (!pool || !object || !pool->slots) {
+        return;
+    }
+
+    uintptr_t address = (uintptr_t)object;
+    uintptr_t first = (uintptr_t)pool->slots;
+    if (address < first || address - first >= pool->capacity * pool->slot_size ||
+        (address - first) % pool->slot_size != 0) {
+        pool->bad_releases++;
+        return;
+    }
+
+    size_t index = (size_t)(address - first) / pool->slot_size;
+    unsigned char bit = (unsigned char)(1U << (index % CHAR_BIT));
+    if (!(pool->acquired[index / CHAR_BIT] & bit)) {
+        pool->bad_releases++;
+        return;
+    }
+
+    pool->acquired[index / CHAR_BIT] &= (unsigned char)~bit;
+    memcpy(object, &pool->free_list, sizeof(void*));
+    pool->free_list = object;
+    pool->in_use--;
+}
+
+void monitor_pool_free(MonitorPool* pool) {
+    if (!pool) {
+        return;
+    }
+
+    free(pool->slots);
+    memset(pool, 0, sizeof(*pool));
+}
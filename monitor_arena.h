@@ -0,0 +1,68 @@
+#ifndef MONITOR_ARENA_H
+#define MONITOR_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "monitor_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Allocation without the heap on the sampling path.
+ *
+ * A MonitorArena is a fixed block handed out by bumping an offset; scratch
+ * data built during a tick comes from the session's arena, which is reset
+ * once the tick ends. Nothing is freed individually, and an allocation that
+ * does not fit returns NULL rather than growing the block, so callers fall
+ * back to less output instead of calling malloc mid-tick. high_water keeps
+ * the largest use seen across resets for sizing.
+ *
+ * A MonitorPool holds fixed-size records for long-lived entities such as
+ * watched pids, devices or remote hosts: one allocation up front, O(1)
+ * acquire and release through an intrusive free list. A bit per record
+ * tracks which ones are handed out, so a stray or repeated release is
+ * counted in bad_releases instead of corrupting the free list.
+ */
+typedef struct {
+    unsigned char* base;
+    size_t capacity;
+    size_t used;
+    size_t high_water;
+    size_t allocations;
+    unsigned long long failures;
+    bool owns_memory;
+} MonitorArena;
+
+typedef struct {
+    unsigned char* slots;
+    size_t slot_size;
+    size_t capacity;
+    unsigned char* acquired;
+    void* free_list;
+    size_t in_use;
+    size_t high_water;
+    unsigned long long failures;
+    unsigned long long bad_releases;
+} MonitorPool;
+
+MonitorStatus monitor_arena_init(MonitorArena* arena, size_t capacity);
+void monitor_arena_init_buffer(MonitorArena* arena, void* buffer, size_t size);
+void* monitor_arena_alloc(MonitorArena* arena, size_t size, size_t alignment);
+size_t monitor_arena_mark(const MonitorArena* arena);
+void monitor_arena_rewind(MonitorArena* arena, size_t mark);
+void monitor_arena_reset(MonitorArena* arena);
+void monitor_arena_free(MonitorArena* arena);
+
+MonitorStatus monitor_pool_init(MonitorPool* pool, size_t object_size, size_t capacity);
+void* monitor_pool_acquire(MonitorPool* pool);
+void monitor_pool_release(MonitorPool* pool, void* object);
+void monitor_pool_free(MonitorPool* pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_ARENA_H
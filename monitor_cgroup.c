@@ -0,0 +1,561 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "monitor_cgroup.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+enum {
+    CGROUP_READ_BUFFER = 4096,
+    CGROUP_VALUE_BUFFER = 64
+};
+
+static const double BYTES_PER_GIGABYTE = 1024.0 * 1024.0 * 1024.0;
+
+/* Copies at most size - 1 bytes of text to out + used; returns the new length. */
+static size_t append_path(char* out, size_t size, size_t used, const char* text) {
+    size_t length = strlen(text);
+
+    if (used >= size) {
+        return used;
+    }
+    if (length > size - 1 - used) {
+        length = size - 1 - used;
+    }
+    memcpy(out + used, text, length);
+    out[used + length] = '\0';
+    return used + length;
+}
+
+/* Joins a cgroup root and a path below it ("/" or "" is the root itself). */
+static void join_cgroup_dir(char* out, size_t size, const char* root, const char* path) {
+    while (*path == '/') {
+        path++;
+    }
+    size_t used = append_path(out, size, 0, root);
+    if (*path != '\0') {
+        used = append_path(out, size, used, "/");
+        append_path(out, size, used, path);
+    }
+}
+
+/* Failure reports name the file by its full path, joined only when something failed. */
+static void cgroup_file_path(char* out, size_t size, const char* dir, const char* name) {
+    size_t used = 0;
+
+    out[0] = '\0';
+    if (dir && *dir != '\0') {
+        used = append_path(out, size, used, dir);
+        used = append_path(out, size, used, "/");
+    }
+    append_path(out, size, used, name);
+}
+
+MONITOR_COLD static MonitorStatus cgroup_io_error(int error_number, const char* dir, const char* name, long offset) {
+    char path[MONITOR_ERROR_MAX_PATH];
+    cgroup_file_path(path, sizeof(path), dir, name);
+    return monitor_error_set(MONITOR_STATUS_IO_ERROR, error_number, path, 0, offset);
+}
+
+MONITOR_COLD static MonitorStatus cgroup_parse_error(const char* dir,
+                                                     const char* name,
+                                                     const char* text,
+                                                     const char* position) {
+    char path[MONITOR_ERROR_MAX_PATH];
+    cgroup_file_path(path, sizeof(path), dir, name);
+    return monitor_error_set_at(MONITOR_STATUS_PARSE_ERROR, path, text, position);
+}
+
+static MonitorStatus read_small_file(const CgroupHandle* handle, const char* name, char* buffer, size_t size) {
+    size_t used = 0;
+    int fd = openat(handle->dir_fd, name, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return errno == ENOENT ? MONITOR_STATUS_UNSUPPORTED : cgroup_io_error(errno, handle->dir, name, -1);
+    }
+
+    while (used + 1 < size) {
+        ssize_t count = read(fd, buffer + used, size - 1 - used);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            int read_error = errno;
+            close(fd);
+            return cgroup_io_error(read_error, handle->dir, name, (long)used);
+        }
+        if (count == 0) {
+            break;
+        }
+        used += (size_t)count;
+    }
+
+    close(fd);
+    buffer[used] = '\0';
+    return MONITOR_STATUS_OK;
+}
+
+static bool parse_u64(const char** cursor, unsigned long long* out) {
+    const char* p = *cursor;
+    unsigned long long value = 0;
+
+    if (*p < '0' || *p > '9') {
+        return false;
+    }
+    while (*p >= '0' && *p <= '9') {
+        value = value * 10ULL + (unsigned long long)(*p - '0');
+        p++;
+    }
+
+    *cursor = p;
+    *out = value;
+    return true;
+}
+
+static bool key_matches(const char* cursor, const char* key, size_t key_length) {
+    return strncmp(cursor, key, key_length) == 0;
+}
+
+static MonitorStatus parse_memory(const char* dir, const char* current, const char* max, CgroupStats* stats) {
+    const char* cursor = current;
+    if (!parse_u64(&cursor, &stats->memory_current)) {
+        return cgroup_parse_error(dir, "memory.current", current, cursor);
+    }
+
+    cursor = max;
+    if (strncmp(max, "max", 3) == 0) {
+        stats->memory_limited = false;
+        stats->memory_max = 0;
+    } else if (parse_u64(&cursor, &stats->memory_max)) {
+        stats->memory_limited = true;
+    } else {
+        return cgroup_parse_error(dir, "memory.max", max, cursor);
+    }
+
+    stats->has_memory = true;
+    return MONITOR_STATUS_OK;
+}
+
+static MonitorStatus parse_cpu(const char* dir, const char* text, CgroupStats* stats) {
+    static const struct {
+        const char* key;
+        size_t offset;
+    } fields[] = {
+        {"usage_usec ", offsetof(CgroupStats, cpu_usage_usec)},
+        {"user_usec ", offsetof(CgroupStats, cpu_user_usec)},
+        {"system_usec ", offsetof(CgroupStats, cpu_system_usec)},
+        {"nr_throttled ", offsetof(CgroupStats, cpu_nr_throttled)},
+        {"throttled_usec ", offsetof(CgroupStats, cpu_throttled_usec)},
+    };
+
+    for (const char* line = text; *line != '\0';) {
+        for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+            size_t key_length = strlen(fields[i].key);
+            if (key_matches(line, fields[i].key, key_length)) {
+                const char* cursor = line + key_length;
+                unsigned long long* target = (unsigned long long*)(void*)((char*)stats + fields[i].offset);
+                if (!parse_u64(&cursor, target)) {
+                    return cgroup_parse_error(dir, "cpu.stat", text, cursor);
+                }
+                break;
+            }
+        }
+        const char* next = strchr(line, '\n');
+        if (!next) {
+            break;
+        }
+        line = next + 1;
+    }
+
+    stats->has_cpu = true;
+    return MONITOR_STATUS_OK;
+}
+
+static MonitorStatus parse_io(const char* dir, const char* text, CgroupStats* stats) {
+    static const struct {
+        const char* key;
+        size_t offset;
+    } fields[] = {
+        {"rbytes=", offsetof(CgroupStats, io_read_bytes)},
+        {"wbytes=", offsetof(CgroupStats, io_write_bytes)},
+        {"rios=", offsetof(CgroupStats, io_read_ops)},
+        {"wios=", offsetof(CgroupStats, io_write_ops)},
+    };
+
+    for (const char* cursor = text; *cursor != '\0';) {
+        bool matched = false;
+        for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+            size_t key_length = strlen(fields[i].key);
+            if (key_matches(cursor, fields[i].key, key_length)) {
+                unsigned long long value = 0;
+                unsigned long long* target = (unsigned long long*)(void*)((char*)stats + fields[i].offset);
+                cursor += key_length;
+                if (!parse_u64(&cursor, &value)) {
+                    return cgroup_parse_error(dir, "io.stat", text, cursor);
+                }
+                *target += value;
+                matched = true;
+                break;
+            }
+        }
+        if (!matched) {
+            cursor++;
+        }
+    }
+
+    stats->has_io = true;
+    return MONITOR_STATUS_OK;
+}
+
+static MonitorStatus read_memory(const CgroupHandle* handle, CgroupStats* stats) {
+    char current[CGROUP_VALUE_BUFFER];
+    char max[CGROUP_VALUE_BUFFER];
+    MonitorStatus status = read_small_file(handle, "memory.current", current, sizeof(current));
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    status = read_small_file(handle, "memory.max", max, sizeof(max));
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    return parse_memory(handle->dir, current, max, stats);
+}
+
+static MonitorStatus read_cpu(const CgroupHandle* handle, CgroupStats* stats) {
+    char buffer[CGROUP_READ_BUFFER];
+    MonitorStatus status = read_small_file(handle, "cpu.stat", buffer, sizeof(buffer));
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    return parse_cpu(handle->dir, buffer, stats);
+}
+
+static MonitorStatus read_io(const CgroupHandle* handle, CgroupStats* stats) {
+    char buffer[CGROUP_READ_BUFFER];
+    MonitorStatus status = read_small_file(handle, "io.stat", buffer, sizeof(buffer));
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    return parse_io(handle->dir, buffer, stats);
+}
+
+static int open_cgroup_dir(int root_fd, const char* path) {
+    while (*path == '/') {
+        path++;
+    }
+    return openat(root_fd, *path == '\0' ? "." : path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+static bool is_cgroup2_root(const char* root) {
+    char probe[MONITOR_CGROUP_MAX_PATH];
+    snprintf(probe, sizeof(probe), "%s/cgroup.controllers", root);
+    return access(probe, R_OK) == 0;
+}
+
+/**
+ * Locates the cgroup v2 mount, checking the unified and hybrid layouts.
+ *
+ * @param out Receives the mount path.
+ * @param size Size of out.
+ * @return MONITOR_STATUS_UNSUPPORTED when the host has no cgroup v2 hierarchy.
+ */
+MonitorStatus monitor_cgroup_find_root(char* out, size_t size) {
+    if (!out || size == 0) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (is_cgroup2_root(MONITOR_CGROUP_DEFAULT_ROOT)) {
+        snprintf(out, size, "%s", MONITOR_CGROUP_DEFAULT_ROOT);
+        return MONITOR_STATUS_OK;
+    }
+    if (is_cgroup2_root(MONITOR_CGROUP_HYBRID_ROOT)) {
+        snprintf(out, size, "%s", MONITOR_CGROUP_HYBRID_ROOT);
+        return MONITOR_STATUS_OK;
+    }
+    return MONITOR_STATUS_UNSUPPORTED;
+}
+
+/**
+ * Reads the calling process's cgroup v2 path from /proc/self/cgroup.
+ *
+ * @param out Receives the path relative to the cgroup v2 root (e.g. "/system.slice/x").
+ * @param size Size of out.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_cgroup_self_path(char* out, size_t size) {
+    char line[MONITOR_CGROUP_MAX_PATH + 16];
+    MonitorStatus status = MONITOR_STATUS_UNSUPPORTED;
+    FILE* file = NULL;
+
+    if (!out || size == 0) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    file = fopen("/proc/self/cgroup", "r");
+    if (!file) {
+        return MONITOR_STATUS_IO_ERROR;
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        if (strncmp(line, "0::", 3) == 0) {
+            line[strcspn(line, "\n")] = '\0';
+            snprintf(out, size, "%s", line + 3);
+            status = MONITOR_STATUS_OK;
+            break;
+        }
+    }
+
+    fclose(file);
+    return status;
+}
+
+MonitorStatus monitor_cgroup_open(CgroupHandle* handle, const char* root, const char* path) {
+    if (!handle || !root || !path) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    int root_fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (root_fd < 0) {
+        return errno == ENOENT ? MONITOR_STATUS_UNSUPPORTED : MONITOR_STATUS_IO_ERROR;
+    }
+
+    handle->dir_fd = open_cgroup_dir(root_fd, path);
+    close(root_fd);
+    if (handle->dir_fd < 0) {
+        return errno == ENOENT ? MONITOR_STATUS_UNSUPPORTED : MONITOR_STATUS_IO_ERROR;
+    }
+
+    snprintf(handle->path, sizeof(handle->path), "%s", path);
+    join_cgroup_dir(handle->dir, sizeof(handle->dir), root, path);
+    return MONITOR_STATUS_OK;
+}
+
+void monitor_cgroup_close(CgroupHandle* handle) {
+    if (!handle || handle->dir_fd < 0) {
+        return;
+    }
+
+    close(handle->dir_fd);
+    handle->dir_fd = -1;
+}
+
+/**
+ * Reads memory, CPU and I/O statistics for one cgroup. Controllers whose
+ * files are absent are left unavailable rather than failing the read.
+ *
+ * @param handle Open cgroup handle.
+ * @param stats Receives the statistics.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_cgroup_read(const CgroupHandle* handle, CgroupStats* stats) {
+    MonitorStatus status = MONITOR_STATUS_OK;
+
+    if (!handle || !stats || handle->dir_fd < 0) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+
+    status = read_memory(handle, stats);
+    if (status != MONITOR_STATUS_OK && status != MONITOR_STATUS_UNSUPPORTED) {
+        return status;
+    }
+    status = read_cpu(handle, stats);
+    if (status != MONITOR_STATUS_OK && status != MONITOR_STATUS_UNSUPPORTED) {
+        return status;
+    }
+    status = read_io(handle, stats);
+    if (status != MONITOR_STATUS_OK && status != MONITOR_STATUS_UNSUPPORTED) {
+        return status;
+    }
+
+    return MONITOR_STATUS_OK;
+}
+
+static size_t batch_add_file(int dir_fd, const char* name, size_t capacity, ReadBatch* batch) {
+    size_t index = MONITOR_CGROUP_NO_SLOT;
+    int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0 && monitor_read_batch_add_fd(batch, fd, capacity, &index) != MONITOR_STATUS_OK) {
+        index = MONITOR_CGROUP_NO_SLOT;
+    }
+    return index;
+}
+
+/**
+ * Adds the cgroup's memory, CPU and I/O files to a read batch. Files the
+ * cgroup does not have get MONITOR_CGROUP_NO_SLOT.
+ *
+ * @param handle Open cgroup handle.
+ * @param batch Batch to extend.
+ * @param slots Receives the slot index of each file.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_cgroup_batch_add(const CgroupHandle* handle, ReadBatch* batch, CgroupReadSlots* slots) {
+    if (!handle || !batch || !slots || handle->dir_fd < 0) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    slots->memory_current = batch_add_file(handle->dir_fd, "memory.current", CGROUP_VALUE_BUFFER, batch);
+    slots->memory_max = batch_add_file(handle->dir_fd, "memory.max", CGROUP_VALUE_BUFFER, batch);
+    slots->cpu_stat = batch_add_file(handle->dir_fd, "cpu.stat", CGROUP_READ_BUFFER, batch);
+    slots->io_stat = batch_add_file(handle->dir_fd, "io.stat", CGROUP_READ_BUFFER, batch);
+    slots->dir = handle->dir;
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Parses the files monitor_cgroup_batch_add() registered after a run of
+ * the batch; same results as monitor_cgroup_read().
+ *
+ * @param batch Batch that was run.
+ * @param slots Slots from monitor_cgroup_batch_add().
+ * @param stats Receives the statistics.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_cgroup_parse_batch(const ReadBatch* batch, const CgroupReadSlots* slots, CgroupStats* stats) {
+    MonitorStatus status = MONITOR_STATUS_OK;
+
+    if (!batch || !slots || !stats) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    const char* current = monitor_read_batch_data(batch, slots->memory_current, NULL);
+    const char* max = monitor_read_batch_data(batch, slots->memory_max, NULL);
+    const char* cpu = monitor_read_batch_data(batch, slots->cpu_stat, NULL);
+    const char* io = monitor_read_batch_data(batch, slots->io_stat, NULL);
+
+    if (current && max) {
+        status = parse_memory(slots->dir, current, max, stats);
+    }
+    if (status == MONITOR_STATUS_OK && cpu) {
+        status = parse_cpu(slots->dir, cpu, stats);
+    }
+    if (status == MONITOR_STATUS_OK && io) {
+        status = parse_io(slots->dir, io, stats);
+    }
+    return status;
+}
+
+/**
+ * Rebases host-wide memory usage on the cgroup's memory.current/memory.max
+ * when the cgroup has a limit below the host total.
+ *
+ * @param stats Statistics from monitor_cgroup_read().
+ * @param usage Host-wide usage to adjust in place.
+ * @return MONITOR_STATUS_UNSUPPORTED (usage untouched) when no limit applies.
+ */
+MonitorStatus monitor_cgroup_apply_memory_limit(const CgroupStats* stats, MemoryUsage* usage) {
+    if (!stats || !usage) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (!stats->has_memory || !stats->memory_limited || stats->memory_max == 0) {
+        return MONITOR_STATUS_UNSUPPORTED;
+    }
+
+    double limit_gb = (double)stats->memory_max / BYTES_PER_GIGABYTE;
+    if (usage->total_gb > 0.0 && limit_gb >= usage->total_gb) {
+        return MONITOR_STATUS_UNSUPPORTED;
+    }
+
+    double used_gb = (double)stats->memory_current / BYTES_PER_GIGABYTE;
+    usage->total_gb = limit_gb;
+    usage->used_gb = used_gb;
+    usage->usage_percent = used_gb / limit_gb * 100.0;
+    if (usage->usage_percent > 100.0) {
+        usage->usage_percent = 100.0;
+    }
+    return MONITOR_STATUS_OK;
+}
+
+MonitorStatus monitor_cgroup_set_init(CgroupSet* set, const char* root, size_t capacity) {
+    if (!set || !root || capacity == 0) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    memset(set, 0, sizeof(*set));
+    append_path(set->root, sizeof(set->root), 0, root);
+    set->root_fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (set->root_fd < 0) {
+        return errno == ENOENT ? MONITOR_STATUS_UNSUPPORTED : MONITOR_STATUS_IO_ERROR;
+    }
+
+    set->handles = calloc(capacity, sizeof(CgroupHandle));
+    set->stats = calloc(capacity, sizeof(CgroupStats));
+    if (!set->handles || !set->stats) {
+        monitor_cgroup_set_free(set);
+        return MONITOR_STATUS_INTERNAL_ERROR;
+    }
+
+    set->capacity = capacity;
+    return MONITOR_STATUS_OK;
+}
+
+MonitorStatus monitor_cgroup_set_add(CgroupSet* set, const char* path, size_t* out_index) {
+    if (!set || !path) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (set->count >= set->capacity) {
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+
+    CgroupHandle* handle = &set->handles[set->count];
+    handle->dir_fd = open_cgroup_dir(set->root_fd, path);
+    if (handle->dir_fd < 0) {
+        return errno == ENOENT ? MONITOR_STATUS_UNSUPPORTED : MONITOR_STATUS_IO_ERROR;
+    }
+    snprintf(handle->path, sizeof(handle->path), "%s", path);
+    join_cgroup_dir(handle->dir, sizeof(handle->dir), set->root, path);
+
+    if (out_index) {
+        *out_index = set->count;
+    }
+    set->count++;
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Refreshes the statistics of every cgroup in the set.
+ *
+ * @param set Set of open cgroups.
+ * @return Number of cgroups read successfully; failures are counted in read_errors.
+ */
+size_t monitor_cgroup_set_read_all(CgroupSet* set) {
+    size_t ok = 0;
+
+    if (!set) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < set->count; i++) {
+        if (monitor_cgroup_read(&set->handles[i], &set->stats[i]) == MONITOR_STATUS_OK) {
+            ok++;
+        } else {
+            set->read_errors++;
+        }
+    }
+    return ok;
+}
+
+void monitor_cgroup_set_free(CgroupSet* set) {
+    if (!set) {
+        return;
+    }
+
+    for (size_t i = 0; i < set->count; i++) {
+        monitor_cgroup_close(&set->handles[i]);
+    }
+    if (set->root_fd >= 0) {
+        close(set->root_fd);
+    }
+    free(set->handles);
+    free(set->stats);
+    memset(set, 0, sizeof(*set));
+    set->root_fd = -1;
+}
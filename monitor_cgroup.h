@@ -0,0 +1,89 @@
+#ifndef MONITOR_CGROUP_H
+#define MONITOR_CGROUP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "monitor.h"
+#include "monitor_read_batch.h"
+#include "monitor_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * cgroup v2 collector.
+ *
+ * Each cgroup is held as an open directory fd; a read opens memory.current,
+ * memory.max, cpu.stat and io.stat relative to it, so a tick costs no path
+ * walks from the mount root and no allocations, even for thousands of cgroups.
+ * Controllers that are not enabled for a cgroup are reported as unavailable.
+ */
+#define MONITOR_CGROUP_MAX_PATH 256
+#define MONITOR_CGROUP_DEFAULT_ROOT "/sys/fs/cgroup"
+#define MONITOR_CGROUP_HYBRID_ROOT "/sys/fs/cgroup/unified"
+#define MONITOR_CGROUP_NO_SLOT ((size_t)-1)
+
+typedef struct {
+    bool has_memory;
+    bool memory_limited;
+    unsigned long long memory_current;
+    unsigned long long memory_max;
+    bool has_cpu;
+    unsigned long long cpu_usage_usec;
+    unsigned long long cpu_user_usec;
+    unsigned long long cpu_system_usec;
+    unsigned long long cpu_nr_throttled;
+    unsigned long long cpu_throttled_usec;
+    bool has_io;
+    unsigned long long io_read_bytes;
+    unsigned long long io_write_bytes;
+    unsigned long long io_read_ops;
+    unsigned long long io_write_ops;
+} CgroupStats;
+
+typedef struct {
+    int dir_fd;
+    char path[MONITOR_CGROUP_MAX_PATH];
+    char dir[MONITOR_CGROUP_MAX_PATH]; // root joined with path, named in error reports
+} CgroupHandle;
+
+/* Slots of one cgroup's files in a ReadBatch, for per-tick batched reads. */
+typedef struct {
+    size_t memory_current;
+    size_t memory_max;
+    size_t cpu_stat;
+    size_t io_stat;
+    const char* dir; // the handle's dir; the handle must outlive the slots
+} CgroupReadSlots;
+
+typedef struct {
+    CgroupHandle* handles;
+    CgroupStats* stats;
+    size_t count;
+    size_t capacity;
+    int root_fd;
+    char root[MONITOR_CGROUP_MAX_PATH];
+    unsigned long long read_errors;
+} CgroupSet;
+
+MonitorStatus monitor_cgroup_find_root(char* out, size_t size);
+MonitorStatus monitor_cgroup_self_path(char* out, size_t size);
+MonitorStatus monitor_cgroup_open(CgroupHandle* handle, const char* root, const char* path);
+void monitor_cgroup_close(CgroupHandle* handle);
+MonitorStatus monitor_cgroup_read(const CgroupHandle* handle, CgroupStats* stats);
+MonitorStatus monitor_cgroup_batch_add(const CgroupHandle* handle, ReadBatch* batch, CgroupReadSlots* slots);
+MonitorStatus monitor_cgroup_parse_batch(const ReadBatch* batch, const CgroupReadSlots* slots, CgroupStats* stats);
+MonitorStatus monitor_cgroup_apply_memory_limit(const CgroupStats* stats, MemoryUsage* usage);
+
+MonitorStatus monitor_cgroup_set_init(CgroupSet* set, const char* root, size_t capacity);
+MonitorStatus monitor_cgroup_set_add(CgroupSet* set, const char* path, size_t* out_index);
+size_t monitor_cgroup_set_read_all(CgroupSet* set);
+void monitor_cgroup_set_free(CgroupSet* set);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_CGROUP_H
@@ -36,6 +36,21 @@ void monitor_config_init(MonitorConfig* config) {
     config->duration_ms = MONITOR_DEFAULT_DURATION_MS;
     config->non_interactive = false;
     config->iterations = 0;
+    config->warning_percent = MONITOR_DEFAULT_WARNING_PERCENT;
+    config->critical_percent = MONITOR_DEFAULT_CRITICAL_PERCENT;
+    config->hysteresis_percent = MONITOR_DEFAULT_HYSTERESIS_PERCENT;
+    config->alert_for_ms = MONITOR_DEFAULT_ALERT_FOR_MS;
+    config->alert_interval_ms = MONITOR_DEFAULT_ALERT_INTERVAL_MS;
+    config->anomaly_sigma = MONITOR_DEFAULT_ANOMALY_SIGMA;
+    config->anomaly_season_ms = MONITOR_DEFAULT_ANOMALY_SEASON_MS;
+    config->log_format = MONITOR_LOG_FORMAT_TEXT;
+    config->output_format = MONITOR_OUTPUT_TEXT;
+    config->output_batch = MONITOR_OUTPUT_DEFAULT_BATCH;
+    config->syscall_bench = 0;
+    config->probe_timeout_ms = MONITOR_DEFAULT_PROBE_TIMEOUT_MS;
+    config->use_cgroup = true;
+    config->self_stats = false;
+    config->daemon = false;
 }
 
 MonitorStatus parse_int_range(const char* value, int min, int max, int* out) {
@@ -80,6 +95,119 @@ MonitorStatus parse_bool(const char* value, bool* out) {
     return MONITOR_STATUS_PARSE_ERROR;
 }
 
+/**
+ * Parses a comma-separated list of process ids such as "812,1440". An
+ * empty string clears the list.
+ *
+ * @param value Input string.
+ * @param pids Receives the ids.
+ * @param capacity Number of ids pids can hold.
+ * @param out_count Receives the number of ids parsed.
+ * @return MONITOR_STATUS_RANGE_ERROR for ids outside 1..MONITOR_MAX_PID or
+ *         more than capacity ids.
+ */
+MonitorStatus parse_pid_list(const char* value, int* pids, size_t capacity, size_t* out_count) {
+    char item[16];
+    size_t count = 0;
+
+    if (!value || !pids || !out_count) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    const char* cursor = value;
+    while (*cursor != '\0') {
+        size_t length = strcspn(cursor, ",");
+        if (length == 0 || length >= sizeof(item)) {
+            return MONITOR_STATUS_PARSE_ERROR;
+        }
+        if (count == capacity) {
+            return MONITOR_STATUS_RANGE_ERROR;
+        }
+        memcpy(item, cursor, length);
+        item[length] = '\0';
+        MonitorStatus status = parse_int_range(item, 1, MONITOR_MAX_PID, &pids[count]);
+        if (status != MONITOR_STATUS_OK) {
+            return status;
+        }
+        count++;
+        cursor += length;
+        if (*cursor == ',') {
+            cursor++;
+            if (*cursor == '\0') {
+                return MONITOR_STATUS_PARSE_ERROR;
+            }
+        }
+    }
+
+    *out_count = count;
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Appends a probe command after checking that it splits into argv; the
+ * executable is only looked up when the monitor starts.
+ *
+ * @param config Configuration to extend.
+ * @param command Command line, e.g. "pg_isready -h 127.0.0.1".
+ * @return MONITOR_STATUS_RANGE_ERROR when MONITOR_MAX_PROBES are already set
+ *         or the command is too long, MONITOR_STATUS_PARSE_ERROR when it is
+ *         empty or has an unterminated quote.
+ */
+MonitorStatus monitor_config_add_probe(MonitorConfig* config, const char* command) {
+    MonitorProbeCommand parsed;
+
+    if (!config || !command) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+    if (config->probe_count == MONITOR_MAX_PROBES || strlen(command) >= MONITOR_PROBE_MAX_COMMAND) {
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+    MonitorStatus status = monitor_probe_parse(command, &parsed);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+
+    snprintf(config->probes[config->probe_count], MONITOR_PROBE_MAX_COMMAND, "%s", command);
+    config->probe_count++;
+    return MONITOR_STATUS_OK;
+}
+
+static MonitorStatus apply_int_env(const char* name, int min, int max, int* out,
+                                   char* error, size_t error_size) {
+    const char* value = getenv(name);
+    MonitorStatus status = MONITOR_STATUS_OK;
+
+    if (!value) {
+        return MONITOR_STATUS_OK;
+    }
+
+    status = parse_int_range(value, min, max, out);
+    if (status != MONITOR_STATUS_OK) {
+        set_errorf(error, error_size, "invalid %s", name);
+    }
+    return status;
+}
+
+static MonitorStatus apply_int_arg(int argc, char** argv, int* index, int min, int max, int* out,
+                                   char* error, size_t error_size) {
+    const char* arg = argv[*index];
+    MonitorStatus status = MONITOR_STATUS_OK;
+
+    if (*index + 1 >= argc) {
+        set_errorf(error, error_size, "%s requires a value", arg);
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    status = parse_int_range(argv[*index + 1], min, max, out);
+    if (status != MONITOR_STATUS_OK) {
+        set_errorf(error, error_size, "invalid %s", arg);
+        return status;
+    }
+
+    *index += 2;
+    return MONITOR_STATUS_OK;
+}
+
 MonitorStatus monitor_config_apply_env(MonitorConfig* config, char* error, size_t error_size) {
     const char* value = NULL;
     int parsed = 0;
@@ -92,6 +220,11 @@ MonitorStatus monitor_config_apply_env(MonitorConfig* config, char* error, size_
         return MONITOR_STATUS_INVALID_ARGUMENT;
     }
 
+    value = getenv("SHM_CONFIG");
+    if (value && *value != '\0') {
+        snprintf(config->config_path, sizeof(config->config_path), "%s", value);
+    }
+
     value = getenv("SHM_SERVER_NAME");
     if (value && *value != '\0') {
         snprintf(config->server_name, sizeof(config->server_name), "%s", value);
@@ -138,6 +271,155 @@ MonitorStatus monitor_config_apply_env(MonitorConfig* config, char* error, size_
         config->non_interactive = true;
     }
 
+    status = apply_int_env("SHM_WARNING_PERCENT", 1, 100, &config->warning_percent, error, error_size);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    status = apply_int_env("SHM_CRITICAL_PERCENT", 1, 100, &config->critical_percent, error, error_size);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    status = apply_int_env("SHM_HYSTERESIS_PERCENT", 0, MONITOR_MAX_HYSTERESIS_PERCENT,
+                           &config->hysteresis_percent, error, error_size);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    status = apply_int_env("SHM_ALERT_FOR_MS", 0, MONITOR_MAX_DURATION_MS, &config->alert_for_ms, error, error_size);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    status = apply_int_env("SHM_ALERT_INTERVAL_MS", 0, MONITOR_MAX_DURATION_MS,
+                           &config->alert_interval_ms, error, error_size);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    status = apply_int_env("SHM_ANOMALY_SIGMA", 0, MONITOR_MAX_ANOMALY_SIGMA,
+                           &config->anomaly_sigma, error, error_size);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    status = apply_int_env("SHM_ANOMALY_SEASON_MS", 0, MONITOR_MAX_DURATION_MS,
+                           &config->anomaly_season_ms, error, error_size);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    status = apply_int_env("SHM_SYSCALL_BENCH", 0, MONITOR_MAX_SYSCALL_BENCH_CALLS,
+                           &config->syscall_bench, error, error_size);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    status = apply_int_env("SHM_PROBE_TIMEOUT_MS", 1, MONITOR_MAX_PROBE_TIMEOUT_MS,
+                           &config->probe_timeout_ms, error, error_size);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    status = apply_int_env("SHM_PROBE_CACHE_MS", 0, MONITOR_MAX_DURATION_MS,
+                           &config->probe_cache_ms, error, error_size);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+
+    value = getenv("SHM_LOG_FORMAT");
+    if (value) {
+        status = monitor_log_parse_format(value, &config->log_format);
+        if (status != MONITOR_STATUS_OK) {
+            set_error(error, error_size, "invalid SHM_LOG_FORMAT");
+            return status;
+        }
+    }
+
+    value = getenv("SHM_OUTPUT_FORMAT");
+    if (value) {
+        status = monitor_output_parse_format(value, &config->output_format);
+        if (status != MONITOR_STATUS_OK) {
+            set_error(error, error_size, "invalid SHM_OUTPUT_FORMAT");
+            return status;
+        }
+        if (config->output_format != MONITOR_OUTPUT_TEXT) {
+            config->non_interactive = true;
+        }
+    }
+
+    value = getenv("SHM_USE_CGROUP");
+    if (value) {
+        status = parse_bool(value, &config->use_cgroup);
+        if (status != MONITOR_STATUS_OK) {
+            set_error(error, error_size, "invalid SHM_USE_CGROUP");
+            return status;
+        }
+    }
+
+    value = getenv("SHM_DAEMON");
+    if (value) {
+        status = parse_bool(value, &config->daemon);
+        if (status != MONITOR_STATUS_OK) {
+            set_error(error, error_size, "invalid SHM_DAEMON");
+            return status;
+        }
+        if (config->daemon) {
+            config->non_interactive = true;
+        }
+    }
+
+    value = getenv("SHM_PUBLISH_SHM");
+    if (value && *value != '\0') {
+        if (strlen(value) >= sizeof(config->shm_name)) {
+            set_error(error, error_size, "SHM_PUBLISH_SHM is too long");
+            return MONITOR_STATUS_RANGE_ERROR;
+        }
+        snprintf(config->shm_name, sizeof(config->shm_name), "%s", value);
+    }
+
+    value = getenv("SHM_WATCH_PIDS");
+    if (value) {
+        status = parse_pid_list(value, config->watch_pids, MONITOR_THREADS_MAX_PIDS, &config->watch_pid_count);
+        if (status != MONITOR_STATUS_OK) {
+            set_error(error, error_size, "invalid SHM_WATCH_PIDS");
+            return status;
+        }
+    }
+
+    value = getenv("SHM_PROBE");
+    if (value && *value != '\0') {
+        status = monitor_config_add_probe(config, value);
+        if (status != MONITOR_STATUS_OK) {
+            set_error(error, error_size, "invalid SHM_PROBE");
+            return status;
+        }
+    }
+
+    value = getenv("SHM_PROBE_CGROUP");
+    if (value && *value != '\0') {
+        if (strlen(value) >= sizeof(config->probe_cgroup)) {
+            set_error(error, error_size, "SHM_PROBE_CGROUP is too long");
+            return MONITOR_STATUS_RANGE_ERROR;
+        }
+        snprintf(config->probe_cgroup, sizeof(config->probe_cgroup), "%s", value);
+    }
+
+    value = getenv("SHM_PROC_ROOT");
+    if (value && *value != '\0') {
+        if (strlen(value) >= sizeof(config->proc_root)) {
+            set_error(error, error_size, "SHM_PROC_ROOT is too long");
+            return MONITOR_STATUS_RANGE_ERROR;
+        }
+        snprintf(config->proc_root, sizeof(config->proc_root), "%s", value);
+    }
+
+    value = getenv("SHM_SELF_STATS");
+    if (value) {
+        status = parse_bool(value, &config->self_stats);
+        if (status != MONITOR_STATUS_OK) {
+            set_error(error, error_size, "invalid SHM_SELF_STATS");
+            return status;
+        }
+    }
+
+    status = apply_int_env("SHM_OUTPUT_BATCH", 1, MONITOR_OUTPUT_MAX_BATCH, &config->output_batch, error, error_size);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+
     return MONITOR_STATUS_OK;
 }
 
@@ -166,6 +448,100 @@ MonitorStatus monitor_config_apply_args(MonitorConfig* config, int argc, char**
             i++;
             continue;
         }
+        if (strcmp(arg, "--no-cgroup") == 0) {
+            config->use_cgroup = false;
+            i++;
+            continue;
+        }
+        if (strcmp(arg, "--daemon") == 0) {
+            config->daemon = true;
+            config->non_interactive = true;
+            i++;
+            continue;
+        }
+        if (strcmp(arg, "--self-stats") == 0) {
+            config->self_stats = true;
+            i++;
+            continue;
+        }
+        if (strcmp(arg, "--publish-shm") == 0) {
+            if (i + 1 >= argc || argv[i + 1][0] == '\0') {
+                set_error(error, error_size, "--publish-shm requires a segment name");
+                return MONITOR_STATUS_INVALID_ARGUMENT;
+            }
+            if (strlen(argv[i + 1]) >= sizeof(config->shm_name)) {
+                set_error(error, error_size, "--publish-shm name is too long");
+                return MONITOR_STATUS_RANGE_ERROR;
+            }
+            snprintf(config->shm_name, sizeof(config->shm_name), "%s", argv[i + 1]);
+            i += 2;
+            continue;
+        }
+        if (strcmp(arg, "--watch-pids") == 0) {
+            if (i + 1 >= argc) {
+                set_error(error, error_size, "--watch-pids requires a list of pids");
+                return MONITOR_STATUS_INVALID_ARGUMENT;
+            }
+            status = parse_pid_list(argv[i + 1], config->watch_pids, MONITOR_THREADS_MAX_PIDS, &config->watch_pid_count);
+            if (status != MONITOR_STATUS_OK) {
+                set_error(error, error_size, "--watch-pids expects up to 16 comma-separated pids");
+                return status;
+            }
+            i += 2;
+            continue;
+        }
+        if (strcmp(arg, "--probe") == 0) {
+            if (i + 1 >= argc) {
+                set_error(error, error_size, "--probe requires a command");
+                return MONITOR_STATUS_INVALID_ARGUMENT;
+            }
+            status = monitor_config_add_probe(config, argv[i + 1]);
+            if (status == MONITOR_STATUS_RANGE_ERROR) {
+                set_error(error, error_size, "--probe allows up to 8 commands of 255 characters");
+                return status;
+            }
+            if (status != MONITOR_STATUS_OK) {
+                set_errorf(error, error_size, "--probe cannot parse: %s", argv[i + 1]);
+                return status;
+            }
+            i += 2;
+            continue;
+        }
+        if (strcmp(arg, "--probe-cgroup") == 0) {
+            if (i + 1 >= argc || argv[i + 1][0] == '\0') {
+                set_error(error, error_size, "--probe-cgroup requires a directory");
+                return MONITOR_STATUS_INVALID_ARGUMENT;
+            }
+            if (strlen(argv[i + 1]) >= sizeof(config->probe_cgroup)) {
+                set_error(error, error_size, "--probe-cgroup path is too long");
+                return MONITOR_STATUS_RANGE_ERROR;
+            }
+            snprintf(config->probe_cgroup, sizeof(config->probe_cgroup), "%s", argv[i + 1]);
+            i += 2;
+            continue;
+        }
+        if (strcmp(arg, "--proc-root") == 0) {
+            if (i + 1 >= argc || argv[i + 1][0] == '\0') {
+                set_error(error, error_size, "--proc-root requires a directory");
+                return MONITOR_STATUS_INVALID_ARGUMENT;
+            }
+            if (strlen(argv[i + 1]) >= sizeof(config->proc_root)) {
+                set_error(error, error_size, "--proc-root path is too long");
+                return MONITOR_STATUS_RANGE_ERROR;
+            }
+            snprintf(config->proc_root, sizeof(config->proc_root), "%s", argv[i + 1]);
+            i += 2;
+            continue;
+        }
+        if (strcmp(arg, "--config") == 0) {
+            if (i + 1 >= argc || argv[i + 1][0] == '\0') {
+                set_error(error, error_size, "--config requires a path");
+                return MONITOR_STATUS_INVALID_ARGUMENT;
+            }
+            snprintf(config->config_path, sizeof(config->config_path), "%s", argv[i + 1]);
+            i += 2;
+            continue;
+        }
         if (strcmp(arg, "--server") == 0) {
             if (i + 1 >= argc) {
                 set_error(error, error_size, "--server requires a value");
@@ -222,6 +598,119 @@ MonitorStatus monitor_config_apply_args(MonitorConfig* config, int argc, char**
             i += 2;
             continue;
         }
+        if (strcmp(arg, "--warning-percent") == 0) {
+            status = apply_int_arg(argc, argv, &i, 1, 100, &config->warning_percent, error, error_size);
+            if (status != MONITOR_STATUS_OK) {
+                return status;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--critical-percent") == 0) {
+            status = apply_int_arg(argc, argv, &i, 1, 100, &config->critical_percent, error, error_size);
+            if (status != MONITOR_STATUS_OK) {
+                return status;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--hysteresis-percent") == 0) {
+            status = apply_int_arg(argc, argv, &i, 0, MONITOR_MAX_HYSTERESIS_PERCENT,
+                                   &config->hysteresis_percent, error, error_size);
+            if (status != MONITOR_STATUS_OK) {
+                return status;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--alert-for-ms") == 0) {
+            status = apply_int_arg(argc, argv, &i, 0, MONITOR_MAX_DURATION_MS, &config->alert_for_ms, error, error_size);
+            if (status != MONITOR_STATUS_OK) {
+                return status;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--log-format") == 0) {
+            if (i + 1 >= argc) {
+                set_error(error, error_size, "--log-format requires a value");
+                return MONITOR_STATUS_INVALID_ARGUMENT;
+            }
+            status = monitor_log_parse_format(argv[i + 1], &config->log_format);
+            if (status != MONITOR_STATUS_OK) {
+                set_error(error, error_size, "invalid --log-format (expected text or json)");
+                return status;
+            }
+            i += 2;
+            continue;
+        }
+        if (strcmp(arg, "--format") == 0) {
+            if (i + 1 >= argc) {
+                set_error(error, error_size, "--format requires a value");
+                return MONITOR_STATUS_INVALID_ARGUMENT;
+            }
+            status = monitor_output_parse_format(argv[i + 1], &config->output_format);
+            if (status != MONITOR_STATUS_OK) {
+                set_error(error, error_size, "invalid --format (expected json, csv or text)");
+                return status;
+            }
+            if (config->output_format != MONITOR_OUTPUT_TEXT) {
+                config->non_interactive = true;
+            }
+            i += 2;
+            continue;
+        }
+        if (strcmp(arg, "--output-batch") == 0) {
+            status = apply_int_arg(argc, argv, &i, 1, MONITOR_OUTPUT_MAX_BATCH, &config->output_batch, error, error_size);
+            if (status != MONITOR_STATUS_OK) {
+                return status;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--alert-interval-ms") == 0) {
+            status = apply_int_arg(argc, argv, &i, 0, MONITOR_MAX_DURATION_MS,
+                                   &config->alert_interval_ms, error, error_size);
+            if (status != MONITOR_STATUS_OK) {
+                return status;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--anomaly-sigma") == 0) {
+            status = apply_int_arg(argc, argv, &i, 0, MONITOR_MAX_ANOMALY_SIGMA,
+                                   &config->anomaly_sigma, error, error_size);
+            if (status != MONITOR_STATUS_OK) {
+                return status;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--anomaly-season-ms") == 0) {
+            status = apply_int_arg(argc, argv, &i, 0, MONITOR_MAX_DURATION_MS,
+                                   &config->anomaly_season_ms, error, error_size);
+            if (status != MONITOR_STATUS_OK) {
+                return status;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--syscall-bench") == 0) {
+            status = apply_int_arg(argc, argv, &i, 0, MONITOR_MAX_SYSCALL_BENCH_CALLS,
+                                   &config->syscall_bench, error, error_size);
+            if (status != MONITOR_STATUS_OK) {
+                return status;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--probe-timeout-ms") == 0) {
+            status = apply_int_arg(argc, argv, &i, 1, MONITOR_MAX_PROBE_TIMEOUT_MS,
+                                   &config->probe_timeout_ms, error, error_size);
+            if (status != MONITOR_STATUS_OK) {
+                return status;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--probe-cache-ms") == 0) {
+            status = apply_int_arg(argc, argv, &i, 0, MONITOR_MAX_DURATION_MS,
+                                   &config->probe_cache_ms, error, error_size);
+            if (status != MONITOR_STATUS_OK) {
+                return status;
+            }
+            continue;
+        }
 
         set_errorf(error, error_size, "unknown argument: %s", arg);
         return MONITOR_STATUS_INVALID_ARGUMENT;
@@ -256,11 +745,47 @@ MonitorStatus monitor_config_validate(const MonitorConfig* config, char* error,
         return MONITOR_STATUS_INVALID_ARGUMENT;
     }
 
-    if (config->iterations == 0 && config->duration_ms < config->interval_ms) {
+    if (config->daemon && config->iterations > 0) {
+        set_error(error, error_size, "daemon mode runs until SIGTERM; iterations are not allowed");
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (!config->daemon && config->iterations == 0 && config->duration_ms < config->interval_ms) {
         set_error(error, error_size, "duration must be >= interval");
         return MONITOR_STATUS_RANGE_ERROR;
     }
 
+    if (config->warning_percent < 1 || config->critical_percent > 100 ||
+        config->warning_percent >= config->critical_percent) {
+        set_error(error, error_size, "warning threshold must be below critical threshold");
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+
+    if (config->hysteresis_percent < 0 || config->hysteresis_percent >= config->warning_percent) {
+        set_error(error, error_size, "hysteresis must be below the warning threshold");
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+
+    if (config->output_format != MONITOR_OUTPUT_TEXT && !config->non_interactive) {
+        set_error(error, error_size, "json/csv output requires non-interactive mode");
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (config->output_batch < 1 || config->output_batch > MONITOR_OUTPUT_MAX_BATCH) {
+        set_error(error, error_size, "output batch out of range");
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+
+    if (config->alert_for_ms < 0 || config->alert_interval_ms < 0) {
+        set_error(error, error_size, "alert windows must be non-negative");
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+
+    if (config->shm_name[0] != '\0' && monitor_shm_validate_name(config->shm_name) != MONITOR_STATUS_OK) {
+        set_error(error, error_size, "shared-memory name must look like /name");
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
     return MONITOR_STATUS_OK;
 }
 
@@ -281,4 +806,48 @@ void monitor_config_print(const MonitorConfig* config) {
     if (config->iterations > 0) {
         printf("  Iterations:    %d\n", config->iterations);
     }
+    printf("  Alerts:        warning >%d%%, critical >%d%%, hysteresis %d%%\n",
+           config->warning_percent,
+           config->critical_percent,
+           config->hysteresis_percent);
+    printf("  Alert timing:  for %d ms, notify every %d ms at most\n",
+           config->alert_for_ms,
+           config->alert_interval_ms);
+    if (config->anomaly_sigma > 0) {
+        printf("  Anomalies:     %d sigma, season %d ms\n", config->anomaly_sigma, config->anomaly_season_ms);
+    } else {
+        printf("  Anomalies:     off\n");
+    }
+    printf("  Log format:    %s\n", config->log_format == MONITOR_LOG_FORMAT_JSON ? "json" : "text");
+    printf("  Output format: %s\n", monitor_output_format_name(config->output_format));
+    printf("  cgroup limits: %s\n", config->use_cgroup ? "auto" : "off");
+    printf("  Proc root:     %s\n", config->proc_root[0] ? config->proc_root : "/proc");
+    printf("  Self stats:    %s\n", config->self_stats ? "on" : "off");
+    if (config->syscall_bench > 0) {
+        printf("  Syscall bench: %d calls per syscall\n", config->syscall_bench);
+    } else {
+        printf("  Syscall bench: off\n");
+    }
+    printf("  Daemon:        %s\n", config->daemon ? "yes" : "no");
+    printf("  Config file:   %s\n", config->config_path[0] ? config->config_path : "(none)");
+    printf("  Shared memory: %s\n", config->shm_name[0] ? config->shm_name : "(off)");
+    printf("  Watched pids: ");
+    if (config->watch_pid_count == 0) {
+        printf(" (none)");
+    }
+    for (size_t i = 0; i < config->watch_pid_count; i++) {
+        printf("%s%d", i == 0 ? " " : ",", config->watch_pids[i]);
+    }
+    printf("\n");
+    if (config->probe_count == 0) {
+        printf("  Probes:        (none)\n");
+        return;
+    }
+    printf("  Probes:        timeout %d ms, reuse results for %d ms, cgroup %s\n",
+           config->probe_timeout_ms,
+           config->probe_cache_ms,
+           config->probe_cgroup[0] ? config->probe_cgroup : "(inherited)");
+    for (size_t i = 0; i < config->probe_count; i++) {
+        printf("    %s\n", config->probes[i]);
+    }
 }
@@ -4,7 +4,12 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include "monitor_format.h"
+#include "monitor_log.h"
+#include "monitor_probe.h"
+#include "monitor_shm.h"
 #include "monitor_status.h"
+#include "monitor_threads.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,6 +23,21 @@ extern "C" {
 #define MONITOR_MAX_DURATION_MS 86400000
 #define MONITOR_MAX_SERVER_NAME 64
 #define MONITOR_MAX_ITERATIONS (MONITOR_MAX_DURATION_MS / MONITOR_MIN_INTERVAL_MS)
+#define MONITOR_DEFAULT_WARNING_PERCENT 75
+#define MONITOR_DEFAULT_CRITICAL_PERCENT 90
+#define MONITOR_DEFAULT_HYSTERESIS_PERCENT 5
+#define MONITOR_DEFAULT_ALERT_FOR_MS 0
+#define MONITOR_DEFAULT_ALERT_INTERVAL_MS 60000
+#define MONITOR_MAX_HYSTERESIS_PERCENT 50
+#define MONITOR_DEFAULT_ANOMALY_SIGMA 4
+#define MONITOR_MAX_ANOMALY_SIGMA 20
+#define MONITOR_DEFAULT_ANOMALY_SEASON_MS 86400000
+#define MONITOR_MAX_SYSCALL_BENCH_CALLS 1000000
+#define MONITOR_MAX_PROBES 8
+#define MONITOR_DEFAULT_PROBE_TIMEOUT_MS 2000
+#define MONITOR_MAX_PROBE_TIMEOUT_MS 60000
+#define MONITOR_MAX_CONFIG_PATH 256
+#define MONITOR_MAX_PID 4194304
 
 typedef struct {
     char server_name[MONITOR_MAX_SERVER_NAME];
@@ -25,11 +45,37 @@ typedef struct {
     int duration_ms;
     bool non_interactive;
     int iterations;
+    int warning_percent;
+    int critical_percent;
+    int hysteresis_percent;
+    int alert_for_ms;
+    int alert_interval_ms;
+    int anomaly_sigma;
+    int anomaly_season_ms;
+    MonitorLogFormat log_format;
+    MonitorOutputFormat output_format;
+    int output_batch;
+    int syscall_bench;
+    bool use_cgroup;
+    bool self_stats;
+    bool daemon;
+    char config_path[MONITOR_MAX_CONFIG_PATH];
+    char shm_name[MONITOR_SHM_MAX_NAME];
+    int watch_pids[MONITOR_THREADS_MAX_PIDS];
+    size_t watch_pid_count;
+    char probes[MONITOR_MAX_PROBES][MONITOR_PROBE_MAX_COMMAND];
+    size_t probe_count;
+    int probe_timeout_ms;
+    int probe_cache_ms;
+    char probe_cgroup[MONITOR_MAX_CONFIG_PATH];
+    char proc_root[MONITOR_MAX_CONFIG_PATH];
 } MonitorConfig;
 
 void monitor_config_init(MonitorConfig* config);
 MonitorStatus parse_int_range(const char* value, int min, int max, int* out);
 MonitorStatus parse_bool(const char* value, bool* out);
+MonitorStatus parse_pid_list(const char* value, int* pids, size_t capacity, size_t* out_count);
+MonitorStatus monitor_config_add_probe(MonitorConfig* config, const char* command);
 MonitorStatus monitor_config_apply_env(MonitorConfig* config, char* error, size_t error_size);
 MonitorStatus monitor_config_apply_args(MonitorConfig* config, int argc, char** argv,
                                        bool* show_help, char* error, size_t error_size);
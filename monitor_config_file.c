@@ -0,0 +1,836 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "monitor_config_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "monitor.h"
+
+enum {
+    RULES_INITIAL_CAPACITY = 16,
+    STRINGS_INITIAL_CAPACITY = 1024,
+    INTERN_INITIAL_CAPACITY = 64,
+    SECTION_NONE = 0,
+    SECTION_MONITOR,
+    SECTION_ALERT
+};
+
+static const size_t NO_STRING = SIZE_MAX;
+
+typedef struct {
+    const char* key;
+    size_t offset;
+    int min;
+    int max;
+} IntSetting;
+
+typedef struct {
+    const char* key;
+    size_t offset;
+} BoolSetting;
+
+static const IntSetting INT_SETTINGS[] = {
+    {"interval_ms", offsetof(MonitorConfig, interval_ms), MONITOR_MIN_INTERVAL_MS, MONITOR_MAX_INTERVAL_MS},
+    {"duration_ms", offsetof(MonitorConfig, duration_ms), MONITOR_MIN_DURATION_MS, MONITOR_MAX_DURATION_MS},
+    {"iterations", offsetof(MonitorConfig, iterations), 0, MONITOR_MAX_ITERATIONS},
+    {"warning_percent", offsetof(MonitorConfig, warning_percent), 1, 100},
+    {"critical_percent", offsetof(MonitorConfig, critical_percent), 1, 100},
+    {"hysteresis_percent", offsetof(MonitorConfig, hysteresis_percent), 0, MONITOR_MAX_HYSTERESIS_PERCENT},
+    {"alert_for_ms", offsetof(MonitorConfig, alert_for_ms), 0, MONITOR_MAX_DURATION_MS},
+    {"alert_interval_ms", offsetof(MonitorConfig, alert_interval_ms), 0, MONITOR_MAX_DURATION_MS},
+    {"anomaly_sigma", offsetof(MonitorConfig, anomaly_sigma), 0, MONITOR_MAX_ANOMALY_SIGMA},
+    {"anomaly_season_ms", offsetof(MonitorConfig, anomaly_season_ms), 0, MONITOR_MAX_DURATION_MS},
+    {"output_batch", offsetof(MonitorConfig, output_batch), 1, MONITOR_OUTPUT_MAX_BATCH},
+    {"syscall_bench", offsetof(MonitorConfig, syscall_bench), 0, MONITOR_MAX_SYSCALL_BENCH_CALLS},
+    {"probe_timeout_ms", offsetof(MonitorConfig, probe_timeout_ms), 1, MONITOR_MAX_PROBE_TIMEOUT_MS},
+    {"probe_cache_ms", offsetof(MonitorConfig, probe_cache_ms), 0, MONITOR_MAX_DURATION_MS},
+};
+
+static const BoolSetting BOOL_SETTINGS[] = {
+    {"non_interactive", offsetof(MonitorConfig, non_interactive)},
+    {"use_cgroup", offsetof(MonitorConfig, use_cgroup)},
+    {"self_stats", offsetof(MonitorConfig, self_stats)},
+    {"daemon", offsetof(MonitorConfig, daemon)},
+};
+
+static void set_errorf(char* error, size_t error_size, const char* format, ...) {
+    va_list args;
+
+    if (error == NULL || error_size == 0 || format == NULL) {
+        return;
+    }
+
+    va_start(args, format);
+    vsnprintf(error, error_size, format, args);
+    va_end(args);
+}
+
+void monitor_config_rules_init(ConfigRules* rules) {
+    if (rules) {
+        memset(rules, 0, sizeof(*rules));
+    }
+}
+
+void monitor_config_rules_free(ConfigRules* rules) {
+    if (!rules) {
+        return;
+    }
+
+    free(rules->rules);
+    free(rules->name_offsets);
+    free(rules->notify_offsets);
+    free(rules->strings);
+    free(rules->intern_slots);
+    free(rules->intern_is_rule_name);
+    memset(rules, 0, sizeof(*rules));
+}
+
+static size_t hash_bytes(const char* text, size_t length) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 1099511628211ULL;
+    }
+    return (size_t)hash;
+}
+
+static MonitorStatus intern_grow(ConfigRules* rules) {
+    size_t capacity = rules->intern_capacity ? rules->intern_capacity * 2 : INTERN_INITIAL_CAPACITY;
+    size_t* slots = malloc(capacity * sizeof(size_t));
+    unsigned char* flags = calloc(capacity, 1);
+    if (!slots || !flags) {
+        free(slots);
+        free(flags);
+        return MONITOR_STATUS_INTERNAL_ERROR;
+    }
+
+    for (size_t i = 0; i < capacity; i++) {
+        slots[i] = NO_STRING;
+    }
+    for (size_t i = 0; i < rules->intern_capacity; i++) {
+        size_t offset = rules->intern_slots[i];
+        if (offset == NO_STRING) {
+            continue;
+        }
+        const char* text = rules->strings + offset;
+        size_t slot = hash_bytes(text, strlen(text)) & (capacity - 1);
+        while (slots[slot] != NO_STRING) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        slots[slot] = offset;
+        flags[slot] = rules->intern_is_rule_name[i];
+    }
+
+    free(rules->intern_slots);
+    free(rules->intern_is_rule_name);
+    rules->intern_slots = slots;
+    rules->intern_is_rule_name = flags;
+    rules->intern_capacity = capacity;
+    return MONITOR_STATUS_OK;
+}
+
+/*
+ * Returns the pool offset of text, adding it if it is not interned yet.
+ * out_slot receives the hash slot, valid until the next intern call.
+ */
+static MonitorStatus intern_string(ConfigRules* rules, const char* text, size_t length, size_t* out, size_t* out_slot) {
+    if ((rules->intern_count + 1) * 2 > rules->intern_capacity) {
+        MonitorStatus status = intern_grow(rules);
+        if (status != MONITOR_STATUS_OK) {
+            return status;
+        }
+    }
+
+    size_t mask = rules->intern_capacity - 1;
+    size_t slot = hash_bytes(text, length) & mask;
+    while (rules->intern_slots[slot] != NO_STRING) {
+        const char* existing = rules->strings + rules->intern_slots[slot];
+        if (strncmp(existing, text, length) == 0 && existing[length] == '\0') {
+            *out = rules->intern_slots[slot];
+            *out_slot = slot;
+            return MONITOR_STATUS_OK;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (rules->strings_size + length + 1 > rules->strings_capacity) {
+        size_t capacity = rules->strings_capacity ? rules->strings_capacity : STRINGS_INITIAL_CAPACITY;
+        while (rules->strings_size + length + 1 > capacity) {
+            capacity *= 2;
+        }
+        char* strings = realloc(rules->strings, capacity);
+        if (!strings) {
+            return MONITOR_STATUS_INTERNAL_ERROR;
+        }
+        rules->strings = strings;
+        rules->strings_capacity = capacity;
+    }
+
+    memcpy(rules->strings + rules->strings_size, text, length);
+    rules->strings[rules->strings_size + length] = '\0';
+    rules->intern_slots[slot] = rules->strings_size;
+    rules->intern_count++;
+    *out = rules->strings_size;
+    *out_slot = slot;
+    rules->strings_size += length + 1;
+    return MONITOR_STATUS_OK;
+}
+
+static MonitorStatus append_rule(ConfigRules* rules, size_t name_offset, const MonitorConfig* config) {
+    if (rules->count == rules->capacity) {
+        size_t capacity = rules->capacity ? rules->capacity * 2 : RULES_INITIAL_CAPACITY;
+        AlertRule* grown_rules = realloc(rules->rules, capacity * sizeof(AlertRule));
+        if (!grown_rules) {
+            return MONITOR_STATUS_INTERNAL_ERROR;
+        }
+        rules->rules = grown_rules;
+
+        size_t* grown_names = realloc(rules->name_offsets, capacity * sizeof(size_t));
+        if (!grown_names) {
+            return MONITOR_STATUS_INTERNAL_ERROR;
+        }
+        rules->name_offsets = grown_names;
+
+        size_t* grown_notify = realloc(rules->notify_offsets, capacity * sizeof(size_t));
+        if (!grown_notify) {
+            return MONITOR_STATUS_INTERNAL_ERROR;
+        }
+        rules->notify_offsets = grown_notify;
+        rules->capacity = capacity;
+    }
+
+    AlertRule* rule = &rules->rules[rules->count];
+    rule->metric = MONITOR_METRIC_COUNT;
+    rule->warning_threshold = -1.0;
+    rule->critical_threshold = -1.0;
+    rule->hysteresis = 0.0;
+    rule->for_ms = 0;
+    rule->min_notify_interval_ms = config->alert_interval_ms;
+    rules->name_offsets[rules->count] = name_offset;
+    rules->notify_offsets[rules->count] = NO_STRING;
+    rules->count++;
+    return MONITOR_STATUS_OK;
+}
+
+static const char* trim(const char* start, const char* end, const char** out_end) {
+    while (start < end && (*start == ' ' || *start == '\t')) {
+        start++;
+    }
+    while (end > start && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) {
+        end--;
+    }
+    *out_end = end;
+    return start;
+}
+
+static bool key_equals(const char* key, size_t length, const char* expected) {
+    return strlen(expected) == length && memcmp(key, expected, length) == 0;
+}
+
+static MonitorStatus parse_int_value(const char* value, size_t length, int min, int max, int* out) {
+    char buffer[32];
+    if (length == 0 || length >= sizeof(buffer)) {
+        return MONITOR_STATUS_PARSE_ERROR;
+    }
+    memcpy(buffer, value, length);
+    buffer[length] = '\0';
+    return parse_int_range(buffer, min, max, out);
+}
+
+static MonitorStatus parse_double_value(const char* value, size_t length, double* out) {
+    char buffer[32];
+    char* end = NULL;
+    if (length == 0 || length >= sizeof(buffer)) {
+        return MONITOR_STATUS_PARSE_ERROR;
+    }
+    memcpy(buffer, value, length);
+    buffer[length] = '\0';
+    errno = 0;
+    *out = strtod(buffer, &end);
+    /* strtod() also reads "nan" and "inf"; a NaN threshold would pass every range check below. */
+    if (errno != 0 || *end != '\0' || !isfinite(*out)) {
+        return MONITOR_STATUS_PARSE_ERROR;
+    }
+    return MONITOR_STATUS_OK;
+}
+
+/* Returns the ';' or '#' starting an inline comment, skipping any inside double quotes, or NULL. */
+static const char* find_inline_comment(const char* value, const char* end) {
+    bool quoted = false;
+
+    for (const char* cursor = value; cursor < end; cursor++) {
+        if (*cursor == '"') {
+            quoted = !quoted;
+        } else if (!quoted && (*cursor == ';' || *cursor == '#')) {
+            return cursor;
+        }
+    }
+    return NULL;
+}
+
+static MonitorStatus parse_metric(const char* value, size_t length, uint32_t* out) {
+    for (uint32_t metric = 0; metric < MONITOR_METRIC_COUNT; metric++) {
+        if (key_equals(value, length, monitor_metric_key((MonitorMetric)metric))) {
+            *out = metric;
+            return MONITOR_STATUS_OK;
+        }
+    }
+    return MONITOR_STATUS_PARSE_ERROR;
+}
+
+static MonitorStatus apply_monitor_key(MonitorConfig* config, const char* key, size_t key_length,
+                                       const char* value, size_t value_length) {
+    char buffer[MONITOR_PROBE_MAX_COMMAND];
+
+    for (size_t i = 0; i < sizeof(INT_SETTINGS) / sizeof(INT_SETTINGS[0]); i++) {
+        if (key_equals(key, key_length, INT_SETTINGS[i].key)) {
+            int* field = (int*)(void*)((char*)config + INT_SETTINGS[i].offset);
+            return parse_int_value(value, value_length, INT_SETTINGS[i].min, INT_SETTINGS[i].max, field);
+        }
+    }
+
+    if (value_length >= sizeof(buffer)) {
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+    memcpy(buffer, value, value_length);
+    buffer[value_length] = '\0';
+
+    for (size_t i = 0; i < sizeof(BOOL_SETTINGS) / sizeof(BOOL_SETTINGS[0]); i++) {
+        if (key_equals(key, key_length, BOOL_SETTINGS[i].key)) {
+            bool* field = (bool*)(void*)((char*)config + BOOL_SETTINGS[i].offset);
+            return parse_bool(buffer, field);
+        }
+    }
+
+    if (key_equals(key, key_length, "server")) {
+        if (value_length == 0) {
+            return MONITOR_STATUS_PARSE_ERROR;
+        }
+        if (value_length >= sizeof(config->server_name)) {
+            return MONITOR_STATUS_RANGE_ERROR;
+        }
+        memcpy(config->server_name, buffer, value_length + 1);
+        return MONITOR_STATUS_OK;
+    }
+    if (key_equals(key, key_length, "publish_shm")) {
+        if (value_length >= sizeof(config->shm_name)) {
+            return MONITOR_STATUS_RANGE_ERROR;
+        }
+        memcpy(config->shm_name, buffer, value_length + 1);
+        return MONITOR_STATUS_OK;
+    }
+    if (key_equals(key, key_length, "watch_pids")) {
+        return parse_pid_list(buffer, config->watch_pids, MONITOR_THREADS_MAX_PIDS, &config->watch_pid_count);
+    }
+    if (key_equals(key, key_length, "probe")) {
+        return monitor_config_add_probe(config, buffer);
+    }
+    if (key_equals(key, key_length, "probe_cgroup")) {
+        snprintf(config->probe_cgroup, sizeof(config->probe_cgroup), "%s", buffer);
+        return MONITOR_STATUS_OK;
+    }
+    if (key_equals(key, key_length, "proc_root")) {
+        snprintf(config->proc_root, sizeof(config->proc_root), "%s", buffer);
+        return MONITOR_STATUS_OK;
+    }
+    if (key_equals(key, key_length, "log_format")) {
+        return monitor_log_parse_format(buffer, &config->log_format);
+    }
+    if (key_equals(key, key_length, "output_format")) {
+        return monitor_output_parse_format(buffer, &config->output_format);
+    }
+
+    return MONITOR_STATUS_UNSUPPORTED;
+}
+
+static MonitorStatus apply_alert_key(ConfigRules* rules, const char* key, size_t key_length,
+                                     const char* value, size_t value_length) {
+    AlertRule* rule = &rules->rules[rules->count - 1];
+
+    if (key_equals(key, key_length, "metric")) {
+        return parse_metric(value, value_length, &rule->metric);
+    }
+    if (key_equals(key, key_length, "warning")) {
+        return parse_double_value(value, value_length, &rule->warning_threshold);
+    }
+    if (key_equals(key, key_length, "critical")) {
+        return parse_double_value(value, value_length, &rule->critical_threshold);
+    }
+    if (key_equals(key, key_length, "hysteresis")) {
+        return parse_double_value(value, value_length, &rule->hysteresis);
+    }
+    if (key_equals(key, key_length, "for_ms")) {
+        return parse_int_value(value, value_length, 0, MONITOR_MAX_DURATION_MS, &rule->for_ms);
+    }
+    if (key_equals(key, key_length, "interval_ms")) {
+        return parse_int_value(value, value_length, 0, MONITOR_MAX_DURATION_MS, &rule->min_notify_interval_ms);
+    }
+    if (key_equals(key, key_length, "notify")) {
+        size_t slot = 0;
+        if (value_length == 0) {
+            return MONITOR_STATUS_PARSE_ERROR;
+        }
+        return intern_string(rules, value, value_length, &rules->notify_offsets[rules->count - 1], &slot);
+    }
+
+    return MONITOR_STATUS_UNSUPPORTED;
+}
+
+/**
+ * Parses INI text onto config and appends its [alert.NAME] sections to rules.
+ *
+ * Settings not present in the text keep their current values, so callers
+ * layer the file between defaults and the environment.
+ *
+ * @param text File contents (need not be NUL-terminated).
+ * @param length Number of bytes in text.
+ * @param config Configuration to update.
+ * @param rules Builder receiving alert rules and interned strings.
+ * @param error Optional buffer for a "line N: ..." message.
+ * @param error_size Size of the error buffer.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_config_parse_ini(const char* text,
+                                       size_t length,
+                                       MonitorConfig* config,
+                                       ConfigRules* rules,
+                                       char* error,
+                                       size_t error_size) {
+    const char* cursor = text;
+    const char* end = text + length;
+    int section = SECTION_NONE;
+    size_t line_number = 0;
+
+    if (!text || !config || !rules) {
+        set_errorf(error, error_size, "invalid arguments");
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    while (cursor < end) {
+        const char* line_end = memchr(cursor, '\n', (size_t)(end - cursor));
+        if (!line_end) {
+            line_end = end;
+        }
+        line_number++;
+
+        const char* content_end = NULL;
+        const char* content = trim(cursor, line_end, &content_end);
+        cursor = line_end + 1;
+
+        if (content == content_end || *content == '#' || *content == ';') {
+            continue;
+        }
+
+        if (*content == '[') {
+            if (content_end[-1] != ']') {
+                set_errorf(error, error_size, "line %zu: unterminated section header", line_number);
+                return MONITOR_STATUS_PARSE_ERROR;
+            }
+            const char* name = content + 1;
+            size_t name_length = (size_t)(content_end - name) - 1;
+            if (key_equals(name, name_length, "monitor")) {
+                section = SECTION_MONITOR;
+                continue;
+            }
+            if (name_length > 6 && memcmp(name, "alert.", 6) == 0) {
+                size_t offset = 0;
+                size_t slot = 0;
+                MonitorStatus status = intern_string(rules, name + 6, name_length - 6, &offset, &slot);
+                if (status == MONITOR_STATUS_OK && rules->intern_is_rule_name[slot]) {
+                    set_errorf(error, error_size, "line %zu: duplicate alert '%s'", line_number, rules->strings + offset);
+                    return MONITOR_STATUS_INVALID_ARGUMENT;
+                }
+                if (status == MONITOR_STATUS_OK) {
+                    rules->intern_is_rule_name[slot] = 1;
+                    status = append_rule(rules, offset, config);
+                }
+                if (status != MONITOR_STATUS_OK) {
+                    set_errorf(error, error_size, "line %zu: out of memory", line_number);
+                    return status;
+                }
+                section = SECTION_ALERT;
+                continue;
+            }
+            set_errorf(error, error_size, "line %zu: unknown section", line_number);
+            return MONITOR_STATUS_PARSE_ERROR;
+        }
+
+        const char* equals = memchr(content, '=', (size_t)(content_end - content));
+        if (!equals) {
+            set_errorf(error, error_size, "line %zu: expected key = value", line_number);
+            return MONITOR_STATUS_PARSE_ERROR;
+        }
+
+        const char* key_end = NULL;
+        const char* key = trim(content, equals, &key_end);
+        const char* value_end = NULL;
+        const char* value = trim(equals + 1, content_end, &value_end);
+        const char* comment = find_inline_comment(value, value_end);
+        if (comment) {
+            value = trim(value, comment, &value_end);
+        }
+        if (value_end - value >= 2 && *value == '"' && value_end[-1] == '"') {
+            value++;
+            value_end--;
+        }
+
+        size_t key_length = (size_t)(key_end - key);
+        size_t value_length = (size_t)(value_end - value);
+        MonitorStatus status = MONITOR_STATUS_UNSUPPORTED;
+        if (section == SECTION_MONITOR) {
+            status = apply_monitor_key(config, key, key_length, value, value_length);
+        } else if (section == SECTION_ALERT) {
+            status = apply_alert_key(rules, key, key_length, value, value_length);
+        }
+
+        if (status == MONITOR_STATUS_UNSUPPORTED) {
+            set_errorf(error, error_size, "line %zu: unknown key '%.*s'", line_number, (int)key_length, key);
+            return MONITOR_STATUS_PARSE_ERROR;
+        }
+        if (status != MONITOR_STATUS_OK) {
+            set_errorf(error, error_size, "line %zu: invalid value for '%.*s'", line_number, (int)key_length, key);
+            return status;
+        }
+    }
+
+    if (config->output_format != MONITOR_OUTPUT_TEXT || config->daemon) {
+        config->non_interactive = true;
+    }
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Reads path and parses it with monitor_config_parse_ini().
+ *
+ * @param path File to read.
+ * @param config Configuration to update.
+ * @param rules Builder receiving alert rules.
+ * @param error Optional buffer for error messages.
+ * @param error_size Size of the error buffer.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_config_apply_file(const char* path,
+                                        MonitorConfig* config,
+                                        ConfigRules* rules,
+                                        char* error,
+                                        size_t error_size) {
+    struct stat info;
+    size_t length = 0;
+
+    if (!path || !config || !rules) {
+        set_errorf(error, error_size, "invalid arguments");
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        set_errorf(error, error_size, "cannot open config file %s", path);
+        return MONITOR_STATUS_IO_ERROR;
+    }
+    if (fstat(fd, &info) != 0 || info.st_size < 0 || info.st_size > MONITOR_CONFIG_MAX_FILE_BYTES) {
+        close(fd);
+        set_errorf(error, error_size, "config file %s is too large", path);
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+
+    char* text = malloc((size_t)info.st_size + 1);
+    if (!text) {
+        close(fd);
+        set_errorf(error, error_size, "out of memory");
+        return MONITOR_STATUS_INTERNAL_ERROR;
+    }
+
+    while (length < (size_t)info.st_size) {
+        ssize_t count = read(fd, text + length, (size_t)info.st_size - length);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
+        }
+        length += (size_t)count;
+    }
+    close(fd);
+
+    MonitorStatus status = monitor_config_parse_ini(text, length, config, rules, error, error_size);
+    free(text);
+    return status;
+}
+
+/**
+ * Finds the config file named by --config PATH or SHM_CONFIG.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @return The path, or NULL when no file was requested.
+ */
+const char* monitor_config_find_path(int argc, char** argv) {
+    for (int i = 1; argv && i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--config") == 0) {
+            return argv[i + 1];
+        }
+    }
+
+    const char* value = getenv("SHM_CONFIG");
+    return value && *value != '\0' ? value : NULL;
+}
+
+/**
+ * Builds a validated snapshot from defaults, the config file, the
+ * environment and argv, in that order of precedence. Used for the initial
+ * load and for daemon reloads.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @param out Receives the snapshot; free with monitor_config_snapshot_free().
+ * @param error Optional buffer for error messages.
+ * @param error_size Size of the error buffer.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_config_load(int argc, char** argv, MonitorConfigSnapshot** out, char* error, size_t error_size) {
+    MonitorConfig config;
+    ConfigRules rules;
+    bool show_help = false;
+    MonitorStatus status = MONITOR_STATUS_OK;
+
+    if (!argv || !out) {
+        set_errorf(error, error_size, "invalid arguments");
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    monitor_config_init(&config);
+    monitor_config_rules_init(&rules);
+
+    const char* path = monitor_config_find_path(argc, argv);
+    if (path) {
+        status = monitor_config_apply_file(path, &config, &rules, error, error_size);
+    }
+    if (status == MONITOR_STATUS_OK) {
+        status = monitor_config_apply_env(&config, error, error_size);
+    }
+    if (status == MONITOR_STATUS_OK) {
+        status = monitor_config_apply_args(&config, argc, argv, &show_help, error, error_size);
+    }
+    if (status == MONITOR_STATUS_OK) {
+        status = monitor_config_snapshot_create(&config, &rules, out, error, error_size);
+    }
+
+    monitor_config_rules_free(&rules);
+    return status;
+}
+
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * Validates config and rules once and packs them into an immutable snapshot.
+ *
+ * @param config Fully layered configuration.
+ * @param rules Rules from the config file, or NULL.
+ * @param out Receives the snapshot; free with monitor_config_snapshot_free().
+ * @param error Optional buffer for error messages.
+ * @param error_size Size of the error buffer.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_config_snapshot_create(const MonitorConfig* config,
+                                             const ConfigRules* rules,
+                                             MonitorConfigSnapshot** out,
+                                             char* error,
+                                             size_t error_size) {
+    static const ConfigRules no_rules;
+
+    if (!config || !out) {
+        set_errorf(error, error_size, "invalid arguments");
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+    if (!rules) {
+        rules = &no_rules;
+    }
+
+    size_t rules_offset = align_up(sizeof(MonitorConfigSnapshot), _Alignof(AlertRule));
+    size_t names_offset = align_up(rules_offset + rules->count * sizeof(AlertRule), _Alignof(const char*));
+    size_t notify_offset = names_offset + rules->count * sizeof(const char*);
+    size_t strings_offset = notify_offset + rules->count * sizeof(const char*);
+    char* block = malloc(strings_offset + rules->strings_size + 1);
+    if (!block) {
+        set_errorf(error, error_size, "out of memory");
+        return MONITOR_STATUS_INTERNAL_ERROR;
+    }
+
+    MonitorConfigSnapshot* snapshot = (MonitorConfigSnapshot*)(void*)block;
+    AlertRule* packed_rules = (AlertRule*)(void*)(block + rules_offset);
+    const char** names = (const char**)(void*)(block + names_offset);
+    const char** notify = (const char**)(void*)(block + notify_offset);
+    char* strings = block + strings_offset;
+
+    if (rules->count > 0) {
+        memcpy(packed_rules, rules->rules, rules->count * sizeof(AlertRule));
+    }
+    if (rules->strings_size > 0) {
+        memcpy(strings, rules->strings, rules->strings_size);
+    }
+    strings[rules->strings_size] = '\0';
+    for (size_t i = 0; i < rules->count; i++) {
+        names[i] = strings + rules->name_offsets[i];
+        notify[i] = rules->notify_offsets[i] == NO_STRING ? NULL : strings + rules->notify_offsets[i];
+    }
+
+    snapshot->config = *config;
+    snapshot->rules = packed_rules;
+    snapshot->rule_names = names;
+    snapshot->rule_notify = notify;
+    snapshot->rule_count = rules->count;
+    snapshot->strings_size = rules->strings_size;
+
+    MonitorStatus status = monitor_config_snapshot_validate(snapshot, error, error_size);
+    if (status != MONITOR_STATUS_OK) {
+        free(block);
+        return status;
+    }
+
+    *out = snapshot;
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Validates the scalar settings with monitor_config_validate() and every
+ * file alert rule.
+ *
+ * @param snapshot Snapshot to check.
+ * @param error Optional buffer for error messages.
+ * @param error_size Size of the error buffer.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_config_snapshot_validate(const MonitorConfigSnapshot* snapshot, char* error, size_t error_size) {
+    if (!snapshot) {
+        set_errorf(error, error_size, "snapshot is null");
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    MonitorStatus status = monitor_config_validate(&snapshot->config, error, error_size);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+
+    for (size_t i = 0; i < snapshot->rule_count; i++) {
+        const AlertRule* rule = &snapshot->rules[i];
+        const char* name = snapshot->rule_names[i];
+        if (rule->metric >= MONITOR_METRIC_COUNT) {
+            set_errorf(error, error_size, "alert '%s' needs a metric", name);
+            return MONITOR_STATUS_INVALID_ARGUMENT;
+        }
+        if (!isfinite(rule->warning_threshold) || !isfinite(rule->critical_threshold) ||
+            !isfinite(rule->hysteresis)) {
+            set_errorf(error, error_size, "alert '%s' needs finite thresholds", name);
+            return MONITOR_STATUS_RANGE_ERROR;
+        }
+        if (rule->warning_threshold < 0.0 || rule->warning_threshold >= rule->critical_threshold) {
+            set_errorf(error, error_size, "alert '%s' needs 0 <= warning < critical", name);
+            return MONITOR_STATUS_RANGE_ERROR;
+        }
+        if (rule->hysteresis < 0.0 || rule->hysteresis > rule->warning_threshold) {
+            set_errorf(error, error_size, "alert '%s' hysteresis must be within [0, warning]", name);
+            return MONITOR_STATUS_RANGE_ERROR;
+        }
+    }
+
+    return MONITOR_STATUS_OK;
+}
+
+void monitor_config_snapshot_free(MonitorConfigSnapshot* snapshot) {
+    free(snapshot);
+}
+
+void monitor_config_store_init(MonitorConfigStore* store) {
+    if (!store) {
+        return;
+    }
+
+    memset(store, 0, sizeof(*store));
+    atomic_init(&store->current, NULL);
+    atomic_init(&store->publish_epoch, 0);
+    atomic_init(&store->reader_epoch, 0);
+}
+
+static void reclaim_retired(MonitorConfigStore* store) {
+    unsigned long long safe_epoch = atomic_load_explicit(&store->reader_epoch, memory_order_acquire);
+    size_t kept = 0;
+
+    for (size_t i = 0; i < store->retired_count; i++) {
+        if (store->retired_epoch[i] <= safe_epoch) {
+            monitor_config_snapshot_free(store->retired[i]);
+        } else {
+            store->retired[kept] = store->retired[i];
+            store->retired_epoch[kept] = store->retired_epoch[i];
+            kept++;
+        }
+    }
+    store->retired_count = kept;
+}
+
+/**
+ * Atomically replaces the current snapshot. The previous one is freed once
+ * the reader has passed a quiescent point after this call.
+ *
+ * @param store Store to update.
+ * @param snapshot Validated snapshot; ownership moves to the store.
+ * @return MONITOR_STATUS_RANGE_ERROR when the reader has not caught up with
+ *         MONITOR_CONFIG_MAX_RETIRED earlier publications.
+ */
+MonitorStatus monitor_config_store_publish(MonitorConfigStore* store, MonitorConfigSnapshot* snapshot) {
+    if (!store || !snapshot) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    reclaim_retired(store);
+    if (store->retired_count == MONITOR_CONFIG_MAX_RETIRED) {
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+
+    MonitorConfigSnapshot* previous = atomic_exchange_explicit(&store->current, snapshot, memory_order_acq_rel);
+    unsigned long long epoch = atomic_fetch_add_explicit(&store->publish_epoch, 1, memory_order_acq_rel) + 1;
+    if (previous) {
+        store->retired[store->retired_count] = previous;
+        store->retired_epoch[store->retired_count] = epoch;
+        store->retired_count++;
+    }
+    return MONITOR_STATUS_OK;
+}
+
+const MonitorConfigSnapshot* monitor_config_store_acquire(MonitorConfigStore* store) {
+    return store ? atomic_load_explicit(&store->current, memory_order_acquire) : NULL;
+}
+
+/**
+ * Declares that the reader holds no snapshot obtained before this call.
+ *
+ * @param store Store being read.
+ */
+void monitor_config_store_quiescent(MonitorConfigStore* store) {
+    if (store) {
+        unsigned long long epoch = atomic_load_explicit(&store->publish_epoch, memory_order_acquire);
+        atomic_store_explicit(&store->reader_epoch, epoch, memory_order_release);
+    }
+}
+
+void monitor_config_store_free(MonitorConfigStore* store) {
+    if (!store) {
+        return;
+    }
+
+    for (size_t i = 0; i < store->retired_count; i++) {
+        monitor_config_snapshot_free(store->retired[i]);
+    }
+    monitor_config_snapshot_free(atomic_exchange_explicit(&store->current, NULL, memory_order_acq_rel));
+    store->retired_count = 0;
+}
@@ -0,0 +1,117 @@
+#ifndef MONITOR_CONFIG_FILE_H
+#define MONITOR_CONFIG_FILE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "monitor_alert.h"
+#include "monitor_config.h"
+#include "monitor_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * INI configuration files and immutable config snapshots.
+ *
+ * A file has a [monitor] section with the same settings as the command line
+ * and any number of [alert.NAME] sections:
+ *
+ *   [monitor]
+ *   server = prod-01
+ *   interval_ms = 1000
+ *
+ *   [alert.api-cpu]
+ *   metric = cpu_percent        ; cpu_percent, ram_percent or ram_used_gb
+ *   warning = 70
+ *   critical = 90
+ *   hysteresis = 5              ; optional
+ *   for_ms = 30000              ; optional
+ *   interval_ms = 300000        ; optional, defaults to alert_interval_ms
+ *   notify = oncall             ; optional
+ *
+ * Precedence is defaults < file < environment < arguments. Parsing fills a
+ * ConfigRules builder; monitor_config_snapshot_create() validates the result
+ * once and packs the config, a flat AlertRule array and every interned
+ * string into a single allocation. Published snapshots are never modified.
+ */
+#define MONITOR_CONFIG_MAX_FILE_BYTES (64 * 1024 * 1024)
+#define MONITOR_CONFIG_MAX_RETIRED 8
+
+typedef struct {
+    AlertRule* rules;
+    size_t* name_offsets;
+    size_t* notify_offsets;
+    size_t count;
+    size_t capacity;
+    char* strings;
+    size_t strings_size;
+    size_t strings_capacity;
+    size_t* intern_slots;
+    unsigned char* intern_is_rule_name;
+    size_t intern_capacity;
+    size_t intern_count;
+} ConfigRules;
+
+typedef struct {
+    MonitorConfig config;
+    const AlertRule* rules;
+    const char* const* rule_names;
+    const char* const* rule_notify;
+    size_t rule_count;
+    size_t strings_size;
+} MonitorConfigSnapshot;
+
+/*
+ * Single-reader publication point. The reader loads the current snapshot
+ * without locks and calls monitor_config_store_quiescent() when it holds no
+ * snapshot pointers (for example between ticks); the publisher frees retired
+ * snapshots only after that.
+ */
+typedef struct {
+    _Atomic(MonitorConfigSnapshot*) current;
+    atomic_ullong publish_epoch;
+    atomic_ullong reader_epoch;
+    MonitorConfigSnapshot* retired[MONITOR_CONFIG_MAX_RETIRED];
+    unsigned long long retired_epoch[MONITOR_CONFIG_MAX_RETIRED];
+    size_t retired_count;
+} MonitorConfigStore;
+
+void monitor_config_rules_init(ConfigRules* rules);
+void monitor_config_rules_free(ConfigRules* rules);
+MonitorStatus monitor_config_parse_ini(const char* text,
+                                       size_t length,
+                                       MonitorConfig* config,
+                                       ConfigRules* rules,
+                                       char* error,
+                                       size_t error_size);
+MonitorStatus monitor_config_apply_file(const char* path,
+                                        MonitorConfig* config,
+                                        ConfigRules* rules,
+                                        char* error,
+                                        size_t error_size);
+const char* monitor_config_find_path(int argc, char** argv);
+
+MonitorStatus monitor_config_load(int argc, char** argv, MonitorConfigSnapshot** out, char* error, size_t error_size);
+
+MonitorStatus monitor_config_snapshot_create(const MonitorConfig* config,
+                                             const ConfigRules* rules,
+                                             MonitorConfigSnapshot** out,
+                                             char* error,
+                                             size_t error_size);
+MonitorStatus monitor_config_snapshot_validate(const MonitorConfigSnapshot* snapshot, char* error, size_t error_size);
+void monitor_config_snapshot_free(MonitorConfigSnapshot* snapshot);
+
+void monitor_config_store_init(MonitorConfigStore* store);
+MonitorStatus monitor_config_store_publish(MonitorConfigStore* store, MonitorConfigSnapshot* snapshot);
+const MonitorConfigSnapshot* monitor_config_store_acquire(MonitorConfigStore* store);
+void monitor_config_store_quiescent(MonitorConfigStore* store);
+void monitor_config_store_free(MonitorConfigStore* store);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_CONFIG_FILE_H
@@ -0,0 +1,169 @@
+#define _GNU_SOURCE
+
+#include "monitor_daemon.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+static void build_signal_set(sigset_t* set) {
+    sigemptyset(set);
+    sigaddset(set, SIGHUP);
+    sigaddset(set, SIGTERM);
+    sigaddset(set, SIGINT);
+    sigaddset(set, SIGUSR1);
+}
+
+/**
+ * Blocks the daemon signals and creates the signalfd and timerfd.
+ *
+ * @param loop Loop to initialise.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_event_loop_init(MonitorEventLoop* loop) {
+    sigset_t set;
+
+    if (!loop) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    memset(loop, 0, sizeof(*loop));
+    loop->signal_fd = -1;
+    loop->timer_fd = -1;
+
+    build_signal_set(&set);
+    if (sigprocmask(SIG_BLOCK, &set, &loop->previous_mask) != 0) {
+        return MONITOR_STATUS_INTERNAL_ERROR;
+    }
+
+    loop->signal_fd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+    loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (loop->signal_fd < 0 || loop->timer_fd < 0) {
+        if (loop->signal_fd < 0) {
+            sigprocmask(SIG_SETMASK, &loop->previous_mask, NULL);
+        }
+        monitor_event_loop_close(loop);
+        return MONITOR_STATUS_IO_ERROR;
+    }
+
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * (Re)arms the tick timer. The first tick fires immediately.
+ *
+ * @param loop Initialised loop.
+ * @param interval_ms Tick period in milliseconds.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_event_loop_arm(MonitorEventLoop* loop, int interval_ms) {
+    struct itimerspec spec;
+
+    if (!loop || loop->timer_fd < 0 || interval_ms <= 0) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    spec.it_interval.tv_sec = interval_ms / 1000;
+    spec.it_interval.tv_nsec = (long)(interval_ms % 1000) * 1000000L;
+    spec.it_value.tv_sec = 0;
+    spec.it_value.tv_nsec = 1;
+    if (timerfd_settime(loop->timer_fd, 0, &spec, NULL) != 0) {
+        return MONITOR_STATUS_IO_ERROR;
+    }
+    return MONITOR_STATUS_OK;
+}
+
+static bool read_signal(MonitorEventLoop* loop, MonitorEventType* out) {
+    struct signalfd_siginfo info;
+    ssize_t count = read(loop->signal_fd, &info, sizeof(info));
+    if (count != (ssize_t)sizeof(info)) {
+        return false;
+    }
+
+    switch (info.ssi_signo) {
+        case SIGHUP:
+            *out = MONITOR_EVENT_RELOAD;
+            return true;
+        case SIGUSR1:
+            *out = MONITOR_EVENT_REPORT;
+            return true;
+        default:
+            *out = MONITOR_EVENT_STOP;
+            return true;
+    }
+}
+
+static bool read_tick(MonitorEventLoop* loop, MonitorEventType* out) {
+    uint64_t expirations = 0;
+    ssize_t count = read(loop->timer_fd, &expirations, sizeof(expirations));
+    if (count != (ssize_t)sizeof(expirations) || expirations == 0) {
+        return false;
+    }
+
+    loop->ticks++;
+    loop->missed_ticks += expirations - 1;
+    *out = MONITOR_EVENT_TICK;
+    return true;
+}
+
+/**
+ * Blocks until the next signal or tick.
+ *
+ * Overrun timer expirations are coalesced into one tick and counted in
+ * missed_ticks.
+ *
+ * @param loop Initialised loop.
+ * @param out Receives the event.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_event_loop_wait(MonitorEventLoop* loop, MonitorEventType* out) {
+    if (!loop || !out || loop->signal_fd < 0 || loop->timer_fd < 0) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    while (true) {
+        struct pollfd fds[2] = {
+            {loop->signal_fd, POLLIN, 0},
+            {loop->timer_fd, POLLIN, 0}
+        };
+
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return MONITOR_STATUS_IO_ERROR;
+        }
+
+        if ((fds[0].revents & POLLIN) && read_signal(loop, out)) {
+            return MONITOR_STATUS_OK;
+        }
+        if ((fds[1].revents & POLLIN) && read_tick(loop, out)) {
+            return MONITOR_STATUS_OK;
+        }
+    }
+}
+
+/**
+ * Closes the descriptors and restores the signal mask saved by init.
+ *
+ * @param loop Loop to close; safe to call more than once.
+ */
+void monitor_event_loop_close(MonitorEventLoop* loop) {
+    if (!loop) {
+        return;
+    }
+
+    if (loop->signal_fd >= 0) {
+        close(loop->signal_fd);
+        loop->signal_fd = -1;
+        sigprocmask(SIG_SETMASK, &loop->previous_mask, NULL);
+    }
+    if (loop->timer_fd >= 0) {
+        close(loop->timer_fd);
+        loop->timer_fd = -1;
+    }
+}
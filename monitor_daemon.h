@@ -0,0 +1,47 @@
+#ifndef MONITOR_DAEMON_H
+#define MONITOR_DAEMON_H
+
+#include <signal.h>
+#include <stdint.h>
+
+#include "monitor_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Event loop for daemon mode.
+ *
+ * SIGHUP, SIGTERM, SIGINT and SIGUSR1 are blocked and read from a signalfd;
+ * sampling ticks come from a periodic timerfd. Both are polled together, so
+ * signals are handled synchronously between ticks and never interrupt a
+ * collector. Signals take priority over a pending tick.
+ * Initialise the loop before starting any other thread so every thread
+ * inherits the blocked mask and the signals reach the signalfd.
+ */
+typedef enum {
+    MONITOR_EVENT_TICK = 0,
+    MONITOR_EVENT_RELOAD,
+    MONITOR_EVENT_REPORT,
+    MONITOR_EVENT_STOP
+} MonitorEventType;
+
+typedef struct {
+    int signal_fd;
+    int timer_fd;
+    sigset_t previous_mask;
+    uint64_t ticks;
+    uint64_t missed_ticks;
+} MonitorEventLoop;
+
+MonitorStatus monitor_event_loop_init(MonitorEventLoop* loop);
+MonitorStatus monitor_event_loop_arm(MonitorEventLoop* loop, int interval_ms);
+MonitorStatus monitor_event_loop_wait(MonitorEventLoop* loop, MonitorEventType* out);
+void monitor_event_loop_close(MonitorEventLoop* loop);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_DAEMON_H
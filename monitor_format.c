@@ -0,0 +1,492 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "monitor_format.h"
+
+#include "monitor.h"
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+enum {
+    MAX_FIXED_DECIMALS = 9
+};
+
+static const unsigned long long POWERS_OF_TEN[MAX_FIXED_DECIMALS + 1] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL,
+    1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL
+};
+
+/* The optional column groups follow the fixed ones, in the order render_csv() writes them. */
+static const char CSV_HEADER[] =
+    "timestamp_ms,server,cpu_percent,ram_percent,ram_used_gb,ram_total_gb,cpu_alert,ram_alert,anomalies";
+static const char CSV_SELF_STATS_COLUMNS[] = ",self_collect_us,self_tick_us";
+static const char CSV_PROBE_CACHE_COLUMNS[] = ",probe_cache_hits,probe_cache_misses,probe_coalesced";
+
+static size_t copy_literal(char* out, size_t size, const char* text, size_t length) {
+    if (length > size) {
+        return 0;
+    }
+    memcpy(out, text, length);
+    return length;
+}
+
+/**
+ * Writes the decimal digits of value without a terminator.
+ *
+ * @return Number of characters written, or 0 if out is too small.
+ */
+size_t monitor_format_uint(char* out, size_t size, unsigned long long value) {
+    char digits[20];
+    size_t count = 0;
+
+    if (!out) {
+        return 0;
+    }
+
+    do {
+        digits[count++] = (char)('0' + (value % 10ULL));
+        value /= 10ULL;
+    } while (value != 0);
+
+    if (count > size) {
+        return 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+size_t monitor_format_int(char* out, size_t size, long long value) {
+    unsigned long long magnitude = 0;
+
+    if (!out || size == 0) {
+        return 0;
+    }
+
+    if (value >= 0) {
+        return monitor_format_uint(out, size, (unsigned long long)value);
+    }
+
+    magnitude = (unsigned long long)(-(value + 1)) + 1ULL;
+    size_t written = monitor_format_uint(out + 1, size - 1, magnitude);
+    if (written == 0) {
+        return 0;
+    }
+    out[0] = '-';
+    return written + 1;
+}
+
+/**
+ * Writes value in fixed-point notation with the given number of decimals,
+ * rounding half away from zero. Non-finite values are written as "nan",
+ * "inf" or "-inf"; magnitudes that do not fit in 64-bit fixed point fail.
+ *
+ * @return Number of characters written, or 0 on failure.
+ */
+size_t monitor_format_fixed(char* out, size_t size, double value, unsigned decimals) {
+    size_t used = 0;
+
+    if (!out || decimals > MAX_FIXED_DECIMALS) {
+        return 0;
+    }
+
+    if (isnan(value)) {
+        return copy_literal(out, size, "nan", 3);
+    }
+    if (isinf(value)) {
+        return value > 0 ? copy_literal(out, size, "inf", 3) : copy_literal(out, size, "-inf", 4);
+    }
+
+    unsigned long long scale = POWERS_OF_TEN[decimals];
+    double magnitude = fabs(value) * (double)scale + 0.5;
+    if (magnitude >= 18446744073709549568.0) {
+        return 0;
+    }
+
+    unsigned long long scaled = (unsigned long long)magnitude;
+    if (value < 0.0 && scaled != 0) {
+        if (size == 0) {
+            return 0;
+        }
+        out[used++] = '-';
+    }
+
+    size_t written = monitor_format_uint(out + used, size - used, scaled / scale);
+    if (written == 0) {
+        return 0;
+    }
+    used += written;
+
+    if (decimals == 0) {
+        return used;
+    }
+    if (used + 1 + decimals > size) {
+        return 0;
+    }
+
+    unsigned long long fraction = scaled % scale;
+    out[used++] = '.';
+    for (unsigned i = decimals; i > 0; i--) {
+        out[used + i - 1] = (char)('0' + (fraction % 10ULL));
+        fraction /= 10ULL;
+    }
+    return used + decimals;
+}
+
+MonitorStatus monitor_output_parse_format(const char* value, MonitorOutputFormat* out) {
+    if (!value || !out) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (strcasecmp(value, "text") == 0) {
+        *out = MONITOR_OUTPUT_TEXT;
+    } else if (strcasecmp(value, "json") == 0) {
+        *out = MONITOR_OUTPUT_JSON;
+    } else if (strcasecmp(value, "csv") == 0) {
+        *out = MONITOR_OUTPUT_CSV;
+    } else {
+        return MONITOR_STATUS_PARSE_ERROR;
+    }
+    return MONITOR_STATUS_OK;
+}
+
+const char* monitor_output_format_name(MonitorOutputFormat format) {
+    switch (format) {
+        case MONITOR_OUTPUT_JSON:
+            return "json";
+        case MONITOR_OUTPUT_CSV:
+            return "csv";
+        default:
+            return "text";
+    }
+}
+
+/**
+ * Prepares a writer over caller-owned storage. The writer never allocates.
+ *
+ * @param writer Writer to initialise.
+ * @param storage Buffer reused for every batch; must hold at least one record.
+ * @param capacity Size of storage in bytes.
+ * @param fd Destination descriptor, or -1 to discard output.
+ * @param format MONITOR_OUTPUT_JSON or MONITOR_OUTPUT_CSV.
+ * @param batch_records Records buffered before a write(2) is issued.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_output_init(OutputWriter* writer,
+                                  char* storage,
+                                  size_t capacity,
+                                  int fd,
+                                  MonitorOutputFormat format,
+                                  size_t batch_records) {
+    if (!writer || !storage || capacity < MONITOR_OUTPUT_MAX_RECORD_BYTES || batch_records == 0) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (format != MONITOR_OUTPUT_JSON && format != MONITOR_OUTPUT_CSV) {
+        return MONITOR_STATUS_UNSUPPORTED;
+    }
+
+    memset(writer, 0, sizeof(*writer));
+    writer->data = storage;
+    writer->capacity = capacity;
+    writer->fd = fd;
+    writer->format = format;
+    writer->batch_records = batch_records;
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Writes every buffered byte to the destination descriptor. On a write error
+ * the bytes already written are dropped from the buffer, so the next flush
+ * resumes after them instead of writing them again.
+ *
+ * @param writer Writer to flush.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_output_flush(OutputWriter* writer) {
+    size_t offset = 0;
+
+    if (!writer) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    while (writer->fd >= 0 && offset < writer->length) {
+        ssize_t written = write(writer->fd, writer->data + offset, writer->length - offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            int write_error = errno;
+            memmove(writer->data, writer->data + offset, writer->length - offset);
+            writer->length -= offset;
+            return monitor_error_set(MONITOR_STATUS_IO_ERROR, write_error, NULL, 0, -1);
+        }
+        offset += (size_t)written;
+    }
+
+    if (writer->length > 0) {
+        writer->flushes++;
+    }
+    writer->length = 0;
+    writer->pending_records = 0;
+    return MONITOR_STATUS_OK;
+}
+
+typedef struct {
+    char* data;
+    size_t used;
+    size_t limit;
+    bool overflow;
+} Cursor;
+
+static void put_bytes(Cursor* cursor, const char* text, size_t length) {
+    if (cursor->overflow || length > cursor->limit - cursor->used) {
+        cursor->overflow = true;
+        return;
+    }
+    memcpy(cursor->data + cursor->used, text, length);
+    cursor->used += length;
+}
+
+static void put_text(Cursor* cursor, const char* text) {
+    put_bytes(cursor, text, strlen(text));
+}
+
+static void put_char(Cursor* cursor, char c) {
+    put_bytes(cursor, &c, 1);
+}
+
+static void put_int(Cursor* cursor, long long value) {
+    size_t written = cursor->overflow ? 0
+                                      : monitor_format_int(cursor->data + cursor->used, cursor->limit - cursor->used, value);
+    if (written == 0) {
+        cursor->overflow = true;
+        return;
+    }
+    cursor->used += written;
+}
+
+static void put_uint(Cursor* cursor, unsigned long long value) {
+    size_t written = cursor->overflow ? 0
+                                      : monitor_format_uint(cursor->data + cursor->used, cursor->limit - cursor->used, value);
+    if (written == 0) {
+        cursor->overflow = true;
+        return;
+    }
+    cursor->used += written;
+}
+
+static void put_fixed(Cursor* cursor, double value, bool json) {
+    if (json && !isfinite(value)) {
+        put_text(cursor, "null");
+        return;
+    }
+
+    size_t written = cursor->overflow
+                         ? 0
+                         : monitor_format_fixed(cursor->data + cursor->used, cursor->limit - cursor->used, value, 2);
+    if (written == 0) {
+        cursor->overflow = true;
+        return;
+    }
+    cursor->used += written;
+}
+
+static void put_json_string(Cursor* cursor, const char* text) {
+    static const char hex[] = "0123456789abcdef";
+
+    put_char(cursor, '"');
+    for (const unsigned char* p = (const unsigned char*)(text ? text : ""); *p != '\0'; p++) {
+        if (*p == '"' || *p == '\\') {
+            put_char(cursor, '\\');
+            put_char(cursor, (char)*p);
+        } else if (*p < 0x20) {
+            char escaped[6] = {'\\', 'u', '0', '0', hex[*p >> 4], hex[*p & 0xF]};
+            put_bytes(cursor, escaped, sizeof(escaped));
+        } else {
+            put_char(cursor, (char)*p);
+        }
+    }
+    put_char(cursor, '"');
+}
+
+static void put_csv_field(Cursor* cursor, const char* text) {
+    const char* value = text ? text : "";
+
+    if (strpbrk(value, ",\"\r\n") == NULL) {
+        put_text(cursor, value);
+        return;
+    }
+
+    put_char(cursor, '"');
+    for (const char* p = value; *p != '\0'; p++) {
+        if (*p == '"') {
+            put_char(cursor, '"');
+        }
+        put_char(cursor, *p);
+    }
+    put_char(cursor, '"');
+}
+
+static void put_json_anomalies(Cursor* cursor, const HealthRecord* record) {
+    put_text(cursor, ",\"anomalies\":[");
+    for (size_t i = 0; i < record->anomaly_count; i++) {
+        const AnomalyEvent* event = &record->anomalies[i];
+        put_text(cursor, i == 0 ? "{\"metric\":" : ",{\"metric\":");
+        put_json_string(cursor, monitor_metric_key((MonitorMetric)event->metric));
+        put_text(cursor, ",\"kind\":");
+        put_json_string(cursor, monitor_anomaly_kind_name(event->flags));
+        put_text(cursor, ",\"expected\":");
+        put_fixed(cursor, event->expected, true);
+        put_text(cursor, ",\"z\":");
+        put_fixed(cursor, event->score, true);
+        put_char(cursor, '}');
+    }
+    put_char(cursor, ']');
+}
+
+/* One metric:kind pair per anomaly, separated by ';' so the field never needs quoting. */
+static void put_csv_anomalies(Cursor* cursor, const HealthRecord* record) {
+    for (size_t i = 0; i < record->anomaly_count; i++) {
+        const AnomalyEvent* event = &record->anomalies[i];
+        if (i > 0) {
+            put_char(cursor, ';');
+        }
+        put_text(cursor, monitor_metric_key((MonitorMetric)event->metric));
+        put_char(cursor, ':');
+        put_text(cursor, monitor_anomaly_kind_name(event->flags));
+    }
+}
+
+static void render_json(Cursor* cursor, const HealthRecord* record) {
+    put_text(cursor, "{\"timestamp_ms\":");
+    put_int(cursor, record->timestamp_ms);
+    put_text(cursor, ",\"server\":");
+    put_json_string(cursor, record->server);
+    put_text(cursor, ",\"cpu_percent\":");
+    put_fixed(cursor, record->cpu_percent, true);
+    put_text(cursor, ",\"ram_percent\":");
+    put_fixed(cursor, record->ram_percent, true);
+    put_text(cursor, ",\"ram_used_gb\":");
+    put_fixed(cursor, record->ram_used_gb, true);
+    put_text(cursor, ",\"ram_total_gb\":");
+    put_fixed(cursor, record->ram_total_gb, true);
+    put_text(cursor, ",\"cpu_alert\":");
+    put_json_string(cursor, record->cpu_alert);
+    put_text(cursor, ",\"ram_alert\":");
+    put_json_string(cursor, record->ram_alert);
+    if (record->anomaly_count > 0) {
+        put_json_anomalies(cursor, record);
+    }
+    if (record->has_self_stats) {
+        put_text(cursor, ",\"self_collect_us\":");
+        put_fixed(cursor, record->self_collect_us, true);
+        put_text(cursor, ",\"self_tick_us\":");
+        put_fixed(cursor, record->self_tick_us, true);
+    }
+    if (record->has_probe_cache) {
+        put_text(cursor, ",\"probe_cache_hits\":");
+        put_uint(cursor, record->probe_cache_hits);
+        put_text(cursor, ",\"probe_cache_misses\":");
+        put_uint(cursor, record->probe_cache_misses);
+        put_text(cursor, ",\"probe_coalesced\":");
+        put_uint(cursor, record->probe_coalesced);
+    }
+    put_text(cursor, "}\n");
+}
+
+static void render_csv(Cursor* cursor, const HealthRecord* record) {
+    put_int(cursor, record->timestamp_ms);
+    put_char(cursor, ',');
+    put_csv_field(cursor, record->server);
+    put_char(cursor, ',');
+    put_fixed(cursor, record->cpu_percent, false);
+    put_char(cursor, ',');
+    put_fixed(cursor, record->ram_percent, false);
+    put_char(cursor, ',');
+    put_fixed(cursor, record->ram_used_gb, false);
+    put_char(cursor, ',');
+    put_fixed(cursor, record->ram_total_gb, false);
+    put_char(cursor, ',');
+    put_csv_field(cursor, record->cpu_alert);
+    put_char(cursor, ',');
+    put_csv_field(cursor, record->ram_alert);
+    put_char(cursor, ',');
+    put_csv_anomalies(cursor, record);
+    if (record->has_self_stats) {
+        put_char(cursor, ',');
+        put_fixed(cursor, record->self_collect_us, false);
+        put_char(cursor, ',');
+        put_fixed(cursor, record->self_tick_us, false);
+    }
+    if (record->has_probe_cache) {
+        put_char(cursor, ',');
+        put_uint(cursor, record->probe_cache_hits);
+        put_char(cursor, ',');
+        put_uint(cursor, record->probe_cache_misses);
+        put_char(cursor, ',');
+        put_uint(cursor, record->probe_coalesced);
+    }
+    put_char(cursor, '\n');
+}
+
+/**
+ * Appends one record to the batch buffer, flushing when the batch is full or
+ * the buffer cannot hold another record.
+ *
+ * @param writer Writer created by monitor_output_init().
+ * @param record Values to render.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_output_write(OutputWriter* writer, const HealthRecord* record) {
+    MonitorStatus status = MONITOR_STATUS_OK;
+
+    if (!writer || !record || !writer->data) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (writer->capacity - writer->length < MONITOR_OUTPUT_MAX_RECORD_BYTES) {
+        status = monitor_output_flush(writer);
+        if (status != MONITOR_STATUS_OK) {
+            return status;
+        }
+    }
+
+    Cursor cursor = {writer->data + writer->length, 0, MONITOR_OUTPUT_MAX_RECORD_BYTES, false};
+    if (writer->format == MONITOR_OUTPUT_CSV) {
+        /* The header goes with the first record that fits; a rejected record takes it back. */
+        if (!writer->header_written) {
+            put_bytes(&cursor, CSV_HEADER, sizeof(CSV_HEADER) - 1);
+            if (record->has_self_stats) {
+                put_bytes(&cursor, CSV_SELF_STATS_COLUMNS, sizeof(CSV_SELF_STATS_COLUMNS) - 1);
+            }
+            if (record->has_probe_cache) {
+                put_bytes(&cursor, CSV_PROBE_CACHE_COLUMNS, sizeof(CSV_PROBE_CACHE_COLUMNS) - 1);
+            }
+            put_char(&cursor, '\n');
+        }
+        render_csv(&cursor, record);
+    } else {
+        render_json(&cursor, record);
+    }
+
+    if (cursor.overflow) {
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+
+    if (writer->format == MONITOR_OUTPUT_CSV) {
+        writer->header_written = true;
+    }
+    writer->length += cursor.used;
+    writer->pending_records++;
+    writer->records_written++;
+
+    if (writer->pending_records >= writer->batch_records) {
+        return monitor_output_flush(writer);
+    }
+    return MONITOR_STATUS_OK;
+}
@@ -0,0 +1,82 @@
+#ifndef MONITOR_FORMAT_H
+#define MONITOR_FORMAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "monitor_anomaly.h"
+#include "monitor_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Allocation-free record formatter for machine-readable output.
+ *
+ * Records are rendered without printf into a caller-provided buffer and
+ * written to a file descriptor in batches of batch_records.
+ */
+#define MONITOR_OUTPUT_MAX_RECORD_BYTES 1024
+#define MONITOR_OUTPUT_DEFAULT_BATCH 1
+#define MONITOR_OUTPUT_MAX_BATCH 1024
+
+typedef enum {
+    MONITOR_OUTPUT_TEXT = 0,
+    MONITOR_OUTPUT_JSON,
+    MONITOR_OUTPUT_CSV
+} MonitorOutputFormat;
+
+typedef struct {
+    long long timestamp_ms;
+    const char* server;
+    double cpu_percent;
+    double ram_percent;
+    double ram_used_gb;
+    double ram_total_gb;
+    const char* cpu_alert;
+    const char* ram_alert;
+    bool has_self_stats;
+    double self_collect_us;
+    double self_tick_us;
+    const AnomalyEvent* anomalies;
+    size_t anomaly_count;
+    bool has_probe_cache; // probe result cache counters, cumulative since startup
+    unsigned long long probe_cache_hits;
+    unsigned long long probe_cache_misses;
+    unsigned long long probe_coalesced;
+} HealthRecord;
+
+typedef struct {
+    char* data;
+    size_t capacity;
+    size_t length;
+    int fd;
+    MonitorOutputFormat format;
+    size_t batch_records;
+    size_t pending_records;
+    bool header_written;
+    unsigned long long records_written;
+    unsigned long long flushes;
+} OutputWriter;
+
+size_t monitor_format_uint(char* out, size_t size, unsigned long long value);
+size_t monitor_format_int(char* out, size_t size, long long value);
+size_t monitor_format_fixed(char* out, size_t size, double value, unsigned decimals);
+
+MonitorStatus monitor_output_parse_format(const char* value, MonitorOutputFormat* out);
+const char* monitor_output_format_name(MonitorOutputFormat format);
+MonitorStatus monitor_output_init(OutputWriter* writer,
+                                  char* storage,
+                                  size_t capacity,
+                                  int fd,
+                                  MonitorOutputFormat format,
+                                  size_t batch_records);
+MonitorStatus monitor_output_write(OutputWriter* writer, const HealthRecord* record);
+MonitorStatus monitor_output_flush(OutputWriter* writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_FORMAT_H
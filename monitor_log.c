@@ -0,0 +1,470 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "monitor_log.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+enum {
+    LOG_CACHE_LINE = 64,
+    LOG_LINE_BYTES = 1024,
+    LOG_NO_TEXT = 0xFFFF
+};
+
+/* The coarse clock avoids a full clock read on the hot path; kernel tick resolution is enough for logs. */
+#ifdef CLOCK_REALTIME_COARSE
+#define LOG_CLOCK CLOCK_REALTIME_COARSE
+#else
+#define LOG_CLOCK CLOCK_REALTIME
+#endif
+
+typedef struct {
+    uint64_t timestamp_ns;
+    const char* format;
+    uint8_t level;
+    uint8_t arg_count;
+    uint8_t arg_types[MONITOR_LOG_MAX_ARGS];
+    uint16_t text_used;
+    union {
+        long long as_int;
+        double as_double;
+        uint16_t text_offset;
+    } values[MONITOR_LOG_MAX_ARGS];
+    char text[MONITOR_LOG_TEXT_BYTES];
+} LogRecord;
+
+typedef struct LogRing {
+    _Alignas(LOG_CACHE_LINE) atomic_size_t head;
+    _Alignas(LOG_CACHE_LINE) atomic_size_t tail;
+    atomic_ullong dropped;
+    atomic_bool owned;
+    struct LogRing* next;
+    LogRecord records[MONITOR_LOG_RING_CAPACITY];
+} LogRing;
+
+_Static_assert((MONITOR_LOG_RING_CAPACITY & (MONITOR_LOG_RING_CAPACITY - 1)) == 0,
+               "ring capacity must be a power of two");
+
+static _Atomic(LogRing*) ring_list = NULL;
+static _Thread_local LogRing* thread_ring = NULL;
+static atomic_size_t ring_count = 0;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+static bool ring_key_ready = false;
+static atomic_bool running = false;
+static atomic_ullong orphan_dropped = 0;
+static pthread_t drain_thread;
+static pthread_mutex_t drain_mutex = PTHREAD_MUTEX_INITIALIZER;
+static MonitorLogFormat log_format = MONITOR_LOG_FORMAT_TEXT;
+static FILE* out_stream = NULL;
+static FILE* err_stream = NULL;
+
+static const char* level_name(uint8_t level) {
+    switch (level) {
+        case MONITOR_LOG_WARNING:
+            return "WARN";
+        case MONITOR_LOG_ERROR:
+            return "ERROR";
+        default:
+            return "INFO";
+    }
+}
+
+static FILE* stream_for(uint8_t level) {
+    if (level == MONITOR_LOG_INFO) {
+        return out_stream ? out_stream : stdout;
+    }
+    return err_stream ? err_stream : stderr;
+}
+
+static void fill_record(LogRecord* record,
+                        MonitorLogLevel level,
+                        const char* format,
+                        const MonitorLogArg* args,
+                        size_t arg_count) {
+    struct timespec ts;
+
+    clock_gettime(LOG_CLOCK, &ts);
+    record->timestamp_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    record->format = format;
+    record->level = (uint8_t)level;
+    record->text_used = 0;
+
+    if (!args || arg_count > MONITOR_LOG_MAX_ARGS) {
+        arg_count = args ? MONITOR_LOG_MAX_ARGS : 0;
+    }
+    record->arg_count = (uint8_t)arg_count;
+
+    for (size_t i = 0; i < arg_count; i++) {
+        record->arg_types[i] = (uint8_t)args[i].type;
+        switch (args[i].type) {
+            case MONITOR_LOG_ARG_DOUBLE:
+                record->values[i].as_double = args[i].value.as_double;
+                break;
+            case MONITOR_LOG_ARG_STRING: {
+                const char* source = args[i].value.as_string ? args[i].value.as_string : "";
+                size_t room = MONITOR_LOG_TEXT_BYTES - record->text_used;
+                if (room == 0) {
+                    record->values[i].text_offset = LOG_NO_TEXT;
+                    break;
+                }
+                size_t length = strnlen(source, room - 1);
+                memcpy(record->text + record->text_used, source, length);
+                record->text[record->text_used + length] = '\0';
+                record->values[i].text_offset = record->text_used;
+                record->text_used = (uint16_t)(record->text_used + length + 1);
+                break;
+            }
+            default:
+                record->values[i].as_int = args[i].value.as_int;
+                break;
+        }
+    }
+}
+
+static size_t append(char* line, size_t used, const char* text, size_t length) {
+    if (used >= LOG_LINE_BYTES - 1) {
+        return used;
+    }
+    if (length > LOG_LINE_BYTES - 1 - used) {
+        length = LOG_LINE_BYTES - 1 - used;
+    }
+    memcpy(line + used, text, length);
+    return used + length;
+}
+
+static size_t append_json_escaped(char* line, size_t used, const char* text, size_t length) {
+    static const char hex[] = "0123456789abcdef";
+
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)text[i];
+        char escaped[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+        if (c == '"' || c == '\\') {
+            char pair[2] = {'\\', (char)c};
+            used = append(line, used, pair, 2);
+        } else if (c < 0x20) {
+            used = append(line, used, escaped, sizeof(escaped));
+        } else {
+            used = append(line, used, text + i, 1);
+        }
+    }
+    return used;
+}
+
+static const char* record_string(const LogRecord* record, size_t index) {
+    uint16_t offset = record->values[index].text_offset;
+    return offset == LOG_NO_TEXT ? "" : record->text + offset;
+}
+
+static size_t render_arg(const LogRecord* record, size_t index, char* buffer, size_t buffer_size) {
+    int written = 0;
+
+    switch (record->arg_types[index]) {
+        case MONITOR_LOG_ARG_DOUBLE:
+            written = snprintf(buffer, buffer_size, "%.2f", record->values[index].as_double);
+            break;
+        case MONITOR_LOG_ARG_STRING:
+            written = snprintf(buffer, buffer_size, "%s", record_string(record, index));
+            break;
+        default:
+            written = snprintf(buffer, buffer_size, "%lld", record->values[index].as_int);
+            break;
+    }
+
+    if (written < 0) {
+        return 0;
+    }
+    return (size_t)written < buffer_size ? (size_t)written : buffer_size - 1;
+}
+
+static size_t render_message(const LogRecord* record, char* message, size_t message_size) {
+    size_t used = 0;
+    size_t next_arg = 0;
+    const char* cursor = record->format;
+
+    while (*cursor != '\0' && used + 1 < message_size) {
+        if (cursor[0] == '{' && cursor[1] == '}' && next_arg < record->arg_count) {
+            used += render_arg(record, next_arg, message + used, message_size - used);
+            next_arg++;
+            cursor += 2;
+            continue;
+        }
+        message[used++] = *cursor++;
+    }
+    message[used] = '\0';
+    return used;
+}
+
+static void emit_record(const LogRecord* record) {
+    char line[LOG_LINE_BYTES];
+    char message[LOG_LINE_BYTES / 2];
+    char stamp[32];
+    char millis[8];
+    struct tm utc;
+    time_t seconds = (time_t)(record->timestamp_ns / 1000000000ULL);
+    size_t message_length = render_message(record, message, sizeof(message));
+    size_t used = 0;
+
+    gmtime_r(&seconds, &utc);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &utc);
+    snprintf(millis, sizeof(millis), ".%03uZ", (unsigned)((record->timestamp_ns / 1000000ULL) % 1000ULL));
+
+    if (log_format == MONITOR_LOG_FORMAT_JSON) {
+        const char* level = level_name(record->level);
+        used = append(line, used, "{\"ts\":\"", 7);
+        used = append(line, used, stamp, strlen(stamp));
+        used = append(line, used, millis, strlen(millis));
+        used = append(line, used, "\",\"level\":\"", 11);
+        used = append(line, used, level, strlen(level));
+        used = append(line, used, "\",\"msg\":\"", 9);
+        used = append_json_escaped(line, used, message, message_length);
+        used = append(line, used, "\",\"fmt\":\"", 9);
+        used = append_json_escaped(line, used, record->format, strlen(record->format));
+        used = append(line, used, "\",\"args\":[", 10);
+        for (size_t i = 0; i < record->arg_count; i++) {
+            char value[64];
+            size_t length = render_arg(record, i, value, sizeof(value));
+            if (i > 0) {
+                used = append(line, used, ",", 1);
+            }
+            if (record->arg_types[i] == MONITOR_LOG_ARG_STRING) {
+                used = append(line, used, "\"", 1);
+                used = append_json_escaped(line, used, value, length);
+                used = append(line, used, "\"", 1);
+            } else {
+                used = append(line, used, value, length);
+            }
+        }
+        used = append(line, used, "]}", 2);
+    } else {
+        const char* level = level_name(record->level);
+        used = append(line, used, stamp, strlen(stamp));
+        used = append(line, used, millis, strlen(millis));
+        used = append(line, used, " [", 2);
+        used = append(line, used, level, strlen(level));
+        used = append(line, used, "] ", 2);
+        used = append(line, used, message, message_length);
+    }
+    line[used++] = '\n';
+
+    fwrite(line, 1, used, stream_for(record->level));
+}
+
+static void drain_ring(LogRing* ring) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    while (tail != head) {
+        emit_record(&ring->records[tail & (MONITOR_LOG_RING_CAPACITY - 1)]);
+        tail++;
+    }
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+}
+
+static void drain_all(void) {
+    pthread_mutex_lock(&drain_mutex);
+    for (LogRing* ring = atomic_load_explicit(&ring_list, memory_order_acquire); ring; ring = ring->next) {
+        drain_ring(ring);
+    }
+    fflush(stream_for(MONITOR_LOG_INFO));
+    fflush(stream_for(MONITOR_LOG_ERROR));
+    pthread_mutex_unlock(&drain_mutex);
+}
+
+static void* drain_main(void* unused) {
+    const struct timespec interval = {0, (long)MONITOR_LOG_DRAIN_INTERVAL_MS * 1000000L};
+
+    (void)unused;
+    while (atomic_load_explicit(&running, memory_order_acquire)) {
+        drain_all();
+        nanosleep(&interval, NULL);
+    }
+    return NULL;
+}
+
+/*
+ * Rings are never unlinked, so the drain thread can walk the list without a
+ * lock. When a thread exits its ring is handed back instead: records still
+ * queued are drained as usual, and the next thread to log claims the ring
+ * rather than allocating one, so short-lived threads do not grow the list.
+ */
+static void release_thread_ring(void* ring) {
+    thread_ring = NULL;
+    atomic_store_explicit(&((LogRing*)ring)->owned, false, memory_order_release);
+}
+
+static void create_ring_key(void) {
+    ring_key_ready = pthread_key_create(&ring_key, release_thread_ring) == 0;
+}
+
+static LogRing* claim_released_ring(void) {
+    for (LogRing* ring = atomic_load_explicit(&ring_list, memory_order_acquire); ring; ring = ring->next) {
+        bool expected = false;
+        if (!atomic_load_explicit(&ring->owned, memory_order_relaxed) &&
+            atomic_compare_exchange_strong_explicit(&ring->owned, &expected, true,
+                                                    memory_order_acquire, memory_order_relaxed)) {
+            return ring;
+        }
+    }
+    return NULL;
+}
+
+static LogRing* acquire_thread_ring(void) {
+    pthread_once(&ring_key_once, create_ring_key);
+    LogRing* ring = ring_key_ready ? claim_released_ring() : NULL;
+    if (!ring) {
+        ring = aligned_alloc(LOG_CACHE_LINE, sizeof(LogRing));
+        if (!ring) {
+            return NULL;
+        }
+
+        memset(ring, 0, sizeof(*ring));
+        atomic_init(&ring->head, 0);
+        atomic_init(&ring->tail, 0);
+        atomic_init(&ring->dropped, 0);
+        atomic_init(&ring->owned, true);
+
+        LogRing* expected = atomic_load_explicit(&ring_list, memory_order_relaxed);
+        do {
+            ring->next = expected;
+        } while (!atomic_compare_exchange_weak_explicit(&ring_list, &expected, ring,
+                                                        memory_order_release, memory_order_relaxed));
+        atomic_fetch_add_explicit(&ring_count, 1, memory_order_relaxed);
+    }
+
+    if (ring_key_ready) {
+        pthread_setspecific(ring_key, ring);
+    }
+    thread_ring = ring;
+    return ring;
+}
+
+MonitorStatus monitor_log_parse_format(const char* value, MonitorLogFormat* out) {
+    if (!value || !out) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (strcasecmp(value, "text") == 0) {
+        *out = MONITOR_LOG_FORMAT_TEXT;
+        return MONITOR_STATUS_OK;
+    }
+    if (strcasecmp(value, "json") == 0) {
+        *out = MONITOR_LOG_FORMAT_JSON;
+        return MONITOR_STATUS_OK;
+    }
+    return MONITOR_STATUS_PARSE_ERROR;
+}
+
+void monitor_log_set_format(MonitorLogFormat format) {
+    pthread_mutex_lock(&drain_mutex);
+    log_format = format;
+    pthread_mutex_unlock(&drain_mutex);
+}
+
+/**
+ * Redirects INFO records to out and WARN/ERROR records to err.
+ * Passing NULL restores stdout/stderr.
+ */
+void monitor_log_set_streams(FILE* out, FILE* err) {
+    pthread_mutex_lock(&drain_mutex);
+    out_stream = out;
+    err_stream = err;
+    pthread_mutex_unlock(&drain_mutex);
+}
+
+/**
+ * Starts the background drain thread. Until it runs, records are written
+ * synchronously by the caller.
+ *
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_log_start(void) {
+    if (atomic_load(&running)) {
+        return MONITOR_STATUS_OK;
+    }
+
+    atomic_store(&running, true);
+    if (pthread_create(&drain_thread, NULL, drain_main, NULL) != 0) {
+        atomic_store(&running, false);
+        return MONITOR_STATUS_INTERNAL_ERROR;
+    }
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Stops the drain thread after writing every pending record.
+ */
+void monitor_log_stop(void) {
+    if (!atomic_exchange(&running, false)) {
+        return;
+    }
+
+    pthread_join(drain_thread, NULL);
+    drain_all();
+}
+
+/**
+ * Writes all pending records before returning, e.g. ahead of an interactive prompt.
+ */
+void monitor_log_flush(void) {
+    drain_all();
+}
+
+/**
+ * Queues one record on the calling thread's ring. Never blocks; if the ring is
+ * full the record is dropped and counted.
+ *
+ * @param level Severity of the record.
+ * @param format Static format string with "{}" placeholders; also the record id.
+ * @param args Arguments for the placeholders (may be NULL when arg_count is 0).
+ * @param arg_count Number of arguments, at most MONITOR_LOG_MAX_ARGS.
+ */
+void monitor_log_write(MonitorLogLevel level, const char* format, const MonitorLogArg* args, size_t arg_count) {
+    if (!format) {
+        return;
+    }
+
+    if (!atomic_load_explicit(&running, memory_order_acquire)) {
+        LogRecord record;
+        fill_record(&record, level, format, args, arg_count);
+        pthread_mutex_lock(&drain_mutex);
+        emit_record(&record);
+        pthread_mutex_unlock(&drain_mutex);
+        return;
+    }
+
+    LogRing* ring = thread_ring ? thread_ring : acquire_thread_ring();
+    if (!ring) {
+        atomic_fetch_add_explicit(&orphan_dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail >= MONITOR_LOG_RING_CAPACITY) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    fill_record(&ring->records[head & (MONITOR_LOG_RING_CAPACITY - 1)], level, format, args, arg_count);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+unsigned long long monitor_log_dropped(void) {
+    unsigned long long total = atomic_load(&orphan_dropped);
+
+    for (LogRing* ring = atomic_load_explicit(&ring_list, memory_order_acquire); ring; ring = ring->next) {
+        total += atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+    }
+    return total;
+}
+
+/* Number of rings allocated so far; threads that exited hand theirs to later ones. */
+size_t monitor_log_ring_count(void) {
+    return atomic_load_explicit(&ring_count, memory_order_relaxed);
+}
@@ -0,0 +1,92 @@
+#ifndef MONITOR_LOG_H
+#define MONITOR_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "monitor_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Asynchronous structured logger.
+ *
+ * Each logging thread owns a lock-free single-producer ring of fixed-size
+ * binary records: the format string pointer (its id), a timestamp and up to
+ * MONITOR_LOG_MAX_ARGS typed arguments. A background thread drains the rings
+ * and renders text or JSON. Format strings must have static storage duration
+ * and use "{}" as the argument placeholder. Before monitor_log_start() (or
+ * after monitor_log_stop()) records are rendered synchronously. A thread's
+ * ring is reused by a later thread once it exits.
+ */
+#define MONITOR_LOG_MAX_ARGS 4
+#define MONITOR_LOG_TEXT_BYTES 128
+#define MONITOR_LOG_RING_CAPACITY 1024
+#define MONITOR_LOG_DRAIN_INTERVAL_MS 10
+
+typedef enum {
+    MONITOR_LOG_INFO = 0,
+    MONITOR_LOG_WARNING,
+    MONITOR_LOG_ERROR
+} MonitorLogLevel;
+
+typedef enum {
+    MONITOR_LOG_FORMAT_TEXT = 0,
+    MONITOR_LOG_FORMAT_JSON
+} MonitorLogFormat;
+
+typedef enum {
+    MONITOR_LOG_ARG_INT = 0,
+    MONITOR_LOG_ARG_DOUBLE,
+    MONITOR_LOG_ARG_STRING
+} MonitorLogArgType;
+
+typedef struct {
+    MonitorLogArgType type;
+    union {
+        long long as_int;
+        double as_double;
+        const char* as_string;
+    } value;
+} MonitorLogArg;
+
+static inline MonitorLogArg monitor_log_int(long long value) {
+    MonitorLogArg arg;
+    arg.type = MONITOR_LOG_ARG_INT;
+    arg.value.as_int = value;
+    return arg;
+}
+
+static inline MonitorLogArg monitor_log_double(double value) {
+    MonitorLogArg arg;
+    arg.type = MONITOR_LOG_ARG_DOUBLE;
+    arg.value.as_double = value;
+    return arg;
+}
+
+/* String arguments are copied into the record, truncated to the inline budget. */
+static inline MonitorLogArg monitor_log_string(const char* value) {
+    MonitorLogArg arg;
+    arg.type = MONITOR_LOG_ARG_STRING;
+    arg.value.as_string = value;
+    return arg;
+}
+
+MonitorStatus monitor_log_parse_format(const char* value, MonitorLogFormat* out);
+void monitor_log_set_format(MonitorLogFormat format);
+void monitor_log_set_streams(FILE* out, FILE* err);
+MonitorStatus monitor_log_start(void);
+void monitor_log_stop(void);
+void monitor_log_flush(void);
+void monitor_log_write(MonitorLogLevel level, const char* format, const MonitorLogArg* args, size_t arg_count);
+unsigned long long monitor_log_dropped(void);
+size_t monitor_log_ring_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_LOG_H
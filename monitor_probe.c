@@ -0,0 +1,822 @@
+#define _GNU_SOURCE
+
+#include "monitor_probe.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "monitor_profile.h"
+
+enum {
+    PROBE_EXIT_SETUP_FAILED = 126,
+    PROBE_EXIT_EXEC_FAILED = 127,
+    PROBE_INITIAL_COMMANDS = 8,
+    PROBE_STREAM_COUNT = 2,
+    PROBE_EXIT_EVENT = PROBE_STREAM_COUNT,
+    PROBE_DISCARD_BYTES = 4096
+};
+
+/* Separates words in a command's cache key; it cannot appear in a parsed word. */
+static const char KEY_SEPARATOR = '\x1f';
+
+static uint64_t hash_key(const char* key) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (const unsigned char* cursor = (const unsigned char*)key; *cursor; cursor++) {
+        hash = (hash ^ *cursor) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Splits a command into words. Quotes group words and are removed; there
+ * is no escaping, globbing or variable expansion.
+ *
+ * @param command Command line such as "check_disk -w '10%'".
+ * @param out Receives argv and the normalised key; path is left empty.
+ * @return MONITOR_STATUS_PARSE_ERROR for an empty command or an open quote,
+ *         MONITOR_STATUS_RANGE_ERROR when it does not fit.
+ */
+MonitorStatus monitor_probe_parse(const char* command, MonitorProbeCommand* out) {
+    if (!command || !out) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    memset(out, 0, sizeof(*out));
+    const char* cursor = command;
+    size_t used = 0;
+    size_t key_length = 0;
+    for (;;) {
+        while (isspace((unsigned char)*cursor)) {
+            cursor++;
+        }
+        if (*cursor == '\0') {
+            break;
+        }
+        if (out->argc == MONITOR_PROBE_MAX_ARGS) {
+            return MONITOR_STATUS_RANGE_ERROR;
+        }
+
+        char* word = out->storage + used;
+        char quote = '\0';
+        while (*cursor && (quote || !isspace((unsigned char)*cursor))) {
+            char c = *cursor++;
+            if (c == quote) {
+                quote = '\0';
+                continue;
+            }
+            if (!quote && (c == '\'' || c == '"')) {
+                quote = c;
+                continue;
+            }
+            if (c == KEY_SEPARATOR || used + 2 > sizeof(out->storage) || key_length + 2 > sizeof(out->key)) {
+                return c == KEY_SEPARATOR ? MONITOR_STATUS_PARSE_ERROR : MONITOR_STATUS_RANGE_ERROR;
+            }
+            out->storage[used++] = c;
+            out->key[key_length++] = c;
+        }
+        if (quote) {
+            return MONITOR_STATUS_PARSE_ERROR;
+        }
+        if (used + 1 > sizeof(out->storage) || key_length + 1 > sizeof(out->key)) {
+            return MONITOR_STATUS_RANGE_ERROR;
+        }
+        out->storage[used++] = '\0';
+        out->key[key_length++] = KEY_SEPARATOR;
+        out->argv[out->argc++] = word;
+    }
+    if (out->argc == 0) {
+        return MONITOR_STATUS_PARSE_ERROR;
+    }
+
+    out->key[key_length - 1] = '\0';
+    out->hash = hash_key(out->key);
+    return MONITOR_STATUS_OK;
+}
+
+static bool is_executable_file(const char* path) {
+    struct stat info;
+    return access(path, X_OK) == 0 && stat(path, &info) == 0 && S_ISREG(info.st_mode);
+}
+
+/* Resolves argv[0] along PATH once, so the child only has to execve(). */
+static MonitorStatus resolve_path(MonitorProbeCommand* command) {
+    const char* name = command->argv[0];
+
+    if (strchr(name, '/')) {
+        if (strlen(name) >= sizeof(command->path) || !is_executable_file(name)) {
+            return MONITOR_STATUS_IO_ERROR;
+        }
+        snprintf(command->path, sizeof(command->path), "%s", name);
+        return MONITOR_STATUS_OK;
+    }
+
+    const char* search = getenv("PATH");
+    if (!search || *search == '\0') {
+        search = "/usr/local/bin:/usr/bin:/bin";
+    }
+    while (*search) {
+        size_t length = strcspn(search, ":");
+        int written = snprintf(command->path,
+                               sizeof(command->path),
+                               "%.*s/%s",
+                               (int)length,
+                               length > 0 ? search : ".",
+                               name);
+        if (length == 0) {
+            written = snprintf(command->path, sizeof(command->path), "./%s", name);
+        }
+        if (written > 0 && (size_t)written < sizeof(command->path) && is_executable_file(command->path)) {
+            return MONITOR_STATUS_OK;
+        }
+        search += length;
+        if (*search == ':') {
+            search++;
+        }
+    }
+    command->path[0] = '\0';
+    return MONITOR_STATUS_IO_ERROR;
+}
+
+static void add_limit(MonitorProbeEngine* engine, int resource, unsigned long long value) {
+    struct rlimit current;
+
+    if (getrlimit(resource, &current) == 0 && current.rlim_max != RLIM_INFINITY &&
+        (unsigned long long)current.rlim_max < value) {
+        value = (unsigned long long)current.rlim_max;
+    }
+    engine->limits[engine->limit_count].resource = resource;
+    engine->limits[engine->limit_count].value = value;
+    engine->limit_count++;
+}
+
+/**
+ * Prepares an engine whose probes get the given limits and, when
+ * cgroup_dir is set, join that cgroup (v2) before exec.
+ *
+ * @param engine Engine to initialise.
+ * @param limits Limits applied in the child; NULL applies none.
+ * @param cgroup_dir Directory whose cgroup.procs the child writes itself into, or NULL.
+ * @return MONITOR_STATUS_IO_ERROR when /dev/null or cgroup.procs cannot be opened.
+ */
+MonitorStatus monitor_probe_engine_init(MonitorProbeEngine* engine,
+                                        const MonitorProbeLimits* limits,
+                                        const char* cgroup_dir) {
+    if (!engine) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    memset(engine, 0, sizeof(*engine));
+    engine->cgroup_fd = -1;
+    engine->null_fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+    if (engine->null_fd < 0) {
+        return MONITOR_STATUS_IO_ERROR;
+    }
+
+    if (cgroup_dir && *cgroup_dir) {
+        char path[MONITOR_PROBE_MAX_PATH + 16];
+        snprintf(path, sizeof(path), "%s/cgroup.procs", cgroup_dir);
+        engine->cgroup_fd = open(path, O_WRONLY | O_CLOEXEC);
+        if (engine->cgroup_fd < 0) {
+            close(engine->null_fd);
+            return MONITOR_STATUS_IO_ERROR;
+        }
+    }
+
+    if (limits) {
+        if (limits->cpu_seconds > 0) {
+            add_limit(engine, RLIMIT_CPU, limits->cpu_seconds);
+        }
+        if (limits->memory_bytes > 0) {
+            add_limit(engine, RLIMIT_AS, limits->memory_bytes);
+        }
+        if (limits->open_files > 0) {
+            add_limit(engine, RLIMIT_NOFILE, limits->open_files);
+        }
+        if (limits->processes > 0) {
+            add_limit(engine, RLIMIT_NPROC, limits->processes);
+        }
+        if (limits->disable_core_dumps) {
+            add_limit(engine, RLIMIT_CORE, 0);
+        }
+    }
+
+    pthread_mutex_init(&engine->lock, NULL);
+    pthread_cond_init(&engine->finished, NULL);
+    pthread_cond_init(&engine->work_ready, NULL);
+    pthread_cond_init(&engine->work_done, NULL);
+    return MONITOR_STATUS_OK;
+}
+
+void monitor_probe_engine_free(MonitorProbeEngine* engine) {
+    if (!engine || engine->null_fd < 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&engine->lock);
+    engine->stopping = true;
+    pthread_cond_broadcast(&engine->work_ready);
+    pthread_mutex_unlock(&engine->lock);
+    for (size_t i = 0; i < engine->worker_count; i++) {
+        pthread_join(engine->workers[i], NULL);
+    }
+
+    for (size_t i = 0; i < engine->count; i++) {
+        free(engine->commands[i]);
+    }
+    free(engine->commands);
+    if (engine->cgroup_fd >= 0) {
+        close(engine->cgroup_fd);
+    }
+    close(engine->null_fd);
+    pthread_cond_destroy(&engine->finished);
+    pthread_cond_destroy(&engine->work_ready);
+    pthread_cond_destroy(&engine->work_done);
+    pthread_mutex_destroy(&engine->lock);
+    memset(engine, 0, sizeof(*engine));
+    engine->cgroup_fd = -1;
+    engine->null_fd = -1;
+}
+
+/* Caller holds the lock. */
+static bool find_command(const MonitorProbeEngine* engine, const MonitorProbeCommand* parsed, size_t* out_id) {
+    for (size_t i = 0; i < engine->count; i++) {
+        const MonitorProbeCommand* cached = engine->commands[i];
+        if (cached->hash == parsed->hash && strcmp(cached->key, parsed->key) == 0) {
+            *out_id = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Parses and resolves a command once and returns its id; commands that
+ * differ only in spacing or quoting share an id.
+ *
+ * @return MONITOR_STATUS_IO_ERROR when the executable is not found.
+ */
+MonitorStatus monitor_probe_prepare(MonitorProbeEngine* engine, const char* command, size_t* out_id) {
+    MonitorProbeCommand parsed;
+
+    if (!engine || !out_id) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+    MonitorStatus status = monitor_probe_parse(command, &parsed);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+
+    pthread_mutex_lock(&engine->lock);
+    bool found = find_command(engine, &parsed, out_id);
+    pthread_mutex_unlock(&engine->lock);
+    if (found) {
+        return MONITOR_STATUS_OK;
+    }
+
+    status = resolve_path(&parsed);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    MonitorProbeCommand* entry = malloc(sizeof(MonitorProbeCommand));
+    if (!entry) {
+        return MONITOR_STATUS_INTERNAL_ERROR;
+    }
+    *entry = parsed;
+    for (size_t i = 0; i < entry->argc; i++) {
+        entry->argv[i] = entry->storage + (parsed.argv[i] - parsed.storage);
+    }
+
+    pthread_mutex_lock(&engine->lock);
+    if (find_command(engine, entry, out_id)) {
+        pthread_mutex_unlock(&engine->lock);
+        free(entry);
+        return MONITOR_STATUS_OK;
+    }
+    if (engine->count == engine->capacity) {
+        size_t capacity = engine->capacity ? engine->capacity * 2 : PROBE_INITIAL_COMMANDS;
+        MonitorProbeCommand** grown = realloc(engine->commands, capacity * sizeof(MonitorProbeCommand*));
+        if (!grown) {
+            pthread_mutex_unlock(&engine->lock);
+            free(entry);
+            return MONITOR_STATUS_INTERNAL_ERROR;
+        }
+        engine->commands = grown;
+        engine->capacity = capacity;
+    }
+    *out_id = engine->count;
+    engine->commands[engine->count++] = entry;
+    pthread_mutex_unlock(&engine->lock);
+    return MONITOR_STATUS_OK;
+}
+
+typedef struct {
+    const MonitorProbeEngine* engine;
+    const MonitorProbeCommand* command;
+    int stdout_fd;
+    int stderr_fd;
+    sigset_t signal_mask;
+} ProbeSpawn;
+
+/*
+ * Runs in the vfork() child, which shares the parent's memory until exec:
+ * only system calls on state the parent prepared, then execve() or _exit().
+ * Signals arrive blocked, so none of the parent's handlers can run on the
+ * shared stack; handlers are reset to the default before the probe's mask
+ * is installed. The handler table is the child's own copy.
+ */
+__attribute__((noreturn, noinline)) static void exec_probe_child(const ProbeSpawn* spawn) {
+    const MonitorProbeEngine* engine = spawn->engine;
+
+    for (int signal = 1; signal < NSIG; signal++) {
+        struct sigaction action;
+        if (sigaction(signal, NULL, &action) == 0 && action.sa_handler != SIG_DFL && action.sa_handler != SIG_IGN) {
+            action.sa_handler = SIG_DFL;
+            action.sa_flags = 0;
+            sigaction(signal, &action, NULL);
+        }
+    }
+    setpgid(0, 0);
+    if (engine->cgroup_fd >= 0 && write(engine->cgroup_fd, "0", 1) != 1) {
+        _exit(PROBE_EXIT_SETUP_FAILED);
+    }
+    for (size_t i = 0; i < engine->limit_count; i++) {
+        struct rlimit limit = {(rlim_t)engine->limits[i].value, (rlim_t)engine->limits[i].value};
+        if (setrlimit(engine->limits[i].resource, &limit) != 0) {
+            _exit(PROBE_EXIT_SETUP_FAILED);
+        }
+    }
+    sigprocmask(SIG_SETMASK, &spawn->signal_mask, NULL);
+    if (dup2(engine->null_fd, STDIN_FILENO) < 0 || dup2(spawn->stdout_fd, STDOUT_FILENO) < 0 ||
+        dup2(spawn->stderr_fd, STDERR_FILENO) < 0) {
+        _exit(PROBE_EXIT_SETUP_FAILED);
+    }
+    execve(spawn->command->path, spawn->command->argv, environ);
+    _exit(PROBE_EXIT_EXEC_FAILED);
+}
+
+/* Blocks every signal across vfork(), which exec_probe_child() relies on. */
+static pid_t spawn_probe(const ProbeSpawn* spawn) {
+    sigset_t all;
+    sigset_t saved;
+
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+    pid_t pid = vfork();
+    if (pid == 0) {
+        exec_probe_child(spawn);
+    }
+    int spawn_error = errno;
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+    errno = spawn_error;
+    return pid;
+}
+
+static int open_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+typedef struct {
+    int fd;
+    char* text;
+    size_t* length;
+} ProbeStream;
+
+/* Reads what is available; bytes past the buffer are dropped. Returns true at end of file. */
+static bool drain_stream(ProbeStream* stream, bool* truncated) {
+    char discard[PROBE_DISCARD_BYTES];
+
+    for (;;) {
+        size_t room = MONITOR_PROBE_OUTPUT_BYTES - *stream->length;
+        ssize_t count = room > 0 ? read(stream->fd, stream->text + *stream->length, room)
+                                 : read(stream->fd, discard, sizeof(discard));
+        if (count > 0) {
+            if (room > 0) {
+                *stream->length += (size_t)count;
+            } else {
+                *truncated = true;
+            }
+            continue;
+        }
+        if (count == 0) {
+            return true;
+        }
+        if (errno != EINTR) {
+            return errno != EAGAIN && errno != EWOULDBLOCK;
+        }
+    }
+}
+
+static void close_stream(int epoll_fd, ProbeStream* stream) {
+    if (stream->fd >= 0) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, stream->fd, NULL);
+        close(stream->fd);
+        stream->fd = -1;
+    }
+}
+
+static bool open_pipe(int fds[2]) {
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        return false;
+    }
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    return true;
+}
+
+static void close_fd(int* fd) {
+    if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+static MonitorStatus wait_for_probe(pid_t pid, int pidfd, int epoll_fd, ProbeStream* streams, int timeout_ms,
+                                    uint64_t start_ns, MonitorProbeResult* result, int* wait_status) {
+    const uint64_t deadline = start_ns + (uint64_t)timeout_ms * UINT64_C(1000000);
+    size_t open_streams = PROBE_STREAM_COUNT;
+    int wait_error = 0;
+    bool reaped = false;
+    bool exited = false;
+
+    while (!exited) {
+        uint64_t now = monitor_profile_now_ns();
+        if (now >= deadline) {
+            result->timed_out = true;
+            break;
+        }
+        int wait_ms = (int)((deadline - now + UINT64_C(999999)) / UINT64_C(1000000));
+
+        /* Without a pidfd the exit is only seen by polling once both pipes have closed. */
+        if (pidfd < 0 && open_streams == 0) {
+            pid_t done = waitpid(pid, wait_status, WNOHANG);
+            if (done == pid) {
+                reaped = exited = true;
+                break;
+            }
+            wait_ms = 1;
+        }
+
+        struct epoll_event events[PROBE_STREAM_COUNT + 1];
+        int ready = epoll_wait(epoll_fd, events, PROBE_STREAM_COUNT + 1, wait_ms);
+        if (ready < 0 && errno != EINTR) {
+            wait_error = errno;
+            break;
+        }
+        for (int i = 0; i < ready; i++) {
+            uint32_t slot = events[i].data.u32;
+            if (slot == PROBE_EXIT_EVENT) {
+                exited = true;
+            } else if (streams[slot].fd >= 0 && drain_stream(&streams[slot], &result->truncated)) {
+                close_stream(epoll_fd, &streams[slot]);
+                open_streams--;
+            }
+        }
+    }
+
+    /* A probe that can no longer be watched is stopped like one that ran out of time. */
+    if (result->timed_out || wait_error != 0) {
+        kill(-pid, SIGKILL);
+    }
+    for (size_t i = 0; i < PROBE_STREAM_COUNT; i++) {
+        if (streams[i].fd >= 0) {
+            drain_stream(&streams[i], &result->truncated);
+        }
+    }
+    while (!reaped && waitpid(pid, wait_status, 0) < 0) {
+        if (errno != EINTR) {
+            return monitor_error_set(MONITOR_STATUS_IO_ERROR, errno, NULL, 0, -1);
+        }
+    }
+    return wait_error != 0 ? monitor_error_set(MONITOR_STATUS_IO_ERROR, wait_error, NULL, 0, -1) : MONITOR_STATUS_OK;
+}
+
+/**
+ * Runs a prepared probe to completion or until timeout_ms has passed.
+ *
+ * @param engine Engine that prepared id.
+ * @param id Value from monitor_probe_prepare().
+ * @param timeout_ms Time allowed before the probe's process group is killed.
+ * @param result Exit code or signal, timing and captured output. Exit code
+ *        127 means exec failed and 126 that the limits or cgroup could not
+ *        be applied.
+ * @return MONITOR_STATUS_OK once the child has been reaped, whatever its
+ *         exit status; MONITOR_STATUS_IO_ERROR when it could not be started,
+ *         or could not be watched and was killed (timed_out stays false).
+ */
+MonitorStatus monitor_probe_run(MonitorProbeEngine* engine, size_t id, int timeout_ms, MonitorProbeResult* result) {
+    if (!engine || !result || timeout_ms <= 0) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    pthread_mutex_lock(&engine->lock);
+    const MonitorProbeCommand* command = id < engine->count ? engine->commands[id] : NULL;
+    pthread_mutex_unlock(&engine->lock);
+    if (!command) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    memset(result, 0, sizeof(*result));
+    result->exit_code = -1;
+    uint64_t start_ns = monitor_profile_now_ns();
+    int stdout_pipe[2] = {-1, -1};
+    int stderr_pipe[2] = {-1, -1};
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0 || !open_pipe(stdout_pipe) || !open_pipe(stderr_pipe)) {
+        close_fd(&epoll_fd);
+        close_fd(&stdout_pipe[0]);
+        close_fd(&stdout_pipe[1]);
+        atomic_fetch_add(&engine->spawn_failures, 1);
+        return MONITOR_STATUS_IO_ERROR;
+    }
+
+    ProbeSpawn spawn = {engine, command, stdout_pipe[1], stderr_pipe[1], {{0}}};
+    sigemptyset(&spawn.signal_mask);
+    pid_t pid = spawn_probe(&spawn);
+    close_fd(&stdout_pipe[1]);
+    close_fd(&stderr_pipe[1]);
+    if (pid < 0) {
+        close_fd(&stdout_pipe[0]);
+        close_fd(&stderr_pipe[0]);
+        close_fd(&epoll_fd);
+        atomic_fetch_add(&engine->spawn_failures, 1);
+        return MONITOR_STATUS_IO_ERROR;
+    }
+    atomic_fetch_add(&engine->launches, 1);
+
+    ProbeStream streams[PROBE_STREAM_COUNT] = {
+        {stdout_pipe[0], result->stdout_text, &result->stdout_length},
+        {stderr_pipe[0], result->stderr_text, &result->stderr_length},
+    };
+    for (uint32_t i = 0; i < PROBE_STREAM_COUNT; i++) {
+        struct epoll_event event = {.events = EPOLLIN, .data.u32 = i};
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, streams[i].fd, &event);
+    }
+    int pidfd = open_pidfd(pid);
+    if (pidfd >= 0) {
+        struct epoll_event event = {.events = EPOLLIN, .data.u32 = PROBE_EXIT_EVENT};
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, pidfd, &event);
+    }
+
+    int wait_status = 0;
+    MonitorStatus status =
+        wait_for_probe(pid, pidfd, epoll_fd, streams, timeout_ms, start_ns, result, &wait_status);
+    for (size_t i = 0; i < PROBE_STREAM_COUNT; i++) {
+        close_fd(&streams[i].fd);
+    }
+    close_fd(&pidfd);
+    close_fd(&epoll_fd);
+
+    if (result->timed_out) {
+        atomic_fetch_add(&engine->timeouts, 1);
+    }
+    if (status == MONITOR_STATUS_OK && WIFEXITED(wait_status)) {
+        result->exit_code = WEXITSTATUS(wait_status);
+    } else if (status == MONITOR_STATUS_OK && WIFSIGNALED(wait_status)) {
+        result->signal = WTERMSIG(wait_status);
+    }
+    result->stdout_text[result->stdout_length] = '\0';
+    result->stderr_text[result->stderr_length] = '\0';
+    result->duration_ns = monitor_profile_now_ns() - start_ns;
+    return status;
+}
+
+/**
+ * Runs a prepared probe through the engine's result cache. A result that
+ * finished less than ttl_ms ago is copied out; if the probe is already
+ * running for another caller this waits for that run and returns its
+ * result; otherwise it runs the probe and publishes the result to every
+ * caller that queued up meanwhile. result->shared tells the cases apart.
+ *
+ * @param engine Engine that prepared id.
+ * @param id Value from monitor_probe_prepare().
+ * @param timeout_ms Passed to monitor_probe_run() when this caller runs the probe.
+ * @param ttl_ms How old a cached result may be; 0 only shares runs in flight.
+ * @param result Receives the result.
+ * @return The status of the run whose result is returned.
+ */
+MonitorStatus monitor_probe_run_shared(MonitorProbeEngine* engine,
+                                       size_t id,
+                                       int timeout_ms,
+                                       int ttl_ms,
+                                       MonitorProbeResult* result) {
+    if (!engine || !result || timeout_ms <= 0 || ttl_ms < 0) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    const uint64_t ttl_ns = (uint64_t)ttl_ms * UINT64_C(1000000);
+    pthread_mutex_lock(&engine->lock);
+    MonitorProbeCommand* command = id < engine->count ? engine->commands[id] : NULL;
+    if (!command) {
+        pthread_mutex_unlock(&engine->lock);
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (command->has_last && ttl_ns > 0 && monitor_profile_now_ns() - command->last_finished_ns < ttl_ns) {
+        *result = command->last;
+        result->shared = true;
+        MonitorStatus status = command->last_status;
+        atomic_fetch_add(&engine->cache_hits, 1);
+        pthread_mutex_unlock(&engine->lock);
+        return status;
+    }
+    if (command->in_flight) {
+        const uint64_t generation = command->generation;
+        atomic_fetch_add(&engine->coalesced, 1);
+        while (command->generation == generation) {
+            pthread_cond_wait(&engine->finished, &engine->lock);
+        }
+        *result = command->last;
+        result->shared = true;
+        MonitorStatus status = command->last_status;
+        pthread_mutex_unlock(&engine->lock);
+        return status;
+    }
+    command->in_flight = true;
+    atomic_fetch_add(&engine->cache_misses, 1);
+    pthread_mutex_unlock(&engine->lock);
+
+    MonitorStatus status = monitor_probe_run(engine, id, timeout_ms, result);
+
+    pthread_mutex_lock(&engine->lock);
+    command->last = *result;
+    command->last_status = status;
+    command->last_finished_ns = monitor_profile_now_ns();
+    command->has_last = true;
+    command->in_flight = false;
+    command->generation++;
+    pthread_cond_broadcast(&engine->finished);
+    pthread_mutex_unlock(&engine->lock);
+    return status;
+}
+
+struct MonitorProbeBatch {
+    const size_t* ids;
+    size_t count;
+    int timeout_ms;
+    int ttl_ms;
+    MonitorProbeResult* results;
+    MonitorStatus* statuses;
+    size_t next;
+    size_t done;
+};
+
+/*
+ * Takes probes off the current batch until none are left. Called with the
+ * engine lock held; it is released around each run. The batch stays valid
+ * while this thread holds an unfinished probe of it.
+ */
+static void run_batch_probes(MonitorProbeEngine* engine) {
+    struct MonitorProbeBatch* batch = engine->batch;
+
+    while (batch && batch->next < batch->count) {
+        size_t i = batch->next++;
+        pthread_mutex_unlock(&engine->lock);
+        batch->statuses[i] =
+            monitor_probe_run_shared(engine, batch->ids[i], batch->timeout_ms, batch->ttl_ms, &batch->results[i]);
+        pthread_mutex_lock(&engine->lock);
+        if (++batch->done == batch->count) {
+            pthread_cond_broadcast(&engine->work_done);
+        }
+    }
+}
+
+static void* probe_worker_main(void* arg) {
+    MonitorProbeEngine* engine = arg;
+    uint64_t seen = 0;
+
+    pthread_mutex_lock(&engine->lock);
+    for (;;) {
+        while (!engine->stopping && engine->batch_generation == seen) {
+            pthread_cond_wait(&engine->work_ready, &engine->lock);
+        }
+        if (engine->stopping) {
+            break;
+        }
+        seen = engine->batch_generation;
+        run_batch_probes(engine);
+    }
+    pthread_mutex_unlock(&engine->lock);
+    return NULL;
+}
+
+/**
+ * Starts up to count worker threads (at most MONITOR_PROBE_MAX_WORKERS in
+ * all) for monitor_probe_run_batch(); they live until the engine is freed.
+ *
+ * @param engine Initialised engine.
+ * @param count Workers wanted in addition to the calling thread.
+ * @return MONITOR_STATUS_INTERNAL_ERROR when a thread could not be created;
+ *         the workers started so far stay in use.
+ */
+MonitorStatus monitor_probe_engine_start_workers(MonitorProbeEngine* engine, size_t count) {
+    if (!engine || engine->null_fd < 0) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    while (engine->worker_count < count && engine->worker_count < MONITOR_PROBE_MAX_WORKERS) {
+        if (pthread_create(&engine->workers[engine->worker_count], NULL, probe_worker_main, engine) != 0) {
+            return MONITOR_STATUS_INTERNAL_ERROR;
+        }
+        engine->worker_count++;
+    }
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Runs prepared probes side by side through monitor_probe_run_shared(),
+ * on the engine's workers and the calling thread, and returns when all
+ * have finished. Without workers they run one after another. Batches
+ * are not reentrant: one caller at a time.
+ *
+ * @param engine Engine that prepared the ids.
+ * @param ids Probes to run.
+ * @param count Number of entries in ids, results and statuses.
+ * @param timeout_ms Passed to monitor_probe_run_shared().
+ * @param ttl_ms Passed to monitor_probe_run_shared().
+ * @param results Receives each probe's result.
+ * @param statuses Receives each probe's status.
+ */
+void monitor_probe_run_batch(MonitorProbeEngine* engine,
+                             const size_t* ids,
+                             size_t count,
+                             int timeout_ms,
+                             int ttl_ms,
+                             MonitorProbeResult* results,
+                             MonitorStatus* statuses) {
+    struct MonitorProbeBatch batch = {ids, count, timeout_ms, ttl_ms, results, statuses, 0, 0};
+
+    if (!engine || !ids || !results || !statuses || count == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&engine->lock);
+    engine->batch = &batch;
+    engine->batch_generation++;
+    pthread_cond_broadcast(&engine->work_ready);
+    run_batch_probes(engine);
+    while (batch.done < batch.count) {
+        pthread_cond_wait(&engine->work_done, &engine->lock);
+    }
+    engine->batch = NULL;
+    pthread_mutex_unlock(&engine->lock);
+}
+
+MonitorStatus monitor_probe_run_command(MonitorProbeEngine* engine,
+                                        const char* command,
+                                        int timeout_ms,
+                                        MonitorProbeResult* result) {
+    size_t id = 0;
+    MonitorStatus status = monitor_probe_prepare(engine, command, &id);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    return monitor_probe_run(engine, id, timeout_ms, result);
+}
+
+void monitor_probe_counters(const MonitorProbeEngine* engine, MonitorProbeCounters* out) {
+    if (!engine || !out) {
+        return;
+    }
+
+    out->launches = atomic_load(&engine->launches);
+    out->spawn_failures = atomic_load(&engine->spawn_failures);
+    out->timeouts = atomic_load(&engine->timeouts);
+    out->cache_hits = atomic_load(&engine->cache_hits);
+    out->cache_misses = atomic_load(&engine->cache_misses);
+    out->coalesced = atomic_load(&engine->coalesced);
+}
+
+/* Folds the counters of an engine that is about to be freed into a running total. */
+void monitor_probe_counters_add(MonitorProbeCounters* total, const MonitorProbeCounters* delta) {
+    if (!total || !delta) {
+        return;
+    }
+
+    total->launches += delta->launches;
+    total->spawn_failures += delta->spawn_failures;
+    total->timeouts += delta->timeouts;
+    total->cache_hits += delta->cache_hits;
+    total->cache_misses += delta->cache_misses;
+    total->coalesced += delta->coalesced;
+}
+
+/* A probe passes when it exits 0 within its timeout. */
+bool monitor_probe_succeeded(const MonitorProbeResult* result) {
+    return result && !result->timed_out && result->signal == 0 && result->exit_code == 0;
+}
@@ -0,0 +1,161 @@
+#ifndef MONITOR_PROBE_H
+#define MONITOR_PROBE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "monitor_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Health probes: short external commands run from the sampling loop.
+ *
+ * A command is split into argv once (whitespace-separated, single or
+ * double quotes group words, no shell) and its executable resolved along
+ * PATH; the parsed form is cached in the engine and looked up by its
+ * normalised text, so repeated runs only pay for the spawn. The child is
+ * started with vfork() and execve(): before exec it joins its own process
+ * group, moves into the engine's cgroup, applies the engine's rlimits and
+ * clears the signal mask, all from state prepared in the parent. stdout
+ * and stderr come back through non-blocking pipes, read together with a
+ * pidfd for the child's exit in one epoll loop that also enforces the
+ * timeout; output beyond MONITOR_PROBE_OUTPUT_BYTES per stream is drained
+ * and dropped. A probe that times out is killed with its whole process
+ * group.
+ *
+ * Runs may come from several threads; each run has its own pipes and
+ * epoll instance. monitor_probe_run_shared() adds a result cache on top:
+ * a result younger than the caller's TTL is returned without a spawn, and
+ * callers that ask for a command already running wait for that run and
+ * all get its result, so identical concurrent checks cost one child.
+ * monitor_probe_run_batch() runs a set of probes side by side on worker
+ * threads the engine starts once, so a caller that checks every tick does
+ * not create a thread per probe.
+ */
+#define MONITOR_PROBE_MAX_COMMAND 256
+#define MONITOR_PROBE_MAX_ARGS 32
+#define MONITOR_PROBE_MAX_PATH 256
+#define MONITOR_PROBE_OUTPUT_BYTES 1024
+#define MONITOR_PROBE_MAX_LIMITS 5
+#define MONITOR_PROBE_MAX_WORKERS 8
+
+/* Zero leaves a limit as inherited from the monitor. */
+typedef struct {
+    unsigned long long cpu_seconds;
+    unsigned long long memory_bytes;
+    unsigned long long open_files;
+    unsigned long long processes;
+    bool disable_core_dumps;
+} MonitorProbeLimits;
+
+typedef struct {
+    int exit_code;
+    int signal;
+    bool timed_out;
+    bool truncated;
+    bool shared; // came from the cache or from another caller's run
+    uint64_t duration_ns;
+    size_t stdout_length;
+    size_t stderr_length;
+    char stdout_text[MONITOR_PROBE_OUTPUT_BYTES + 1];
+    char stderr_text[MONITOR_PROBE_OUTPUT_BYTES + 1];
+} MonitorProbeResult;
+
+typedef struct {
+    char key[MONITOR_PROBE_MAX_COMMAND];
+    char path[MONITOR_PROBE_MAX_PATH];
+    char storage[MONITOR_PROBE_MAX_COMMAND];
+    char* argv[MONITOR_PROBE_MAX_ARGS + 1];
+    size_t argc;
+    uint64_t hash;
+    /* Result cache, guarded by the engine lock. */
+    MonitorProbeResult last;
+    MonitorStatus last_status;
+    uint64_t last_finished_ns;
+    uint64_t generation;
+    bool has_last;
+    bool in_flight;
+} MonitorProbeCommand;
+
+typedef struct {
+    int resource;
+    unsigned long long value;
+} MonitorProbeLimit;
+
+struct MonitorProbeBatch;
+
+typedef struct {
+    MonitorProbeCommand** commands;
+    size_t count;
+    size_t capacity;
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+    /* Worker set for monitor_probe_run_batch(), guarded by the engine lock. */
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    pthread_t workers[MONITOR_PROBE_MAX_WORKERS];
+    size_t worker_count;
+    struct MonitorProbeBatch* batch;
+    uint64_t batch_generation;
+    bool stopping;
+    MonitorProbeLimit limits[MONITOR_PROBE_MAX_LIMITS];
+    size_t limit_count;
+    int cgroup_fd;
+    int null_fd;
+    _Atomic unsigned long long launches;
+    _Atomic unsigned long long spawn_failures;
+    _Atomic unsigned long long timeouts;
+    _Atomic unsigned long long cache_hits;
+    _Atomic unsigned long long cache_misses;
+    _Atomic unsigned long long coalesced;
+} MonitorProbeEngine;
+
+typedef struct {
+    unsigned long long launches;
+    unsigned long long spawn_failures;
+    unsigned long long timeouts;
+    unsigned long long cache_hits;
+    unsigned long long cache_misses;
+    unsigned long long coalesced;
+} MonitorProbeCounters;
+
+MonitorStatus monitor_probe_parse(const char* command, MonitorProbeCommand* out);
+
+MonitorStatus monitor_probe_engine_init(MonitorProbeEngine* engine,
+                                        const MonitorProbeLimits* limits,
+                                        const char* cgroup_dir);
+void monitor_probe_engine_free(MonitorProbeEngine* engine);
+MonitorStatus monitor_probe_prepare(MonitorProbeEngine* engine, const char* command, size_t* out_id);
+MonitorStatus monitor_probe_run(MonitorProbeEngine* engine, size_t id, int timeout_ms, MonitorProbeResult* result);
+MonitorStatus monitor_probe_run_shared(MonitorProbeEngine* engine,
+                                       size_t id,
+                                       int timeout_ms,
+                                       int ttl_ms,
+                                       MonitorProbeResult* result);
+MonitorStatus monitor_probe_engine_start_workers(MonitorProbeEngine* engine, size_t count);
+void monitor_probe_run_batch(MonitorProbeEngine* engine,
+                             const size_t* ids,
+                             size_t count,
+                             int timeout_ms,
+                             int ttl_ms,
+                             MonitorProbeResult* results,
+                             MonitorStatus* statuses);
+MonitorStatus monitor_probe_run_command(MonitorProbeEngine* engine,
+                                        const char* command,
+                                        int timeout_ms,
+                                        MonitorProbeResult* result);
+bool monitor_probe_succeeded(const MonitorProbeResult* result);
+void monitor_probe_counters(const MonitorProbeEngine* engine, MonitorProbeCounters* out);
+void monitor_probe_counters_add(MonitorProbeCounters* total, const MonitorProbeCounters* delta);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_PROBE_H
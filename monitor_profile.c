@@ -0,0 +1,278 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "monitor_profile.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct ProfileThread {
+    pthread_mutex_t mutex;
+    ProfileScopeStats scopes[MONITOR_PROFILE_SCOPE_COUNT];
+    atomic_bool owned;
+    struct ProfileThread* next;
+} ProfileThread;
+
+static _Thread_local ProfileThread* thread_profile = NULL;
+static _Atomic(ProfileThread*) thread_list = NULL;
+static atomic_uint thread_count = 0;
+static pthread_key_t profile_key;
+static pthread_once_t profile_key_once = PTHREAD_ONCE_INIT;
+static bool profile_key_ready = false;
+
+static const double NANOSECONDS_PER_MICROSECOND = 1000.0;
+
+const char* monitor_profile_scope_name(MonitorProfileScope scope) {
+    switch (scope) {
+        case MONITOR_PROFILE_TICK:
+            return "tick";
+        case MONITOR_PROFILE_COLLECT:
+            return "collect";
+        case MONITOR_PROFILE_READ_CPU:
+            return "read_cpu";
+        case MONITOR_PROFILE_READ_MEMORY:
+            return "read_memory";
+        case MONITOR_PROFILE_READ_CGROUP:
+            return "read_cgroup";
+        case MONITOR_PROFILE_READ_BATCH:
+            return "read_batch";
+        case MONITOR_PROFILE_READ_THREADS:
+            return "read_threads";
+        case MONITOR_PROFILE_PROBES:
+            return "probes";
+        case MONITOR_PROFILE_ALERTS:
+            return "alerts";
+        case MONITOR_PROFILE_RENDER:
+            return "render";
+        case MONITOR_PROFILE_OUTPUT:
+            return "output";
+        case MONITOR_PROFILE_SLEEP:
+            return "sleep";
+        default:
+            return "unknown";
+    }
+}
+
+uint64_t monitor_profile_now_ns(void) {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC_RAW, &ts) != 0) {
+        return 0;
+    }
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void reset_scopes(ProfileScopeStats* scopes) {
+    for (size_t i = 0; i < MONITOR_PROFILE_SCOPE_COUNT; i++) {
+        scopes[i].count = 0;
+        scopes[i].total_ns = 0;
+        scopes[i].max_ns = 0;
+        scopes[i].last_ns = 0;
+        monitor_sketch_init(&scopes[i].sketch);
+    }
+}
+
+/*
+ * Profiles are never unlinked, so snapshots keep the samples of threads that
+ * have exited. The exiting thread hands its profile back instead, and the next
+ * thread to record claims it and keeps adding to the same statistics, so
+ * MONITOR_PROFILE_MAX_THREADS bounds concurrent threads rather than all
+ * threads ever started.
+ */
+static void release_thread_profile(void* profile) {
+    thread_profile = NULL;
+    atomic_store_explicit(&((ProfileThread*)profile)->owned, false, memory_order_release);
+}
+
+static void create_profile_key(void) {
+    profile_key_ready = pthread_key_create(&profile_key, release_thread_profile) == 0;
+}
+
+static ProfileThread* claim_released_profile(void) {
+    for (ProfileThread* profile = atomic_load_explicit(&thread_list, memory_order_acquire); profile;
+         profile = profile->next) {
+        bool expected = false;
+        if (!atomic_load_explicit(&profile->owned, memory_order_relaxed) &&
+            atomic_compare_exchange_strong_explicit(&profile->owned, &expected, true,
+                                                    memory_order_acquire, memory_order_relaxed)) {
+            return profile;
+        }
+    }
+    return NULL;
+}
+
+static ProfileThread* allocate_thread_profile(void) {
+    unsigned count = atomic_load_explicit(&thread_count, memory_order_relaxed);
+    do {
+        if (count >= MONITOR_PROFILE_MAX_THREADS) {
+            return NULL;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&thread_count, &count, count + 1,
+                                                    memory_order_relaxed, memory_order_relaxed));
+
+    ProfileThread* profile = calloc(1, sizeof(ProfileThread));
+    if (!profile) {
+        atomic_fetch_sub_explicit(&thread_count, 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    pthread_mutex_init(&profile->mutex, NULL);
+    reset_scopes(profile->scopes);
+    atomic_init(&profile->owned, true);
+
+    ProfileThread* expected = atomic_load_explicit(&thread_list, memory_order_relaxed);
+    do {
+        profile->next = expected;
+    } while (!atomic_compare_exchange_weak_explicit(&thread_list, &expected, profile,
+                                                    memory_order_release, memory_order_relaxed));
+    return profile;
+}
+
+static ProfileThread* acquire_thread_profile(void) {
+    pthread_once(&profile_key_once, create_profile_key);
+    ProfileThread* profile = profile_key_ready ? claim_released_profile() : NULL;
+    if (!profile) {
+        profile = allocate_thread_profile();
+        if (!profile) {
+            return NULL;
+        }
+    }
+
+    if (profile_key_ready) {
+        pthread_setspecific(profile_key, profile);
+    }
+    thread_profile = profile;
+    return profile;
+}
+
+/**
+ * Records one timed section for the calling thread.
+ *
+ * The first call on a thread claims a profile left by an exited thread or
+ * allocates one; while MONITOR_PROFILE_MAX_THREADS threads hold a profile,
+ * further threads are not recorded.
+ *
+ * @param scope Section the duration belongs to.
+ * @param elapsed_ns Duration in nanoseconds.
+ */
+void monitor_profile_record(MonitorProfileScope scope, uint64_t elapsed_ns) {
+    ProfileThread* profile = thread_profile;
+    if ((unsigned)scope >= MONITOR_PROFILE_SCOPE_COUNT) {
+        return;
+    }
+    if (!profile) {
+        profile = acquire_thread_profile();
+        if (!profile) {
+            return;
+        }
+    }
+
+    ProfileScopeStats* stats = &profile->scopes[scope];
+    pthread_mutex_lock(&profile->mutex);
+    stats->count++;
+    stats->total_ns += elapsed_ns;
+    stats->last_ns = elapsed_ns;
+    if (elapsed_ns > stats->max_ns) {
+        stats->max_ns = elapsed_ns;
+    }
+    monitor_sketch_add(&stats->sketch, (double)elapsed_ns / NANOSECONDS_PER_MICROSECOND);
+    pthread_mutex_unlock(&profile->mutex);
+}
+
+/**
+ * Returns the most recent duration the calling thread recorded for scope.
+ *
+ * @param scope Section to query.
+ * @return Duration in nanoseconds, or 0 if none was recorded.
+ */
+uint64_t monitor_profile_last_ns(MonitorProfileScope scope) {
+    if (!thread_profile || (unsigned)scope >= MONITOR_PROFILE_SCOPE_COUNT) {
+        return 0;
+    }
+    return thread_profile->scopes[scope].last_ns;
+}
+
+/**
+ * Merges every thread's statistics into out.
+ *
+ * @param out Array indexed by MonitorProfileScope.
+ * @param count Number of entries in out; must be MONITOR_PROFILE_SCOPE_COUNT.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_profile_snapshot(ProfileScopeStats* out, size_t count) {
+    if (!out || count != MONITOR_PROFILE_SCOPE_COUNT) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    reset_scopes(out);
+    for (ProfileThread* profile = atomic_load_explicit(&thread_list, memory_order_acquire); profile;
+         profile = profile->next) {
+        pthread_mutex_lock(&profile->mutex);
+        for (size_t i = 0; i < MONITOR_PROFILE_SCOPE_COUNT; i++) {
+            const ProfileScopeStats* src = &profile->scopes[i];
+            out[i].count += src->count;
+            out[i].total_ns += src->total_ns;
+            if (src->max_ns > out[i].max_ns) {
+                out[i].max_ns = src->max_ns;
+            }
+            if (src->count > 0) {
+                out[i].last_ns = src->last_ns;
+            }
+            monitor_sketch_merge(&out[i].sketch, &src->sketch);
+        }
+        pthread_mutex_unlock(&profile->mutex);
+    }
+
+    return MONITOR_STATUS_OK;
+}
+
+void monitor_profile_reset(void) {
+    for (ProfileThread* profile = atomic_load_explicit(&thread_list, memory_order_acquire); profile;
+         profile = profile->next) {
+        pthread_mutex_lock(&profile->mutex);
+        reset_scopes(profile->scopes);
+        pthread_mutex_unlock(&profile->mutex);
+    }
+}
+
+/**
+ * Prints count, mean, p50, p99 and max per scope, in microseconds.
+ *
+ * @param stream Destination stream.
+ */
+void monitor_profile_print(FILE* stream) {
+    static ProfileScopeStats merged[MONITOR_PROFILE_SCOPE_COUNT];
+
+    if (!stream) {
+        return;
+    }
+
+    if (!MONITOR_PROFILE_ENABLED) {
+        fprintf(stream, "Self-profiling was disabled at compile time.\n");
+        return;
+    }
+
+    monitor_profile_snapshot(merged, MONITOR_PROFILE_SCOPE_COUNT);
+    fprintf(stream, "Self Stats (microseconds)\n");
+    fprintf(stream, "  %-12s %9s %10s %10s %10s %10s\n", "Scope", "count", "mean", "p50", "p99", "max");
+    for (size_t i = 0; i < MONITOR_PROFILE_SCOPE_COUNT; i++) {
+        const ProfileScopeStats* stats = &merged[i];
+        double p50 = 0.0;
+        double p99 = 0.0;
+        if (stats->count == 0) {
+            continue;
+        }
+        monitor_sketch_quantile(&stats->sketch, 0.50, &p50);
+        monitor_sketch_quantile(&stats->sketch, 0.99, &p99);
+        fprintf(stream,
+                "  %-12s %9llu %10.1f %10.1f %10.1f %10.1f\n",
+                monitor_profile_scope_name((MonitorProfileScope)i),
+                (unsigned long long)stats->count,
+                (double)stats->total_ns / (double)stats->count / NANOSECONDS_PER_MICROSECOND,
+                p50,
+                p99,
+                (double)stats->max_ns / NANOSECONDS_PER_MICROSECOND);
+    }
+    fflush(stream);
+}
@@ -0,0 +1,76 @@
+#ifndef MONITOR_PROFILE_H
+#define MONITOR_PROFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "monitor_sketch.h"
+#include "monitor_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Self-profiling timers for the monitor loop.
+ *
+ * MONITOR_PROFILE_BEGIN/END bracket a hot-path section and record its
+ * CLOCK_MONOTONIC_RAW duration into a per-thread quantile sketch for that
+ * scope. Reports merge every thread's sketches. Building with
+ * MONITOR_PROFILE_ENABLED=0 (ENABLE_SELF_PROFILING=OFF in CMake) compiles the
+ * macros away entirely.
+ */
+#ifndef MONITOR_PROFILE_ENABLED
+#define MONITOR_PROFILE_ENABLED 1
+#endif
+
+#define MONITOR_PROFILE_MAX_THREADS 32
+
+typedef enum {
+    MONITOR_PROFILE_TICK = 0,
+    MONITOR_PROFILE_COLLECT,
+    MONITOR_PROFILE_READ_CPU,
+    MONITOR_PROFILE_READ_MEMORY,
+    MONITOR_PROFILE_READ_CGROUP,
+    MONITOR_PROFILE_READ_BATCH,
+    MONITOR_PROFILE_READ_THREADS,
+    MONITOR_PROFILE_PROBES,
+    MONITOR_PROFILE_ALERTS,
+    MONITOR_PROFILE_RENDER,
+    MONITOR_PROFILE_OUTPUT,
+    MONITOR_PROFILE_SLEEP,
+    MONITOR_PROFILE_SCOPE_COUNT
+} MonitorProfileScope;
+
+typedef struct {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t last_ns;
+    QuantileSketch sketch;
+} ProfileScopeStats;
+
+#if MONITOR_PROFILE_ENABLED
+#define MONITOR_PROFILE_BEGIN(name) const uint64_t name##_profile_start = monitor_profile_now_ns()
+#define MONITOR_PROFILE_END(name, scope) \
+    monitor_profile_record((scope), monitor_profile_now_ns() - name##_profile_start)
+#else
+#define MONITOR_PROFILE_BEGIN(name) ((void)0)
+#define MONITOR_PROFILE_END(name, scope) ((void)0)
+#endif
+
+const char* monitor_profile_scope_name(MonitorProfileScope scope);
+uint64_t monitor_profile_now_ns(void);
+void monitor_profile_record(MonitorProfileScope scope, uint64_t elapsed_ns);
+uint64_t monitor_profile_last_ns(MonitorProfileScope scope);
+MonitorStatus monitor_profile_snapshot(ProfileScopeStats* out, size_t count);
+void monitor_profile_reset(void);
+void monitor_profile_print(FILE* stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_PROFILE_H
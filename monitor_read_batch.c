@@ -0,0 +1,457 @@
+#define _GNU_SOURCE
+
+#include "monitor_read_batch.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define MONITOR_HAVE_IO_URING 1
+#endif
+#endif
+
+#ifndef MONITOR_HAVE_IO_URING
+#define MONITOR_HAVE_IO_URING 0
+#endif
+
+enum {
+    ARENA_ALIGNMENT = 4096
+};
+
+const char* monitor_read_backend_name(MonitorReadBackend backend) {
+    switch (backend) {
+        case MONITOR_READ_BACKEND_IO_URING:
+            return "io_uring";
+        case MONITOR_READ_BACKEND_PREAD:
+            return "pread";
+        default:
+            return "auto";
+    }
+}
+
+#if MONITOR_HAVE_IO_URING
+
+static unsigned* ring_field(void* ring, unsigned offset) {
+    return (unsigned*)(void*)((char*)ring + offset);
+}
+
+static unsigned load_acquire(const unsigned* field) {
+    return atomic_load_explicit((_Atomic unsigned*)(uintptr_t)field, memory_order_acquire);
+}
+
+static void store_release(unsigned* field, unsigned value) {
+    atomic_store_explicit((_Atomic unsigned*)(uintptr_t)field, value, memory_order_release);
+}
+
+static void ring_close(ReadRing* ring) {
+    if (ring->sqes) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring && ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    if (ring->fd >= 0) {
+        close(ring->fd);
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+static MonitorStatus ring_open(ReadRing* ring) {
+    struct io_uring_params params;
+
+    memset(&params, 0, sizeof(params));
+    long fd = syscall(__NR_io_uring_setup, (unsigned)MONITOR_READ_BATCH_MAX, &params);
+    if (fd < 0) {
+        return MONITOR_STATUS_UNSUPPORTED;
+    }
+    ring->fd = (int)fd;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, (off_t)IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        ring->sq_ring = NULL;
+        ring_close(ring);
+        return MONITOR_STATUS_UNSUPPORTED;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->fd, (off_t)IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            ring->cq_ring = NULL;
+            ring_close(ring);
+            return MONITOR_STATUS_UNSUPPORTED;
+        }
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, (off_t)IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        ring_close(ring);
+        return MONITOR_STATUS_UNSUPPORTED;
+    }
+
+    ring->sq_head = ring_field(ring->sq_ring, params.sq_off.head);
+    ring->sq_tail = ring_field(ring->sq_ring, params.sq_off.tail);
+    ring->sq_mask = ring_field(ring->sq_ring, params.sq_off.ring_mask);
+    ring->sq_array = ring_field(ring->sq_ring, params.sq_off.array);
+    ring->cq_head = ring_field(ring->cq_ring, params.cq_off.head);
+    ring->cq_tail = ring_field(ring->cq_ring, params.cq_off.tail);
+    ring->cq_mask = ring_field(ring->cq_ring, params.cq_off.ring_mask);
+    ring->cqes = (char*)ring->cq_ring + params.cq_off.cqes;
+    return MONITOR_STATUS_OK;
+}
+
+static void ring_unregister(ReadRing* ring) {
+    if (ring->registered) {
+        syscall(__NR_io_uring_register, ring->fd, IORING_UNREGISTER_FILES, NULL, 0);
+        syscall(__NR_io_uring_register, ring->fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+        ring->registered = false;
+    }
+}
+
+/* The arena is registered as one fixed buffer; every slot reads into a slice of it. */
+static MonitorStatus ring_register(ReadBatch* batch) {
+    int fds[MONITOR_READ_BATCH_MAX];
+    struct iovec arena = {batch->arena, batch->arena_size};
+
+    for (size_t i = 0; i < batch->count; i++) {
+        fds[i] = batch->slots[i].fd;
+    }
+    if (syscall(__NR_io_uring_register, batch->ring.fd, IORING_REGISTER_FILES, fds, (unsigned)batch->count) != 0) {
+        return MONITOR_STATUS_UNSUPPORTED;
+    }
+    if (syscall(__NR_io_uring_register, batch->ring.fd, IORING_REGISTER_BUFFERS, &arena, 1U) != 0) {
+        syscall(__NR_io_uring_register, batch->ring.fd, IORING_UNREGISTER_FILES, NULL, 0);
+        return MONITOR_STATUS_UNSUPPORTED;
+    }
+    batch->ring.registered = true;
+    return MONITOR_STATUS_OK;
+}
+
+static MonitorStatus ring_run(ReadBatch* batch) {
+    ReadRing* ring = &batch->ring;
+    struct io_uring_sqe* sqes = ring->sqes;
+    struct io_uring_cqe* cqes = ring->cqes;
+    unsigned tail = *ring->sq_tail;
+    unsigned sq_mask = *ring->sq_mask;
+    unsigned cq_mask = *ring->cq_mask;
+
+    if (!ring->registered && ring_register(batch) != MONITOR_STATUS_OK) {
+        return MONITOR_STATUS_UNSUPPORTED;
+    }
+
+    for (size_t i = 0; i < batch->count; i++) {
+        ReadSlot* slot = &batch->slots[i];
+        unsigned index = tail & sq_mask;
+        struct io_uring_sqe* sqe = &sqes[index];
+
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->fd = (int)i;
+        sqe->addr = (uint64_t)(uintptr_t)(batch->arena + slot->offset);
+        sqe->len = (uint32_t)slot->capacity;
+        sqe->off = 0;
+        sqe->buf_index = 0;
+        sqe->user_data = i;
+        ring->sq_array[index] = index;
+        tail++;
+    }
+    store_release(ring->sq_tail, tail);
+
+    size_t harvested = 0;
+    while (harvested < batch->count) {
+        unsigned pending = tail - load_acquire(ring->sq_head);
+        unsigned wanted = (unsigned)(batch->count - harvested);
+        batch->syscalls++;
+        if (syscall(__NR_io_uring_enter, ring->fd, pending, wanted, IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return MONITOR_STATUS_IO_ERROR;
+        }
+
+        unsigned head = *ring->cq_head;
+        unsigned cq_tail = load_acquire(ring->cq_tail);
+        while (head != cq_tail) {
+            const struct io_uring_cqe* cqe = &cqes[head & cq_mask];
+            if (cqe->user_data < batch->count) {
+                ReadSlot* slot = &batch->slots[cqe->user_data];
+                slot->length = cqe->res > 0 ? (size_t)cqe->res : 0;
+                slot->error = cqe->res < 0 ? -cqe->res : 0;
+                harvested++;
+            }
+            head++;
+        }
+        store_release(ring->cq_head, head);
+    }
+    return MONITOR_STATUS_OK;
+}
+
+#else
+
+static void ring_close(ReadRing* ring) {
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+static MonitorStatus ring_open(ReadRing* ring) {
+    (void)ring;
+    return MONITOR_STATUS_UNSUPPORTED;
+}
+
+static void ring_unregister(ReadRing* ring) {
+    (void)ring;
+}
+
+static MonitorStatus ring_run(ReadBatch* batch) {
+    (void)batch;
+    return MONITOR_STATUS_UNSUPPORTED;
+}
+
+#endif
+
+/**
+ * Prepares an empty batch.
+ *
+ * @param batch Batch to initialise.
+ * @param backend MONITOR_READ_BACKEND_AUTO times both paths over the first
+ *        2 * MONITOR_READ_CALIBRATION_RUNS runs and keeps the faster one;
+ *        the other values force one path.
+ * @return MONITOR_STATUS_UNSUPPORTED when io_uring was forced but cannot be
+ *         set up.
+ */
+MonitorStatus monitor_read_batch_init(ReadBatch* batch, MonitorReadBackend backend) {
+    if (!batch) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    memset(batch, 0, sizeof(*batch));
+    batch->ring.fd = -1;
+    batch->backend = MONITOR_READ_BACKEND_PREAD;
+    if (backend == MONITOR_READ_BACKEND_PREAD) {
+        return MONITOR_STATUS_OK;
+    }
+
+    if (ring_open(&batch->ring) == MONITOR_STATUS_OK) {
+        batch->backend = MONITOR_READ_BACKEND_IO_URING;
+        batch->calibrating = backend == MONITOR_READ_BACKEND_AUTO;
+    } else if (backend == MONITOR_READ_BACKEND_IO_URING) {
+        return MONITOR_STATUS_UNSUPPORTED;
+    }
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Adds an already open descriptor; the batch takes ownership of fd and
+ * closes it even when adding fails.
+ *
+ * @param batch Batch to extend.
+ * @param fd Readable descriptor supporting positioned reads.
+ * @param capacity Maximum bytes read per run; longer contents are truncated.
+ * @param out_index Optional; receives the slot index.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_read_batch_add_fd(ReadBatch* batch, int fd, size_t capacity, size_t* out_index) {
+    if (!batch || fd < 0 || capacity == 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+    if (batch->count == MONITOR_READ_BATCH_MAX) {
+        close(fd);
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+
+    /* One byte past each slice keeps the data NUL-terminated for the parsers. */
+    size_t offset = batch->arena_size;
+    size_t arena_size = offset + capacity + 1;
+    char* arena = NULL;
+    if (posix_memalign((void**)&arena, ARENA_ALIGNMENT, arena_size) != 0) {
+        close(fd);
+        return MONITOR_STATUS_INTERNAL_ERROR;
+    }
+    if (batch->arena) {
+        memcpy(arena, batch->arena, batch->arena_size);
+        free(batch->arena);
+    }
+    memset(arena + offset, 0, capacity + 1);
+    batch->arena = arena;
+    batch->arena_size = arena_size;
+
+    ring_unregister(&batch->ring);
+    ReadSlot* slot = &batch->slots[batch->count];
+    slot->fd = fd;
+    slot->offset = offset;
+    slot->capacity = capacity;
+    slot->length = 0;
+    slot->error = 0;
+    if (out_index) {
+        *out_index = batch->count;
+    }
+    batch->count++;
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Opens path read-only and adds it to the batch.
+ *
+ * @param batch Batch to extend.
+ * @param path File to read on every run.
+ * @param capacity Maximum bytes read per run.
+ * @param out_index Optional; receives the slot index.
+ * @return MONITOR_STATUS_UNSUPPORTED when path does not exist.
+ */
+MonitorStatus monitor_read_batch_add(ReadBatch* batch, const char* path, size_t capacity, size_t* out_index) {
+    if (!batch || !path) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno == ENOENT ? MONITOR_STATUS_UNSUPPORTED : MONITOR_STATUS_IO_ERROR;
+    }
+    return monitor_read_batch_add_fd(batch, fd, capacity, out_index);
+}
+
+static unsigned long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+static void drop_ring(ReadBatch* batch) {
+    ring_unregister(&batch->ring);
+    ring_close(&batch->ring);
+    batch->backend = MONITOR_READ_BACKEND_PREAD;
+    batch->calibrating = false;
+}
+
+static void pread_run(ReadBatch* batch) {
+    for (size_t i = 0; i < batch->count; i++) {
+        ReadSlot* slot = &batch->slots[i];
+        ssize_t count = 0;
+        do {
+            batch->syscalls++;
+            count = pread(slot->fd, batch->arena + slot->offset, slot->capacity, 0);
+        } while (count < 0 && errno == EINTR);
+        slot->length = count > 0 ? (size_t)count : 0;
+        slot->error = count < 0 ? errno : 0;
+    }
+}
+
+/**
+ * Re-reads every file from offset 0. Per-file failures are reported through
+ * monitor_read_batch_data() rather than failing the run.
+ *
+ * @param batch Batch to run.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_read_batch_run(ReadBatch* batch) {
+    if (!batch) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    batch->runs++;
+    if (batch->count == 0) {
+        return MONITOR_STATUS_OK;
+    }
+
+    if (batch->calibrating) {
+        /* Even runs use io_uring, odd runs pread; both produce the same data. */
+        size_t path = batch->calibration_runs % 2;
+        unsigned long long start = now_ns();
+        if (path == 0 && ring_run(batch) != MONITOR_STATUS_OK) {
+            drop_ring(batch);
+            path = 1;
+        }
+        if (path == 1) {
+            pread_run(batch);
+        }
+        if (batch->calibrating) {
+            batch->calibration_ns[path] += now_ns() - start;
+            if (++batch->calibration_runs == 2 * MONITOR_READ_CALIBRATION_RUNS &&
+                batch->calibration_ns[1] <= batch->calibration_ns[0]) {
+                drop_ring(batch);
+            }
+            batch->calibrating = batch->calibration_runs < 2 * MONITOR_READ_CALIBRATION_RUNS;
+        }
+    } else {
+        if (batch->backend == MONITOR_READ_BACKEND_IO_URING && ring_run(batch) != MONITOR_STATUS_OK) {
+            drop_ring(batch);
+        }
+        if (batch->backend == MONITOR_READ_BACKEND_PREAD) {
+            pread_run(batch);
+        }
+    }
+
+    for (size_t i = 0; i < batch->count; i++) {
+        const ReadSlot* slot = &batch->slots[i];
+        batch->arena[slot->offset + slot->length] = '\0';
+    }
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Returns the NUL-terminated contents read for a slot by the last run.
+ *
+ * @param batch Batch that was run.
+ * @param index Slot index from monitor_read_batch_add().
+ * @param out_length Optional; receives the byte count.
+ * @return The data, or NULL when the slot does not exist or its read failed.
+ */
+const char* monitor_read_batch_data(const ReadBatch* batch, size_t index, size_t* out_length) {
+    if (!batch || index >= batch->count || batch->slots[index].error != 0) {
+        return NULL;
+    }
+    if (out_length) {
+        *out_length = batch->slots[index].length;
+    }
+    return batch->arena + batch->slots[index].offset;
+}
+
+void monitor_read_batch_free(ReadBatch* batch) {
+    if (!batch) {
+        return;
+    }
+
+    ring_unregister(&batch->ring);
+    ring_close(&batch->ring);
+    for (size_t i = 0; i < batch->count; i++) {
+        close(batch->slots[i].fd);
+    }
+    free(batch->arena);
+    batch->arena = NULL;
+    batch->arena_size = 0;
+    batch->count = 0;
+}
@@ -0,0 +1,90 @@
+#ifndef MONITOR_READ_BATCH_H
+#define MONITOR_READ_BATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "monitor_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Reads a fixed set of small proc/sys files once per tick.
+ *
+ * Files are opened once and re-read from offset 0 on every run, which
+ * regenerates proc and kernfs contents. With io_uring the descriptors and
+ * the buffer arena are registered with the kernel and a whole tick is one
+ * io_uring_enter() call; otherwise each file costs one pread(). io_uring is
+ * driven through raw syscalls, so there is no liburing dependency, and any
+ * setup or submission failure drops the batch to pread for good.
+ *
+ * Fewer syscalls is not always faster: proc files cannot be read without
+ * blocking, so io_uring hands each read to a kernel worker thread. In AUTO
+ * mode the first runs alternate between both paths and the batch keeps
+ * whichever was faster on this machine.
+ */
+#define MONITOR_READ_BATCH_MAX 64
+#define MONITOR_READ_CALIBRATION_RUNS 8
+
+typedef enum {
+    MONITOR_READ_BACKEND_AUTO = 0,
+    MONITOR_READ_BACKEND_IO_URING,
+    MONITOR_READ_BACKEND_PREAD
+} MonitorReadBackend;
+
+typedef struct {
+    int fd;
+    size_t offset;
+    size_t capacity;
+    size_t length;
+    int error;
+} ReadSlot;
+
+typedef struct {
+    int fd;
+    void* sq_ring;
+    size_t sq_ring_size;
+    void* cq_ring;
+    size_t cq_ring_size;
+    void* sqes;
+    size_t sqes_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    void* cqes;
+    bool registered;
+} ReadRing;
+
+typedef struct {
+    ReadSlot slots[MONITOR_READ_BATCH_MAX];
+    size_t count;
+    char* arena;
+    size_t arena_size;
+    MonitorReadBackend backend;
+    bool calibrating;
+    unsigned calibration_runs;
+    unsigned long long calibration_ns[2];
+    ReadRing ring;
+    unsigned long long runs;
+    unsigned long long syscalls;
+} ReadBatch;
+
+MonitorStatus monitor_read_batch_init(ReadBatch* batch, MonitorReadBackend backend);
+MonitorStatus monitor_read_batch_add(ReadBatch* batch, const char* path, size_t capacity, size_t* out_index);
+MonitorStatus monitor_read_batch_add_fd(ReadBatch* batch, int fd, size_t capacity, size_t* out_index);
+MonitorStatus monitor_read_batch_run(ReadBatch* batch);
+const char* monitor_read_batch_data(const ReadBatch* batch, size_t index, size_t* out_length);
+const char* monitor_read_backend_name(MonitorReadBackend backend);
+void monitor_read_batch_free(ReadBatch* batch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_READ_BATCH_H
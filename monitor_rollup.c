@@ -0,0 +1,248 @@
+#include "monitor_rollup.h"
+
+#include <math.h>
+#include <string.h>
+
+typedef struct {
+    const char* name;
+    int64_t width_ms;
+    size_t offset;
+    size_t capacity;
+} RollupTierSpec;
+
+/* A width of 0 stores each sample in its own bucket. */
+static const RollupTierSpec TIERS[MONITOR_ROLLUP_TIER_COUNT] = {
+    {"raw", 0, 0, MONITOR_ROLLUP_RAW_CAPACITY},
+    {"10s", 10000, MONITOR_ROLLUP_RAW_CAPACITY, MONITOR_ROLLUP_10S_CAPACITY},
+    {"1m", 60000, MONITOR_ROLLUP_RAW_CAPACITY + MONITOR_ROLLUP_10S_CAPACITY, MONITOR_ROLLUP_1M_CAPACITY},
+    {"1h",
+     3600000,
+     MONITOR_ROLLUP_RAW_CAPACITY + MONITOR_ROLLUP_10S_CAPACITY + MONITOR_ROLLUP_1M_CAPACITY,
+     MONITOR_ROLLUP_1H_CAPACITY}
+};
+
+static int64_t bucket_start(int64_t timestamp_ms, int64_t width_ms) {
+    int64_t remainder = timestamp_ms % width_ms;
+    return timestamp_ms - (remainder < 0 ? remainder + width_ms : remainder);
+}
+
+static const RollupBucket* tier_bucket(const MetricRollup* rollup, size_t tier, size_t position) {
+    const RollupRing* ring = &rollup->rings[tier];
+    return &rollup->buckets[TIERS[tier].offset + (ring->first + position) % TIERS[tier].capacity];
+}
+
+static int64_t bucket_end(size_t tier, const RollupBucket* bucket) {
+    return bucket->start_ms + (TIERS[tier].width_ms > 0 ? TIERS[tier].width_ms : 1);
+}
+
+/* A tier that has overwritten buckets only covers ranges starting at or after its oldest one. */
+static bool tier_covers(const MetricRollup* rollup, size_t tier, int64_t start_ms) {
+    const RollupRing* ring = &rollup->rings[tier];
+    return !ring->wrapped || tier_bucket(rollup, tier, 0)->start_ms <= start_ms;
+}
+
+/* Buckets in a ring are ordered by start, so the overlapping ones form one run found by bisection. */
+static size_t tier_range(const MetricRollup* rollup, size_t tier, int64_t start_ms, int64_t end_ms, size_t* out_first) {
+    size_t low = 0;
+    size_t high = rollup->rings[tier].count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (bucket_end(tier, tier_bucket(rollup, tier, middle)) <= start_ms) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    *out_first = low;
+
+    high = rollup->rings[tier].count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (tier_bucket(rollup, tier, middle)->start_ms < end_ms) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low - *out_first;
+}
+
+static void bucket_fold(RollupBucket* dest, const RollupBucket* src) {
+    if (dest->count == 0 || src->min < dest->min) {
+        dest->min = src->min;
+    }
+    if (dest->count == 0 || src->max > dest->max) {
+        dest->max = src->max;
+    }
+    dest->sum += src->sum;
+    dest->count += src->count;
+}
+
+static void tier_add(MetricRollup* rollup, size_t tier, int64_t timestamp_ms, double value) {
+    const RollupTierSpec* spec = &TIERS[tier];
+    RollupRing* ring = &rollup->rings[tier];
+    RollupBucket sample = {timestamp_ms, value, value, value, 1};
+
+    if (spec->width_ms > 0) {
+        sample.start_ms = bucket_start(timestamp_ms, spec->width_ms);
+        if (ring->count > 0) {
+            RollupBucket* newest = &rollup->buckets[spec->offset + (ring->first + ring->count - 1) % spec->capacity];
+            if (newest->start_ms == sample.start_ms) {
+                bucket_fold(newest, &sample);
+                return;
+            }
+        }
+    }
+
+    if (ring->count == spec->capacity) {
+        ring->first = (ring->first + 1) % spec->capacity;
+        ring->count--;
+        ring->wrapped = true;
+    }
+    rollup->buckets[spec->offset + (ring->first + ring->count) % spec->capacity] = sample;
+    ring->count++;
+}
+
+void monitor_rollup_init(MetricRollup* rollup) {
+    if (!rollup) {
+        return;
+    }
+
+    memset(rollup->rings, 0, sizeof(rollup->rings));
+    rollup->last_ms = 0;
+    rollup->samples = 0;
+}
+
+/**
+ * Folds one sample into every tier. Amortised O(1): each tier either updates
+ * its newest bucket or starts a new one.
+ *
+ * @param rollup Rollup to update.
+ * @param timestamp_ms Sample time; must not go backwards.
+ * @param value Sample value; NaN is rejected.
+ * @return MONITOR_STATUS_RANGE_ERROR when timestamp_ms is older than the
+ *         previous sample.
+ */
+MonitorStatus monitor_rollup_add(MetricRollup* rollup, int64_t timestamp_ms, double value) {
+    if (!rollup || isnan(value)) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+    if (rollup->samples > 0 && timestamp_ms < rollup->last_ms) {
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+
+    for (size_t tier = 0; tier < MONITOR_ROLLUP_TIER_COUNT; tier++) {
+        tier_add(rollup, tier, timestamp_ms, value);
+    }
+    rollup->last_ms = timestamp_ms;
+    rollup->samples++;
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Copies the buckets overlapping [start_ms, end_ms), oldest first, from the
+ * finest tier that still holds the whole range and fits in capacity. Longer
+ * ranges or smaller capacities are therefore answered from coarser tiers.
+ *
+ * @param rollup Rollup to read.
+ * @param start_ms Inclusive range start.
+ * @param end_ms Exclusive range end; must be after start_ms.
+ * @param out Receives the buckets.
+ * @param capacity Number of buckets out can hold.
+ * @param out_count Receives the number of buckets written.
+ * @param out_tier Optional; receives the tier that answered.
+ * @return MONITOR_STATUS_RANGE_ERROR when even the coarsest tier needs more
+ *         than capacity buckets; out then holds the newest capacity of them.
+ */
+MonitorStatus monitor_rollup_query(const MetricRollup* rollup,
+                                   int64_t start_ms,
+                                   int64_t end_ms,
+                                   RollupBucket* out,
+                                   size_t capacity,
+                                   size_t* out_count,
+                                   MonitorRollupTier* out_tier) {
+    if (!rollup || !out || !out_count || end_ms <= start_ms) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    size_t tier = MONITOR_ROLLUP_TIER_COUNT - 1;
+    size_t first = 0;
+    size_t matches = tier_range(rollup, tier, start_ms, end_ms, &first);
+    for (size_t candidate = 0; candidate < MONITOR_ROLLUP_TIER_COUNT - 1; candidate++) {
+        size_t candidate_first = 0;
+        if (!tier_covers(rollup, candidate, start_ms)) {
+            continue;
+        }
+        size_t count = tier_range(rollup, candidate, start_ms, end_ms, &candidate_first);
+        if (count <= capacity) {
+            tier = candidate;
+            first = candidate_first;
+            matches = count;
+            break;
+        }
+    }
+
+    size_t written = matches > capacity ? capacity : matches;
+    for (size_t i = 0; i < written; i++) {
+        out[i] = *tier_bucket(rollup, tier, first + matches - written + i);
+    }
+
+    *out_count = written;
+    if (out_tier) {
+        *out_tier = (MonitorRollupTier)tier;
+    }
+    return matches > capacity ? MONITOR_STATUS_RANGE_ERROR : MONITOR_STATUS_OK;
+}
+
+/**
+ * Folds [start_ms, end_ms) into one bucket using the finest tier that still
+ * holds the whole range. Coarse buckets that straddle start_ms are counted
+ * whole, so long ranges are approximate at the edges.
+ *
+ * @param rollup Rollup to read.
+ * @param start_ms Inclusive range start.
+ * @param end_ms Exclusive range end; must be after start_ms.
+ * @param out Receives min/max/sum/count; start_ms is the first bucket's.
+ * @param out_tier Optional; receives the tier that answered.
+ * @return MONITOR_STATUS_RANGE_ERROR when no sample falls in the range.
+ */
+MonitorStatus monitor_rollup_summarize(const MetricRollup* rollup,
+                                       int64_t start_ms,
+                                       int64_t end_ms,
+                                       RollupBucket* out,
+                                       MonitorRollupTier* out_tier) {
+    if (!rollup || !out || end_ms <= start_ms) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    size_t tier = MONITOR_ROLLUP_TIER_COUNT - 1;
+    for (size_t candidate = 0; candidate < MONITOR_ROLLUP_TIER_COUNT - 1; candidate++) {
+        if (tier_covers(rollup, candidate, start_ms)) {
+            tier = candidate;
+            break;
+        }
+    }
+
+    size_t first = 0;
+    size_t matches = tier_range(rollup, tier, start_ms, end_ms, &first);
+    memset(out, 0, sizeof(*out));
+    for (size_t i = 0; i < matches; i++) {
+        bucket_fold(out, tier_bucket(rollup, tier, first + i));
+    }
+    if (matches > 0) {
+        out->start_ms = tier_bucket(rollup, tier, first)->start_ms;
+    }
+
+    if (out_tier) {
+        *out_tier = (MonitorRollupTier)tier;
+    }
+    return out->count > 0 ? MONITOR_STATUS_OK : MONITOR_STATUS_RANGE_ERROR;
+}
+
+int64_t monitor_rollup_tier_width_ms(MonitorRollupTier tier) {
+    return tier < MONITOR_ROLLUP_TIER_COUNT ? TIERS[tier].width_ms : 0;
+}
+
+const char* monitor_rollup_tier_name(MonitorRollupTier tier) {
+    return tier < MONITOR_ROLLUP_TIER_COUNT ? TIERS[tier].name : "unknown";
+}
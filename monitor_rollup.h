@@ -0,0 +1,81 @@
+#ifndef MONITOR_ROLLUP_H
+#define MONITOR_ROLLUP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "monitor_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fixed-memory history of one metric at decreasing resolution.
+ *
+ * Every sample is folded into each tier as it arrives: the raw tier keeps
+ * the latest samples one per bucket, the others keep min/max/sum/count per
+ * 10 s, 1 min and 1 h bucket. Each tier is a ring, so the oldest bucket is
+ * overwritten once it is full and a rollup never allocates. With the
+ * capacities below a rollup keeps 6 minutes of 100 ms samples, one hour at
+ * 10 s, one day at 1 min and 30 days at 1 h in about 240 KiB.
+ */
+#define MONITOR_ROLLUP_RAW_CAPACITY 3600
+#define MONITOR_ROLLUP_10S_CAPACITY 360
+#define MONITOR_ROLLUP_1M_CAPACITY 1440
+#define MONITOR_ROLLUP_1H_CAPACITY 720
+#define MONITOR_ROLLUP_TOTAL_CAPACITY \
+    (MONITOR_ROLLUP_RAW_CAPACITY + MONITOR_ROLLUP_10S_CAPACITY + MONITOR_ROLLUP_1M_CAPACITY + MONITOR_ROLLUP_1H_CAPACITY)
+
+typedef enum {
+    MONITOR_ROLLUP_RAW = 0,
+    MONITOR_ROLLUP_10S,
+    MONITOR_ROLLUP_1M,
+    MONITOR_ROLLUP_1H,
+    MONITOR_ROLLUP_TIER_COUNT
+} MonitorRollupTier;
+
+typedef struct {
+    int64_t start_ms;
+    double min;
+    double max;
+    double sum;
+    uint64_t count;
+} RollupBucket;
+
+typedef struct {
+    size_t first;
+    size_t count;
+    bool wrapped;
+} RollupRing;
+
+typedef struct {
+    RollupBucket buckets[MONITOR_ROLLUP_TOTAL_CAPACITY];
+    RollupRing rings[MONITOR_ROLLUP_TIER_COUNT];
+    int64_t last_ms;
+    uint64_t samples;
+} MetricRollup;
+
+void monitor_rollup_init(MetricRollup* rollup);
+MonitorStatus monitor_rollup_add(MetricRollup* rollup, int64_t timestamp_ms, double value);
+MonitorStatus monitor_rollup_query(const MetricRollup* rollup,
+                                   int64_t start_ms,
+                                   int64_t end_ms,
+                                   RollupBucket* out,
+                                   size_t capacity,
+                                   size_t* out_count,
+                                   MonitorRollupTier* out_tier);
+MonitorStatus monitor_rollup_summarize(const MetricRollup* rollup,
+                                       int64_t start_ms,
+                                       int64_t end_ms,
+                                       RollupBucket* out,
+                                       MonitorRollupTier* out_tier);
+int64_t monitor_rollup_tier_width_ms(MonitorRollupTier tier);
+const char* monitor_rollup_tier_name(MonitorRollupTier tier);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_ROLLUP_H
@@ -0,0 +1,231 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "monitor_shm.h"
+
+#include <fcntl.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+enum {
+    READ_ATTEMPTS_BEFORE_YIELD = 64
+};
+
+/**
+ * Checks that name is a portable shm_open() name: a leading slash followed
+ * by 1..MONITOR_SHM_MAX_NAME-2 characters and no further slashes.
+ *
+ * @param name Candidate segment name.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_shm_validate_name(const char* name) {
+    if (!name || name[0] != '/' || name[1] == '\0') {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+    if (strlen(name) >= MONITOR_SHM_MAX_NAME) {
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+    if (strchr(name + 1, '/') != NULL) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Creates the segment and maps it for writing.
+ *
+ * A segment left behind under the same name is unlinked first; readers that
+ * still map it keep their mapping but see no further updates.
+ *
+ * @param writer Writer to initialise.
+ * @param name Segment name, e.g. "/server_monitor".
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_shm_writer_open(MonitorShmWriter* writer, const char* name) {
+    if (!writer) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    writer->layout = NULL;
+    MonitorStatus status = monitor_shm_validate_name(name);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        return MONITOR_STATUS_IO_ERROR;
+    }
+    if (ftruncate(fd, (off_t)sizeof(MonitorShmLayout)) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return MONITOR_STATUS_IO_ERROR;
+    }
+
+    void* mapping = mmap(NULL, sizeof(MonitorShmLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        shm_unlink(name);
+        return MONITOR_STATUS_IO_ERROR;
+    }
+
+    /* ftruncate() zero-fills; the magic goes in last so readers never see a partial header. */
+    MonitorShmLayout* layout = mapping;
+    layout->version = MONITOR_SHM_VERSION;
+    layout->layout_size = (uint32_t)sizeof(MonitorShmLayout);
+    layout->writer_pid = (int32_t)getpid();
+    atomic_store_explicit(&layout->state, MONITOR_SHM_STATE_LIVE, memory_order_relaxed);
+    atomic_store_explicit(&layout->sequence, 0, memory_order_relaxed);
+    atomic_store_explicit(&layout->magic, MONITOR_SHM_MAGIC, memory_order_release);
+
+    writer->layout = layout;
+    snprintf(writer->name, sizeof(writer->name), "%s", name);
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Publishes sample as the latest value. Wait-free; must only be called from
+ * one thread at a time.
+ *
+ * @param writer Open writer.
+ * @param sample Sample to copy into the segment.
+ */
+void monitor_shm_publish(MonitorShmWriter* writer, const MonitorShmSample* sample) {
+    if (!writer || !writer->layout || !sample) {
+        return;
+    }
+
+    MonitorShmLayout* layout = writer->layout;
+    uint64_t sequence = atomic_load_explicit(&layout->sequence, memory_order_relaxed);
+    atomic_store_explicit(&layout->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&layout->sample, sample, sizeof(*sample));
+    atomic_store_explicit(&layout->sequence, sequence + 2, memory_order_release);
+}
+
+/**
+ * Marks the segment closed, unmaps it and removes the name.
+ *
+ * @param writer Writer to close; safe to call more than once.
+ */
+void monitor_shm_writer_close(MonitorShmWriter* writer) {
+    if (!writer || !writer->layout) {
+        return;
+    }
+
+    atomic_store_explicit(&writer->layout->state, MONITOR_SHM_STATE_CLOSED, memory_order_release);
+    munmap(writer->layout, sizeof(MonitorShmLayout));
+    shm_unlink(writer->name);
+    writer->layout = NULL;
+}
+
+/**
+ * Maps an existing segment read-only and checks its layout.
+ *
+ * @param reader Reader to initialise.
+ * @param name Segment name used by the writer.
+ * @return MONITOR_STATUS_IO_ERROR when the segment does not exist or is
+ *         still being initialised, MONITOR_STATUS_UNSUPPORTED when its
+ *         layout version differs from this library's.
+ */
+MonitorStatus monitor_shm_reader_open(MonitorShmReader* reader, const char* name) {
+    struct stat info;
+
+    if (!reader) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    reader->layout = NULL;
+    reader->retries = 0;
+    MonitorStatus status = monitor_shm_validate_name(name);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return MONITOR_STATUS_IO_ERROR;
+    }
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return MONITOR_STATUS_IO_ERROR;
+    }
+    if ((size_t)info.st_size != sizeof(MonitorShmLayout)) {
+        close(fd);
+        return info.st_size == 0 ? MONITOR_STATUS_IO_ERROR : MONITOR_STATUS_UNSUPPORTED;
+    }
+
+    void* mapping = mmap(NULL, sizeof(MonitorShmLayout), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return MONITOR_STATUS_IO_ERROR;
+    }
+
+    const MonitorShmLayout* layout = mapping;
+    uint32_t magic = atomic_load_explicit(&layout->magic, memory_order_acquire);
+    if (magic != MONITOR_SHM_MAGIC || layout->version != MONITOR_SHM_VERSION ||
+        layout->layout_size != sizeof(MonitorShmLayout)) {
+        munmap(mapping, sizeof(MonitorShmLayout));
+        return magic == 0 ? MONITOR_STATUS_IO_ERROR : MONITOR_STATUS_UNSUPPORTED;
+    }
+
+    reader->layout = layout;
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Copies the latest consistent sample. Makes no syscalls unless the writer
+ * keeps the sequence busy, in which case it yields between attempts.
+ *
+ * @param reader Open reader.
+ * @param out Receives the sample.
+ * @param out_sequence Optional; receives the number of samples published,
+ *        0 meaning out holds no sample yet.
+ * @return MONITOR_STATUS_IO_ERROR once the writer has closed the segment,
+ *         MONITOR_STATUS_RANGE_ERROR when no consistent copy was obtained in
+ *         MONITOR_SHM_READ_ATTEMPTS attempts.
+ */
+MonitorStatus monitor_shm_read(MonitorShmReader* reader, MonitorShmSample* out, uint64_t* out_sequence) {
+    if (!reader || !reader->layout || !out) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    const MonitorShmLayout* layout = reader->layout;
+    if (atomic_load_explicit(&layout->state, memory_order_acquire) == MONITOR_SHM_STATE_CLOSED) {
+        return MONITOR_STATUS_IO_ERROR;
+    }
+
+    for (unsigned attempt = 0; attempt < MONITOR_SHM_READ_ATTEMPTS; attempt++) {
+        uint64_t before = atomic_load_explicit(&layout->sequence, memory_order_acquire);
+        if ((before & 1u) == 0) {
+            memcpy(out, &layout->sample, sizeof(*out));
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&layout->sequence, memory_order_relaxed) == before) {
+                if (out_sequence) {
+                    *out_sequence = before / 2;
+                }
+                return MONITOR_STATUS_OK;
+            }
+        }
+        reader->retries++;
+        if (attempt % READ_ATTEMPTS_BEFORE_YIELD == READ_ATTEMPTS_BEFORE_YIELD - 1) {
+            sched_yield();
+        }
+    }
+
+    return MONITOR_STATUS_RANGE_ERROR;
+}
+
+void monitor_shm_reader_close(MonitorShmReader* reader) {
+    if (!reader || !reader->layout) {
+        return;
+    }
+
+    munmap((void*)(uintptr_t)reader->layout, sizeof(MonitorShmLayout));
+    reader->layout = NULL;
+}
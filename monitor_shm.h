@@ -0,0 +1,102 @@
+#ifndef MONITOR_SHM_H
+#define MONITOR_SHM_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "monitor_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Latest sample published into a POSIX shared-memory segment.
+ *
+ * The writer bumps `sequence` to an odd value, copies the sample and bumps
+ * it to the next even value. Readers copy the sample between two loads of
+ * `sequence` and retry when it was odd or changed, so any number of readers
+ * see a consistent sample without locks or syscalls once mapped. The
+ * sequence divided by two is the number of samples published so far.
+ *
+ * The layout is versioned: readers reject a segment whose magic, version or
+ * size they do not recognise. Fields are only ever appended, with a version
+ * bump. The segment only depends on this header and monitor_shm.c, which
+ * build into the standalone server_monitor_shm library for consumers.
+ */
+#define MONITOR_SHM_MAGIC 0x314d4853u /* "SHM1" */
+#define MONITOR_SHM_VERSION 1u
+#define MONITOR_SHM_MAX_NAME 64
+#define MONITOR_SHM_MAX_SERVER 64
+#define MONITOR_SHM_READ_ATTEMPTS 4096
+
+enum {
+    MONITOR_SHM_STATE_LIVE = 1,
+    MONITOR_SHM_STATE_CLOSED = 2
+};
+
+enum {
+    MONITOR_SHM_FLAG_CGROUP_MEMORY = 1u << 0,
+    MONITOR_SHM_FLAG_CGROUP_CPU = 1u << 1,
+    MONITOR_SHM_FLAG_SELF_STATS = 1u << 2
+};
+
+typedef struct {
+    int64_t timestamp_ms;
+    char server[MONITOR_SHM_MAX_SERVER];
+    double cpu_percent;
+    double ram_percent;
+    double ram_used_gb;
+    double ram_total_gb;
+    uint32_t cpu_alert_level;
+    uint32_t ram_alert_level;
+    uint32_t flags;
+    uint32_t active_alerts;
+    uint64_t swap_total_kb;
+    uint64_t swap_free_kb;
+    uint64_t dirty_kb;
+    uint64_t writeback_kb;
+    uint64_t cgroup_memory_current;
+    uint64_t cgroup_memory_max;
+    uint64_t cgroup_cpu_usage_usec;
+    uint64_t cgroup_cpu_throttled_usec;
+    double self_collect_us;
+    double self_tick_us;
+} MonitorShmSample;
+
+typedef struct {
+    _Atomic uint32_t magic;
+    uint32_t version;
+    uint32_t layout_size;
+    int32_t writer_pid;
+    _Atomic uint32_t state;
+    _Alignas(64) _Atomic uint64_t sequence;
+    _Alignas(64) MonitorShmSample sample;
+} MonitorShmLayout;
+
+typedef struct {
+    MonitorShmLayout* layout;
+    char name[MONITOR_SHM_MAX_NAME];
+} MonitorShmWriter;
+
+typedef struct {
+    const MonitorShmLayout* layout;
+    uint64_t retries;
+} MonitorShmReader;
+
+MonitorStatus monitor_shm_validate_name(const char* name);
+
+MonitorStatus monitor_shm_writer_open(MonitorShmWriter* writer, const char* name);
+void monitor_shm_publish(MonitorShmWriter* writer, const MonitorShmSample* sample);
+void monitor_shm_writer_close(MonitorShmWriter* writer);
+
+MonitorStatus monitor_shm_reader_open(MonitorShmReader* reader, const char* name);
+MonitorStatus monitor_shm_read(MonitorShmReader* reader, MonitorShmSample* out, uint64_t* out_sequence);
+void monitor_shm_reader_close(MonitorShmReader* reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_SHM_H
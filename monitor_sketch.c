@@ -0,0 +1,337 @@
+#include "monitor_sketch.h"
+
+#include <math.h>
+#include <string.h>
+
+enum {
+    SKETCH_ENCODING_VERSION = 1,
+    SKETCH_HEADER_SIZE = 52,
+    SKETCH_ENTRY_SIZE = 6
+};
+
+static const unsigned char SKETCH_MAGIC[4] = {'S', 'H', 'M', 'Q'};
+
+static double sketch_gamma(void) {
+    return (1.0 + MONITOR_SKETCH_RELATIVE_ACCURACY) / (1.0 - MONITOR_SKETCH_RELATIVE_ACCURACY);
+}
+
+static size_t sketch_bin_index(const QuantileSketch* sketch, double value) {
+    int key = (int)ceil(log(value) / sketch->log_gamma) - sketch->key_offset;
+    if (key < 0) {
+        return 0;
+    }
+    if (key >= MONITOR_SKETCH_BIN_COUNT) {
+        return MONITOR_SKETCH_BIN_COUNT - 1;
+    }
+    return (size_t)key;
+}
+
+static double sketch_bin_value(const QuantileSketch* sketch, size_t index) {
+    const double gamma = sketch_gamma();
+    int key = (int)index + sketch->key_offset;
+    return 2.0 * pow(gamma, (double)key) / (gamma + 1.0);
+}
+
+/**
+ * Resets the sketch and caches the bucket layout constants, so the hot add
+ * path does not call log() for them on every sample.
+ *
+ * @param sketch Sketch to initialise.
+ */
+void monitor_sketch_init(QuantileSketch* sketch) {
+    if (!sketch) {
+        return;
+    }
+
+    memset(sketch, 0, sizeof(*sketch));
+    sketch->log_gamma = log(sketch_gamma());
+    sketch->key_offset = (int)ceil(log(MONITOR_SKETCH_MIN_VALUE) / sketch->log_gamma);
+}
+
+/**
+ * Adds one sample to the sketch. Values at or below MONITOR_SKETCH_MIN_VALUE
+ * (including negatives) are counted in the zero bucket; NaN and infinities
+ * are ignored, as are samples landing in a bucket already at UINT32_MAX.
+ *
+ * @param sketch Sketch to update.
+ * @param value Sample value.
+ */
+void monitor_sketch_add(QuantileSketch* sketch, double value) {
+    size_t index = 0;
+
+    if (!sketch || !isfinite(value)) {
+        return;
+    }
+
+    if (value > MONITOR_SKETCH_MIN_VALUE) {
+        index = sketch_bin_index(sketch, value);
+        if (sketch->bins[index] == UINT32_MAX) {
+            return;
+        }
+    }
+
+    if (sketch->count == 0 || value < sketch->min) {
+        sketch->min = value;
+    }
+    if (sketch->count == 0 || value > sketch->max) {
+        sketch->max = value;
+    }
+    sketch->count++;
+    sketch->sum += value;
+
+    if (value <= MONITOR_SKETCH_MIN_VALUE) {
+        sketch->zero_count++;
+        return;
+    }
+
+    sketch->bins[index]++;
+}
+
+/**
+ * Merges src into dest. Both sketches share the compile-time bucket layout,
+ * so the result is identical to a sketch fed with both sample streams. Counts
+ * that would overflow a bucket are clipped and left out of dest->count.
+ *
+ * @param dest Sketch receiving the merged counts.
+ * @param src Sketch to merge in.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_sketch_merge(QuantileSketch* dest, const QuantileSketch* src) {
+    if (!dest || !src) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (src->count == 0) {
+        return MONITOR_STATUS_OK;
+    }
+
+    if (dest->count == 0 || src->min < dest->min) {
+        dest->min = src->min;
+    }
+    if (dest->count == 0 || src->max > dest->max) {
+        dest->max = src->max;
+    }
+    uint64_t clipped = 0;
+    for (size_t i = 0; i < MONITOR_SKETCH_BIN_COUNT; i++) {
+        uint32_t room = UINT32_MAX - dest->bins[i];
+        if (src->bins[i] > room) {
+            clipped += src->bins[i] - room;
+            dest->bins[i] = UINT32_MAX;
+        } else {
+            dest->bins[i] += src->bins[i];
+        }
+    }
+
+    dest->count += src->count - clipped;
+    dest->zero_count += src->zero_count;
+    dest->sum += src->sum;
+
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Estimates the value at the given quantile.
+ *
+ * @param sketch Sketch to query.
+ * @param quantile Quantile in [0, 1]; 0 and 1 return the exact min and max.
+ * @param out Receives the estimate.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_sketch_quantile(const QuantileSketch* sketch, double quantile, double* out) {
+    if (!sketch || !out || isnan(quantile) || quantile < 0.0 || quantile > 1.0) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (sketch->count == 0) {
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+
+    if (quantile == 0.0) {
+        *out = sketch->min;
+        return MONITOR_STATUS_OK;
+    }
+    if (quantile == 1.0) {
+        *out = sketch->max;
+        return MONITOR_STATUS_OK;
+    }
+
+    uint64_t rank = (uint64_t)(quantile * (double)(sketch->count - 1));
+    uint64_t seen = sketch->zero_count;
+    double estimate = sketch->max;
+
+    if (rank < seen) {
+        estimate = 0.0;
+    } else {
+        for (size_t i = 0; i < MONITOR_SKETCH_BIN_COUNT; i++) {
+            seen += sketch->bins[i];
+            if (rank < seen) {
+                estimate = sketch_bin_value(sketch, i);
+                break;
+            }
+        }
+    }
+
+    if (estimate < sketch->min) {
+        estimate = sketch->min;
+    }
+    if (estimate > sketch->max) {
+        estimate = sketch->max;
+    }
+
+    *out = estimate;
+    return MONITOR_STATUS_OK;
+}
+
+static void put_u16(unsigned char* buffer, uint16_t value) {
+    buffer[0] = (unsigned char)(value & 0xFFU);
+    buffer[1] = (unsigned char)(value >> 8);
+}
+
+static void put_u32(unsigned char* buffer, uint32_t value) {
+    for (size_t i = 0; i < 4; i++) {
+        buffer[i] = (unsigned char)((value >> (8 * i)) & 0xFFU);
+    }
+}
+
+static void put_u64(unsigned char* buffer, uint64_t value) {
+    for (size_t i = 0; i < 8; i++) {
+        buffer[i] = (unsigned char)((value >> (8 * i)) & 0xFFU);
+    }
+}
+
+static void put_double(unsigned char* buffer, double value) {
+    uint64_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    put_u64(buffer, bits);
+}
+
+static uint16_t get_u16(const unsigned char* buffer) {
+    return (uint16_t)(buffer[0] | (buffer[1] << 8));
+}
+
+static uint32_t get_u32(const unsigned char* buffer) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; i++) {
+        value |= (uint32_t)buffer[i] << (8 * i);
+    }
+    return value;
+}
+
+static uint64_t get_u64(const unsigned char* buffer) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < 8; i++) {
+        value |= (uint64_t)buffer[i] << (8 * i);
+    }
+    return value;
+}
+
+static double get_double(const unsigned char* buffer) {
+    uint64_t bits = get_u64(buffer);
+    double value = 0.0;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/**
+ * Serialises the sketch into a portable little-endian buffer holding only the
+ * non-empty buckets, for shipping to a fleet aggregator.
+ *
+ * @param sketch Sketch to encode.
+ * @param buffer Destination buffer (MONITOR_SKETCH_ENCODED_MAX_SIZE always suffices).
+ * @param buffer_size Size of buffer in bytes.
+ * @return Number of bytes written, or 0 if the buffer is too small.
+ */
+size_t monitor_sketch_encode(const QuantileSketch* sketch, unsigned char* buffer, size_t buffer_size) {
+    uint32_t non_empty = 0;
+
+    if (!sketch || !buffer) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < MONITOR_SKETCH_BIN_COUNT; i++) {
+        if (sketch->bins[i] != 0) {
+            non_empty++;
+        }
+    }
+
+    size_t required = SKETCH_HEADER_SIZE + (size_t)non_empty * SKETCH_ENTRY_SIZE;
+    if (buffer_size < required) {
+        return 0;
+    }
+
+    memcpy(buffer, SKETCH_MAGIC, sizeof(SKETCH_MAGIC));
+    put_u16(buffer + 4, SKETCH_ENCODING_VERSION);
+    put_u16(buffer + 6, MONITOR_SKETCH_BIN_COUNT);
+    put_u64(buffer + 8, sketch->count);
+    put_u64(buffer + 16, sketch->zero_count);
+    put_double(buffer + 24, sketch->min);
+    put_double(buffer + 32, sketch->max);
+    put_double(buffer + 40, sketch->sum);
+    put_u32(buffer + 48, non_empty);
+
+    size_t offset = SKETCH_HEADER_SIZE;
+    for (size_t i = 0; i < MONITOR_SKETCH_BIN_COUNT; i++) {
+        if (sketch->bins[i] == 0) {
+            continue;
+        }
+        put_u16(buffer + offset, (uint16_t)i);
+        put_u32(buffer + offset + 2, sketch->bins[i]);
+        offset += SKETCH_ENTRY_SIZE;
+    }
+
+    return offset;
+}
+
+/**
+ * Restores a sketch produced by monitor_sketch_encode(), possibly on another host.
+ * Input whose count differs from zero_count plus the bucket counts is rejected.
+ *
+ * @param sketch Receives the decoded sketch.
+ * @param buffer Encoded bytes.
+ * @param size Number of encoded bytes.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_sketch_decode(QuantileSketch* sketch, const unsigned char* buffer, size_t size) {
+    if (!sketch || !buffer) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (size < SKETCH_HEADER_SIZE || memcmp(buffer, SKETCH_MAGIC, sizeof(SKETCH_MAGIC)) != 0) {
+        return MONITOR_STATUS_PARSE_ERROR;
+    }
+
+    if (get_u16(buffer + 4) != SKETCH_ENCODING_VERSION || get_u16(buffer + 6) != MONITOR_SKETCH_BIN_COUNT) {
+        return MONITOR_STATUS_UNSUPPORTED;
+    }
+
+    uint32_t non_empty = get_u32(buffer + 48);
+    if (non_empty > MONITOR_SKETCH_BIN_COUNT ||
+        size < SKETCH_HEADER_SIZE + (size_t)non_empty * SKETCH_ENTRY_SIZE) {
+        return MONITOR_STATUS_PARSE_ERROR;
+    }
+
+    monitor_sketch_init(sketch);
+    sketch->count = get_u64(buffer + 8);
+    sketch->zero_count = get_u64(buffer + 16);
+    sketch->min = get_double(buffer + 24);
+    sketch->max = get_double(buffer + 32);
+    sketch->sum = get_double(buffer + 40);
+
+    uint64_t binned = 0;
+    size_t offset = SKETCH_HEADER_SIZE;
+    for (uint32_t i = 0; i < non_empty; i++) {
+        uint16_t index = get_u16(buffer + offset);
+        if (index >= MONITOR_SKETCH_BIN_COUNT || sketch->bins[index] != 0) {
+            return MONITOR_STATUS_PARSE_ERROR;
+        }
+        sketch->bins[index] = get_u32(buffer + offset + 2);
+        binned += sketch->bins[index];
+        offset += SKETCH_ENTRY_SIZE;
+    }
+
+    if (sketch->zero_count > sketch->count || sketch->count - sketch->zero_count != binned) {
+        return MONITOR_STATUS_PARSE_ERROR;
+    }
+
+    return MONITOR_STATUS_OK;
+}
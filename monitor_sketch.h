@@ -0,0 +1,51 @@
+#ifndef MONITOR_SKETCH_H
+#define MONITOR_SKETCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "monitor_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Streaming quantile sketch with logarithmic buckets (DDSketch style).
+ *
+ * Every sketch uses the same compile-time bucket layout, so memory is fixed
+ * and sketches built on different hosts can be merged bucket by bucket.
+ * Quantile estimates are within MONITOR_SKETCH_RELATIVE_ACCURACY of the true
+ * value for inputs inside [MONITOR_SKETCH_MIN_VALUE, MONITOR_SKETCH_MAX_VALUE].
+ * count always equals zero_count plus the sum of bins: a sample that would
+ * overflow a full bucket is dropped from count as well.
+ */
+#define MONITOR_SKETCH_RELATIVE_ACCURACY 0.01
+#define MONITOR_SKETCH_BIN_COUNT 2048
+#define MONITOR_SKETCH_MIN_VALUE 1e-6
+#define MONITOR_SKETCH_MAX_VALUE 1e11
+#define MONITOR_SKETCH_ENCODED_MAX_SIZE (52 + (MONITOR_SKETCH_BIN_COUNT * 6))
+
+typedef struct {
+    uint32_t bins[MONITOR_SKETCH_BIN_COUNT];
+    uint64_t zero_count;
+    uint64_t count;
+    double min;
+    double max;
+    double sum;
+    double log_gamma;
+    int key_offset;
+} QuantileSketch;
+
+void monitor_sketch_init(QuantileSketch* sketch);
+void monitor_sketch_add(QuantileSketch* sketch, double value);
+MonitorStatus monitor_sketch_merge(QuantileSketch* dest, const QuantileSketch* src);
+MonitorStatus monitor_sketch_quantile(const QuantileSketch* sketch, double quantile, double* out);
+size_t monitor_sketch_encode(const QuantileSketch* sketch, unsigned char* buffer, size_t buffer_size);
+MonitorStatus monitor_sketch_decode(QuantileSketch* sketch, const unsigned char* buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_SKETCH_H
@@ -0,0 +1,273 @@
+#include "monitor_sparkline.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "monitor_format.h"
+
+enum {
+    SPARKLINE_LEVELS = 8,
+    SPARKLINE_VALUE_WIDTH = 7,
+    SPARKLINE_VALUE_DECIMALS = 2
+};
+
+typedef struct {
+    char bytes[MONITOR_SPARKLINE_MAX_GLYPH_BYTES];
+} SparklineGlyph;
+
+/* U+2581..U+2588, lower one-eighth block to full block. */
+static const SparklineGlyph UTF8_GLYPHS[SPARKLINE_LEVELS] = {
+    {{'\xe2', '\x96', '\x81'}}, {{'\xe2', '\x96', '\x82'}}, {{'\xe2', '\x96', '\x83'}}, {{'\xe2', '\x96', '\x84'}},
+    {{'\xe2', '\x96', '\x85'}}, {{'\xe2', '\x96', '\x86'}}, {{'\xe2', '\x96', '\x87'}}, {{'\xe2', '\x96', '\x88'}}
+};
+
+static const SparklineGlyph ASCII_GLYPHS[SPARKLINE_LEVELS] = {
+    {{'_'}}, {{'.'}}, {{'-'}}, {{':'}}, {{'='}}, {{'+'}}, {{'*'}}, {{'#'}}
+};
+
+void monitor_history_init(HistoryRing* history) {
+    if (!history) {
+        return;
+    }
+
+    history->next = 0;
+    history->count = 0;
+}
+
+/**
+ * Appends a sample, overwriting the oldest once the ring is full. NaN is
+ * ignored.
+ *
+ * @param history Ring to update.
+ * @param value Sample value.
+ */
+void monitor_history_push(HistoryRing* history, double value) {
+    if (!history || isnan(value)) {
+        return;
+    }
+
+    history->values[history->next] = value;
+    history->next = (history->next + 1) % MONITOR_HISTORY_CAPACITY;
+    if (history->count < MONITOR_HISTORY_CAPACITY) {
+        history->count++;
+    }
+}
+
+/* Index of the first of the newest `window` samples. */
+static size_t window_start(const HistoryRing* history, size_t window) {
+    return (history->next + MONITOR_HISTORY_CAPACITY - window) % MONITOR_HISTORY_CAPACITY;
+}
+
+/**
+ * Computes min/avg/max over the newest window samples.
+ *
+ * @param history Ring to read.
+ * @param window Number of samples; clamped to the samples recorded.
+ * @param out Receives the statistics.
+ * @return MONITOR_STATUS_RANGE_ERROR when the ring is empty.
+ */
+MonitorStatus monitor_history_stats(const HistoryRing* history, size_t window, HistoryStats* out) {
+    if (!history || !out) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+    if (window > history->count) {
+        window = history->count;
+    }
+    memset(out, 0, sizeof(*out));
+    if (window == 0) {
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+
+    size_t index = window_start(history, window);
+    double sum = 0.0;
+    out->min = history->values[index];
+    out->max = history->values[index];
+    for (size_t i = 0; i < window; i++) {
+        double value = history->values[index];
+        out->min = value < out->min ? value : out->min;
+        out->max = value > out->max ? value : out->max;
+        sum += value;
+        index = (index + 1) % MONITOR_HISTORY_CAPACITY;
+    }
+    out->avg = sum / (double)window;
+    out->count = window;
+    return MONITOR_STATUS_OK;
+}
+
+/* Inlined per style so the glyph copy is a fixed-size store rather than a memcpy call. */
+static inline size_t emit_glyphs(const HistoryRing* history,
+                                 size_t index,
+                                 size_t count,
+                                 double low,
+                                 double scale,
+                                 const SparklineGlyph* glyphs,
+                                 size_t glyph_bytes,
+                                 char* out) {
+    for (size_t i = 0; i < count; i++) {
+        double level = (history->values[index] - low) * scale;
+        int glyph = level <= 0.0 ? 0 : level >= SPARKLINE_LEVELS - 1 ? SPARKLINE_LEVELS - 1 : (int)level;
+        memcpy(out + i * glyph_bytes, glyphs[glyph].bytes, glyph_bytes);
+        index = (index + 1) % MONITOR_HISTORY_CAPACITY;
+    }
+    return count * glyph_bytes;
+}
+
+/**
+ * Renders the newest samples as one glyph each, right-aligned in width
+ * columns with spaces on the left until the history fills it. Values are
+ * scaled from [low, high]; when high <= low the shown samples' own range is
+ * used instead. The output is not NUL-terminated.
+ *
+ * @param history Ring to draw.
+ * @param width Columns to fill.
+ * @param low Value drawn as the lowest glyph.
+ * @param high Value drawn as the highest glyph.
+ * @param style ASCII or UTF-8 block glyphs.
+ * @param out Destination buffer.
+ * @param size Size of out.
+ * @return Bytes written, or 0 when out is too small.
+ */
+size_t monitor_sparkline_render(const HistoryRing* history,
+                                size_t width,
+                                double low,
+                                double high,
+                                MonitorSparklineStyle style,
+                                char* out,
+                                size_t size) {
+    const size_t glyph_bytes = style == MONITOR_SPARKLINE_UTF8 ? 3 : 1;
+
+    if (!history || !out) {
+        return 0;
+    }
+
+    size_t shown = width < history->count ? width : history->count;
+    size_t padding = width - shown;
+    if (padding + shown * glyph_bytes > size) {
+        return 0;
+    }
+
+    if (high <= low) {
+        HistoryStats stats;
+        if (monitor_history_stats(history, shown, &stats) == MONITOR_STATUS_OK) {
+            low = stats.min;
+            high = stats.max;
+        }
+    }
+    double scale = high > low ? (double)SPARKLINE_LEVELS / (high - low) : 0.0;
+
+    memset(out, ' ', padding);
+    size_t start = window_start(history, shown);
+    if (style == MONITOR_SPARKLINE_UTF8) {
+        return padding + emit_glyphs(history, start, shown, low, scale, UTF8_GLYPHS, 3, out + padding);
+    }
+    return padding + emit_glyphs(history, start, shown, low, scale, ASCII_GLYPHS, 1, out + padding);
+}
+
+static size_t put_text(char* out, size_t size, const char* text, size_t length, size_t width, bool right_align) {
+    if (length > width) {
+        length = width;
+    }
+    if (width > size) {
+        return 0;
+    }
+
+    size_t padding = width - length;
+    memset(right_align ? out : out + length, ' ', padding);
+    memcpy(right_align ? out + padding : out, text, length);
+    return width;
+}
+
+/* Values wider than SPARKLINE_VALUE_WIDTH widen the line rather than lose digits. */
+static size_t put_value(char* out, size_t size, const char* name, double value) {
+    char digits[32];
+    size_t name_length = strlen(name);
+    size_t length = monitor_format_fixed(digits, sizeof(digits), value, SPARKLINE_VALUE_DECIMALS);
+    size_t width = length > SPARKLINE_VALUE_WIDTH ? length : SPARKLINE_VALUE_WIDTH;
+
+    if (length == 0 || name_length > size) {
+        return 0;
+    }
+    memcpy(out, name, name_length);
+    size_t written = put_text(out + name_length, size - name_length, digits, length, width, true);
+    return written == 0 ? 0 : name_length + written;
+}
+
+/**
+ * Renders one line per row into out: the label, a sparkline filling the
+ * remaining columns and min/avg/max over the samples drawn.
+ *
+ * @param rows Metrics to draw.
+ * @param row_count Number of rows.
+ * @param columns Terminal width; sparklines are capped at
+ *        MONITOR_HISTORY_CAPACITY glyphs on wider terminals.
+ * @param style ASCII or UTF-8 block glyphs.
+ * @param out Destination buffer; NUL-terminated on success.
+ * @param size Size of out.
+ * @return Bytes written excluding the NUL, or 0 when out is too small or
+ *         columns leaves no room for a sparkline.
+ */
+size_t monitor_sparkline_panel(const SparklineRow* rows,
+                               size_t row_count,
+                               size_t columns,
+                               MonitorSparklineStyle style,
+                               char* out,
+                               size_t size) {
+    const size_t fixed = MONITOR_SPARKLINE_LABEL_WIDTH + 1 + MONITOR_SPARKLINE_STATS_WIDTH;
+
+    if (!rows || !out || size == 0 || columns <= fixed) {
+        return 0;
+    }
+
+    size_t width = columns - fixed;
+    if (width > MONITOR_HISTORY_CAPACITY) {
+        width = MONITOR_HISTORY_CAPACITY;
+    }
+
+    size_t used = 0;
+    for (size_t r = 0; r < row_count; r++) {
+        const SparklineRow* row = &rows[r];
+        const char* label = row->label ? row->label : "";
+        HistoryStats stats;
+        size_t written;
+
+        written = put_text(out + used, size - used, label, strlen(label), MONITOR_SPARKLINE_LABEL_WIDTH, false);
+        if (written == 0 || used + written + 1 > size) {
+            return 0;
+        }
+        used += written;
+        out[used++] = ' ';
+
+        written = monitor_sparkline_render(row->history, width, row->low, row->high, style, out + used, size - used);
+        if (written == 0) {
+            return 0;
+        }
+        used += written;
+
+        if (monitor_history_stats(row->history, width, &stats) == MONITOR_STATUS_OK) {
+            const char* names[] = {" min ", " avg ", " max "};
+            const double values[] = {stats.min, stats.avg, stats.max};
+            for (size_t i = 0; i < 3; i++) {
+                written = put_value(out + used, size - used, names[i], values[i]);
+                if (written == 0) {
+                    return 0;
+                }
+                used += written;
+            }
+        } else {
+            written = put_text(out + used, size - used, "", 0, MONITOR_SPARKLINE_STATS_WIDTH, false);
+            if (written == 0) {
+                return 0;
+            }
+            used += written;
+        }
+
+        if (used + 1 >= size) {
+            return 0;
+        }
+        out[used++] = '\n';
+    }
+
+    out[used] = '\0';
+    return used;
+}
@@ -0,0 +1,72 @@
+#ifndef MONITOR_SPARKLINE_H
+#define MONITOR_SPARKLINE_H
+
+#include <stddef.h>
+
+#include "monitor_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Recent-sample history and sparkline rendering for the live dashboard.
+ *
+ * Each metric keeps its last MONITOR_HISTORY_CAPACITY samples in a fixed
+ * ring. A panel row is rendered without printf into a caller buffer: one
+ * glyph per sample copied from a precomputed eight-level table, followed by
+ * min/avg/max over the samples shown, all gathered in the same pass.
+ */
+#define MONITOR_HISTORY_CAPACITY 256
+#define MONITOR_SPARKLINE_LABEL_WIDTH 14
+#define MONITOR_SPARKLINE_STATS_WIDTH 36
+#define MONITOR_SPARKLINE_MAX_GLYPH_BYTES 3
+
+typedef enum {
+    MONITOR_SPARKLINE_ASCII = 0,
+    MONITOR_SPARKLINE_UTF8
+} MonitorSparklineStyle;
+
+typedef struct {
+    double values[MONITOR_HISTORY_CAPACITY];
+    size_t next;
+    size_t count;
+} HistoryRing;
+
+typedef struct {
+    double min;
+    double avg;
+    double max;
+    size_t count;
+} HistoryStats;
+
+typedef struct {
+    const char* label;
+    const HistoryRing* history;
+    double low;
+    double high;
+} SparklineRow;
+
+void monitor_history_init(HistoryRing* history);
+void monitor_history_push(HistoryRing* history, double value);
+MonitorStatus monitor_history_stats(const HistoryRing* history, size_t window, HistoryStats* out);
+
+size_t monitor_sparkline_render(const HistoryRing* history,
+                                size_t width,
+                                double low,
+                                double high,
+                                MonitorSparklineStyle style,
+                                char* out,
+                                size_t size);
+size_t monitor_sparkline_panel(const SparklineRow* rows,
+                               size_t row_count,
+                               size_t columns,
+                               MonitorSparklineStyle style,
+                               char* out,
+                               size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_SPARKLINE_H
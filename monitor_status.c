@@ -1,6 +1,20 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "monitor_status.h"
 
-const char* monitor_status_message(MonitorStatus status) {
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+enum {
+    ERROR_MESSAGE_BYTES = MONITOR_ERROR_MAX_PATH + 192,
+    ERROR_TEXT_BYTES = 96
+};
+
+static _Thread_local MonitorErrorContext last_error;
+static _Thread_local char rendered[ERROR_MESSAGE_BYTES];
+
+static const char* status_text(MonitorStatus status) {
     switch (status) {
         case MONITOR_STATUS_OK:
             return "OK";
@@ -20,3 +34,99 @@ const char* monitor_status_message(MonitorStatus status) {
             return "unknown error";
     }
 }
+
+/**
+ * Records the context of a failure for the calling thread.
+ *
+ * @param status Status the failing call is about to return.
+ * @param error_number errno of the failed system call, or 0.
+ * @param path File involved, or NULL; longer paths are truncated.
+ * @param line 1-based line within path, or 0.
+ * @param offset Byte offset within path, or -1.
+ * @return status, so failure paths can `return monitor_error_set(...)`.
+ */
+MonitorStatus monitor_error_set(MonitorStatus status, int error_number, const char* path, long line, long offset) {
+    struct timespec now;
+
+    last_error.status = status;
+    last_error.error_number = error_number;
+    snprintf(last_error.path, sizeof(last_error.path), "%s", path ? path : "");
+    last_error.line = line;
+    last_error.offset = offset;
+    last_error.timestamp_ns = clock_gettime(CLOCK_MONOTONIC, &now) == 0
+                                  ? (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec
+                                  : 1;
+    return status;
+}
+
+/**
+ * Records a parse failure at position within text, the contents of path;
+ * the line is counted here rather than tracked by the parser.
+ *
+ * @return status.
+ */
+MonitorStatus monitor_error_set_at(MonitorStatus status, const char* path, const char* text, const char* position) {
+    long line = 0;
+    long offset = -1;
+
+    if (text && position && position >= text) {
+        line = 1;
+        for (const char* cursor = text; cursor < position; cursor++) {
+            line += *cursor == '\n';
+        }
+        offset = (long)(position - text);
+    }
+    return monitor_error_set(status, 0, path, line, offset);
+}
+
+const MonitorErrorContext* monitor_error_last(void) {
+    return &last_error;
+}
+
+/* Cheap when nothing was recorded, so callers can clear on every success. */
+void monitor_error_clear(void) {
+    if (last_error.timestamp_ns != 0) {
+        memset(&last_error, 0, sizeof(last_error));
+    }
+}
+
+/**
+ * Describes a status. When the calling thread's last recorded failure has
+ * this status, the text adds its file, position and errno, e.g.
+ * "parse error in /proc/stat at line 1, byte 0" or
+ * "I/O error in /proc/meminfo: Permission denied".
+ *
+ * @param status Status to describe.
+ * @return A static string, or a thread-local buffer that the thread's
+ *         next call overwrites.
+ */
+const char* monitor_status_message(MonitorStatus status) {
+    const MonitorErrorContext* error = &last_error;
+
+    if (status == MONITOR_STATUS_OK || error->timestamp_ns == 0 || error->status != status) {
+        return status_text(status);
+    }
+
+    int length = snprintf(rendered, sizeof(rendered), "%s", status_text(status));
+    if (error->path[0] != '\0' && length < (int)sizeof(rendered)) {
+        length += snprintf(rendered + length, sizeof(rendered) - (size_t)length, " in %s", error->path);
+    }
+    if (error->line > 0 && length < (int)sizeof(rendered)) {
+        length += snprintf(rendered + length, sizeof(rendered) - (size_t)length, " at line %ld", error->line);
+    }
+    if (error->offset >= 0 && length < (int)sizeof(rendered)) {
+        length += snprintf(rendered + length,
+                           sizeof(rendered) - (size_t)length,
+                           "%s byte %ld",
+                           error->line > 0 ? "," : " at",
+                           error->offset);
+    }
+    if (error->error_number != 0 && length < (int)sizeof(rendered)) {
+        char text[ERROR_TEXT_BYTES];
+        if (strerror_r(error->error_number, text, sizeof(text)) != 0) {
+            snprintf(text, sizeof(text), "errno %d", error->error_number);
+        }
+        snprintf(rendered + length, sizeof(rendered) - (size_t)length, ": %s", text);
+    }
+    return rendered;
+}
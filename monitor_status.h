@@ -1,6 +1,8 @@
 #ifndef MONITOR_STATUS_H
 #define MONITOR_STATUS_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -15,6 +17,44 @@ typedef enum {
     MONITOR_STATUS_INTERNAL_ERROR
 } MonitorStatus;
 
+#define MONITOR_ERROR_MAX_PATH 256
+
+/*
+ * Where the calling thread's most recent failure happened. Failure paths
+ * record it with monitor_error_set() on their way out and success paths
+ * never touch it, so it costs nothing until something fails; the setters
+ * are cold and out of line. A record is only meaningful right after a call
+ * returned the status it carries, which monitor_status_message() checks;
+ * callers that keep going after a failure clear it with monitor_error_clear()
+ * before the next attempt, so a later failure with the same status that
+ * records nothing is not described with the earlier one's file.
+ */
+typedef struct {
+    MonitorStatus status;
+    int error_number;                  // errno, or 0
+    char path[MONITOR_ERROR_MAX_PATH]; // file involved, or empty
+    long line;                         // 1-based line in path, or 0
+    long offset;                       // byte offset in path, or -1
+    uint64_t timestamp_ns;             // CLOCK_MONOTONIC when recorded; 0 if never
+} MonitorErrorContext;
+
+#if defined(__GNUC__)
+#define MONITOR_COLD __attribute__((cold, noinline))
+#else
+#define MONITOR_COLD
+#endif
+
+MONITOR_COLD MonitorStatus monitor_error_set(MonitorStatus status,
+                                             int error_number,
+                                             const char* path,
+                                             long line,
+                                             long offset);
+MONITOR_COLD MonitorStatus monitor_error_set_at(MonitorStatus status,
+                                                const char* path,
+                                                const char* text,
+                                                const char* position);
+const MonitorErrorContext* monitor_error_last(void);
+void monitor_error_clear(void);
 const char* monitor_status_message(MonitorStatus status);
 
 #ifdef __cplusplus
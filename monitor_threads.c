@@ -0,0 +1,623 @@
+#define _GNU_SOURCE
+
+#include "monitor_threads.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/taskstats.h>) && __has_include(<linux/genetlink.h>)
+#include <linux/genetlink.h>
+#include <linux/netlink.h>
+#include <linux/taskstats.h>
+#define MONITOR_HAVE_TASKSTATS 1
+#endif
+#endif
+
+#ifndef MONITOR_HAVE_TASKSTATS
+#define MONITOR_HAVE_TASKSTATS 0
+#endif
+
+enum {
+    STAT_READ_BYTES = 1024,
+    TASKSTATS_BATCH = 64,
+    TASKSTATS_REPLY_BYTES = 2048,
+    TASKSTATS_RECEIVE_BUFFER = TASKSTATS_BATCH * 4096
+};
+
+const char* monitor_threads_backend_name(MonitorThreadsBackend backend) {
+    switch (backend) {
+        case MONITOR_THREADS_BACKEND_TASKSTATS:
+            return "taskstats";
+        case MONITOR_THREADS_BACKEND_PROCFS:
+            return "procfs";
+        default:
+            return "auto";
+    }
+}
+
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void copy_comm(char* dest, const char* src, size_t length) {
+    if (length >= MONITOR_THREADS_COMM_SIZE) {
+        length = MONITOR_THREADS_COMM_SIZE - 1;
+    }
+    memcpy(dest, src, length);
+    dest[length] = '\0';
+}
+
+#if MONITOR_HAVE_TASKSTATS
+
+typedef struct {
+    struct nlmsghdr header;
+    struct genlmsghdr genl;
+    struct nlattr attr;
+    uint32_t value;
+} TaskstatsRequest;
+
+/* The uapi attribute macros are int-typed; these keep the arithmetic unsigned. */
+#define ATTR_HEADER ATTR_ALIGN(sizeof(struct nlattr))
+#define ATTR_ALIGN(length) (((size_t)(length) + (size_t)NLA_ALIGNTO - 1) & ~((size_t)NLA_ALIGNTO - 1))
+
+static const struct nlattr* next_attr(const char* data, size_t length, size_t* offset) {
+    if (*offset + ATTR_HEADER > length) {
+        return NULL;
+    }
+    const struct nlattr* attr = (const struct nlattr*)(const void*)(data + *offset);
+    if (attr->nla_len < ATTR_HEADER || *offset + attr->nla_len > length) {
+        return NULL;
+    }
+    *offset += ATTR_ALIGN(attr->nla_len);
+    return attr;
+}
+
+/* Looks up the generic-netlink id of the TASKSTATS family. */
+static MonitorStatus taskstats_resolve(int fd, uint16_t* out_family) {
+    struct {
+        struct nlmsghdr header;
+        struct genlmsghdr genl;
+        char attrs[64];
+    } request;
+    char reply[TASKSTATS_REPLY_BYTES];
+    const size_t name_length = sizeof(TASKSTATS_GENL_NAME);
+
+    memset(&request, 0, sizeof(request));
+    struct nlattr* name = (struct nlattr*)(void*)request.attrs;
+    name->nla_type = CTRL_ATTR_FAMILY_NAME;
+    name->nla_len = (uint16_t)(ATTR_HEADER + name_length);
+    memcpy(request.attrs + ATTR_HEADER, TASKSTATS_GENL_NAME, name_length);
+    request.header.nlmsg_len = (uint32_t)(NLMSG_LENGTH(GENL_HDRLEN) + ATTR_ALIGN(name->nla_len));
+    request.header.nlmsg_type = GENL_ID_CTRL;
+    request.header.nlmsg_flags = NLM_F_REQUEST;
+    request.genl.cmd = CTRL_CMD_GETFAMILY;
+    request.genl.version = 1;
+
+    if (send(fd, &request, request.header.nlmsg_len, 0) < 0) {
+        return MONITOR_STATUS_IO_ERROR;
+    }
+    ssize_t received = recv(fd, reply, sizeof(reply), 0);
+    const struct nlmsghdr* header = (const struct nlmsghdr*)(void*)reply;
+    if (received < (ssize_t)NLMSG_LENGTH(GENL_HDRLEN) || !NLMSG_OK(header, (size_t)received) ||
+        header->nlmsg_type != GENL_ID_CTRL) {
+        return MONITOR_STATUS_UNSUPPORTED;
+    }
+
+    const char* attrs = (const char*)NLMSG_DATA(header) + GENL_HDRLEN;
+    size_t length = header->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+    size_t offset = 0;
+    const struct nlattr* attr;
+    while ((attr = next_attr(attrs, length, &offset)) != NULL) {
+        if (attr->nla_type == CTRL_ATTR_FAMILY_ID && attr->nla_len >= ATTR_HEADER + sizeof(uint16_t)) {
+            memcpy(out_family, (const char*)attr + ATTR_HEADER, sizeof(uint16_t));
+            return MONITOR_STATUS_OK;
+        }
+    }
+    return MONITOR_STATUS_UNSUPPORTED;
+}
+
+/* Extracts the thread's CPU time and comm from one TASKSTATS_CMD_GET reply. */
+static bool taskstats_parse(const struct nlmsghdr* header, uint64_t* out_cpu_us, char* comm) {
+    const char* attrs = (const char*)NLMSG_DATA(header) + GENL_HDRLEN;
+    size_t length = header->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+    size_t offset = 0;
+    const struct nlattr* attr;
+
+    while ((attr = next_attr(attrs, length, &offset)) != NULL) {
+        if (attr->nla_type != TASKSTATS_TYPE_AGGR_PID) {
+            continue;
+        }
+        const char* nested = (const char*)attr + ATTR_HEADER;
+        size_t nested_length = attr->nla_len - ATTR_HEADER;
+        size_t nested_offset = 0;
+        const struct nlattr* inner;
+        while ((inner = next_attr(nested, nested_length, &nested_offset)) != NULL) {
+            /* struct taskstats only grows at the end, so these offsets hold for newer kernels too. */
+            if (inner->nla_type == TASKSTATS_TYPE_STATS &&
+                inner->nla_len >= ATTR_HEADER + offsetof(struct taskstats, ac_stime) + sizeof(uint64_t)) {
+                const char* stats = (const char*)inner + ATTR_HEADER;
+                uint64_t utime = 0;
+                uint64_t stime = 0;
+                memcpy(&utime, stats + offsetof(struct taskstats, ac_utime), sizeof(utime));
+                memcpy(&stime, stats + offsetof(struct taskstats, ac_stime), sizeof(stime));
+                const char* name = stats + offsetof(struct taskstats, ac_comm);
+                copy_comm(comm, name, strnlen(name, TS_COMM_LEN));
+                *out_cpu_us = utime + stime;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static MonitorStatus taskstats_open(ThreadTracker* tracker) {
+    int buffer_size = TASKSTATS_RECEIVE_BUFFER;
+    struct sockaddr_nl address;
+
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+    if (fd < 0) {
+        return MONITOR_STATUS_UNSUPPORTED;
+    }
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        taskstats_resolve(fd, &tracker->family_id) != MONITOR_STATUS_OK) {
+        close(fd);
+        return MONITOR_STATUS_UNSUPPORTED;
+    }
+
+    tracker->netlink_buffer = malloc((size_t)TASKSTATS_BATCH * (sizeof(TaskstatsRequest) + TASKSTATS_REPLY_BYTES));
+    if (!tracker->netlink_buffer) {
+        close(fd);
+        return MONITOR_STATUS_INTERNAL_ERROR;
+    }
+    tracker->netlink_fd = fd;
+    return MONITOR_STATUS_OK;
+}
+
+#endif
+
+static void record_thread(ThreadTracker* tracker, int32_t pid, int32_t tid, uint64_t cpu_us, const char* comm);
+
+/*
+ * Queries up to TASKSTATS_BATCH threads with one sendmsg and one recvmmsg.
+ * The kernel answers each request synchronously while processing the send,
+ * so every reply is already queued when recvmmsg runs. Threads that exited
+ * in between answer with an error and are skipped.
+ */
+static MonitorStatus taskstats_query(ThreadTracker* tracker, int32_t pid, const int32_t* tids, size_t count) {
+#if MONITOR_HAVE_TASKSTATS
+    TaskstatsRequest* requests = (TaskstatsRequest*)(void*)tracker->netlink_buffer;
+    char* replies = tracker->netlink_buffer + (size_t)TASKSTATS_BATCH * sizeof(TaskstatsRequest);
+    struct mmsghdr messages[TASKSTATS_BATCH];
+    struct iovec vectors[TASKSTATS_BATCH];
+
+    for (size_t i = 0; i < count; i++) {
+        TaskstatsRequest* request = &requests[i];
+        memset(request, 0, sizeof(*request));
+        request->header.nlmsg_len = sizeof(*request);
+        request->header.nlmsg_type = tracker->family_id;
+        request->header.nlmsg_flags = NLM_F_REQUEST;
+        request->header.nlmsg_seq = (uint32_t)i;
+        request->genl.cmd = TASKSTATS_CMD_GET;
+        request->genl.version = TASKSTATS_GENL_VERSION;
+        request->attr.nla_type = TASKSTATS_CMD_ATTR_PID;
+        request->attr.nla_len = ATTR_HEADER + sizeof(uint32_t);
+        request->value = (uint32_t)tids[i];
+
+        vectors[i].iov_base = replies + i * TASKSTATS_REPLY_BYTES;
+        vectors[i].iov_len = TASKSTATS_REPLY_BYTES;
+        memset(&messages[i], 0, sizeof(messages[i]));
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    tracker->syscalls++;
+    if (send(tracker->netlink_fd, requests, count * sizeof(TaskstatsRequest), 0) < 0) {
+        return MONITOR_STATUS_IO_ERROR;
+    }
+
+    size_t answered = 0;
+    while (answered < count) {
+        tracker->syscalls++;
+        int received = recvmmsg(tracker->netlink_fd, messages, (unsigned)(count - answered), MSG_DONTWAIT, NULL);
+        if (received < 0) {
+            return errno == EAGAIN ? MONITOR_STATUS_OK : MONITOR_STATUS_IO_ERROR;
+        }
+        for (int m = 0; m < received; m++) {
+            const struct nlmsghdr* header = (const struct nlmsghdr*)messages[m].msg_hdr.msg_iov->iov_base;
+            char comm[MONITOR_THREADS_COMM_SIZE];
+            uint64_t cpu_us = 0;
+
+            answered++;
+            if (!NLMSG_OK(header, messages[m].msg_len) || header->nlmsg_type != tracker->family_id ||
+                header->nlmsg_seq >= count || !taskstats_parse(header, &cpu_us, comm)) {
+                continue;
+            }
+            record_thread(tracker, pid, tids[header->nlmsg_seq], cpu_us, comm);
+        }
+    }
+    return MONITOR_STATUS_OK;
+#else
+    (void)tracker;
+    (void)pid;
+    (void)tids;
+    (void)count;
+    return MONITOR_STATUS_UNSUPPORTED;
+#endif
+}
+
+/* utime and stime are fields 14 and 15; the comm before them may contain spaces and ')'. */
+static bool parse_task_stat(const char* text, long clock_ticks, uint64_t* out_cpu_us, char* comm) {
+    const char* open = strchr(text, '(');
+    const char* close = strrchr(text, ')');
+    if (!open || !close || close < open) {
+        return false;
+    }
+    copy_comm(comm, open + 1, (size_t)(close - open - 1));
+
+    const char* cursor = close + 1;
+    unsigned long long utime = 0;
+    unsigned long long stime = 0;
+    for (int field = 3; field <= 15; field++) {
+        while (*cursor == ' ') {
+            cursor++;
+        }
+        if (*cursor == '\0') {
+            return false;
+        }
+        if (field == 14 || field == 15) {
+            char* end = NULL;
+            unsigned long long value = strtoull(cursor, &end, 10);
+            if (end == cursor) {
+                return false;
+            }
+            *(field == 14 ? &utime : &stime) = value;
+            cursor = end;
+        } else {
+            while (*cursor != ' ' && *cursor != '\0') {
+                cursor++;
+            }
+        }
+    }
+    *out_cpu_us = (utime + stime) * 1000000ULL / (unsigned long long)clock_ticks;
+    return true;
+}
+
+static void procfs_query(ThreadTracker* tracker, size_t pid_index, const int32_t* tids, size_t count) {
+    int dir_fd = dirfd(tracker->task_dirs[pid_index]);
+    long clock_ticks = sysconf(_SC_CLK_TCK);
+    char path[32];
+    char text[STAT_READ_BYTES];
+
+    if (clock_ticks <= 0) {
+        clock_ticks = 100;
+    }
+    for (size_t i = 0; i < count; i++) {
+        char comm[MONITOR_THREADS_COMM_SIZE];
+        uint64_t cpu_us = 0;
+
+        snprintf(path, sizeof(path), "%d/stat", (int)tids[i]);
+        tracker->syscalls += 3;
+        int fd = openat(dir_fd, path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        ssize_t length = read(fd, text, sizeof(text) - 1);
+        close(fd);
+        if (length <= 0) {
+            continue;
+        }
+        text[length] = '\0';
+        if (parse_task_stat(text, clock_ticks, &cpu_us, comm)) {
+            record_thread(tracker, tracker->pids[pid_index], tids[i], cpu_us, comm);
+        }
+    }
+}
+
+static size_t table_slot(int32_t tid) {
+    return ((uint32_t)tid * 2654435761u) & (MONITOR_THREADS_TABLE_CAPACITY - 1);
+}
+
+static void insert_top(ThreadTracker* tracker, const ThreadEntry* entry) {
+    size_t position = tracker->top_count;
+    if (position == MONITOR_THREADS_TOP) {
+        if (entry->delta_us <= tracker->top[MONITOR_THREADS_TOP - 1].cpu_us) {
+            return;
+        }
+        position--;
+    } else {
+        tracker->top_count++;
+    }
+    /* While sampling, top[].cpu_us holds the delta; percentages are filled in afterwards. */
+    while (position > 0 && tracker->top[position - 1].cpu_us < entry->delta_us) {
+        tracker->top[position] = tracker->top[position - 1];
+        position--;
+    }
+    ThreadUsage* usage = &tracker->top[position];
+    usage->pid = entry->pid;
+    usage->tid = entry->tid;
+    usage->cpu_us = entry->delta_us;
+    memcpy(usage->comm, entry->comm, sizeof(usage->comm));
+}
+
+static void record_thread(ThreadTracker* tracker, int32_t pid, int32_t tid, uint64_t cpu_us, const char* comm) {
+    size_t slot = table_slot(tid);
+    ThreadEntry* entry;
+
+    while ((entry = &tracker->table[slot])->tid != 0 && entry->tid != tid) {
+        slot = (slot + 1) & (MONITOR_THREADS_TABLE_CAPACITY - 1);
+    }
+
+    if (entry->tid == tid && entry->pid == pid) {
+        uint32_t intervals = tracker->generation - entry->sampled_generation;
+        entry->delta_us = cpu_us >= entry->cpu_us ? cpu_us - entry->cpu_us : 0;
+        /* A thread left unread on earlier ticks reports its average over the intervals it missed. */
+        if (intervals > 1) {
+            entry->delta_us /= intervals;
+        }
+    } else {
+        if (entry->tid == 0) {
+            if (tracker->tracked >= MONITOR_THREADS_MAX_TRACKED) {
+                tracker->dropped++;
+                return;
+            }
+            tracker->tracked++;
+        }
+        /* A thread born since the last sample spent all of its CPU time within the interval. */
+        entry->tid = tid;
+        entry->pid = pid;
+        entry->delta_us = tracker->primed ? cpu_us : 0;
+    }
+    entry->cpu_us = cpu_us;
+    entry->generation = tracker->generation;
+    entry->sampled_generation = tracker->generation;
+    memcpy(entry->comm, comm, sizeof(entry->comm));
+    tracker->threads++;
+    insert_top(tracker, entry);
+}
+
+/* Backward-shift deletion keeps probe chains intact without tombstones. */
+static void table_remove(ThreadTracker* tracker, size_t slot) {
+    const size_t mask = MONITOR_THREADS_TABLE_CAPACITY - 1;
+    size_t hole = slot;
+    size_t next = (slot + 1) & mask;
+
+    while (tracker->table[next].tid != 0) {
+        size_t home = table_slot(tracker->table[next].tid);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            tracker->table[hole] = tracker->table[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    tracker->table[hole].tid = 0;
+    tracker->tracked--;
+}
+
+/*
+ * A thread still listed under /proc/<pid>/task but without a reading this tick
+ * (a partial taskstats batch, a stat read that failed) is alive; stamping it
+ * keeps its baseline instead of letting sweep_exited() drop it.
+ */
+static size_t keep_unread(ThreadTracker* tracker, int32_t pid, const int32_t* tids, size_t count) {
+    size_t kept = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        size_t slot = table_slot(tids[i]);
+        ThreadEntry* entry;
+        while ((entry = &tracker->table[slot])->tid != 0 && entry->tid != tids[i]) {
+            slot = (slot + 1) & (MONITOR_THREADS_TABLE_CAPACITY - 1);
+        }
+        if (entry->tid == tids[i] && entry->pid == pid && entry->generation != tracker->generation) {
+            entry->generation = tracker->generation;
+            kept++;
+        }
+    }
+    return kept;
+}
+
+static void sweep_exited(ThreadTracker* tracker, size_t live) {
+    for (size_t slot = 0; slot < MONITOR_THREADS_TABLE_CAPACITY && tracker->tracked > live;) {
+        const ThreadEntry* entry = &tracker->table[slot];
+        if (entry->tid != 0 && entry->generation != tracker->generation) {
+            table_remove(tracker, slot);
+            continue;
+        }
+        slot++;
+    }
+}
+
+/**
+ * Prepares an empty tracker.
+ *
+ * @param tracker Tracker to initialise.
+ * @param backend MONITOR_THREADS_BACKEND_AUTO uses taskstats when the
+ *        kernel answers a query for this process and procfs otherwise; the
+ *        other values force one path.
+ * @return MONITOR_STATUS_UNSUPPORTED when taskstats was forced but is not
+ *         available.
+ */
+MonitorStatus monitor_threads_init(ThreadTracker* tracker, MonitorThreadsBackend backend) {
+    if (!tracker) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    memset(tracker, 0, sizeof(*tracker));
+    tracker->netlink_fd = -1;
+    tracker->backend = MONITOR_THREADS_BACKEND_PROCFS;
+    tracker->table = calloc(MONITOR_THREADS_TABLE_CAPACITY, sizeof(*tracker->table));
+    tracker->tids = malloc(MONITOR_THREADS_MAX_TRACKED * sizeof(*tracker->tids));
+    if (!tracker->table || !tracker->tids) {
+        monitor_threads_free(tracker);
+        return MONITOR_STATUS_INTERNAL_ERROR;
+    }
+    if (backend == MONITOR_THREADS_BACKEND_PROCFS) {
+        return MONITOR_STATUS_OK;
+    }
+
+#if MONITOR_HAVE_TASKSTATS
+    if (taskstats_open(tracker) == MONITOR_STATUS_OK) {
+        /* Probing with our own pid catches kernels that refuse the query (it needs CAP_NET_ADMIN). */
+        int32_t self = (int32_t)getpid();
+        tracker->backend = MONITOR_THREADS_BACKEND_TASKSTATS;
+        bool answered = taskstats_query(tracker, self, &self, 1) == MONITOR_STATUS_OK && tracker->threads == 1;
+        memset(tracker->table, 0, MONITOR_THREADS_TABLE_CAPACITY * sizeof(*tracker->table));
+        tracker->tracked = 0;
+        tracker->threads = 0;
+        tracker->top_count = 0;
+        tracker->syscalls = 0;
+        if (answered) {
+            return MONITOR_STATUS_OK;
+        }
+        tracker->backend = MONITOR_THREADS_BACKEND_PROCFS;
+        close(tracker->netlink_fd);
+        tracker->netlink_fd = -1;
+        free(tracker->netlink_buffer);
+        tracker->netlink_buffer = NULL;
+    }
+#endif
+    if (backend == MONITOR_THREADS_BACKEND_TASKSTATS) {
+        monitor_threads_free(tracker);
+        return MONITOR_STATUS_UNSUPPORTED;
+    }
+    return MONITOR_STATUS_OK;
+}
+
+/**
+ * Adds a process whose threads are sampled. Its task directory stays open
+ * until the tracker is freed.
+ *
+ * @param tracker Tracker to extend.
+ * @param pid Process id.
+ * @return MONITOR_STATUS_IO_ERROR when the process does not exist,
+ *         MONITOR_STATUS_RANGE_ERROR when MONITOR_THREADS_MAX_PIDS are
+ *         already watched.
+ */
+MonitorStatus monitor_threads_watch(ThreadTracker* tracker, int pid) {
+    char path[64];
+
+    if (!tracker || !tracker->table || pid <= 0) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+    for (size_t i = 0; i < tracker->pid_count; i++) {
+        if (tracker->pids[i] == pid) {
+            return MONITOR_STATUS_OK;
+        }
+    }
+    if (tracker->pid_count == MONITOR_THREADS_MAX_PIDS) {
+        return MONITOR_STATUS_RANGE_ERROR;
+    }
+
+    snprintf(path, sizeof(path), "/proc/%d/task", pid);
+    DIR* dir = opendir(path);
+    if (!dir) {
+        return MONITOR_STATUS_IO_ERROR;
+    }
+    tracker->pids[tracker->pid_count] = (int32_t)pid;
+    tracker->task_dirs[tracker->pid_count] = dir;
+    tracker->pid_count++;
+    return MONITOR_STATUS_OK;
+}
+
+static size_t list_tasks(ThreadTracker* tracker, size_t pid_index, size_t capacity) {
+    DIR* dir = tracker->task_dirs[pid_index];
+    struct dirent* entry;
+    size_t count = 0;
+
+    rewinddir(dir);
+    while ((entry = readdir(dir)) != NULL) {
+        char* end = NULL;
+        long tid = strtol(entry->d_name, &end, 10);
+        if (end == entry->d_name || *end != '\0' || tid <= 0) {
+            continue;
+        }
+        if (count == capacity) {
+            tracker->dropped++;
+            continue;
+        }
+        tracker->tids[count++] = (int32_t)tid;
+    }
+    return count;
+}
+
+/**
+ * Samples every thread of the watched processes and ranks them by CPU time
+ * used since the previous sample. The first sample only sets the baseline.
+ *
+ * @param tracker Tracker to update; top[0..top_count) holds the busiest
+ *        threads afterwards, with cpu_percent relative to one CPU.
+ * @return MonitorStatus indicating success or error state.
+ */
+MonitorStatus monitor_threads_sample(ThreadTracker* tracker) {
+    if (!tracker || !tracker->table) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    int64_t now = monotonic_ns();
+    tracker->generation++;
+    tracker->threads = 0;
+    tracker->top_count = 0;
+
+    size_t kept = 0;
+    for (size_t p = 0; p < tracker->pid_count; p++) {
+        size_t count = list_tasks(tracker, p, MONITOR_THREADS_MAX_TRACKED);
+        size_t read_before = tracker->threads;
+        size_t done = 0;
+        while (tracker->backend == MONITOR_THREADS_BACKEND_TASKSTATS && done < count) {
+            size_t batch = count - done < TASKSTATS_BATCH ? count - done : TASKSTATS_BATCH;
+            if (taskstats_query(tracker, tracker->pids[p], tracker->tids + done, batch) != MONITOR_STATUS_OK) {
+                tracker->backend = MONITOR_THREADS_BACKEND_PROCFS;
+                break;
+            }
+            done += batch;
+        }
+        if (done < count) {
+            procfs_query(tracker, p, tracker->tids + done, count - done);
+        }
+        if (tracker->threads - read_before < count) {
+            kept += keep_unread(tracker, tracker->pids[p], tracker->tids, count);
+        }
+    }
+    sweep_exited(tracker, tracker->threads + kept);
+
+    double elapsed_us = (double)(now - tracker->last_sample_ns) / 1000.0;
+    for (size_t i = 0; i < tracker->top_count; i++) {
+        ThreadUsage* usage = &tracker->top[i];
+        usage->cpu_percent = tracker->primed && elapsed_us > 0.0 ? (double)usage->cpu_us * 100.0 / elapsed_us : 0.0;
+    }
+    if (!tracker->primed) {
+        tracker->top_count = 0;
+    }
+    tracker->primed = true;
+    tracker->last_sample_ns = now;
+    return MONITOR_STATUS_OK;
+}
+
+void monitor_threads_free(ThreadTracker* tracker) {
+    if (!tracker) {
+        return;
+    }
+
+    for (size_t i = 0; i < tracker->pid_count; i++) {
+        closedir(tracker->task_dirs[i]);
+    }
+    if (tracker->netlink_fd >= 0) {
+        close(tracker->netlink_fd);
+    }
+    free(tracker->netlink_buffer);
+    free(tracker->tids);
+    free(tracker->table);
+    memset(tracker, 0, sizeof(*tracker));
+    tracker->netlink_fd = -1;
+}
@@ -0,0 +1,89 @@
+#ifndef MONITOR_THREADS_H
+#define MONITOR_THREADS_H
+
+#include <dirent.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "monitor_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Per-thread CPU accounting for a small set of watched processes.
+ *
+ * Each watched pid keeps its /proc/PID/task directory open; every sample
+ * rewinds it to list the current threads. CPU time per thread comes from
+ * netlink taskstats when the kernel allows it, with requests sent in
+ * batches so a tick costs a few syscalls per hundred threads, and from
+ * /proc/PID/task/TID/stat otherwise.
+ *
+ * Threads live in one flat open-addressed table keyed by tid. An entry not
+ * seen in a sample belongs to an exited thread and is removed at the end of
+ * that sample, so its slot is reused by later threads.
+ */
+#define MONITOR_THREADS_MAX_PIDS 16
+#define MONITOR_THREADS_TOP 5
+#define MONITOR_THREADS_TABLE_CAPACITY 32768
+#define MONITOR_THREADS_MAX_TRACKED (MONITOR_THREADS_TABLE_CAPACITY / 2)
+#define MONITOR_THREADS_COMM_SIZE 16
+
+typedef enum {
+    MONITOR_THREADS_BACKEND_AUTO = 0,
+    MONITOR_THREADS_BACKEND_TASKSTATS,
+    MONITOR_THREADS_BACKEND_PROCFS
+} MonitorThreadsBackend;
+
+typedef struct {
+    int32_t tid;
+    int32_t pid;
+    uint32_t generation;
+    uint32_t sampled_generation;
+    uint64_t cpu_us;
+    uint64_t delta_us;
+    char comm[MONITOR_THREADS_COMM_SIZE];
+} ThreadEntry;
+
+typedef struct {
+    int32_t pid;
+    int32_t tid;
+    double cpu_percent;
+    uint64_t cpu_us;
+    char comm[MONITOR_THREADS_COMM_SIZE];
+} ThreadUsage;
+
+typedef struct {
+    int32_t pids[MONITOR_THREADS_MAX_PIDS];
+    DIR* task_dirs[MONITOR_THREADS_MAX_PIDS];
+    size_t pid_count;
+    ThreadEntry* table;
+    size_t tracked;
+    uint32_t generation;
+    MonitorThreadsBackend backend;
+    int netlink_fd;
+    uint16_t family_id;
+    int32_t* tids;
+    char* netlink_buffer;
+    int64_t last_sample_ns;
+    bool primed;
+    ThreadUsage top[MONITOR_THREADS_TOP];
+    size_t top_count;
+    size_t threads;
+    unsigned long long dropped;
+    unsigned long long syscalls;
+} ThreadTracker;
+
+MonitorStatus monitor_threads_init(ThreadTracker* tracker, MonitorThreadsBackend backend);
+MonitorStatus monitor_threads_watch(ThreadTracker* tracker, int pid);
+MonitorStatus monitor_threads_sample(ThreadTracker* tracker);
+const char* monitor_threads_backend_name(MonitorThreadsBackend backend);
+void monitor_threads_free(ThreadTracker* tracker);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_THREADS_H
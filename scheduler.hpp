@@ -0,0 +1,41 @@
+// Basic example of a process scheduler in C++
+#ifndef OS_SCHEDULER_HPP
+#define OS_SCHEDULER_HPP
+
+#include <iostream>
+#include <vector>
+
+class Process {
+public:
+    int id;
+    int burstTime;
+    int waitingTime;
+    int turnaroundTime;
+
+    Process(int processId, int burst) : id(processId), burstTime(burst), waitingTime(0), turnaroundTime(0) {}
+};
+
+class Scheduler {
+public:
+    std::vector<Process> processes;
+
+    void addProcess(Process p) {
+        processes.push_back(p);
+    }
+
+    void schedule(std::ostream& out = std::cout) {
+        // Simple First-Come-First-Served (FCFS) scheduling algorithm:
+        // each process waits for the bursts of every process queued before it.
+        int elapsed = 0;
+        for (auto& p : processes) {
+            out << "Process " << p.id << " is running.\n";
+            p.waitingTime = elapsed;
+            elapsed += p.burstTime;
+            p.turnaroundTime = elapsed;
+            out << "Process " << p.id << " finished. Turnaround Time: " << p.turnaroundTime << '\n';
+        }
+        out.flush();
+    }
+};
+
+#endif // OS_SCHEDULER_HPP
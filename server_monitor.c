@@ -1,27 +1,166 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include <errno.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <time.h>
 #include <unistd.h>
 
 #include "monitor.h"
+#include "monitor_alert.h"
+#include "monitor_anomaly.h"
+#include "monitor_arena.h"
+#include "monitor_cgroup.h"
 #include "monitor_config.h"
+#include "monitor_config_file.h"
+#include "monitor_daemon.h"
+#include "monitor_format.h"
+#include "monitor_log.h"
+#include "monitor_probe.h"
+#include "monitor_profile.h"
+#include "monitor_read_batch.h"
+#include "monitor_rollup.h"
+#include "monitor_shm.h"
+#include "monitor_sketch.h"
+#include "monitor_sparkline.h"
 #include "monitor_status.h"
+#include "monitor_threads.h"
+#include "syscall_test.h"
 
+typedef struct {
+    QuantileSketch sketches[MONITOR_METRIC_COUNT];
+    MetricRollup rollups[MONITOR_METRIC_COUNT];
+} HealthStats;
+
+typedef enum {
+    COLLECTOR_READS = 0,
+    COLLECTOR_CPU,
+    COLLECTOR_MEMORY,
+    COLLECTOR_CGROUP,
+    COLLECTOR_COUNT
+} Collector;
+
+typedef struct {
+    CpuTracker tracker;
+    HealthStats* stats;
+    AlertEngine alerts;
+    size_t alert_rule[MONITOR_METRIC_COUNT];
+    AnomalyDetector anomalies;
+    AnomalyEvent anomaly_events[MONITOR_METRIC_COUNT];
+    size_t anomaly_count;
+    bool has_anomalies;
+    const MonitorConfigSnapshot* snapshot;
+    size_t file_rule_base;
+    OutputWriter* writer;
+    FILE* report_stream;
+    CgroupHandle cgroup;
+    CgroupStats cgroup_stats;
+    bool has_cgroup;
+    bool has_cgroup_stats;
+    MonitorShmWriter shm;
+    bool has_shm;
+    ReadBatch reads;
+    size_t stat_slot;
+    size_t meminfo_slot;
+    char stat_path[MONITOR_MAX_CONFIG_PATH + sizeof("/stat")];
+    char meminfo_path[MONITOR_MAX_CONFIG_PATH + sizeof("/meminfo")];
+    const char* reads_failed_path; // set when a --proc-root file cannot be opened
+    int reads_error;
+    CgroupReadSlots cgroup_slots;
+    bool has_reads;
+    bool cgroup_batched;
+    ThreadTracker threads;
+    bool has_threads;
+    MonitorProbeEngine probes;
+    size_t probe_ids[MONITOR_MAX_PROBES];
+    char probe_labels[MONITOR_MAX_PROBES][MONITOR_PROBE_MAX_COMMAND];
+    bool probe_failing[MONITOR_MAX_PROBES];
+    MonitorProbeResult* probe_results;
+    size_t probe_count;
+    int probe_timeout_ms;
+    int probe_cache_ms;
+    MonitorProbeCounters probe_totals;
+    bool has_probes;
+    bool record_probe_cache; // fixed with the output header, whatever a reload does to the probes
+    HistoryRing history[MONITOR_METRIC_COUNT];
+    MonitorArena scratch;
+    MonitorSparklineStyle sparkline_style;
+    unsigned long long collector_errors[COLLECTOR_COUNT];
+    bool collector_failing[COLLECTOR_COUNT];
+    unsigned long long skipped_ticks;
+    int failed_ticks_in_row;
+    unsigned long long dropped_records;
+    bool output_failing;
+    int syscall_bench;
+    bool self_stats;
+    bool live_output;
+    bool ansi;
+} MonitorSession;
+
+enum {
+    MAX_ALERT_EVENTS_PER_TICK = 16,
+    ALERT_MESSAGE_BYTES = 256,
+    PROC_STAT_READ_BYTES = 4096,
+    PROC_MEMINFO_READ_BYTES = 8192,
+    DEFAULT_TERMINAL_COLUMNS = 80,
+    TREND_PANEL_BYTES = MONITOR_METRIC_COUNT *
+                        (MONITOR_SPARKLINE_LABEL_WIDTH + MONITOR_HISTORY_CAPACITY * MONITOR_SPARKLINE_MAX_GLYPH_BYTES +
+                         MONITOR_SPARKLINE_STATS_WIDTH + 64),
+    OUTPUT_BUFFER_BYTES = 256 * MONITOR_OUTPUT_MAX_RECORD_BYTES,
+    SCRATCH_ARENA_BYTES = 64 * 1024,
+    SYSCALL_BENCH_MAX_RESULTS = 32,
+    MAX_FAILED_TICKS_IN_ROW = 10,
+    PROBE_OPEN_FILES_LIMIT = 256,
+    PROBE_OUTPUT_COLUMNS = 60
+};
+
+static const size_t NO_ALERT_RULE = (size_t)-1;
+
+static volatile sig_atomic_t report_requested = 0;
+
+/* Messages passed to log_info/log_warning/log_error must be string literals. */
 static void log_info(const char* message) {
-    printf("[INFO] %s\n", message);
+    monitor_log_write(MONITOR_LOG_INFO, message, NULL, 0);
 }
 
 static void log_warning(const char* message) {
-    fprintf(stderr, "[WARN] %s\n", message);
+    monitor_log_write(MONITOR_LOG_WARNING, message, NULL, 0);
 }
 
 static void log_error(const char* message) {
-    fprintf(stderr, "[ERROR] %s\n", message);
+    monitor_log_write(MONITOR_LOG_ERROR, message, NULL, 0);
+}
+
+static void log_detail(MonitorLogLevel level, const char* format, const char* detail) {
+    MonitorLogArg arg = monitor_log_string(detail);
+    monitor_log_write(level, format, &arg, 1);
+}
+
+static void log_value(MonitorLogLevel level, const char* format, long long value) {
+    MonitorLogArg arg = monitor_log_int(value);
+    monitor_log_write(level, format, &arg, 1);
+}
+
+static void handle_report_signal(int signal_number) {
+    (void)signal_number;
+    report_requested = 1;
+}
+
+static void install_report_handler(void) {
+    struct sigaction action;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_report_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGUSR1, &action, NULL) != 0) {
+        log_warning("Failed to install SIGUSR1 handler; on-demand reports disabled.");
+    }
 }
 
 static bool supports_ansi_output(void) {
@@ -41,6 +180,26 @@ static const char* ansi_reset(bool enabled) {
     return enabled ? "\x1b[0m" : "";
 }
 
+static bool locale_is_utf8(void) {
+    const char* names[] = {"LC_ALL", "LC_CTYPE", "LANG"};
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        const char* value = getenv(names[i]);
+        if (value && value[0] != '\0') {
+            return strstr(value, "UTF-8") || strstr(value, "utf8") || strstr(value, "UTF8") ||
+                   strstr(value, "utf-8");
+        }
+    }
+    return false;
+}
+
+static size_t terminal_columns(void) {
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0) {
+        return size.ws_col;
+    }
+    return DEFAULT_TERMINAL_COLUMNS;
+}
+
 static void print_usage(const char* program) {
     printf("Server Health Monitor\n\n");
     printf("Usage: %s [options]\n\n", program);
@@ -50,10 +209,40 @@ static void print_usage(const char* program) {
     printf("  --duration-ms MS       Total monitoring duration in milliseconds\n");
     printf("  --iterations N         Run N samples (implies non-interactive)\n");
     printf("  --non-interactive      Run without the menu (use flags/env)\n");
+    printf("  --warning-percent P    Warning alert threshold (default: 75)\n");
+    printf("  --critical-percent P   Critical alert threshold (default: 90)\n");
+    printf("  --hysteresis-percent P Band below a threshold before an alert clears (default: 5)\n");
+    printf("  --alert-for-ms MS      Time above a threshold before an alert fires (default: 0)\n");
+    printf("  --alert-interval-ms MS Minimum time between notifications per alert (default: 60000)\n");
+    printf("  --anomaly-sigma N      Flag samples N std devs off their baseline; 0 disables (default: 4)\n");
+    printf("  --anomaly-season-ms MS Period of the seasonal baseline; 0 disables (default: 86400000)\n");
+    printf("  --log-format FORMAT    Log record format: text or json (default: text)\n");
+    printf("  --format FORMAT        Sample output: text, json or csv (json/csv imply non-interactive)\n");
+    printf("  --output-batch N       Records buffered per write for json/csv (default: 1)\n");
+    printf("  --no-cgroup            Report host-wide RAM even inside a memory-limited cgroup\n");
+    printf("  --proc-root DIR        Read stat and meminfo from DIR instead of /proc\n");
+    printf("  --config PATH          Read settings and [alert.NAME] rules from an INI file\n");
+    printf("  --publish-shm NAME     Publish every sample to POSIX shared memory /NAME for local readers\n");
+    printf("  --watch-pids LIST      Show the busiest threads of these comma-separated pids each sample\n");
+    printf("  --daemon               Run until SIGTERM; SIGHUP reloads the file, env and flags\n");
+    printf("  --self-stats           Report time spent collecting, rendering and sleeping per tick\n");
+    printf("  --syscall-bench N      Time N calls of each syscall a tick makes at startup; 0 disables\n");
+    printf("  --probe CMD            Run CMD (no shell) every sample and show its outcome; repeat for up to 8\n");
+    printf("  --probe-timeout-ms MS  Kill a probe that runs longer than MS (default: 2000)\n");
+    printf("  --probe-cgroup DIR     Start probes in this cgroup v2 directory\n");
+    printf("  --probe-cache-ms MS    Reuse a probe's result for MS; 0 only shares runs in flight (default: 0)\n");
     printf("  -h, --help             Show this help message\n\n");
+    printf("Send SIGUSR1 to print p50/p90/p99/max (and self stats, syscall costs) for the current run.\n\n");
     printf("Environment variables:\n");
     printf("  SHM_SERVER_NAME, SHM_INTERVAL_MS, SHM_DURATION_MS,\n");
-    printf("  SHM_NON_INTERACTIVE, SHM_ITERATIONS\n");
+    printf("  SHM_NON_INTERACTIVE, SHM_ITERATIONS, SHM_WARNING_PERCENT,\n");
+    printf("  SHM_CRITICAL_PERCENT, SHM_HYSTERESIS_PERCENT, SHM_ALERT_FOR_MS,\n");
+    printf("  SHM_ALERT_INTERVAL_MS, SHM_LOG_FORMAT, SHM_OUTPUT_FORMAT,\n");
+    printf("  SHM_OUTPUT_BATCH, SHM_USE_CGROUP, SHM_SELF_STATS,\n");
+    printf("  SHM_DAEMON, SHM_CONFIG, SHM_PUBLISH_SHM, SHM_WATCH_PIDS,\n");
+    printf("  SHM_ANOMALY_SIGMA, SHM_ANOMALY_SEASON_MS, SHM_SYSCALL_BENCH,\n");
+    printf("  SHM_PROBE, SHM_PROBE_TIMEOUT_MS, SHM_PROBE_CGROUP, SHM_PROBE_CACHE_MS,\n");
+    printf("  SHM_PROC_ROOT\n");
 }
 
 static void display_menu(void) {
@@ -62,7 +251,8 @@ static void display_menu(void) {
     printf("2. Set Monitoring Interval\n");
     printf("3. Set Monitoring Duration\n");
     printf("4. Show Current Configuration\n");
-    printf("5. Exit\n");
+    printf("5. Show Percentile Report\n");
+    printf("6. Exit\n");
     printf("Enter your choice: ");
 }
 
@@ -89,6 +279,14 @@ static MonitorStatus get_integer_input(const char* prompt, int min, int max, int
     }
 }
 
+static long long wall_clock_ms(void) {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_REALTIME, &ts) != 0) {
+        return 0;
+    }
+    return (long long)ts.tv_sec * 1000LL + (long long)ts.tv_nsec / 1000000LL;
+}
+
 static long long now_ms(void) {
     struct timespec ts;
     if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
@@ -106,22 +304,23 @@ static void sleep_ms(int milliseconds) {
     req.tv_sec = milliseconds / 1000;
     req.tv_nsec = (long)(milliseconds % 1000) * 1000000L;
 
+    MONITOR_PROFILE_BEGIN(sleep);
     while (nanosleep(&req, &req) == -1 && errno == EINTR) {
         // Restart sleep with the remaining duration.
     }
+    MONITOR_PROFILE_END(sleep, MONITOR_PROFILE_SLEEP);
 }
 
-static const char* usage_label(double usage_percent) {
-    const double critical_threshold = 90.0;
-    const double warning_threshold = 75.0;
-
-    if (usage_percent > critical_threshold) {
-        return "CRITICAL";
-    }
-    if (usage_percent > warning_threshold) {
-        return "WARNING";
+static AlertLevel usage_level(const MonitorSession* session, MonitorMetric metric) {
+    size_t rule = session->alert_rule[metric];
+    if (rule == NO_ALERT_RULE) {
+        return ALERT_LEVEL_OK;
     }
-    return "OK";
+    return monitor_alert_engine_level(&session->alerts, rule);
+}
+
+static const char* usage_label(const MonitorSession* session, MonitorMetric metric) {
+    return monitor_alert_level_name(usage_level(session, metric));
 }
 
 static void build_usage_bar(char* buffer, size_t buffer_size, double usage_percent, int width) {
@@ -170,294 +369,1554 @@ static void clear_screen(bool ansi) {
     printf("\x1b[2J\x1b[H");
 }
 
-static MonitorStatus collect_health_snapshot(CpuTracker* tracker, double* cpu_usage, MemoryUsage* memory) {
-    MonitorStatus status = monitor_read_cpu_usage(tracker, cpu_usage);
-    if (status != MONITOR_STATUS_OK) {
-        log_error("Failed to read CPU usage.");
-        return status;
+static void session_open_cgroup(MonitorSession* session, const MonitorConfig* config) {
+    char root[MONITOR_CGROUP_MAX_PATH];
+    char path[MONITOR_CGROUP_MAX_PATH];
+    CgroupStats stats;
+
+    session->has_cgroup = false;
+    session->cgroup.dir_fd = -1;
+    if (!config->use_cgroup) {
+        return;
     }
 
-    status = monitor_read_memory_usage(memory);
-    if (status != MONITOR_STATUS_OK) {
-        log_error("Failed to read memory usage.");
-        return status;
+    if (monitor_cgroup_find_root(root, sizeof(root)) != MONITOR_STATUS_OK ||
+        monitor_cgroup_self_path(path, sizeof(path)) != MONITOR_STATUS_OK ||
+        monitor_cgroup_open(&session->cgroup, root, path) != MONITOR_STATUS_OK) {
+        return;
     }
 
-    return MONITOR_STATUS_OK;
+    if (monitor_cgroup_read(&session->cgroup, &stats) != MONITOR_STATUS_OK || !stats.memory_limited) {
+        monitor_cgroup_close(&session->cgroup);
+        return;
+    }
+
+    session->has_cgroup = true;
+    log_detail(MONITOR_LOG_INFO, "Reporting RAM against the cgroup v2 memory limit of {}", session->cgroup.path);
 }
 
-static void log_threshold_messages(double cpu_usage, double memory_usage) {
-    if (cpu_usage > 90.0) {
-        printf("Critical: High CPU usage detected.\n");
-    } else if (cpu_usage > 75.0) {
-        printf("Warning: CPU usage is elevated.\n");
+/*
+ * A tick's proc and cgroup files are read in one batch; without it each collector reads its own files
+ * from /proc. Another --proc-root has no such fallback, so its files failing to open fails every tick.
+ */
+static void session_open_reads(MonitorSession* session, const MonitorConfig* config) {
+    const char* root = config->proc_root[0] ? config->proc_root : "/proc";
+
+    session->has_reads = false;
+    session->cgroup_batched = false;
+    session->reads_failed_path = NULL;
+    session->reads_error = 0;
+    snprintf(session->stat_path, sizeof(session->stat_path), "%s/stat", root);
+    snprintf(session->meminfo_path, sizeof(session->meminfo_path), "%s/meminfo", root);
+    if (monitor_read_batch_init(&session->reads, MONITOR_READ_BACKEND_AUTO) != MONITOR_STATUS_OK) {
+        session->reads_failed_path = config->proc_root[0] ? session->stat_path : NULL;
+        return;
+    }
+
+    const char* failed_path = NULL;
+    if (monitor_read_batch_add(&session->reads, session->stat_path, PROC_STAT_READ_BYTES, &session->stat_slot) !=
+        MONITOR_STATUS_OK) {
+        failed_path = session->stat_path;
+    } else if (monitor_read_batch_add(&session->reads,
+                                      session->meminfo_path,
+                                      PROC_MEMINFO_READ_BYTES,
+                                      &session->meminfo_slot) != MONITOR_STATUS_OK) {
+        failed_path = session->meminfo_path;
+    }
+    if (failed_path) {
+        session->reads_error = errno;
+        session->reads_failed_path = config->proc_root[0] ? failed_path : NULL;
+        monitor_read_batch_free(&session->reads);
+        return;
     }
 
-    if (memory_usage > 90.0) {
-        printf("Critical: High RAM usage detected.\n");
-    } else if (memory_usage > 75.0) {
-        printf("Warning: RAM usage is elevated.\n");
+    session->cgroup_batched =
+        session->has_cgroup &&
+        monitor_cgroup_batch_add(&session->cgroup, &session->reads, &session->cgroup_slots) == MONITOR_STATUS_OK;
+    session->has_reads = true;
+    if (session->self_stats) {
+        log_detail(MONITOR_LOG_INFO,
+                   "Reading proc files in one batch via {}",
+                   monitor_read_backend_name(session->reads.calibrating ? MONITOR_READ_BACKEND_AUTO
+                                                                        : session->reads.backend));
     }
 }
 
-static MonitorStatus log_health_status(const char* server, CpuTracker* tracker) {
-    double cpu_usage = 0.0;
-    MemoryUsage memory = {0};
-    MonitorStatus status = collect_health_snapshot(tracker, &cpu_usage, &memory);
-    if (status != MONITOR_STATUS_OK) {
-        return status;
+/* Pids that are gone at startup are skipped; the rest are tracked until they exit. */
+static void session_open_threads(MonitorSession* session, const MonitorConfig* config) {
+    session->has_threads = false;
+    if (config->watch_pid_count == 0 ||
+        monitor_threads_init(&session->threads, MONITOR_THREADS_BACKEND_AUTO) != MONITOR_STATUS_OK) {
+        return;
     }
 
-    printf("Server Health Report for: %s\n", server);
-    printf("CPU Usage: %.2f%%\n", cpu_usage);
-    printf("RAM Usage: %.2f%% (%.2f GB / %.2f GB)\n", memory.usage_percent, memory.used_gb, memory.total_gb);
+    for (size_t i = 0; i < config->watch_pid_count; i++) {
+        if (monitor_threads_watch(&session->threads, config->watch_pids[i]) != MONITOR_STATUS_OK) {
+            log_value(MONITOR_LOG_WARNING, "Not watching pid {}: no such process.", config->watch_pids[i]);
+        }
+    }
+    if (session->threads.pid_count == 0) {
+        monitor_threads_free(&session->threads);
+        return;
+    }
 
-    log_threshold_messages(cpu_usage, memory.usage_percent);
+    session->has_threads = true;
+    log_detail(MONITOR_LOG_INFO,
+               "Reading per-thread CPU via {}",
+               monitor_threads_backend_name(session->threads.backend));
+}
 
-    printf("----------------------------------\n");
-    return MONITOR_STATUS_OK;
+/*
+ * Probes get their timeout (rounded up) as a CPU limit, no core dumps and a
+ * small descriptor table; one whose executable is missing is skipped.
+ */
+static void session_open_probes(MonitorSession* session, const MonitorConfig* config) {
+    const MonitorProbeLimits limits = {
+        .cpu_seconds = (unsigned long long)config->probe_timeout_ms / 1000ULL + 1ULL,
+        .open_files = PROBE_OPEN_FILES_LIMIT,
+        .disable_core_dumps = true
+    };
+    const char* cgroup_dir = config->probe_cgroup[0] ? config->probe_cgroup : NULL;
+
+    session->has_probes = false;
+    session->probe_count = 0;
+    if (config->probe_count == 0) {
+        return;
+    }
+    if (monitor_probe_engine_init(&session->probes, &limits, cgroup_dir) != MONITOR_STATUS_OK) {
+        if (cgroup_dir) {
+            log_detail(MONITOR_LOG_WARNING, "Probes disabled: cannot open {}/cgroup.procs.", cgroup_dir);
+        } else {
+            log_warning("Probes disabled: cannot open /dev/null.");
+        }
+        return;
+    }
+    session->probe_results = calloc(config->probe_count, sizeof(MonitorProbeResult));
+    if (!session->probe_results) {
+        monitor_probe_engine_free(&session->probes);
+        return;
+    }
+
+    for (size_t i = 0; i < config->probe_count; i++) {
+        size_t id = 0;
+        if (monitor_probe_prepare(&session->probes, config->probes[i], &id) != MONITOR_STATUS_OK) {
+            log_detail(MONITOR_LOG_WARNING, "Skipping probe {}: executable not found.", config->probes[i]);
+            continue;
+        }
+        session->probe_ids[session->probe_count] = id;
+        session->probe_failing[session->probe_count] = false;
+        snprintf(session->probe_labels[session->probe_count], MONITOR_PROBE_MAX_COMMAND, "%s", config->probes[i]);
+        session->probe_count++;
+    }
+    if (session->probe_count == 0) {
+        free(session->probe_results);
+        session->probe_results = NULL;
+        monitor_probe_engine_free(&session->probes);
+        return;
+    }
+
+    /* The sampling thread runs one probe itself. */
+    if (monitor_probe_engine_start_workers(&session->probes, session->probe_count - 1) != MONITOR_STATUS_OK) {
+        log_warning("Could not start every probe worker; some probes will run one after another.");
+    }
+    session->probe_timeout_ms = config->probe_timeout_ms;
+    session->probe_cache_ms = config->probe_cache_ms;
+    session->has_probes = true;
+    log_value(MONITOR_LOG_INFO, "Running {} probes every sample", (long long)session->probe_count);
 }
 
-static void render_live_dashboard(const MonitorConfig* config,
-                                  const char* server,
-                                  double cpu_usage,
-                                  const MemoryUsage* memory,
-                                  long long elapsed_ms,
-                                  long long remaining_ms,
-                                  int sample_index,
-                                  int total_samples,
-                                  bool ansi) {
-    const char spinner_chars[] = {'|', '/', '-', '\\'};
-    char cpu_bar[64] = {0};
-    char mem_bar[64] = {0};
-    const char* cpu_label = usage_label(cpu_usage);
-    const char* mem_label = usage_label(memory->usage_percent);
-    const char* cpu_color = status_color(ansi, cpu_label);
-    const char* mem_color = status_color(ansi, mem_label);
-    const char* header_color = ansi_color(ansi, "\x1b[36m");
-    const char* bold = ansi_color(ansi, "\x1b[1m");
+static void session_open_collectors(MonitorSession* session, const MonitorConfig* config) {
+    session_open_cgroup(session, config);
+    session_open_reads(session, config);
+    session_open_threads(session, config);
+    session_open_probes(session, config);
+}
 
-    build_usage_bar(cpu_bar, sizeof(cpu_bar), cpu_usage, 28);
-    build_usage_bar(mem_bar, sizeof(mem_bar), memory->usage_percent, 28);
+/* The batch holds the cgroup's files, so it is closed before the cgroup. */
+static void session_close_reads(MonitorSession* session) {
+    monitor_read_batch_free(&session->reads);
+    session->has_reads = false;
+    session->cgroup_batched = false;
+}
 
-    clear_screen(ansi);
+static void session_close_cgroup(MonitorSession* session) {
+    monitor_cgroup_close(&session->cgroup);
+    session->has_cgroup = false;
+}
 
-    printf("%s%sServer Health Monitor%s\n", bold, header_color, ansi_reset(ansi));
-    printf("Server: %s\n", server);
-    if (total_samples > 0) {
-        printf("Sample: %d / %d\n", sample_index, total_samples);
-    } else {
-        printf("Elapsed: %.2fs\n", elapsed_ms / 1000.0);
+static void session_close_threads(MonitorSession* session) {
+    if (session->has_threads) {
+        monitor_threads_free(&session->threads);
+        session->has_threads = false;
     }
-    printf("\n");
+}
 
-    printf("CPU Usage: %s%6.2f%%%s [%s] %s%s%s\n",
-           cpu_color,
-           cpu_usage,
-           ansi_reset(ansi),
-           cpu_bar,
-           cpu_color,
-           cpu_label,
-           ansi_reset(ansi));
-    printf("RAM Usage: %s%6.2f%%%s (%.2f GB / %.2f GB) [%s] %s%s%s\n",
-           mem_color,
-           memory->usage_percent,
-           ansi_reset(ansi),
-           memory->used_gb,
-           memory->total_gb,
-           mem_bar,
-           mem_color,
-           mem_label,
-           ansi_reset(ansi));
+static void session_close_probes(MonitorSession* session) {
+    if (session->has_probes) {
+        MonitorProbeCounters counters;
+        monitor_probe_counters(&session->probes, &counters);
+        monitor_probe_counters_add(&session->probe_totals, &counters);
+        monitor_probe_engine_free(&session->probes);
+        free(session->probe_results);
+        session->probe_results = NULL;
+        session->has_probes = false;
+    }
+}
 
-    printf("\n");
-    log_threshold_messages(cpu_usage, memory->usage_percent);
+static void session_close_collectors(MonitorSession* session) {
+    session_close_reads(session);
+    session_close_cgroup(session);
+    session_close_threads(session);
+    session_close_probes(session);
+}
 
-    if (remaining_ms >= 0) {
-        printf("\nNext sample in: %.2fs  %c\n",
-               remaining_ms / 1000.0,
-               spinner_chars[sample_index % 4]);
+static bool probes_config_changed(const MonitorConfig* current, const MonitorConfig* next) {
+    if (next->probe_count != current->probe_count || next->probe_timeout_ms != current->probe_timeout_ms ||
+        strcmp(next->probe_cgroup, current->probe_cgroup) != 0) {
+        return true;
     }
-    printf("%sSampling every %d ms. Press Ctrl+C to stop early.%s\n",
-           ansi_color(ansi, "\x1b[2m"),
-           config->interval_ms,
-           ansi_reset(ansi));
-    fflush(stdout);
+    for (size_t i = 0; i < next->probe_count; i++) {
+        if (strcmp(next->probes[i], current->probes[i]) != 0) {
+            return true;
+        }
+    }
+    return false;
 }
 
-static MonitorStatus monitor_server_health(const MonitorConfig* config, bool live_output) {
-    CpuTracker tracker = {0};
-    MonitorStatus status = MONITOR_STATUS_OK;
-    const bool ansi = live_output && supports_ansi_output();
+/*
+ * On reload only the collectors whose settings changed are reopened, so the
+ * thread tracker's CPU baselines and the probe engine's cache survive.
+ */
+static void session_reload_collectors(MonitorSession* session,
+                                      const MonitorConfig* current,
+                                      const MonitorConfig* next) {
+    bool cgroup_changed = next->use_cgroup != current->use_cgroup;
+    bool reads_changed = cgroup_changed || strcmp(next->proc_root, current->proc_root) != 0;
+    bool threads_changed = next->watch_pid_count != current->watch_pid_count ||
+                           memcmp(next->watch_pids, current->watch_pids, next->watch_pid_count * sizeof(int)) != 0;
 
-    if (!config) {
-        return MONITOR_STATUS_INVALID_ARGUMENT;
+    if (reads_changed) {
+        session_close_reads(session);
+    }
+    if (cgroup_changed) {
+        session_close_cgroup(session);
+        session_open_cgroup(session, next);
+    }
+    if (reads_changed) {
+        session_open_reads(session, next);
+    }
+    if (threads_changed) {
+        session_close_threads(session);
+        session_open_threads(session, next);
+    }
+    if (probes_config_changed(current, next)) {
+        session_close_probes(session);
+        session_open_probes(session, next);
+    } else {
+        session->probe_cache_ms = next->probe_cache_ms;
     }
+}
 
-    if (config->iterations > 0) {
-        for (int i = 0; i < config->iterations; i++) {
-            if (live_output) {
-                double cpu_usage = 0.0;
-                MemoryUsage memory = {0};
-                long long remaining_ms = (i + 1 < config->iterations) ? config->interval_ms : -1;
-                status = collect_health_snapshot(&tracker, &cpu_usage, &memory);
-                if (status != MONITOR_STATUS_OK) {
-                    return status;
-                }
-                render_live_dashboard(config,
-                                      config->server_name,
-                                      cpu_usage,
-                                      &memory,
-                                      0,
-                                      remaining_ms,
-                                      i + 1,
-                                      config->iterations,
-                                      ansi);
-            } else {
-                status = log_health_status(config->server_name, &tracker);
-            }
-            if (status != MONITOR_STATUS_OK) {
-                return status;
-            }
-            if (i + 1 < config->iterations) {
-                sleep_ms(config->interval_ms);
-            }
-        }
-        return MONITOR_STATUS_OK;
+static const char* collector_name(Collector collector) {
+    switch (collector) {
+        case COLLECTOR_READS:
+            return "batched reads";
+        case COLLECTOR_CPU:
+            return "cpu";
+        case COLLECTOR_MEMORY:
+            return "memory";
+        case COLLECTOR_CGROUP:
+            return "cgroup";
+        default:
+            return "unknown";
     }
+}
 
-    long long start_ms = now_ms();
-    if (start_ms < 0) {
-        return MONITOR_STATUS_INTERNAL_ERROR;
+/* Counts the error and logs it with its context the first time in a row the collector fails. */
+MONITOR_COLD static void collector_failed(MonitorSession* session, Collector collector, MonitorStatus status) {
+    char message[MONITOR_ERROR_MAX_PATH + 256];
+
+    session->collector_errors[collector]++;
+    if (session->collector_failing[collector]) {
+        return;
     }
+    session->collector_failing[collector] = true;
+    snprintf(message, sizeof(message), "%s: %s", collector_name(collector), monitor_status_message(status));
+    log_detail(MONITOR_LOG_WARNING, "Collector failing: {}", message);
+}
 
-    while (true) {
-        long long elapsed = now_ms() - start_ms;
-        if (elapsed >= config->duration_ms) {
-            break;
-        }
+static void collector_succeeded(MonitorSession* session, Collector collector) {
+    if (session->collector_failing[collector]) {
+        session->collector_failing[collector] = false;
+        log_detail(MONITOR_LOG_INFO, "Collector recovered: {}", collector_name(collector));
+    }
+}
 
-        if (live_output) {
-            double cpu_usage = 0.0;
-            MemoryUsage memory = {0};
-            long long remaining_ms = config->duration_ms - elapsed;
-            status = collect_health_snapshot(&tracker, &cpu_usage, &memory);
-            if (status != MONITOR_STATUS_OK) {
-                return status;
-            }
-            render_live_dashboard(config,
-                                  config->server_name,
-                                  cpu_usage,
-                                  &memory,
-                                  elapsed,
-                                  remaining_ms,
-                                  (int)(elapsed / config->interval_ms) + 1,
-                                  0,
-                                  ansi);
-        } else {
-            status = log_health_status(config->server_name, &tracker);
-        }
+/*
+ * A CPU or memory failure fails the snapshot and the caller skips the tick;
+ * a cgroup failure only drops the cgroup figures for this tick.
+ */
+static MonitorStatus collect_health_snapshot(MonitorSession* session,
+                                             double* cpu_usage,
+                                             MemoryUsage* memory,
+                                             MemoryBreakdown* breakdown) {
+    MonitorStatus status = MONITOR_STATUS_OK;
+    MONITOR_PROFILE_BEGIN(collect);
+    if (session->has_reads) {
+        MONITOR_PROFILE_BEGIN(batch);
+        status = monitor_read_batch_run(&session->reads);
+        MONITOR_PROFILE_END(batch, MONITOR_PROFILE_READ_BATCH);
         if (status != MONITOR_STATUS_OK) {
+            collector_failed(session, COLLECTOR_READS, status);
             return status;
         }
+        collector_succeeded(session, COLLECTOR_READS);
+    } else if (session->reads_failed_path) {
+        status = monitor_error_set(MONITOR_STATUS_IO_ERROR, session->reads_error, session->reads_failed_path, 0, -1);
+        collector_failed(session, COLLECTOR_READS, status);
+        return status;
+    }
 
-        long long after_sample_ms = now_ms();
-        if (after_sample_ms < 0) {
-            return MONITOR_STATUS_INTERNAL_ERROR;
-        }
-        long long remaining_ms = config->duration_ms - (after_sample_ms - start_ms);
-        if (remaining_ms <= 0) {
-            break;
-        }
-        int sleep_duration = config->interval_ms;
-        if (remaining_ms < sleep_duration) {
-            sleep_duration = (int)remaining_ms;
-        }
-        sleep_ms(sleep_duration);
+    MONITOR_PROFILE_BEGIN(cpu);
+    if (session->has_reads) {
+        const char* stat = monitor_read_batch_data(&session->reads, session->stat_slot, NULL);
+        status = stat ? monitor_cpu_usage_from_stat(&session->tracker, stat, cpu_usage)
+                      : monitor_error_set(MONITOR_STATUS_IO_ERROR,
+                                          session->reads.slots[session->stat_slot].error,
+                                          session->stat_path,
+                                          0,
+                                          -1);
+    } else {
+        status = monitor_read_cpu_usage(&session->tracker, cpu_usage);
+    }
+    MONITOR_PROFILE_END(cpu, MONITOR_PROFILE_READ_CPU);
+    if (status != MONITOR_STATUS_OK) {
+        collector_failed(session, COLLECTOR_CPU, status);
+        return status;
     }
+    collector_succeeded(session, COLLECTOR_CPU);
 
-    if (live_output) {
-        clear_screen(ansi);
-        printf("Health monitoring completed for server: %s\n", config->server_name);
+    MONITOR_PROFILE_BEGIN(memory);
+    if (session->has_reads) {
+        size_t length = 0;
+        const char* meminfo = monitor_read_batch_data(&session->reads, session->meminfo_slot, &length);
+        status = meminfo && length > 0 ? monitor_parse_meminfo(meminfo, length, breakdown)
+                                       : monitor_error_set(MONITOR_STATUS_IO_ERROR,
+                                                           session->reads.slots[session->meminfo_slot].error,
+                                                           session->meminfo_path,
+                                                           0,
+                                                           -1);
     } else {
-        printf("Health monitoring completed for server: %s\n", config->server_name);
+        status = monitor_read_memory_breakdown(breakdown);
+    }
+    if (status == MONITOR_STATUS_OK) {
+        status = monitor_memory_usage_from_breakdown(breakdown, memory);
+    }
+    MONITOR_PROFILE_END(memory, MONITOR_PROFILE_READ_MEMORY);
+    if (status != MONITOR_STATUS_OK) {
+        collector_failed(session, COLLECTOR_MEMORY, status);
+        return status;
+    }
+    collector_succeeded(session, COLLECTOR_MEMORY);
+
+    session->has_cgroup_stats = false;
+    if (session->has_cgroup) {
+        MONITOR_PROFILE_BEGIN(cgroup);
+        MonitorStatus cgroup_status = session->cgroup_batched
+                                          ? monitor_cgroup_parse_batch(&session->reads, &session->cgroup_slots,
+                                                                       &session->cgroup_stats)
+                                          : monitor_cgroup_read(&session->cgroup, &session->cgroup_stats);
+        if (cgroup_status == MONITOR_STATUS_OK) {
+            session->has_cgroup_stats = true;
+            monitor_cgroup_apply_memory_limit(&session->cgroup_stats, memory);
+            collector_succeeded(session, COLLECTOR_CGROUP);
+        } else {
+            collector_failed(session, COLLECTOR_CGROUP, cgroup_status);
+        }
+        MONITOR_PROFILE_END(cgroup, MONITOR_PROFILE_READ_CGROUP);
     }
+
+    MONITOR_PROFILE_END(collect, MONITOR_PROFILE_COLLECT);
     return MONITOR_STATUS_OK;
 }
 
-int main(int argc, char** argv) {
-    MonitorConfig config;
-    MonitorStatus status = MONITOR_STATUS_OK;
-    char error[128] = {0};
-    bool show_help = false;
-    bool running = true;
+static const char* alert_subject(uint32_t metric) {
+    switch (metric) {
+        case MONITOR_METRIC_CPU_PERCENT:
+            return "CPU";
+        case MONITOR_METRIC_RAM_PERCENT:
+            return "RAM";
+        default:
+            return monitor_metric_name((MonitorMetric)metric);
+    }
+}
 
-    monitor_config_init(&config);
+static void print_alert_message(const char* subject, const char* notify, AlertLevel level) {
+    switch (level) {
+        case ALERT_LEVEL_CRITICAL:
+            printf("Critical: High %s usage detected.", subject);
+            break;
+        case ALERT_LEVEL_WARNING:
+            printf("Warning: %s usage is elevated.", subject);
+            break;
+        default:
+            printf("Recovered: %s usage is back to normal.", subject);
+            break;
+    }
+    if (notify) {
+        printf(" (notify: %s)", notify);
+    }
+    printf("\n");
+}
 
-    status = monitor_config_apply_env(&config, error, sizeof(error));
-    if (status != MONITOR_STATUS_OK) {
-        log_warning(error);
+/* Names a rule for alert messages; file rules also carry their notify target, or NULL. */
+static const char* rule_subject(const MonitorSession* session, size_t rule_index, const char** notify) {
+    if (session->snapshot && rule_index >= session->file_rule_base) {
+        size_t file_index = rule_index - session->file_rule_base;
+        *notify = session->snapshot->rule_notify[file_index];
+        return session->snapshot->rule_names[file_index];
     }
+    *notify = NULL;
+    return alert_subject(session->alerts.rules[rule_index].metric);
+}
 
-    status = monitor_config_apply_args(&config, argc, argv, &show_help, error, sizeof(error));
-    if (status != MONITOR_STATUS_OK) {
-        log_error(error);
-        print_usage(argv[0]);
-        return EXIT_FAILURE;
+static void print_rule_alert(const MonitorSession* session, size_t rule_index, AlertLevel level) {
+    const char* notify = NULL;
+    const char* subject = rule_subject(session, rule_index, &notify);
+    print_alert_message(subject, notify, level);
+}
+
+static void log_alert_events(const MonitorSession* session, const AlertEvent* events, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        print_rule_alert(session, events[i].rule_index, events[i].level);
     }
+}
 
-    if (show_help) {
-        print_usage(argv[0]);
-        return EXIT_SUCCESS;
+/*
+ * JSON/CSV records and the live dashboard only show the current alert levels, so
+ * their transitions go through the logger, which writes to stderr when stdout
+ * carries records.
+ */
+static void log_alert_transitions(const MonitorSession* session, const AlertEvent* events, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const char* notify = NULL;
+        const char* subject = rule_subject(session, events[i].rule_index, &notify);
+        char message[ALERT_MESSAGE_BYTES];
+        MonitorLogLevel level = events[i].level == ALERT_LEVEL_CRITICAL  ? MONITOR_LOG_ERROR
+                                : events[i].level == ALERT_LEVEL_WARNING ? MONITOR_LOG_WARNING
+                                                                         : MONITOR_LOG_INFO;
+
+        snprintf(message,
+                 sizeof(message),
+                 "%s %s (was %s) at %.2f%s%s%s",
+                 subject,
+                 monitor_alert_level_name(events[i].level),
+                 monitor_alert_level_name(events[i].previous_level),
+                 events[i].value,
+                 notify ? " (notify: " : "",
+                 notify ? notify : "",
+                 notify ? ")" : "");
+        log_detail(level, "Alert: {}", message);
+    }
+}
+
+static void print_anomalies(const MonitorSession* session) {
+    for (size_t i = 0; i < session->anomaly_count; i++) {
+        const AnomalyEvent* event = &session->anomaly_events[i];
+        printf("Anomaly: %s %s at %.2f (expected %.2f, z %+.1f)\n",
+               monitor_metric_name((MonitorMetric)event->metric),
+               monitor_anomaly_kind_name(event->flags),
+               event->value,
+               event->expected,
+               event->score);
+    }
+}
+
+static void print_active_alerts(const MonitorSession* session) {
+    for (size_t i = 0; i < session->alerts.count; i++) {
+        AlertLevel level = monitor_alert_engine_level(&session->alerts, i);
+        if (level != ALERT_LEVEL_OK) {
+            print_rule_alert(session, i, level);
+        }
     }
+}
 
-    status = monitor_config_validate(&config, error, sizeof(error));
+static MonitorStatus session_init_alerts(MonitorSession* session,
+                                         const MonitorConfig* config,
+                                         const MonitorConfigSnapshot* snapshot) {
+    const MonitorMetric alerted_metrics[] = {MONITOR_METRIC_CPU_PERCENT, MONITOR_METRIC_RAM_PERCENT};
+    const size_t alerted_count = sizeof(alerted_metrics) / sizeof(alerted_metrics[0]);
+    const size_t file_rule_count = snapshot ? snapshot->rule_count : 0;
+    MonitorStatus status = monitor_alert_engine_init(&session->alerts, alerted_count + file_rule_count);
     if (status != MONITOR_STATUS_OK) {
-        log_error(error);
-        return EXIT_FAILURE;
+        return status;
     }
 
-    printf("Server Health Monitor\n");
-    printf("GitHub: https://github.com/kvnbbg\n");
+    for (size_t i = 0; i < MONITOR_METRIC_COUNT; i++) {
+        session->alert_rule[i] = NO_ALERT_RULE;
+    }
 
-    if (config.non_interactive) {
-        log_info("Running in non-interactive mode.");
-        status = monitor_server_health(&config, false);
+    for (size_t i = 0; i < alerted_count; i++) {
+        AlertRule rule = {
+            .metric = (uint32_t)alerted_metrics[i],
+            .warning_threshold = config->warning_percent,
+            .critical_threshold = config->critical_percent,
+            .hysteresis = config->hysteresis_percent,
+            .for_ms = config->alert_for_ms,
+            .min_notify_interval_ms = config->alert_interval_ms
+        };
+        status = monitor_alert_engine_add_rule(&session->alerts, &rule, &session->alert_rule[alerted_metrics[i]]);
         if (status != MONITOR_STATUS_OK) {
-            log_error(monitor_status_message(status));
-            return EXIT_FAILURE;
+            monitor_alert_engine_free(&session->alerts);
+            return status;
         }
-        return EXIT_SUCCESS;
     }
 
-    while (running) {
-        display_menu();
-        int choice = 0;
-        status = get_integer_input("", 1, 5, &choice);
+    session->snapshot = snapshot;
+    session->file_rule_base = alerted_count;
+    for (size_t i = 0; i < file_rule_count; i++) {
+        status = monitor_alert_engine_add_rule(&session->alerts, &snapshot->rules[i], NULL);
         if (status != MONITOR_STATUS_OK) {
-            log_error("Failed to read menu input.");
-            return EXIT_FAILURE;
+            monitor_alert_engine_free(&session->alerts);
+            return status;
         }
+    }
 
-        switch (choice) {
-            case 1:
-                log_info("Monitoring server health...");
-                status = monitor_server_health(&config, true);
-                if (status != MONITOR_STATUS_OK) {
-                    log_error(monitor_status_message(status));
-                }
-                break;
-            case 2: {
-                int new_interval = 0;
-                status = get_integer_input("Enter new interval (ms): ",
+    return MONITOR_STATUS_OK;
+}
+
+/* Learned baselines survive a reload unless the seasonal period changes. */
+static MonitorStatus session_configure_anomalies(MonitorSession* session, const MonitorConfig* config) {
+    AnomalyParams params;
+
+    session->anomaly_count = 0;
+    if (config->anomaly_sigma == 0) {
+        monitor_anomaly_free(&session->anomalies);
+        session->has_anomalies = false;
+        return MONITOR_STATUS_OK;
+    }
+
+    monitor_anomaly_default_params(&params);
+    params.threshold = config->anomaly_sigma;
+    params.season_ms = config->anomaly_season_ms;
+    if (session->has_anomalies) {
+        bool season_changed = params.season_ms != session->anomalies.params.season_ms;
+        session->anomalies.params = params;
+        if (season_changed) {
+            monitor_anomaly_reset(&session->anomalies);
+        }
+        return MONITOR_STATUS_OK;
+    }
+
+    MonitorStatus status = monitor_anomaly_init(&session->anomalies, MONITOR_METRIC_COUNT, &params);
+    session->has_anomalies = status == MONITOR_STATUS_OK;
+    return status;
+}
+
+static double kb_to_gb(unsigned long long kb) {
+    return (double)kb / (1024.0 * 1024.0);
+}
+
+static double kb_to_mb(unsigned long long kb) {
+    return (double)kb / 1024.0;
+}
+
+/* Busiest threads of the watched pids over the last tick, as a share of one CPU. */
+static void print_top_threads(const MonitorSession* session) {
+    const ThreadTracker* threads = &session->threads;
+
+    if (!session->has_threads || threads->top_count == 0) {
+        return;
+    }
+
+    printf("Top threads (%zu tracked):\n", threads->threads);
+    for (size_t i = 0; i < threads->top_count; i++) {
+        const ThreadUsage* usage = &threads->top[i];
+        printf("  %7d/%-7d %-16s %6.2f%%\n", usage->pid, usage->tid, usage->comm, usage->cpu_percent);
+    }
+}
+
+static void describe_probe(const MonitorProbeResult* result, char* buffer, size_t buffer_size) {
+    if (result->timed_out) {
+        snprintf(buffer, buffer_size, "timeout");
+    } else if (result->signal != 0) {
+        snprintf(buffer, buffer_size, "signal %d", result->signal);
+    } else if (result->exit_code != 0) {
+        snprintf(buffer, buffer_size, "exit %d", result->exit_code);
+    } else {
+        snprintf(buffer, buffer_size, "ok");
+    }
+}
+
+/* One line per probe: outcome, run time and the first line of what it printed. */
+static void print_probes(const MonitorSession* session) {
+    char outcome[32];
+
+    if (!session->has_probes) {
+        return;
+    }
+
+    printf("Probes:\n");
+    for (size_t i = 0; i < session->probe_count; i++) {
+        const MonitorProbeResult* result = &session->probe_results[i];
+        const char* output = result->stdout_length > 0 ? result->stdout_text : result->stderr_text;
+        size_t line_length = strcspn(output, "\n");
+        if (line_length > PROBE_OUTPUT_COLUMNS) {
+            line_length = PROBE_OUTPUT_COLUMNS;
+        }
+        describe_probe(result, outcome, sizeof(outcome));
+        printf("  %-10s %-32.32s %8.1f ms%s  %.*s\n",
+               outcome,
+               session->probe_labels[i],
+               (double)result->duration_ns / 1e6,
+               result->shared ? " (shared)" : "",
+               (int)line_length,
+               output);
+    }
+}
+
+/*
+ * Runs the probes side by side on the engine's workers, so a tick waits for
+ * the slowest one rather than their sum and identical commands share a run.
+ * Failures are logged when a probe starts or stops failing.
+ */
+static void run_probes(MonitorSession* session) {
+    MonitorStatus statuses[MONITOR_MAX_PROBES];
+
+    monitor_probe_run_batch(&session->probes,
+                            session->probe_ids,
+                            session->probe_count,
+                            session->probe_timeout_ms,
+                            session->probe_cache_ms,
+                            session->probe_results,
+                            statuses);
+
+    for (size_t i = 0; i < session->probe_count; i++) {
+        const MonitorProbeResult* result = &session->probe_results[i];
+        bool failing = statuses[i] != MONITOR_STATUS_OK || !monitor_probe_succeeded(result);
+        if (failing && !session->probe_failing[i]) {
+            log_detail(MONITOR_LOG_WARNING, "Probe failing: {}", session->probe_labels[i]);
+        } else if (!failing && session->probe_failing[i]) {
+            log_detail(MONITOR_LOG_INFO, "Probe recovered: {}", session->probe_labels[i]);
+        }
+        session->probe_failing[i] = failing;
+    }
+}
+
+static void log_health_status(const char* server,
+                              double cpu_usage,
+                              const MemoryUsage* memory,
+                              const MemoryBreakdown* breakdown,
+                              const MonitorSession* session,
+                              const AlertEvent* events,
+                              size_t event_count) {
+    printf("Server Health Report for: %s\n", server);
+    printf("CPU Usage: %.2f%%\n", cpu_usage);
+    printf("RAM Usage: %.2f%% (%.2f GB / %.2f GB)\n", memory->usage_percent, memory->used_gb, memory->total_gb);
+    printf("Swap: %.2f GB / %.2f GB | Dirty: %.1f MB | Writeback: %.1f MB\n",
+           kb_to_gb(breakdown->swap_total_kb - breakdown->swap_free_kb),
+           kb_to_gb(breakdown->swap_total_kb),
+           kb_to_mb(breakdown->dirty_kb),
+           kb_to_mb(breakdown->writeback_kb));
+    printf("Slab: %.1f MB | Shmem: %.1f MB | HugePages: %llu/%llu free | Committed: %.2f GB / %.2f GB\n",
+           kb_to_mb(breakdown->slab_kb),
+           kb_to_mb(breakdown->shmem_kb),
+           breakdown->huge_pages_free,
+           breakdown->huge_pages_total,
+           kb_to_gb(breakdown->committed_as_kb),
+           kb_to_gb(breakdown->commit_limit_kb));
+
+    print_top_threads(session);
+    print_probes(session);
+    log_alert_events(session, events, event_count);
+    print_anomalies(session);
+
+    printf("----------------------------------\n");
+}
+
+static void health_stats_reset(HealthStats* stats) {
+    for (size_t i = 0; i < MONITOR_METRIC_COUNT; i++) {
+        monitor_sketch_init(&stats->sketches[i]);
+        monitor_rollup_init(&stats->rollups[i]);
+    }
+}
+
+static void health_stats_record(HealthStats* stats, long long timestamp_ms, const double* values) {
+    for (size_t i = 0; i < MONITOR_METRIC_COUNT; i++) {
+        monitor_sketch_add(&stats->sketches[i], values[i]);
+        monitor_rollup_add(&stats->rollups[i], timestamp_ms, values[i]);
+    }
+}
+
+/* Averages and peaks over trailing windows, like load averages, answered from the rollup tiers. */
+static void print_window_report(FILE* stream, const HealthStats* stats) {
+    const struct {
+        const char* label;
+        int64_t width_ms;
+    } windows[] = {{"1m", 60000}, {"15m", 900000}, {"1h", 3600000}};
+    const int64_t now = stats->rollups[0].last_ms + 1;
+
+    fprintf(stream, "  %-16s", "Window avg/max");
+    for (size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++) {
+        fprintf(stream, " %17s", windows[w].label);
+    }
+    fprintf(stream, "\n");
+    for (size_t i = 0; i < MONITOR_METRIC_COUNT; i++) {
+        fprintf(stream, "  %-16s", monitor_metric_name((MonitorMetric)i));
+        for (size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++) {
+            RollupBucket summary;
+            char cell[32] = "-";
+            if (monitor_rollup_summarize(&stats->rollups[i], now - windows[w].width_ms, now, &summary, NULL) ==
+                MONITOR_STATUS_OK) {
+                snprintf(cell, sizeof(cell), "%.2f/%.2f", summary.sum / (double)summary.count, summary.max);
+            }
+            fprintf(stream, " %17s", cell);
+        }
+        fprintf(stream, "\n");
+    }
+}
+
+static void print_percentile_report(FILE* stream, const char* server, const HealthStats* stats) {
+    const double quantiles[] = {0.50, 0.90, 0.99, 1.0};
+    const QuantileSketch* first = &stats->sketches[0];
+
+    if (first->count == 0) {
+        fprintf(stream, "No samples recorded yet for server: %s\n", server);
+        return;
+    }
+
+    fprintf(stream, "Percentile Report for: %s (%llu samples)\n", server, (unsigned long long)first->count);
+    fprintf(stream, "  %-16s %9s %9s %9s %9s\n", "Metric", "p50", "p90", "p99", "max");
+    for (size_t i = 0; i < MONITOR_METRIC_COUNT; i++) {
+        double values[4] = {0.0};
+        for (size_t q = 0; q < 4; q++) {
+            monitor_sketch_quantile(&stats->sketches[i], quantiles[q], &values[q]);
+        }
+        fprintf(stream,
+                "  %-16s %9.2f %9.2f %9.2f %9.2f\n",
+                monitor_metric_name((MonitorMetric)i),
+                values[0],
+                values[1],
+                values[2],
+                values[3]);
+    }
+    print_window_report(stream, stats);
+    fflush(stream);
+}
+
+/* Times the syscalls a tick is built from, which bound how fast this host lets the monitor sample. */
+static void print_syscall_costs(FILE* stream, int calls) {
+    SyscallBenchResult results[SYSCALL_BENCH_MAX_RESULTS];
+
+    if (calls <= 0) {
+        return;
+    }
+    register_default_syscall_benches();
+    size_t count = run_syscall_benches((size_t)calls, results, SYSCALL_BENCH_MAX_RESULTS);
+    print_syscall_bench_results(stream, results, count);
+}
+
+static void print_collector_errors(const MonitorSession* session) {
+    if (session->dropped_records > 0) {
+        fprintf(session->report_stream, "Output records dropped: %llu\n", session->dropped_records);
+    }
+    if (session->skipped_ticks == 0 && session->collector_errors[COLLECTOR_CGROUP] == 0) {
+        return;
+    }
+    fprintf(session->report_stream, "Collector errors (%llu ticks skipped):", session->skipped_ticks);
+    for (size_t i = 0; i < COLLECTOR_COUNT; i++) {
+        fprintf(session->report_stream,
+                "%s %s %llu",
+                i == 0 ? "" : ",",
+                collector_name((Collector)i),
+                session->collector_errors[i]);
+    }
+    fprintf(session->report_stream, "\n");
+}
+
+/* Totals since the session began, including engines replaced by a reload. */
+static void probe_counter_totals(const MonitorSession* session, MonitorProbeCounters* counters) {
+    MonitorProbeCounters current;
+
+    *counters = session->probe_totals;
+    if (session->has_probes) {
+        monitor_probe_counters(&session->probes, &current);
+        monitor_probe_counters_add(counters, &current);
+    }
+}
+
+static void print_probe_counters(const MonitorSession* session) {
+    MonitorProbeCounters counters;
+
+    probe_counter_totals(session, &counters);
+    if (counters.cache_misses + counters.cache_hits + counters.coalesced == 0) {
+        return;
+    }
+    fprintf(session->report_stream,
+            "Probes: %llu launched, %llu timed out, %llu failed to start; "
+            "cache %llu hits, %llu misses, %llu coalesced\n",
+            counters.launches,
+            counters.timeouts,
+            counters.spawn_failures,
+            counters.cache_hits,
+            counters.cache_misses,
+            counters.coalesced);
+}
+
+static void service_report_request(const MonitorSession* session, const char* server) {
+    if (report_requested) {
+        report_requested = 0;
+        print_percentile_report(session->report_stream, server, session->stats);
+        print_collector_errors(session);
+        if (session->self_stats) {
+            monitor_profile_print(session->report_stream);
+            print_probe_counters(session);
+        }
+        print_syscall_costs(session->report_stream, session->syscall_bench);
+    }
+}
+
+/* Sparklines of the recent samples; memory in GB is drawn against the host or cgroup total. */
+static void print_trend_panel(MonitorSession* session, const MemoryUsage* memory) {
+    char* panel = monitor_arena_alloc(&session->scratch, TREND_PANEL_BYTES, 1);
+    SparklineRow rows[MONITOR_METRIC_COUNT];
+
+    if (!panel) {
+        return;
+    }
+
+    for (size_t i = 0; i < MONITOR_METRIC_COUNT; i++) {
+        rows[i].label = monitor_metric_name((MonitorMetric)i);
+        rows[i].history = &session->history[i];
+        rows[i].low = 0.0;
+        rows[i].high = 100.0;
+    }
+    rows[MONITOR_METRIC_RAM_USED_GB].high = memory->total_gb;
+
+    size_t length =
+        monitor_sparkline_panel(rows, MONITOR_METRIC_COUNT, terminal_columns(), session->sparkline_style, panel, TREND_PANEL_BYTES);
+    if (length > 0) {
+        printf("\n%s", panel);
+    }
+}
+
+static void render_live_dashboard(const MonitorConfig* config,
+                                  MonitorSession* session,
+                                  double cpu_usage,
+                                  const MemoryUsage* memory,
+                                  long long elapsed_ms,
+                                  long long remaining_ms,
+                                  int sample_index,
+                                  int total_samples) {
+    const char* server = config->server_name;
+    const bool ansi = session->ansi;
+    const char spinner_chars[] = {'|', '/', '-', '\\'};
+    char cpu_bar[64] = {0};
+    char mem_bar[64] = {0};
+    const char* cpu_label = usage_label(session, MONITOR_METRIC_CPU_PERCENT);
+    const char* mem_label = usage_label(session, MONITOR_METRIC_RAM_PERCENT);
+    const char* cpu_color = status_color(ansi, cpu_label);
+    const char* mem_color = status_color(ansi, mem_label);
+    const char* header_color = ansi_color(ansi, "\x1b[36m");
+    const char* bold = ansi_color(ansi, "\x1b[1m");
+
+    build_usage_bar(cpu_bar, sizeof(cpu_bar), cpu_usage, 28);
+    build_usage_bar(mem_bar, sizeof(mem_bar), memory->usage_percent, 28);
+
+    clear_screen(ansi);
+
+    printf("%s%sServer Health Monitor%s\n", bold, header_color, ansi_reset(ansi));
+    printf("Server: %s\n", server);
+    if (total_samples > 0) {
+        printf("Sample: %d / %d\n", sample_index, total_samples);
+    } else {
+        printf("Elapsed: %.2fs\n", (double)elapsed_ms / 1000.0);
+    }
+    printf("\n");
+
+    printf("CPU Usage: %s%6.2f%%%s [%s] %s%s%s\n",
+           cpu_color,
+           cpu_usage,
+           ansi_reset(ansi),
+           cpu_bar,
+           cpu_color,
+           cpu_label,
+           ansi_reset(ansi));
+    printf("RAM Usage: %s%6.2f%%%s (%.2f GB / %.2f GB) [%s] %s%s%s\n",
+           mem_color,
+           memory->usage_percent,
+           ansi_reset(ansi),
+           memory->used_gb,
+           memory->total_gb,
+           mem_bar,
+           mem_color,
+           mem_label,
+           ansi_reset(ansi));
+
+    print_trend_panel(session, memory);
+    if (session->has_threads && session->threads.top_count > 0) {
+        printf("\n");
+        print_top_threads(session);
+    }
+    if (session->has_probes) {
+        printf("\n");
+        print_probes(session);
+    }
+
+    printf("\n");
+    print_active_alerts(session);
+    print_anomalies(session);
+
+    if (remaining_ms >= 0) {
+        printf("\nNext sample in: %.2fs  %c\n",
+               (double)remaining_ms / 1000.0,
+               spinner_chars[sample_index % 4]);
+    }
+    printf("%sSampling every %d ms. Press Ctrl+C to stop early.%s\n",
+           ansi_color(ansi, "\x1b[2m"),
+           config->interval_ms,
+           ansi_reset(ansi));
+    fflush(stdout);
+}
+
+static void publish_shm_sample(const MonitorConfig* config,
+                               MonitorSession* session,
+                               double cpu_usage,
+                               const MemoryUsage* memory,
+                               const MemoryBreakdown* breakdown) {
+    MonitorShmSample sample;
+    uint32_t active_alerts = 0;
+
+    for (size_t i = 0; i < session->alerts.count; i++) {
+        active_alerts += monitor_alert_engine_level(&session->alerts, i) != ALERT_LEVEL_OK;
+    }
+
+    memset(&sample, 0, sizeof(sample));
+    sample.timestamp_ms = wall_clock_ms();
+    snprintf(sample.server, sizeof(sample.server), "%s", config->server_name);
+    sample.cpu_percent = cpu_usage;
+    sample.ram_percent = memory->usage_percent;
+    sample.ram_used_gb = memory->used_gb;
+    sample.ram_total_gb = memory->total_gb;
+    sample.cpu_alert_level = (uint32_t)usage_level(session, MONITOR_METRIC_CPU_PERCENT);
+    sample.ram_alert_level = (uint32_t)usage_level(session, MONITOR_METRIC_RAM_PERCENT);
+    sample.active_alerts = active_alerts;
+    sample.swap_total_kb = breakdown->swap_total_kb;
+    sample.swap_free_kb = breakdown->swap_free_kb;
+    sample.dirty_kb = breakdown->dirty_kb;
+    sample.writeback_kb = breakdown->writeback_kb;
+
+    const CgroupStats* cgroup = &session->cgroup_stats;
+    if (session->has_cgroup_stats && cgroup->has_memory) {
+        sample.flags |= MONITOR_SHM_FLAG_CGROUP_MEMORY;
+        sample.cgroup_memory_current = cgroup->memory_current;
+        sample.cgroup_memory_max = cgroup->memory_limited ? cgroup->memory_max : 0;
+    }
+    if (session->has_cgroup_stats && cgroup->has_cpu) {
+        sample.flags |= MONITOR_SHM_FLAG_CGROUP_CPU;
+        sample.cgroup_cpu_usage_usec = cgroup->cpu_usage_usec;
+        sample.cgroup_cpu_throttled_usec = cgroup->cpu_throttled_usec;
+    }
+    if (session->self_stats) {
+        sample.flags |= MONITOR_SHM_FLAG_SELF_STATS;
+        sample.self_collect_us = (double)monitor_profile_last_ns(MONITOR_PROFILE_COLLECT) / 1000.0;
+        sample.self_tick_us = (double)monitor_profile_last_ns(MONITOR_PROFILE_TICK) / 1000.0;
+    }
+
+    monitor_shm_publish(&session->shm, &sample);
+}
+
+/* A record that cannot be written is dropped; the run, and a daemon, keep going. */
+MONITOR_COLD static void output_failed(MonitorSession* session, MonitorStatus status) {
+    session->dropped_records++;
+    if (!session->output_failing) {
+        session->output_failing = true;
+        log_detail(MONITOR_LOG_WARNING, "Dropping output records: {}", monitor_status_message(status));
+    }
+}
+
+/* One failed collection skips its tick; only a run of them ends monitoring. */
+MONITOR_COLD static MonitorStatus skip_failed_tick(MonitorSession* session, MonitorStatus status) {
+    session->skipped_ticks++;
+    if (++session->failed_ticks_in_row < MAX_FAILED_TICKS_IN_ROW) {
+        return MONITOR_STATUS_OK;
+    }
+    log_value(MONITOR_LOG_ERROR, "Giving up after {} failed ticks in a row.", session->failed_ticks_in_row);
+    return status;
+}
+
+static MonitorStatus sample_tick(const MonitorConfig* config,
+                                 MonitorSession* session,
+                                 long long elapsed_ms,
+                                 long long remaining_ms,
+                                 int sample_index,
+                                 int total_samples) {
+    double cpu_usage = 0.0;
+    MemoryUsage memory = {0};
+    MemoryBreakdown breakdown;
+    double values[MONITOR_METRIC_COUNT] = {0.0};
+    AlertEvent events[MAX_ALERT_EVENTS_PER_TICK];
+    MonitorStatus status = collect_health_snapshot(session, &cpu_usage, &memory, &breakdown);
+    if (status != MONITOR_STATUS_OK) {
+        return skip_failed_tick(session, status);
+    }
+    if (session->failed_ticks_in_row > 0) {
+        log_value(MONITOR_LOG_INFO, "Sampling resumed after {} skipped ticks.", session->failed_ticks_in_row);
+        session->failed_ticks_in_row = 0;
+    }
+
+    if (session->has_threads) {
+        MONITOR_PROFILE_BEGIN(threads);
+        monitor_threads_sample(&session->threads);
+        MONITOR_PROFILE_END(threads, MONITOR_PROFILE_READ_THREADS);
+    }
+    if (session->has_probes) {
+        MONITOR_PROFILE_BEGIN(probes);
+        run_probes(session);
+        MONITOR_PROFILE_END(probes, MONITOR_PROFILE_PROBES);
+    }
+
+    values[MONITOR_METRIC_CPU_PERCENT] = cpu_usage;
+    values[MONITOR_METRIC_RAM_PERCENT] = memory.usage_percent;
+    values[MONITOR_METRIC_RAM_USED_GB] = memory.used_gb;
+    long long timestamp_ms = now_ms();
+    health_stats_record(session->stats, timestamp_ms, values);
+    if (session->live_output) {
+        for (size_t i = 0; i < MONITOR_METRIC_COUNT; i++) {
+            monitor_history_push(&session->history[i], values[i]);
+        }
+    }
+
+    MONITOR_PROFILE_BEGIN(alerts);
+    size_t event_count = monitor_alert_engine_evaluate(&session->alerts,
+                                                       values,
+                                                       MONITOR_METRIC_COUNT,
+                                                       timestamp_ms,
+                                                       events,
+                                                       MAX_ALERT_EVENTS_PER_TICK);
+    if (session->has_anomalies) {
+        /* Seasonal slots follow the wall clock (UTC), not the time since boot. */
+        session->anomaly_count = monitor_anomaly_update(&session->anomalies,
+                                                        values,
+                                                        MONITOR_METRIC_COUNT,
+                                                        wall_clock_ms(),
+                                                        session->anomaly_events,
+                                                        MONITOR_METRIC_COUNT);
+    }
+    MONITOR_PROFILE_END(alerts, MONITOR_PROFILE_ALERTS);
+    if (session->writer || session->live_output) {
+        log_alert_transitions(session, events, event_count);
+    }
+
+    if (session->has_shm) {
+        MONITOR_PROFILE_BEGIN(publish);
+        publish_shm_sample(config, session, cpu_usage, &memory, &breakdown);
+        MONITOR_PROFILE_END(publish, MONITOR_PROFILE_OUTPUT);
+    }
+
+    if (session->writer) {
+        MonitorProbeCounters probe_counters = {0};
+        if (session->record_probe_cache) {
+            probe_counter_totals(session, &probe_counters);
+        }
+        HealthRecord record = {
+            .timestamp_ms = wall_clock_ms(),
+            .server = config->server_name,
+            .cpu_percent = cpu_usage,
+            .ram_percent = memory.usage_percent,
+            .ram_used_gb = memory.used_gb,
+            .ram_total_gb = memory.total_gb,
+            .cpu_alert = usage_label(session, MONITOR_METRIC_CPU_PERCENT),
+            .ram_alert = usage_label(session, MONITOR_METRIC_RAM_PERCENT),
+            .has_self_stats = config->self_stats,
+            .self_collect_us = (double)monitor_profile_last_ns(MONITOR_PROFILE_COLLECT) / 1000.0,
+            .self_tick_us = (double)monitor_profile_last_ns(MONITOR_PROFILE_TICK) / 1000.0,
+            .anomalies = session->anomaly_events,
+            .anomaly_count = session->anomaly_count,
+            .has_probe_cache = session->record_probe_cache,
+            .probe_cache_hits = probe_counters.cache_hits,
+            .probe_cache_misses = probe_counters.cache_misses,
+            .probe_coalesced = probe_counters.coalesced
+        };
+        MONITOR_PROFILE_BEGIN(output);
+        status = monitor_output_write(session->writer, &record);
+        MONITOR_PROFILE_END(output, MONITOR_PROFILE_OUTPUT);
+        if (status != MONITOR_STATUS_OK) {
+            output_failed(session, status);
+        } else if (session->output_failing) {
+            session->output_failing = false;
+            log_info("Output recovered.");
+        }
+        service_report_request(session, config->server_name);
+        return MONITOR_STATUS_OK;
+    }
+
+    monitor_log_flush();
+    MONITOR_PROFILE_BEGIN(render);
+    if (session->live_output) {
+        render_live_dashboard(config,
+                              session,
+                              cpu_usage,
+                              &memory,
+                              elapsed_ms,
+                              remaining_ms,
+                              sample_index,
+                              total_samples);
+    } else {
+        log_health_status(config->server_name,
+                          cpu_usage,
+                          &memory,
+                          &breakdown,
+                          session,
+                          events,
+                          event_count);
+    }
+    MONITOR_PROFILE_END(render, MONITOR_PROFILE_RENDER);
+
+    service_report_request(session, config->server_name);
+    return MONITOR_STATUS_OK;
+}
+
+static MonitorStatus sample_once(const MonitorConfig* config,
+                                 MonitorSession* session,
+                                 long long elapsed_ms,
+                                 long long remaining_ms,
+                                 int sample_index,
+                                 int total_samples) {
+    MONITOR_PROFILE_BEGIN(tick);
+    /* A skipped tick's context must not describe a later, unrelated failure. */
+    monitor_error_clear();
+    MonitorStatus status = sample_tick(config, session, elapsed_ms, remaining_ms, sample_index, total_samples);
+    if (status == MONITOR_STATUS_OK) {
+        monitor_error_clear();
+    }
+    monitor_arena_reset(&session->scratch);
+    MONITOR_PROFILE_END(tick, MONITOR_PROFILE_TICK);
+    return status;
+}
+
+static MonitorStatus run_monitor_loop(const MonitorConfig* config, MonitorSession* session) {
+    MonitorStatus status = MONITOR_STATUS_OK;
+
+    if (config->iterations > 0) {
+        for (int i = 0; i < config->iterations; i++) {
+            long long remaining_ms = (i + 1 < config->iterations) ? config->interval_ms : -1;
+            status = sample_once(config, session, 0, remaining_ms, i + 1, config->iterations);
+            if (status != MONITOR_STATUS_OK) {
+                return status;
+            }
+            if (i + 1 < config->iterations) {
+                sleep_ms(config->interval_ms);
+            }
+        }
+    } else {
+        long long start_ms = now_ms();
+        if (start_ms < 0) {
+            return MONITOR_STATUS_INTERNAL_ERROR;
+        }
+
+        while (true) {
+            long long elapsed = now_ms() - start_ms;
+            if (elapsed >= config->duration_ms) {
+                break;
+            }
+
+            status = sample_once(config,
+                                 session,
+                                 elapsed,
+                                 config->duration_ms - elapsed,
+                                 (int)(elapsed / config->interval_ms) + 1,
+                                 0);
+            if (status != MONITOR_STATUS_OK) {
+                return status;
+            }
+
+            long long after_sample_ms = now_ms();
+            if (after_sample_ms < 0) {
+                return MONITOR_STATUS_INTERNAL_ERROR;
+            }
+            long long remaining_ms = config->duration_ms - (after_sample_ms - start_ms);
+            if (remaining_ms <= 0) {
+                break;
+            }
+            int sleep_duration = config->interval_ms;
+            if (remaining_ms < sleep_duration) {
+                sleep_duration = (int)remaining_ms;
+            }
+            sleep_ms(sleep_duration);
+            service_report_request(session, config->server_name);
+        }
+    }
+
+    return MONITOR_STATUS_OK;
+}
+
+static MonitorStatus session_open_shm(MonitorSession* session, const MonitorConfig* config) {
+    session->has_shm = false;
+    session->shm.layout = NULL;
+    if (config->shm_name[0] == '\0') {
+        return MONITOR_STATUS_OK;
+    }
+
+    MonitorStatus status = monitor_shm_writer_open(&session->shm, config->shm_name);
+    if (status != MONITOR_STATUS_OK) {
+        log_detail(MONITOR_LOG_ERROR, "Cannot create shared-memory segment {}", config->shm_name);
+        return status;
+    }
+    session->has_shm = true;
+    log_detail(MONITOR_LOG_INFO, "Publishing samples to shared memory {}", config->shm_name);
+    return MONITOR_STATUS_OK;
+}
+
+static MonitorStatus session_begin(MonitorSession* session,
+                                   const MonitorConfig* config,
+                                   const MonitorConfigSnapshot* snapshot,
+                                   HealthStats* stats,
+                                   OutputWriter* writer,
+                                   bool live_output) {
+    static char output_storage[OUTPUT_BUFFER_BYTES];
+    static unsigned char scratch_storage[SCRATCH_ARENA_BYTES];
+    MonitorStatus status = MONITOR_STATUS_OK;
+
+    memset(session, 0, sizeof(*session));
+    monitor_arena_init_buffer(&session->scratch, scratch_storage, sizeof(scratch_storage));
+    session->stats = stats;
+    session->live_output = live_output;
+    session->ansi = live_output && supports_ansi_output();
+    session->sparkline_style = session->ansi && locale_is_utf8() ? MONITOR_SPARKLINE_UTF8 : MONITOR_SPARKLINE_ASCII;
+    session->report_stream = stdout;
+    session->self_stats = config->self_stats;
+    session->syscall_bench = config->syscall_bench;
+
+    if (!live_output && config->output_format != MONITOR_OUTPUT_TEXT) {
+        status = monitor_output_init(writer,
+                                     output_storage,
+                                     sizeof(output_storage),
+                                     STDOUT_FILENO,
+                                     config->output_format,
+                                     (size_t)config->output_batch);
+        if (status != MONITOR_STATUS_OK) {
+            return status;
+        }
+        session->writer = writer;
+        session->record_probe_cache = config->probe_count > 0;
+        session->report_stream = stderr;
+        fflush(stdout);
+    }
+
+    status = session_init_alerts(session, config, snapshot);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+    status = session_configure_anomalies(session, config);
+    if (status != MONITOR_STATUS_OK) {
+        monitor_alert_engine_free(&session->alerts);
+        return status;
+    }
+    session_open_collectors(session, config);
+    status = session_open_shm(session, config);
+    if (status != MONITOR_STATUS_OK) {
+        monitor_alert_engine_free(&session->alerts);
+        monitor_anomaly_free(&session->anomalies);
+        session_close_collectors(session);
+        return status;
+    }
+
+    health_stats_reset(stats);
+    print_syscall_costs(session->report_stream, session->syscall_bench);
+    monitor_profile_reset();
+    return MONITOR_STATUS_OK;
+}
+
+static MonitorStatus session_finish(MonitorSession* session, MonitorStatus status) {
+    monitor_alert_engine_free(&session->alerts);
+    monitor_anomaly_free(&session->anomalies);
+    session_close_collectors(session);
+    monitor_shm_writer_close(&session->shm);
+    if (session->writer) {
+        MonitorStatus flush_status = monitor_output_flush(session->writer);
+        if (status == MONITOR_STATUS_OK) {
+            status = flush_status;
+        }
+    }
+    return status;
+}
+
+static void session_print_summary(const MonitorSession* session, const char* server) {
+    fprintf(session->report_stream, "Health monitoring completed for server: %s\n", server);
+    print_percentile_report(session->report_stream, server, session->stats);
+    print_collector_errors(session);
+    if (session->self_stats) {
+        monitor_profile_print(session->report_stream);
+        fprintf(session->report_stream,
+                "Tick scratch: peak %zu of %zu bytes, %llu allocations did not fit\n",
+                session->scratch.high_water,
+                session->scratch.capacity,
+                session->scratch.failures);
+        print_probe_counters(session);
+    }
+}
+
+static MonitorStatus monitor_server_health(const MonitorConfig* config,
+                                           const MonitorConfigSnapshot* snapshot,
+                                           HealthStats* stats,
+                                           bool live_output) {
+    OutputWriter writer;
+    MonitorSession session;
+
+    if (!config || !stats) {
+        return MONITOR_STATUS_INVALID_ARGUMENT;
+    }
+
+    MonitorStatus status = session_begin(&session, config, snapshot, stats, &writer, live_output);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+
+    status = session_finish(&session, run_monitor_loop(config, &session));
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+
+    if (live_output) {
+        clear_screen(session.ansi);
+    }
+    session_print_summary(&session, config->server_name);
+    return MONITOR_STATUS_OK;
+}
+
+/*
+ * Rules that survive a reload keep their level and timers: built-in rules by
+ * position, file rules by name, both only while they watch the same metric.
+ */
+static void carry_alert_states(MonitorSession* session,
+                               const AlertEngine* previous,
+                               const MonitorConfigSnapshot* previous_snapshot,
+                               size_t previous_rule_base) {
+    session->alerts.suppressed_notifications = previous->suppressed_notifications;
+    session->alerts.dropped_events = previous->dropped_events;
+    for (size_t i = 0; i < session->file_rule_base && i < previous_rule_base; i++) {
+        monitor_alert_engine_carry_state(&session->alerts, i, previous, i);
+    }
+    if (!session->snapshot || !previous_snapshot) {
+        return;
+    }
+    for (size_t i = 0; i < session->snapshot->rule_count; i++) {
+        for (size_t j = 0; j < previous_snapshot->rule_count; j++) {
+            if (strcmp(session->snapshot->rule_names[i], previous_snapshot->rule_names[j]) == 0) {
+                monitor_alert_engine_carry_state(&session->alerts,
+                                                 session->file_rule_base + i,
+                                                 previous,
+                                                 previous_rule_base + j);
+                break;
+            }
+        }
+    }
+}
+
+static MonitorStatus daemon_apply_reload(MonitorSession* session,
+                                         MonitorConfigStore* store,
+                                         MonitorEventLoop* loop,
+                                         int argc,
+                                         char** argv) {
+    const MonitorConfigSnapshot* current = monitor_config_store_acquire(store);
+    MonitorConfigSnapshot* next = NULL;
+    char error[128] = {0};
+
+    MonitorStatus status = monitor_config_load(argc, argv, &next, error, sizeof(error));
+    if (status != MONITOR_STATUS_OK) {
+        log_detail(MONITOR_LOG_ERROR, "Reload rejected, keeping the running configuration: {}", error);
+        return status;
+    }
+
+    /* next is private until published, so it can still be adjusted here. */
+    if (next->config.output_format != current->config.output_format ||
+        next->config.output_batch != current->config.output_batch) {
+        log_warning("Output format and batch size cannot change on reload; keeping the running values.");
+        next->config.output_format = current->config.output_format;
+        next->config.output_batch = current->config.output_batch;
+    }
+    /* The self-stats columns are part of the record schema, fixed by the header already written. */
+    if (session->writer && next->config.self_stats != current->config.self_stats) {
+        log_warning("Self stats cannot change on reload while writing JSON or CSV; keeping the running value.");
+        next->config.self_stats = current->config.self_stats;
+    }
+
+    /* The CPU baseline and the percentile history live in the session and survive. */
+    AlertEngine previous_alerts = session->alerts;
+    size_t previous_rule_base = session->file_rule_base;
+    status = session_init_alerts(session, &next->config, next);
+    if (status == MONITOR_STATUS_OK) {
+        carry_alert_states(session, &previous_alerts, current, previous_rule_base);
+        status = monitor_config_store_publish(store, next);
+    }
+    if (status != MONITOR_STATUS_OK) {
+        monitor_alert_engine_free(&session->alerts);
+        session_init_alerts(session, &current->config, current);
+        carry_alert_states(session, &previous_alerts, current, previous_rule_base);
+        monitor_alert_engine_free(&previous_alerts);
+        monitor_config_snapshot_free(next);
+        return status;
+    }
+    monitor_alert_engine_free(&previous_alerts);
+
+    session->self_stats = next->config.self_stats;
+    session->syscall_bench = next->config.syscall_bench;
+    if (session_configure_anomalies(session, &next->config) != MONITOR_STATUS_OK) {
+        log_warning("Anomaly detection stays off until the next reload.");
+    }
+    session_reload_collectors(session, &current->config, &next->config);
+    if (strcmp(next->config.shm_name, current->config.shm_name) != 0 ||
+        (!session->has_shm && next->config.shm_name[0] != '\0')) {
+        monitor_shm_writer_close(&session->shm);
+        if (session_open_shm(session, &next->config) != MONITOR_STATUS_OK) {
+            log_warning("Shared-memory publishing stays off until the next reload.");
+        }
+    }
+    monitor_log_set_format(next->config.log_format);
+
+    if (next->config.interval_ms != current->config.interval_ms) {
+        status = monitor_event_loop_arm(loop, next->config.interval_ms);
+    }
+    return status;
+}
+
+static MonitorStatus run_daemon_loop(MonitorConfigStore* store,
+                                     MonitorSession* session,
+                                     MonitorEventLoop* loop,
+                                     int argc,
+                                     char** argv,
+                                     uint64_t started_ns) {
+    MonitorStatus status = monitor_event_loop_arm(loop, monitor_config_store_acquire(store)->config.interval_ms);
+    if (status != MONITOR_STATUS_OK) {
+        return status;
+    }
+
+    long long start_ms = now_ms();
+    log_value(MONITOR_LOG_INFO,
+              "Daemon ready in {} us; SIGHUP reloads, SIGTERM stops.",
+              (long long)((monitor_profile_now_ns() - started_ns) / 1000));
+
+    while (true) {
+        MonitorEventType event = MONITOR_EVENT_TICK;
+
+        /* Between events only session->snapshot (always the current one) is held. */
+        monitor_config_store_quiescent(store);
+        status = monitor_event_loop_wait(loop, &event);
+        if (status != MONITOR_STATUS_OK) {
+            return status;
+        }
+
+        const MonitorConfig* config = &monitor_config_store_acquire(store)->config;
+        switch (event) {
+            case MONITOR_EVENT_TICK:
+                status = sample_once(config, session, now_ms() - start_ms, -1, (int)loop->ticks, 0);
+                if (status != MONITOR_STATUS_OK) {
+                    return status;
+                }
+                break;
+            case MONITOR_EVENT_RELOAD: {
+                uint64_t reload_start = monitor_profile_now_ns();
+                if (daemon_apply_reload(session, store, loop, argc, argv) == MONITOR_STATUS_OK) {
+                    log_value(MONITOR_LOG_INFO,
+                              "Configuration reloaded in {} us.",
+                              (long long)((monitor_profile_now_ns() - reload_start) / 1000));
+                }
+                break;
+            }
+            case MONITOR_EVENT_REPORT:
+                monitor_log_flush();
+                print_percentile_report(session->report_stream, config->server_name, session->stats);
+                print_collector_errors(session);
+                if (session->self_stats) {
+                    monitor_profile_print(session->report_stream);
+                    print_probe_counters(session);
+                }
+                print_syscall_costs(session->report_stream, session->syscall_bench);
+                break;
+            case MONITOR_EVENT_STOP:
+                log_info("Stopping daemon.");
+                monitor_log_flush();
+                return MONITOR_STATUS_OK;
+        }
+    }
+}
+
+static int run_daemon(MonitorConfigStore* store,
+                      HealthStats* stats,
+                      MonitorEventLoop* loop,
+                      int argc,
+                      char** argv,
+                      uint64_t started_ns) {
+    const MonitorConfigSnapshot* snapshot = monitor_config_store_acquire(store);
+    OutputWriter writer;
+    MonitorSession session;
+
+    log_info("Running in daemon mode.");
+    MonitorStatus status = session_begin(&session, &snapshot->config, snapshot, stats, &writer, false);
+    if (status == MONITOR_STATUS_OK) {
+        status = session_finish(&session, run_daemon_loop(store, &session, loop, argc, argv, started_ns));
+        if (loop->missed_ticks > 0) {
+            log_value(MONITOR_LOG_WARNING,
+                      "{} ticks were skipped because a sample overran the interval.",
+                      (long long)loop->missed_ticks);
+        }
+        if (status == MONITOR_STATUS_OK) {
+            session_print_summary(&session, monitor_config_store_acquire(store)->config.server_name);
+        }
+    }
+
+    if (status != MONITOR_STATUS_OK) {
+        log_detail(MONITOR_LOG_ERROR, "{}", monitor_status_message(status));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+static int run_non_interactive(const MonitorConfigSnapshot* snapshot, HealthStats* stats) {
+    log_info("Running in non-interactive mode.");
+    MonitorStatus status = monitor_server_health(&snapshot->config, snapshot, stats, false);
+    if (status != MONITOR_STATUS_OK) {
+        log_detail(MONITOR_LOG_ERROR, "{}", monitor_status_message(status));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+static int run_interactive(MonitorConfig* config, const MonitorConfigSnapshot* snapshot, HealthStats* stats) {
+    MonitorStatus status = MONITOR_STATUS_OK;
+    bool running = true;
+
+    while (running) {
+        monitor_log_flush();
+        display_menu();
+        int choice = 0;
+        status = get_integer_input("", 1, 6, &choice);
+        if (status != MONITOR_STATUS_OK) {
+            log_error("Failed to read menu input.");
+            return EXIT_FAILURE;
+        }
+
+        switch (choice) {
+            case 1:
+                log_info("Monitoring server health...");
+                monitor_log_flush();
+                status = monitor_server_health(config, snapshot, stats, true);
+                if (status != MONITOR_STATUS_OK) {
+                    log_detail(MONITOR_LOG_ERROR, "{}", monitor_status_message(status));
+                }
+                break;
+            case 2: {
+                int new_interval = 0;
+                status = get_integer_input("Enter new interval (ms): ",
                                            MONITOR_MIN_INTERVAL_MS,
                                            MONITOR_MAX_INTERVAL_MS,
                                            &new_interval);
                 if (status == MONITOR_STATUS_OK) {
-                    if (new_interval > config.duration_ms) {
+                    if (new_interval > config->duration_ms) {
                         log_warning("Interval must be <= duration; keeping previous value.");
                     } else {
-                        config.interval_ms = new_interval;
+                        config->interval_ms = new_interval;
                         log_info("Monitoring interval updated.");
                     }
                 }
@@ -470,19 +1929,22 @@ int main(int argc, char** argv) {
                                            MONITOR_MAX_DURATION_MS,
                                            &new_duration);
                 if (status == MONITOR_STATUS_OK) {
-                    if (new_duration < config.interval_ms) {
+                    if (new_duration < config->interval_ms) {
                         log_warning("Duration must be >= interval; keeping previous value.");
                     } else {
-                        config.duration_ms = new_duration;
+                        config->duration_ms = new_duration;
                         log_info("Monitoring duration updated.");
                     }
                 }
                 break;
             }
             case 4:
-                monitor_config_print(&config);
+                monitor_config_print(config);
                 break;
             case 5:
+                print_percentile_report(stdout, config->server_name, stats);
+                break;
+            case 6:
                 running = false;
                 log_info("Exiting.");
                 break;
@@ -494,3 +1956,100 @@ int main(int argc, char** argv) {
 
     return EXIT_SUCCESS;
 }
+
+int main(int argc, char** argv) {
+    const uint64_t started_ns = monitor_profile_now_ns();
+    MonitorConfig config;
+    ConfigRules rules;
+    MonitorConfigSnapshot* snapshot = NULL;
+    MonitorConfigStore store;
+    static HealthStats stats;
+    MonitorStatus status = MONITOR_STATUS_OK;
+    char error[128] = {0};
+    bool show_help = false;
+    int exit_code = EXIT_SUCCESS;
+
+    monitor_config_init(&config);
+    monitor_config_rules_init(&rules);
+    health_stats_reset(&stats);
+
+    const char* config_path = monitor_config_find_path(argc, argv);
+    if (config_path) {
+        status = monitor_config_apply_file(config_path, &config, &rules, error, sizeof(error));
+        if (status != MONITOR_STATUS_OK) {
+            log_detail(MONITOR_LOG_ERROR, "{}", error);
+            monitor_config_rules_free(&rules);
+            return EXIT_FAILURE;
+        }
+    }
+
+    status = monitor_config_apply_env(&config, error, sizeof(error));
+    if (status != MONITOR_STATUS_OK) {
+        log_detail(MONITOR_LOG_WARNING, "{}", error);
+    }
+
+    status = monitor_config_apply_args(&config, argc, argv, &show_help, error, sizeof(error));
+    if (status != MONITOR_STATUS_OK) {
+        log_detail(MONITOR_LOG_ERROR, "{}", error);
+        print_usage(argv[0]);
+        monitor_config_rules_free(&rules);
+        return EXIT_FAILURE;
+    }
+
+    if (show_help) {
+        print_usage(argv[0]);
+        monitor_config_rules_free(&rules);
+        return EXIT_SUCCESS;
+    }
+
+    /* Validates everything once; the run modes only ever see the compiled snapshot. */
+    status = monitor_config_snapshot_create(&config, &rules, &snapshot, error, sizeof(error));
+    monitor_config_rules_free(&rules);
+    if (status != MONITOR_STATUS_OK) {
+        log_detail(MONITOR_LOG_ERROR, "{}", error);
+        return EXIT_FAILURE;
+    }
+
+    /* Structured output owns stdout; everything meant for humans moves to stderr. */
+    FILE* banner_stream = config.output_format == MONITOR_OUTPUT_TEXT ? stdout : stderr;
+    if (banner_stream == stderr) {
+        monitor_log_set_streams(stderr, stderr);
+    }
+    monitor_log_set_format(config.log_format);
+    fprintf(banner_stream, "Server Health Monitor\n");
+    fprintf(banner_stream, "GitHub: https://github.com/kvnbbg\n");
+    fflush(banner_stream);
+    install_report_handler();
+
+    /* Block the daemon signals before the logger thread starts so it inherits the mask. */
+    MonitorEventLoop loop;
+    if (config.daemon) {
+        status = monitor_event_loop_init(&loop);
+        if (status != MONITOR_STATUS_OK) {
+            log_detail(MONITOR_LOG_ERROR, "{}", monitor_status_message(status));
+            monitor_config_snapshot_free(snapshot);
+            return EXIT_FAILURE;
+        }
+    }
+    monitor_config_store_init(&store);
+    monitor_config_store_publish(&store, snapshot);
+
+    if (monitor_log_start() != MONITOR_STATUS_OK) {
+        log_warning("Background logger unavailable; logging synchronously.");
+    }
+
+    if (config.daemon) {
+        exit_code = run_daemon(&store, &stats, &loop, argc, argv, started_ns);
+    } else if (config.non_interactive) {
+        exit_code = run_non_interactive(snapshot, &stats);
+    } else {
+        exit_code = run_interactive(&config, snapshot, &stats);
+    }
+
+    monitor_log_stop();
+    monitor_config_store_free(&store);
+    if (config.daemon) {
+        monitor_event_loop_close(&loop);
+    }
+    return exit_code;
+}
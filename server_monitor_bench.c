@@ -0,0 +1,953 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "monitor.h"
+#include "monitor_alert.h"
+#include "monitor_anomaly.h"
+#include "monitor_cgroup.h"
+#include "monitor_config.h"
+#include "monitor_config_file.h"
+#include "monitor_format.h"
+#include "monitor_log.h"
+#include "monitor_probe.h"
+#include "monitor_profile.h"
+#include "monitor_read_batch.h"
+#include "monitor_rollup.h"
+#include "monitor_shm.h"
+#include "monitor_sparkline.h"
+#include "monitor_threads.h"
+
+enum {
+    ALERT_BENCH_RULES = 100000,
+    ALERT_BENCH_TICKS = 200,
+    ALERT_BENCH_EVENTS = 1024,
+    LOG_BENCH_BATCHES = 2000,
+    LOG_BENCH_BATCH_SIZE = MONITOR_LOG_RING_CAPACITY / 2,
+    FORMAT_BENCH_RECORDS = 1000000,
+    FORMAT_BENCH_BATCH = 512,
+    CGROUP_BENCH_GROUPS = 2000,
+    CGROUP_BENCH_TICKS = 20,
+    MEMINFO_BENCH_READS = 20000,
+    MEMINFO_BENCH_PARSES = 1000000,
+    PROFILE_BENCH_SCOPES = 1000000,
+    CONFIG_BENCH_LOADS = 100000,
+    CONFIG_BENCH_RULES = 5000,
+    CONFIG_BENCH_FILE_ROUNDS = 50,
+    SHM_BENCH_PUBLISHES = 2000000,
+    SHM_BENCH_READS = 2000000,
+    SHM_BENCH_MAX_READERS = 16,
+    READ_BENCH_TICKS = 20000,
+    READ_BENCH_BUFFER = 8192,
+    ROLLUP_BENCH_INTERVAL_MS = 100,
+    ROLLUP_BENCH_QUERIES = 2000,
+    ROLLUP_BENCH_POINTS = 512,
+    SPARKLINE_BENCH_COLUMNS = 200,
+    SPARKLINE_BENCH_ROWS = 60,
+    SPARKLINE_BENCH_FRAMES = 5000,
+    THREADS_BENCH_THREADS = 10000,
+    THREADS_BENCH_SAMPLES = 20,
+    THREADS_BENCH_STACK = 64 * 1024,
+    ANOMALY_BENCH_METRICS = 10000,
+    ANOMALY_BENCH_SHAPES = 64,
+    ANOMALY_BENCH_PERIOD_TICKS = 480,
+    ANOMALY_BENCH_TICKS = 6 * ANOMALY_BENCH_PERIOD_TICKS,
+    ANOMALY_BENCH_SPIKE_EVERY = 397,
+    PROBE_BENCH_LAUNCHES = 2000,
+    PROBE_BENCH_THREADS = 4,
+    PROBE_BENCH_TARGET_PER_SECOND = 1000,
+    PROBE_BENCH_CACHE_HITS = 200000
+};
+
+static long long bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + (long long)ts.tv_nsec;
+}
+
+static void report(const char* name, long long elapsed_ns, long long operations, const char* unit) {
+    printf("%-32s %12.1f ns/%s  (%lld %ss)\n",
+           name,
+           (double)elapsed_ns / (double)operations,
+           unit,
+           operations,
+           unit);
+}
+
+static void bench_alert_engine(void) {
+    AlertEngine engine;
+    static AlertEvent events[ALERT_BENCH_EVENTS];
+    double values[MONITOR_METRIC_COUNT] = {0.0};
+    unsigned int seed = 42;
+
+    if (monitor_alert_engine_init(&engine, ALERT_BENCH_RULES) != MONITOR_STATUS_OK) {
+        fprintf(stderr, "alert bench: allocation failed\n");
+        return;
+    }
+
+    for (size_t i = 0; i < ALERT_BENCH_RULES; i++) {
+        AlertRule rule = {
+            .metric = (uint32_t)(i % MONITOR_METRIC_COUNT),
+            .warning_threshold = 50.0 + (double)(i % 30),
+            .critical_threshold = 85.0 + (double)(i % 10),
+            .hysteresis = 5.0,
+            .for_ms = (int)(i % 4) * 1000,
+            .min_notify_interval_ms = 60000
+        };
+        monitor_alert_engine_add_rule(&engine, &rule, NULL);
+    }
+
+    size_t total_events = 0;
+    long long start = bench_now_ns();
+    for (int tick = 0; tick < ALERT_BENCH_TICKS; tick++) {
+        for (size_t m = 0; m < MONITOR_METRIC_COUNT; m++) {
+            seed = seed * 1103515245U + 12345U;
+            values[m] = (double)(seed % 10000U) / 100.0;
+        }
+        total_events += monitor_alert_engine_evaluate(&engine,
+                                                      values,
+                                                      MONITOR_METRIC_COUNT,
+                                                      (long long)tick * 100LL,
+                                                      events,
+                                                      ALERT_BENCH_EVENTS);
+    }
+    long long elapsed = bench_now_ns() - start;
+
+    report("alert_engine_100k_rules", elapsed, ALERT_BENCH_TICKS, "tick");
+    report("alert_engine_per_rule", elapsed, (long long)ALERT_BENCH_TICKS * ALERT_BENCH_RULES, "rule");
+    printf("  events=%zu suppressed=%llu\n", total_events, engine.suppressed_notifications);
+
+    monitor_alert_engine_free(&engine);
+}
+
+static void bench_logger(void) {
+    FILE* sink = fopen("/dev/null", "w");
+    long long elapsed = 0;
+
+    if (!sink) {
+        fprintf(stderr, "log bench: cannot open /dev/null\n");
+        return;
+    }
+
+    monitor_log_set_streams(sink, sink);
+    monitor_log_set_format(MONITOR_LOG_FORMAT_JSON);
+    if (monitor_log_start() != MONITOR_STATUS_OK) {
+        fprintf(stderr, "log bench: failed to start logger\n");
+        fclose(sink);
+        return;
+    }
+
+    for (int batch = 0; batch < LOG_BENCH_BATCHES; batch++) {
+        long long start = bench_now_ns();
+        for (int i = 0; i < LOG_BENCH_BATCH_SIZE; i++) {
+            MonitorLogArg args[2] = {monitor_log_int(i), monitor_log_double(42.5)};
+            monitor_log_write(MONITOR_LOG_INFO, "sample {} cpu={}", args, 2);
+        }
+        elapsed += bench_now_ns() - start;
+        monitor_log_flush();
+    }
+
+    report("log_write_two_args", elapsed, (long long)LOG_BENCH_BATCHES * LOG_BENCH_BATCH_SIZE, "call");
+    printf("  dropped=%llu\n", monitor_log_dropped());
+
+    monitor_log_stop();
+    monitor_log_set_streams(NULL, NULL);
+    fclose(sink);
+}
+
+static void bench_output_format(MonitorOutputFormat format, const char* name) {
+    static char storage[FORMAT_BENCH_BATCH * MONITOR_OUTPUT_MAX_RECORD_BYTES];
+    OutputWriter writer;
+    int fd = open("/dev/null", O_WRONLY);
+
+    if (fd < 0) {
+        fprintf(stderr, "format bench: cannot open /dev/null\n");
+        return;
+    }
+
+    monitor_output_init(&writer, storage, sizeof(storage), fd, format, FORMAT_BENCH_BATCH);
+
+    long long start = bench_now_ns();
+    for (int i = 0; i < FORMAT_BENCH_RECORDS; i++) {
+        HealthRecord record = {
+            .timestamp_ms = 1700000000000LL + i,
+            .server = "prod-01",
+            .cpu_percent = (double)(i % 10000) / 100.0,
+            .ram_percent = 42.4242,
+            .ram_used_gb = 6.78,
+            .ram_total_gb = 15.96,
+            .cpu_alert = "OK",
+            .ram_alert = "WARNING"
+        };
+        monitor_output_write(&writer, &record);
+    }
+    monitor_output_flush(&writer);
+    long long elapsed = bench_now_ns() - start;
+
+    report(name, elapsed, FORMAT_BENCH_RECORDS, "record");
+    printf("  %.0f records/s, %llu flushes\n",
+           (double)FORMAT_BENCH_RECORDS * 1e9 / (double)elapsed,
+           writer.flushes);
+    close(fd);
+}
+
+static void write_cgroup_file(const char* dir, const char* name, const char* contents) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE* file = fopen(path, "w");
+    if (file) {
+        fputs(contents, file);
+        fclose(file);
+    }
+}
+
+static void bench_cgroup_collector(void) {
+    static const char* files[] = {"memory.current", "memory.max", "cpu.stat", "io.stat"};
+    char root[] = "/tmp/shm_cgroup_bench_XXXXXX";
+    char dir[512];
+    CgroupSet set;
+
+    if (!mkdtemp(root)) {
+        fprintf(stderr, "cgroup bench: mkdtemp failed\n");
+        return;
+    }
+
+    for (int i = 0; i < CGROUP_BENCH_GROUPS; i++) {
+        snprintf(dir, sizeof(dir), "%s/g%d", root, i);
+        mkdir(dir, 0700);
+        write_cgroup_file(dir, files[0], "123456789\n");
+        write_cgroup_file(dir, files[1], "1073741824\n");
+        write_cgroup_file(dir, files[2], "usage_usec 1\nuser_usec 1\nsystem_usec 0\nnr_periods 0\n"
+                                         "nr_throttled 0\nthrottled_usec 0\n");
+        write_cgroup_file(dir, files[3], "8:0 rbytes=1 wbytes=2 rios=3 wios=4 dbytes=0 dios=0\n");
+    }
+
+    if (monitor_cgroup_set_init(&set, root, CGROUP_BENCH_GROUPS) == MONITOR_STATUS_OK) {
+        for (int i = 0; i < CGROUP_BENCH_GROUPS; i++) {
+            snprintf(dir, sizeof(dir), "g%d", i);
+            monitor_cgroup_set_add(&set, dir, NULL);
+        }
+
+        long long start = bench_now_ns();
+        for (int tick = 0; tick < CGROUP_BENCH_TICKS; tick++) {
+            monitor_cgroup_set_read_all(&set);
+        }
+        long long elapsed = bench_now_ns() - start;
+
+        report("cgroup_2000_groups", elapsed, CGROUP_BENCH_TICKS, "tick");
+        report("cgroup_per_group", elapsed, (long long)CGROUP_BENCH_TICKS * CGROUP_BENCH_GROUPS, "group");
+        monitor_cgroup_set_free(&set);
+    }
+
+    for (int i = 0; i < CGROUP_BENCH_GROUPS; i++) {
+        for (size_t f = 0; f < sizeof(files) / sizeof(files[0]); f++) {
+            snprintf(dir, sizeof(dir), "%s/g%d/%s", root, i, files[f]);
+            unlink(dir);
+        }
+        snprintf(dir, sizeof(dir), "%s/g%d", root, i);
+        rmdir(dir);
+    }
+    rmdir(root);
+}
+
+/* The fscanf + strcmp loop monitor_read_memory_usage() used before the table parser. */
+static int legacy_read_meminfo(unsigned long long* total_out, unsigned long long* available_out) {
+    FILE* file = fopen("/proc/meminfo", "r");
+    char label[64] = {0};
+    unsigned long long value_kb = 0ULL;
+    unsigned long long total_kb = 0ULL;
+    unsigned long long available_kb = 0ULL;
+    unsigned long long free_kb = 0ULL;
+    unsigned long long buffers_kb = 0ULL;
+    unsigned long long cached_kb = 0ULL;
+
+    if (!file) {
+        return -1;
+    }
+
+    while (fscanf(file, "%63s %llu kB", label, &value_kb) == 2) {
+        if (strcmp(label, "MemTotal:") == 0) {
+            total_kb = value_kb;
+        } else if (strcmp(label, "MemAvailable:") == 0) {
+            available_kb = value_kb;
+        } else if (strcmp(label, "MemFree:") == 0) {
+            free_kb = value_kb;
+        } else if (strcmp(label, "Buffers:") == 0) {
+            buffers_kb = value_kb;
+        } else if (strcmp(label, "Cached:") == 0) {
+            cached_kb = value_kb;
+        }
+
+        if (total_kb > 0 && available_kb > 0) {
+            break;
+        }
+    }
+    fclose(file);
+
+    *total_out = total_kb;
+    *available_out = available_kb ? available_kb : free_kb + buffers_kb + cached_kb;
+    return 0;
+}
+
+static void bench_meminfo(void) {
+    static char text[8192];
+    unsigned long long sink = 0ULL;
+    MemoryBreakdown breakdown;
+
+    long long start = bench_now_ns();
+    for (int i = 0; i < MEMINFO_BENCH_READS; i++) {
+        unsigned long long total = 0ULL;
+        unsigned long long available = 0ULL;
+        legacy_read_meminfo(&total, &available);
+        sink += available;
+    }
+    report("meminfo_legacy_fscanf", bench_now_ns() - start, MEMINFO_BENCH_READS, "read");
+
+    start = bench_now_ns();
+    for (int i = 0; i < MEMINFO_BENCH_READS; i++) {
+        monitor_read_memory_breakdown(&breakdown);
+        sink += breakdown.available_kb;
+    }
+    report("meminfo_full_breakdown", bench_now_ns() - start, MEMINFO_BENCH_READS, "read");
+
+    int fd = open("/proc/meminfo", O_RDONLY);
+    ssize_t length = fd >= 0 ? read(fd, text, sizeof(text)) : -1;
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (length > 0) {
+        start = bench_now_ns();
+        for (int i = 0; i < MEMINFO_BENCH_PARSES; i++) {
+            monitor_parse_meminfo(text, (size_t)length, &breakdown);
+            sink += breakdown.dirty_kb;
+        }
+        report("meminfo_parse_only", bench_now_ns() - start, MEMINFO_BENCH_PARSES, "parse");
+    }
+
+    if (sink == 0ULL) {
+        fprintf(stderr, "meminfo bench: no data\n");
+    }
+}
+
+static void bench_profile_scope(void) {
+    long long start = bench_now_ns();
+    for (int i = 0; i < PROFILE_BENCH_SCOPES; i++) {
+        MONITOR_PROFILE_BEGIN(bench);
+        MONITOR_PROFILE_END(bench, MONITOR_PROFILE_RENDER);
+    }
+    report("profile_scope", bench_now_ns() - start, PROFILE_BENCH_SCOPES, "scope");
+    monitor_profile_reset();
+}
+
+static void bench_config_reload(void) {
+    char program[] = "server_monitor";
+    char daemon_flag[] = "--daemon";
+    char interval_flag[] = "--interval-ms";
+    char interval_value[] = "500";
+    char* argv[] = {program, daemon_flag, interval_flag, interval_value};
+    int loaded = 0;
+
+    long long start = bench_now_ns();
+    for (int i = 0; i < CONFIG_BENCH_LOADS; i++) {
+        MonitorConfigSnapshot* snapshot = NULL;
+        if (monitor_config_load(4, argv, &snapshot, NULL, 0) == MONITOR_STATUS_OK) {
+            monitor_config_snapshot_free(snapshot);
+            loaded++;
+        }
+    }
+    report("config_reload_parse", bench_now_ns() - start, CONFIG_BENCH_LOADS, "load");
+    if (loaded != CONFIG_BENCH_LOADS) {
+        fprintf(stderr, "config bench: %d loads failed\n", CONFIG_BENCH_LOADS - loaded);
+    }
+}
+
+static void bench_config_file(void) {
+    const size_t line_capacity = 160;
+    size_t capacity = CONFIG_BENCH_RULES * line_capacity + 128;
+    char* text = malloc(capacity);
+    ConfigRules rules;
+    MonitorConfig config;
+    MonitorConfigSnapshot* snapshot = NULL;
+    char error[128] = {0};
+    size_t length = 0;
+
+    if (!text) {
+        return;
+    }
+    length += (size_t)snprintf(text, capacity, "[monitor]\nserver = bench\ninterval_ms = 1000\n");
+    for (int i = 0; i < CONFIG_BENCH_RULES; i++) {
+        length += (size_t)snprintf(text + length,
+                                   capacity - length,
+                                   "[alert.rule-%d]\nmetric = cpu_percent\nwarning = %d\ncritical = %d\nnotify = team-%d\n",
+                                   i,
+                                   50 + i % 20,
+                                   80 + i % 20,
+                                   i % 16);
+    }
+
+    long long parse_ns = 0;
+    long long compile_ns = 0;
+    for (int round = 0; round < CONFIG_BENCH_FILE_ROUNDS; round++) {
+        monitor_config_init(&config);
+        monitor_config_rules_init(&rules);
+        long long start = bench_now_ns();
+        MonitorStatus status = monitor_config_parse_ini(text, length, &config, &rules, error, sizeof(error));
+        long long parsed = bench_now_ns();
+        if (status == MONITOR_STATUS_OK) {
+            status = monitor_config_snapshot_create(&config, &rules, &snapshot, error, sizeof(error));
+        }
+        compile_ns += bench_now_ns() - parsed;
+        parse_ns += parsed - start;
+        monitor_config_rules_free(&rules);
+        if (status != MONITOR_STATUS_OK) {
+            fprintf(stderr, "config file bench: %s\n", error);
+            break;
+        }
+        monitor_config_snapshot_free(snapshot);
+    }
+
+    report("config_file_parse", parse_ns, (long long)CONFIG_BENCH_RULES * CONFIG_BENCH_FILE_ROUNDS, "rule");
+    report("config_file_compile", compile_ns, (long long)CONFIG_BENCH_RULES * CONFIG_BENCH_FILE_ROUNDS, "rule");
+    free(text);
+}
+
+typedef struct {
+    const char* name;
+    long long elapsed_ns;
+    unsigned long long retries;
+    unsigned long long failures;
+} ShmBenchReader;
+
+typedef struct {
+    MonitorShmWriter* writer;
+    atomic_bool stop;
+    unsigned long long published;
+} ShmBenchWriter;
+
+static void* shm_bench_reader(void* arg) {
+    ShmBenchReader* bench = arg;
+    MonitorShmReader reader;
+    MonitorShmSample sample;
+    double checksum = 0.0;
+
+    if (monitor_shm_reader_open(&reader, bench->name) != MONITOR_STATUS_OK) {
+        bench->failures = SHM_BENCH_READS;
+        return NULL;
+    }
+
+    long long start = bench_now_ns();
+    for (int i = 0; i < SHM_BENCH_READS; i++) {
+        if (monitor_shm_read(&reader, &sample, NULL) == MONITOR_STATUS_OK) {
+            checksum += sample.cpu_percent;
+        } else {
+            bench->failures++;
+        }
+    }
+    bench->elapsed_ns = bench_now_ns() - start;
+    bench->retries = reader.retries;
+    monitor_shm_reader_close(&reader);
+    if (checksum < 0.0) {
+        fprintf(stderr, "shm bench: impossible checksum\n");
+    }
+    return NULL;
+}
+
+static void* shm_bench_writer(void* arg) {
+    ShmBenchWriter* bench = arg;
+    MonitorShmSample sample;
+
+    memset(&sample, 0, sizeof(sample));
+    while (!atomic_load_explicit(&bench->stop, memory_order_relaxed)) {
+        sample.cpu_percent = (double)(bench->published % 100);
+        sample.timestamp_ms = (int64_t)bench->published;
+        monitor_shm_publish(bench->writer, &sample);
+        bench->published++;
+    }
+    return NULL;
+}
+
+static void bench_shm_contention(void) {
+    static const int reader_counts[] = {1, 4, SHM_BENCH_MAX_READERS};
+    char name[MONITOR_SHM_MAX_NAME];
+    MonitorShmWriter writer;
+    MonitorShmSample sample;
+
+    snprintf(name, sizeof(name), "/shm_bench_%ld", (long)getpid());
+    if (monitor_shm_writer_open(&writer, name) != MONITOR_STATUS_OK) {
+        fprintf(stderr, "shm bench: cannot create %s\n", name);
+        return;
+    }
+
+    memset(&sample, 0, sizeof(sample));
+    long long start = bench_now_ns();
+    for (int i = 0; i < SHM_BENCH_PUBLISHES; i++) {
+        sample.cpu_percent = (double)i;
+        monitor_shm_publish(&writer, &sample);
+    }
+    report("shm_publish", bench_now_ns() - start, SHM_BENCH_PUBLISHES, "publish");
+
+    /* Readers race a writer that publishes as fast as it can: the worst case for the seqlock. */
+    for (size_t r = 0; r < sizeof(reader_counts) / sizeof(reader_counts[0]); r++) {
+        int count = reader_counts[r];
+        pthread_t threads[SHM_BENCH_MAX_READERS];
+        ShmBenchReader readers[SHM_BENCH_MAX_READERS];
+        ShmBenchWriter publisher = {&writer, false, 0};
+        pthread_t writer_thread;
+        long long elapsed_ns = 0;
+        unsigned long long retries = 0;
+        unsigned long long failures = 0;
+        char label[64];
+
+        pthread_create(&writer_thread, NULL, shm_bench_writer, &publisher);
+        for (int i = 0; i < count; i++) {
+            readers[i] = (ShmBenchReader){name, 0, 0, 0};
+            pthread_create(&threads[i], NULL, shm_bench_reader, &readers[i]);
+        }
+        for (int i = 0; i < count; i++) {
+            pthread_join(threads[i], NULL);
+            elapsed_ns += readers[i].elapsed_ns;
+            retries += readers[i].retries;
+            failures += readers[i].failures;
+        }
+        atomic_store(&publisher.stop, true);
+        pthread_join(writer_thread, NULL);
+
+        long long reads = (long long)count * SHM_BENCH_READS;
+        snprintf(label, sizeof(label), "shm_read_%d_readers", count);
+        report(label, elapsed_ns, reads, "read");
+        printf("  %.3f retries/read, %llu failed reads, %llu concurrent publishes\n",
+               (double)retries / (double)reads,
+               failures,
+               publisher.published);
+    }
+
+    monitor_shm_writer_close(&writer);
+}
+
+static const char* const READ_BENCH_WIDE_FILES[] = {
+    "/proc/stat", "/proc/meminfo", "/proc/loadavg", "/proc/uptime", "/proc/vmstat",
+    "/proc/diskstats", "/proc/net/dev", "/proc/net/snmp", "/proc/pressure/cpu", "/proc/pressure/memory",
+    "/proc/pressure/io", "/proc/sys/fs/file-nr", "/proc/self/stat", "/proc/self/status", "/proc/self/io",
+    "/proc/self/statm",
+};
+
+static size_t read_file_sequential(const char* path, char* buffer, size_t size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    ssize_t count = read(fd, buffer, size);
+    close(fd);
+    return count > 0 ? (size_t)count : 0;
+}
+
+static void bench_read_tick(void) {
+    static char buffer[READ_BENCH_BUFFER];
+    const MonitorReadBackend backends[] = {MONITOR_READ_BACKEND_PREAD, MONITOR_READ_BACKEND_IO_URING,
+                                           MONITOR_READ_BACKEND_AUTO};
+    const char* wide[sizeof(READ_BENCH_WIDE_FILES) / sizeof(READ_BENCH_WIDE_FILES[0])];
+    size_t wide_count = 0;
+    char root[MONITOR_CGROUP_MAX_PATH];
+    char path[MONITOR_CGROUP_MAX_PATH];
+    CgroupHandle cgroup = {-1, "", ""};
+    CgroupStats stats;
+    CpuTracker tracker = {0, 0, false};
+    MemoryBreakdown breakdown;
+    double cpu = 0.0;
+    size_t bytes = 0;
+
+    bool has_cgroup = monitor_cgroup_find_root(root, sizeof(root)) == MONITOR_STATUS_OK &&
+                      monitor_cgroup_self_path(path, sizeof(path)) == MONITOR_STATUS_OK &&
+                      monitor_cgroup_open(&cgroup, root, path) == MONITOR_STATUS_OK;
+    for (size_t i = 0; i < sizeof(READ_BENCH_WIDE_FILES) / sizeof(READ_BENCH_WIDE_FILES[0]); i++) {
+        if (access(READ_BENCH_WIDE_FILES[i], R_OK) == 0) {
+            wide[wide_count++] = READ_BENCH_WIDE_FILES[i];
+        }
+    }
+
+    /* The monitor's own tick: /proc/stat, /proc/meminfo and the cgroup files. */
+    long long start = bench_now_ns();
+    for (int i = 0; i < READ_BENCH_TICKS; i++) {
+        monitor_read_cpu_usage(&tracker, &cpu);
+        monitor_read_memory_breakdown(&breakdown);
+        if (has_cgroup) {
+            monitor_cgroup_read(&cgroup, &stats);
+        }
+    }
+    report("tick_read_sequential", bench_now_ns() - start, READ_BENCH_TICKS, "tick");
+
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+        ReadBatch batch;
+        CgroupReadSlots slots;
+        size_t stat_slot = 0;
+        size_t meminfo_slot = 0;
+        char label[64];
+
+        if (monitor_read_batch_init(&batch, backends[b]) != MONITOR_STATUS_OK) {
+            printf("%-32s unavailable\n", backends[b] == MONITOR_READ_BACKEND_IO_URING ? "tick_read_io_uring" : "pread");
+            continue;
+        }
+        monitor_read_batch_add(&batch, "/proc/stat", 4096, &stat_slot);
+        monitor_read_batch_add(&batch, "/proc/meminfo", 8192, &meminfo_slot);
+        if (has_cgroup) {
+            monitor_cgroup_batch_add(&cgroup, &batch, &slots);
+        }
+
+        start = bench_now_ns();
+        for (int i = 0; i < READ_BENCH_TICKS; i++) {
+            size_t length = 0;
+            monitor_read_batch_run(&batch);
+            monitor_cpu_usage_from_stat(&tracker, monitor_read_batch_data(&batch, stat_slot, NULL), &cpu);
+            const char* meminfo = monitor_read_batch_data(&batch, meminfo_slot, &length);
+            monitor_parse_meminfo(meminfo, length, &breakdown);
+            if (has_cgroup) {
+                monitor_cgroup_parse_batch(&batch, &slots, &stats);
+            }
+        }
+        snprintf(label, sizeof(label), "tick_read_%s%s", backends[b] == MONITOR_READ_BACKEND_AUTO ? "auto_" : "",
+                 monitor_read_backend_name(batch.backend));
+        report(label, bench_now_ns() - start, READ_BENCH_TICKS, "tick");
+        printf("  %zu files, %.1f syscalls/tick\n", batch.count, (double)batch.syscalls / (double)batch.runs);
+        monitor_read_batch_free(&batch);
+    }
+
+    /* A wider collector set: raw reads only, no parsing. */
+    start = bench_now_ns();
+    for (int i = 0; i < READ_BENCH_TICKS; i++) {
+        for (size_t f = 0; f < wide_count; f++) {
+            bytes += read_file_sequential(wide[f], buffer, sizeof(buffer));
+        }
+    }
+    report("wide_read_sequential", bench_now_ns() - start, READ_BENCH_TICKS, "tick");
+
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+        ReadBatch batch;
+        char label[64];
+
+        if (monitor_read_batch_init(&batch, backends[b]) != MONITOR_STATUS_OK) {
+            continue;
+        }
+        for (size_t f = 0; f < wide_count; f++) {
+            monitor_read_batch_add(&batch, wide[f], sizeof(buffer), NULL);
+        }
+        start = bench_now_ns();
+        for (int i = 0; i < READ_BENCH_TICKS; i++) {
+            monitor_read_batch_run(&batch);
+            bytes += batch.slots[0].length;
+        }
+        snprintf(label, sizeof(label), "wide_read_%s%s", backends[b] == MONITOR_READ_BACKEND_AUTO ? "auto_" : "",
+                 monitor_read_backend_name(batch.backend));
+        report(label, bench_now_ns() - start, READ_BENCH_TICKS, "tick");
+        monitor_read_batch_free(&batch);
+    }
+    printf("  %zu files per wide tick (%zu bytes read in total)\n", wide_count, bytes);
+
+    if (has_cgroup) {
+        monitor_cgroup_close(&cgroup);
+    }
+}
+
+/* One day of 100 ms samples, i.e. MONITOR_MAX_ITERATIONS points for one metric. */
+static void bench_rollup(void) {
+    static MetricRollup rollup;
+    static RollupBucket buckets[ROLLUP_BENCH_POINTS];
+    const int64_t samples = MONITOR_MAX_ITERATIONS;
+    const int64_t end = samples * ROLLUP_BENCH_INTERVAL_MS;
+    const int64_t ranges[] = {60000, 3600000, end};
+    MonitorRollupTier tier = MONITOR_ROLLUP_RAW;
+    double checksum = 0.0;
+
+    monitor_rollup_init(&rollup);
+    long long start = bench_now_ns();
+    for (int64_t i = 0; i < samples; i++) {
+        monitor_rollup_add(&rollup, i * ROLLUP_BENCH_INTERVAL_MS, (double)(i % 1000) / 10.0);
+    }
+    report("rollup_add", bench_now_ns() - start, samples, "sample");
+    printf("  %zu KiB per metric instead of %lld KiB of raw samples\n",
+           sizeof(rollup) / 1024,
+           (long long)(samples * (int64_t)(sizeof(int64_t) + sizeof(double)) / 1024));
+
+    for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+        char label[64];
+        size_t count = 0;
+
+        start = bench_now_ns();
+        for (int q = 0; q < ROLLUP_BENCH_QUERIES; q++) {
+            monitor_rollup_query(&rollup, end - ranges[r], end, buckets, ROLLUP_BENCH_POINTS, &count, &tier);
+            checksum += buckets[0].max;
+        }
+        snprintf(label, sizeof(label), "rollup_query_%llds", (long long)(ranges[r] / 1000));
+        report(label, bench_now_ns() - start, ROLLUP_BENCH_QUERIES, "call");
+        printf("  %zu points from the %s tier\n", count, monitor_rollup_tier_name(tier));
+    }
+    printf("  (checksum %.1f)\n", checksum);
+}
+
+/* A full 200x60 terminal of sparkline rows, rendered as the live dashboard does each frame. */
+static void bench_sparkline_frame(void) {
+    static HistoryRing histories[SPARKLINE_BENCH_ROWS];
+    static char frame[SPARKLINE_BENCH_ROWS * (SPARKLINE_BENCH_COLUMNS * MONITOR_SPARKLINE_MAX_GLYPH_BYTES + 64)];
+    SparklineRow rows[SPARKLINE_BENCH_ROWS];
+    char labels[SPARKLINE_BENCH_ROWS][16];
+    const MonitorSparklineStyle styles[] = {MONITOR_SPARKLINE_UTF8, MONITOR_SPARKLINE_ASCII};
+    const char* names[] = {"sparkline_frame_utf8", "sparkline_frame_ascii"};
+    size_t length = 0;
+
+    for (size_t r = 0; r < SPARKLINE_BENCH_ROWS; r++) {
+        monitor_history_init(&histories[r]);
+        for (size_t i = 0; i < MONITOR_HISTORY_CAPACITY; i++) {
+            monitor_history_push(&histories[r], (double)((i * 7 + r * 13) % 100));
+        }
+        snprintf(labels[r], sizeof(labels[r]), "metric_%zu", r);
+        rows[r].label = labels[r];
+        rows[r].history = &histories[r];
+        rows[r].low = 0.0;
+        rows[r].high = r % 2 == 0 ? 100.0 : 0.0;
+    }
+
+    for (size_t s = 0; s < sizeof(styles) / sizeof(styles[0]); s++) {
+        long long start = bench_now_ns();
+        for (int f = 0; f < SPARKLINE_BENCH_FRAMES; f++) {
+            monitor_history_push(&histories[(size_t)f % SPARKLINE_BENCH_ROWS], (double)(f % 100));
+            length = monitor_sparkline_panel(
+                rows, SPARKLINE_BENCH_ROWS, SPARKLINE_BENCH_COLUMNS, styles[s], frame, sizeof(frame));
+        }
+        report(names[s], bench_now_ns() - start, SPARKLINE_BENCH_FRAMES, "frame");
+        printf("  %dx%d terminal, %zu bytes per frame\n", SPARKLINE_BENCH_COLUMNS, SPARKLINE_BENCH_ROWS, length);
+    }
+}
+
+static pthread_mutex_t threads_bench_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t threads_bench_wake = PTHREAD_COND_INITIALIZER;
+static bool threads_bench_stop;
+
+/* Blocks without waking, so ten thousand of these leave the CPU to the sampler. */
+static void* parked_thread(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&threads_bench_lock);
+    while (!threads_bench_stop) {
+        pthread_cond_wait(&threads_bench_wake, &threads_bench_lock);
+    }
+    pthread_mutex_unlock(&threads_bench_lock);
+    return NULL;
+}
+
+/* Per-thread CPU for this process after parking THREADS_BENCH_THREADS extra threads in it. */
+static void bench_thread_sampling(void) {
+    static pthread_t threads[THREADS_BENCH_THREADS];
+    const MonitorThreadsBackend backends[] = {MONITOR_THREADS_BACKEND_PROCFS, MONITOR_THREADS_BACKEND_TASKSTATS};
+    pthread_attr_t attr;
+    size_t started = 0;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, THREADS_BENCH_STACK);
+    threads_bench_stop = false;
+    while (started < THREADS_BENCH_THREADS && pthread_create(&threads[started], &attr, parked_thread, NULL) == 0) {
+        started++;
+    }
+    pthread_attr_destroy(&attr);
+
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+        static ThreadTracker tracker;
+        char label[64];
+
+        if (monitor_threads_init(&tracker, backends[b]) != MONITOR_STATUS_OK) {
+            printf("%-32s unavailable\n", backends[b] == MONITOR_THREADS_BACKEND_TASKSTATS ? "threads_taskstats" : "threads_procfs");
+            continue;
+        }
+        monitor_threads_watch(&tracker, (int)getpid());
+        monitor_threads_sample(&tracker);
+        tracker.syscalls = 0;
+
+        long long start = bench_now_ns();
+        for (int s = 0; s < THREADS_BENCH_SAMPLES; s++) {
+            monitor_threads_sample(&tracker);
+        }
+        snprintf(label, sizeof(label), "threads_%s", monitor_threads_backend_name(tracker.backend));
+        report(label, bench_now_ns() - start, THREADS_BENCH_SAMPLES, "sample");
+        printf("  %zu threads, %.0f syscalls/sample besides listing, top %s at %.2f%%\n",
+               tracker.threads,
+               (double)tracker.syscalls / THREADS_BENCH_SAMPLES,
+               tracker.top_count > 0 ? tracker.top[0].comm : "-",
+               tracker.top_count > 0 ? tracker.top[0].cpu_percent : 0.0);
+        monitor_threads_free(&tracker);
+    }
+
+    pthread_mutex_lock(&threads_bench_lock);
+    threads_bench_stop = true;
+    pthread_cond_broadcast(&threads_bench_wake);
+    pthread_mutex_unlock(&threads_bench_lock);
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+/*
+ * Replays synthetic traces through 10k models: every metric follows one of a
+ * few shapes with a daily-style bump, per-metric noise, injected spikes and
+ * a level shift halfway through for half of the shapes.
+ */
+static void bench_anomaly_replay(void) {
+    static float traces[ANOMALY_BENCH_SHAPES][ANOMALY_BENCH_TICKS];
+    static bool spikes[ANOMALY_BENCH_SHAPES][ANOMALY_BENCH_TICKS];
+    static double values[ANOMALY_BENCH_METRICS];
+    static AnomalyEvent events[ANOMALY_BENCH_METRICS];
+    const int slot_ticks = ANOMALY_BENCH_PERIOD_TICKS / MONITOR_ANOMALY_SEASON_SLOTS;
+    const int64_t step_ms = 1000;
+    AnomalyDetector detector;
+    AnomalyParams params;
+    uint32_t noise = 1;
+    unsigned long long injected = 0;
+    unsigned long long caught = 0;
+    unsigned long long other = 0;
+    long long elapsed = 0;
+
+    for (int shape = 0; shape < ANOMALY_BENCH_SHAPES; shape++) {
+        const int bump_slot = shape % MONITOR_ANOMALY_SEASON_SLOTS;
+        for (int t = 0; t < ANOMALY_BENCH_TICKS; t++) {
+            bool bump = (t % ANOMALY_BENCH_PERIOD_TICKS) / slot_ticks == bump_slot;
+            bool shifted = shape % 2 == 0 && t >= ANOMALY_BENCH_TICKS / 2;
+            spikes[shape][t] = (t * 7 + shape) % ANOMALY_BENCH_SPIKE_EVERY == 0;
+            traces[shape][t] = (float)(20.0 + shape % 5 * 10.0 + (bump ? 15.0 : 0.0) + (shifted ? 10.0 : 0.0) +
+                                       (spikes[shape][t] ? 25.0 : 0.0));
+        }
+    }
+
+    monitor_anomaly_default_params(&params);
+    params.season_ms = ANOMALY_BENCH_PERIOD_TICKS * step_ms;
+    if (monitor_anomaly_init(&detector, ANOMALY_BENCH_METRICS, &params) != MONITOR_STATUS_OK) {
+        printf("anomaly_replay                   unavailable\n");
+        return;
+    }
+
+    for (int t = 0; t < ANOMALY_BENCH_TICKS; t++) {
+        for (size_t m = 0; m < ANOMALY_BENCH_METRICS; m++) {
+            noise = noise * 1664525u + 1013904223u;
+            double jitter = (double)(noise >> 8) / (double)(1u << 23) - 1.0;
+            values[m] = (double)traces[m % ANOMALY_BENCH_SHAPES][t] + jitter;
+        }
+
+        long long start = bench_now_ns();
+        size_t count = monitor_anomaly_update(
+            &detector, values, ANOMALY_BENCH_METRICS, t * step_ms, events, ANOMALY_BENCH_METRICS);
+        elapsed += bench_now_ns() - start;
+
+        for (size_t e = 0; e < count; e++) {
+            bool spike = spikes[events[e].metric % ANOMALY_BENCH_SHAPES][t];
+            caught += spike && (events[e].flags & ANOMALY_SPIKE);
+            other += !spike;
+        }
+        if (t >= (int)params.warmup_samples) {
+            for (int shape = 0; shape < ANOMALY_BENCH_SHAPES; shape++) {
+                int metrics = (ANOMALY_BENCH_METRICS - shape + ANOMALY_BENCH_SHAPES - 1) / ANOMALY_BENCH_SHAPES;
+                injected += spikes[shape][t] ? (unsigned long long)metrics : 0;
+            }
+        }
+    }
+
+    report("anomaly_update_10k", elapsed, ANOMALY_BENCH_TICKS, "tick");
+    printf("  %.1f ns per metric, %zu KiB of models, %llu/%llu injected spikes flagged, %llu other flags\n",
+           (double)elapsed / ((double)ANOMALY_BENCH_TICKS * ANOMALY_BENCH_METRICS),
+           detector.count * sizeof(AnomalyModel) / 1024,
+           caught,
+           injected,
+           other);
+    monitor_anomaly_free(&detector);
+}
+
+typedef struct {
+    MonitorProbeEngine* engine;
+    size_t id;
+    int launches;
+    int failures;
+} ProbeBenchWorker;
+
+static void* probe_bench_worker(void* arg) {
+    ProbeBenchWorker* worker = arg;
+    static _Thread_local MonitorProbeResult result;
+
+    for (int i = 0; i < worker->launches; i++) {
+        if (monitor_probe_run(worker->engine, worker->id, 1000, &result) != MONITOR_STATUS_OK ||
+            !monitor_probe_succeeded(&result)) {
+            worker->failures++;
+        }
+    }
+    return NULL;
+}
+
+/* Spawn, capture and reap of /bin/true, the floor under every probe, with the limits the monitor applies. */
+static void bench_probe_launches(void) {
+    const MonitorProbeLimits limits = {.cpu_seconds = 3, .open_files = 256, .disable_core_dumps = true};
+    ProbeBenchWorker workers[PROBE_BENCH_THREADS];
+    pthread_t threads[PROBE_BENCH_THREADS];
+    MonitorProbeEngine engine;
+    size_t id = 0;
+
+    if (monitor_probe_engine_init(&engine, &limits, NULL) != MONITOR_STATUS_OK ||
+        monitor_probe_prepare(&engine, "true", &id) != MONITOR_STATUS_OK) {
+        printf("%-32s unavailable\n", "probe_launch");
+        return;
+    }
+
+    for (size_t threads_used = 1; threads_used <= PROBE_BENCH_THREADS; threads_used *= PROBE_BENCH_THREADS) {
+        char label[64];
+        int failures = 0;
+
+        long long start = bench_now_ns();
+        for (size_t t = 0; t < threads_used; t++) {
+            workers[t] = (ProbeBenchWorker){&engine, id, PROBE_BENCH_LAUNCHES / (int)threads_used, 0};
+            pthread_create(&threads[t], NULL, probe_bench_worker, &workers[t]);
+        }
+        for (size_t t = 0; t < threads_used; t++) {
+            pthread_join(threads[t], NULL);
+            failures += workers[t].failures;
+        }
+        long long elapsed = bench_now_ns() - start;
+
+        snprintf(label, sizeof(label), "probe_launch_%zu_thread%s", threads_used, threads_used == 1 ? "" : "s");
+        report(label, elapsed, PROBE_BENCH_LAUNCHES, "spawn");
+        printf("%-32s %12.0f launches/s (target %d/s)%s\n",
+               "",
+               (double)PROBE_BENCH_LAUNCHES * 1e9 / (double)elapsed,
+               PROBE_BENCH_TARGET_PER_SECOND,
+               failures > 0 ? ", some launches failed" : "");
+    }
+
+    static MonitorProbeResult result;
+    monitor_probe_run_shared(&engine, id, 1000, 60000, &result);
+    long long start = bench_now_ns();
+    for (int i = 0; i < PROBE_BENCH_CACHE_HITS; i++) {
+        monitor_probe_run_shared(&engine, id, 1000, 60000, &result);
+    }
+    report("probe_cache_hit", bench_now_ns() - start, PROBE_BENCH_CACHE_HITS, "call");
+    monitor_probe_engine_free(&engine);
+}
+
+int main(void) {
+    printf("Server Health Monitor benchmarks\n");
+    bench_alert_engine();
+    bench_logger();
+    bench_output_format(MONITOR_OUTPUT_JSON, "output_json_batched");
+    bench_output_format(MONITOR_OUTPUT_CSV, "output_csv_batched");
+    bench_cgroup_collector();
+    bench_meminfo();
+    bench_profile_scope();
+    bench_config_reload();
+    bench_config_file();
+    bench_shm_contention();
+    bench_read_tick();
+    bench_rollup();
+    bench_sparkline_frame();
+    bench_thread_sampling();
+    bench_anomaly_replay();
+    bench_probe_launches();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,346 @@
+// End-to-end checks of the server_monitor binary, run by integration_test.cpp.
+#include "integration_test.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef SERVER_MONITOR_PATH
+#define SERVER_MONITOR_PATH "./server_monitor"
+#endif
+
+namespace {
+
+struct CommandResult {
+    int exit_code = -1;
+    std::string output;
+};
+
+// Runs a shell command with stderr folded into stdout.
+CommandResult run_command(const std::string& command) {
+    CommandResult result;
+    FILE* pipe = popen((command + " 2>&1").c_str(), "r");
+    if (!pipe) {
+        throw std::runtime_error("popen failed: " + command);
+    }
+
+    char buffer[4096];
+    size_t length = 0;
+    while ((length = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        result.output.append(buffer, length);
+    }
+    int status = pclose(pipe);
+    result.exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    return result;
+}
+
+std::string monitor(const std::string& arguments) {
+    return std::string(SERVER_MONITOR_PATH) + " " + arguments;
+}
+
+size_t count_lines_containing(const std::string& text, const std::string& needle) {
+    std::istringstream lines(text);
+    size_t count = 0;
+    for (std::string line; std::getline(lines, line);) {
+        if (line.find(needle) != std::string::npos) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool contains(const std::string& text, const std::string& needle) {
+    return text.find(needle) != std::string::npos;
+}
+
+std::string read_file(const std::string& path) {
+    std::ifstream file(path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+void add_cli_suite(IntegrationTestRunner& runner) {
+    runner.add_test_suite("cli", nullptr, nullptr, {
+        {"help_lists_options", []() {
+            CommandResult result = run_command(monitor("--help"));
+            return result.exit_code == 0 && contains(result.output, "--iterations") &&
+                   contains(result.output, "--syscall-bench");
+        }},
+        {"json_emits_one_record_per_iteration", []() {
+            CommandResult result = run_command(monitor("--iterations 3 --interval-ms 100 --format json"));
+            bool passed = result.exit_code == 0 && count_lines_containing(result.output, "{\"timestamp_ms\"") == 3;
+            if (!passed) {
+                IntegrationTestRunner::output() << result.output;
+            }
+            return passed;
+        }},
+        {"json_logs_alert_transitions", []() {
+            // RAM use is above 2% on any host, so the RAM rule goes CRITICAL on the first sample.
+            CommandResult result = run_command(
+                monitor("--iterations 2 --interval-ms 100 --format json --warning-percent 1 --critical-percent 2 "
+                        "--hysteresis-percent 0"));
+            bool passed =
+                result.exit_code == 0 && count_lines_containing(result.output, "Alert: RAM CRITICAL (was OK)") == 1;
+            if (!passed) {
+                IntegrationTestRunner::output() << result.output;
+            }
+            return passed;
+        }},
+        {"rejects_unknown_flags", []() {
+            CommandResult result = run_command(monitor("--no-such-flag"));
+            return result.exit_code != 0 && contains(result.output, "unknown argument");
+        }},
+    });
+}
+
+// Settings come from an INI file written by setup into a private directory.
+void add_config_file_suite(IntegrationTestRunner& runner) {
+    static std::string directory;
+    static std::string config_path;
+
+    runner.add_test_suite("config_file", []() {
+        char pattern[] = "/tmp/shm-integration-XXXXXX";
+        if (!mkdtemp(pattern)) {
+            throw std::runtime_error(std::string("mkdtemp: ") + std::strerror(errno));
+        }
+        directory = pattern;
+        config_path = directory + "/monitor.ini";
+        std::ofstream(config_path) << "[monitor]\niterations = 2\ninterval_ms = 100\noutput_format = csv\n";
+    }, []() {
+        std::remove(config_path.c_str());
+        rmdir(directory.c_str());
+    }, {
+        {"csv_rows_follow_file_settings", []() {
+            CommandResult result = run_command(monitor("--config " + config_path));
+            bool passed = result.exit_code == 0 && count_lines_containing(result.output, "timestamp_ms,") == 1 &&
+                          count_lines_containing(result.output, ",local,") == 2;
+            if (!passed) {
+                IntegrationTestRunner::output() << result.output;
+            }
+            return passed;
+        }},
+        {"flags_override_the_file", []() {
+            CommandResult result = run_command(monitor("--config " + config_path + " --iterations 1"));
+            return result.exit_code == 0 && count_lines_containing(result.output, ",local,") == 1;
+        }},
+        {"invalid_values_are_rejected", []() {
+            std::ofstream(directory + "/bad.ini") << "[monitor]\ninterval_ms = soon\n";
+            CommandResult result = run_command(monitor("--config " + directory + "/bad.ini --iterations 1"));
+            std::remove((directory + "/bad.ini").c_str());
+            return result.exit_code != 0;
+        }},
+    });
+}
+
+// --proc-root points the collectors at a fixture whose stat is a directory, so every read of it fails.
+void add_collector_errors_suite(IntegrationTestRunner& runner) {
+    static std::string directory;
+
+    runner.add_test_suite("collector_errors", []() {
+        char pattern[] = "/tmp/shm-proc-XXXXXX";
+        if (!mkdtemp(pattern)) {
+            throw std::runtime_error(std::string("mkdtemp: ") + std::strerror(errno));
+        }
+        directory = pattern;
+        if (mkdir((directory + "/stat").c_str(), 0700) != 0) {
+            throw std::runtime_error(std::string("mkdir: ") + std::strerror(errno));
+        }
+        std::ofstream(directory + "/meminfo") << read_file("/proc/meminfo");
+    }, []() {
+        rmdir((directory + "/stat").c_str());
+        std::remove((directory + "/meminfo").c_str());
+        rmdir(directory.c_str());
+    }, {
+        {"failed_ticks_are_skipped", []() {
+            CommandResult result =
+                run_command(monitor("--proc-root " + directory + " --iterations 3 --interval-ms 100 --format csv"));
+            std::string failure = "Collector failing: cpu: I/O error in " + directory + "/stat: ";
+            bool passed = result.exit_code == 0 && count_lines_containing(result.output, failure) == 1 &&
+                          count_lines_containing(result.output, ",local,") == 0 &&
+                          contains(result.output, "Collector errors (3 ticks skipped)");
+            if (!passed) {
+                IntegrationTestRunner::output() << result.output;
+            }
+            return passed;
+        }},
+        {"ten_failed_ticks_in_a_row_end_the_run", []() {
+            CommandResult result =
+                run_command(monitor("--proc-root " + directory + " --iterations 12 --interval-ms 100 --format csv"));
+            // The final error still carries the failing file: the give-up path keeps its context.
+            std::string failure = "I/O error in " + directory + "/stat: ";
+            bool passed = result.exit_code != 0 &&
+                          contains(result.output, "Giving up after 10 failed ticks in a row.") &&
+                          count_lines_containing(result.output, failure) == 2;
+            if (!passed) {
+                IntegrationTestRunner::output() << result.output;
+            }
+            return passed;
+        }},
+    });
+}
+
+// One daemon is started by setup and shared by the suite's tests; teardown stops it.
+void add_daemon_suite(IntegrationTestRunner& runner) {
+    static pid_t daemon_pid = -1;
+    static int samples_fd = -1;
+    static std::string log_path;
+
+    runner.add_test_suite("daemon", []() {
+        char pattern[] = "/tmp/shm-daemon-log-XXXXXX";
+        // Close-on-exec, so commands other suites start meanwhile do not hold the daemon's pipe open.
+        int log_fd = mkostemp(pattern, O_CLOEXEC);
+        int pipe_fds[2];
+        if (log_fd < 0 || pipe2(pipe_fds, O_CLOEXEC) != 0) {
+            throw std::runtime_error(std::string("daemon setup: ") + std::strerror(errno));
+        }
+        log_path = pattern;
+
+        daemon_pid = fork();
+        if (daemon_pid < 0) {
+            throw std::runtime_error(std::string("fork: ") + std::strerror(errno));
+        }
+        if (daemon_pid == 0) {
+            dup2(pipe_fds[1], STDOUT_FILENO);
+            dup2(log_fd, STDERR_FILENO);
+            close(pipe_fds[0]);
+            close(pipe_fds[1]);
+            close(log_fd);
+            // RAM use is above 2% on any host, so the RAM alert is CRITICAL from the first sample.
+            execl(SERVER_MONITOR_PATH, SERVER_MONITOR_PATH, "--daemon", "--format", "json", "--interval-ms", "100",
+                  "--warning-percent", "1", "--critical-percent", "2", "--hysteresis-percent", "0",
+                  static_cast<char*>(nullptr));
+            _exit(127);
+        }
+        close(pipe_fds[1]);
+        close(log_fd);
+        samples_fd = pipe_fds[0];
+    }, []() {
+        if (daemon_pid > 0) {
+            kill(daemon_pid, SIGTERM);
+            int status = 0;
+            waitpid(daemon_pid, &status, 0);
+            daemon_pid = -1;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                IntegrationTestRunner::output() << read_file(log_path);
+                throw std::runtime_error("daemon did not exit cleanly on SIGTERM");
+            }
+        }
+        close(samples_fd);
+        std::remove(log_path.c_str());
+    }, {
+        {"streams_json_samples", []() {
+            std::string received;
+            char buffer[1024];
+            while (count_lines_containing(received, "{\"timestamp_ms\"") < 3) {
+                ssize_t length = read(samples_fd, buffer, sizeof(buffer));
+                if (length <= 0) {
+                    return false;
+                }
+                received.append(buffer, static_cast<size_t>(length));
+            }
+            return true;
+        }},
+        {"sigusr1_prints_a_report", []() {
+            kill(daemon_pid, SIGUSR1);
+            for (int attempt = 0; attempt < 50; attempt++) {
+                if (contains(read_file(log_path), "Percentile Report")) {
+                    return true;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            IntegrationTestRunner::output() << read_file(log_path);
+            return false;
+        }},
+        {"sighup_keeps_active_alerts", []() {
+            std::string log = read_file(log_path);
+            for (int attempt = 0; attempt < 50 && !contains(log, "Alert: RAM CRITICAL"); attempt++) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                log = read_file(log_path);
+            }
+            kill(daemon_pid, SIGHUP);
+            for (int attempt = 0; attempt < 50 && !contains(log, "Configuration reloaded"); attempt++) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                log = read_file(log_path);
+            }
+            // A few ticks after the reload the alert is still the one raised before it.
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            log = read_file(log_path);
+            bool passed = contains(log, "Configuration reloaded") &&
+                          count_lines_containing(log, "Alert: RAM CRITICAL (was OK)") == 1 &&
+                          count_lines_containing(log, "Alert: RAM OK") == 0;
+            if (!passed) {
+                IntegrationTestRunner::output() << log;
+            }
+            return passed;
+        }},
+    });
+}
+
+void print_usage(const char* program) {
+    std::printf("Usage: %s [--jobs N] [--timeout-ms MS] [--filter SUITE/TEST]\n", program);
+}
+
+/* A whole number from min to 1000000, as the C runner accepts for its counts. */
+bool parse_count(const char* text, long min, long& out) {
+    char* end = nullptr;
+    errno = 0;
+    long value = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || value < min || value > 1000000) {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    IntegrationRunOptions options;
+    options.timeout = std::chrono::milliseconds(30000);
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        long value = 0;
+        if ((arg == "--jobs" || arg == "-j") && i + 1 < argc) {
+            if (!parse_count(argv[++i], 1, value)) {
+                std::fprintf(stderr, "%s expects a positive count\n", arg.c_str());
+                print_usage(argv[0]);
+                return 2;
+            }
+            options.jobs = static_cast<unsigned>(value);
+        } else if (arg == "--timeout-ms" && i + 1 < argc) {
+            if (!parse_count(argv[++i], 1, value)) {
+                std::fprintf(stderr, "%s expects milliseconds\n", arg.c_str());
+                print_usage(argv[0]);
+                return 2;
+            }
+            options.timeout = std::chrono::milliseconds(value);
+        } else if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 2;
+        }
+    }
+
+    IntegrationTestRunner& runner = IntegrationTestRunner::instance();
+    add_cli_suite(runner);
+    add_config_file_suite(runner);
+    add_collector_errors_suite(runner);
+    add_daemon_suite(runner);
+    return runner.run_all_tests(options) ? 0 : 1;
+}
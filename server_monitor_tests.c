@@ -1,4 +1,35 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "monitor_alert.h"
+#include "monitor_anomaly.h"
+#include "monitor_arena.h"
+#include "monitor_cgroup.h"
 #include "monitor_config.h"
+#include "monitor_config_file.h"
+#include "monitor_daemon.h"
+#include "monitor_format.h"
+#include "monitor_log.h"
+#include "monitor_probe.h"
+#include "monitor_profile.h"
+#include "monitor_read_batch.h"
+#include "monitor_rollup.h"
+#include "monitor_shm.h"
+#include "monitor_sketch.h"
+#include "monitor_sparkline.h"
+#include "monitor_threads.h"
+#include "mem_test.h"
+#include "syscall_test.h"
 #include "test_framework.h"
 
 TEST_CASE(parse_int_range_accepts_valid) {
@@ -32,14 +63,1892 @@ TEST_CASE(config_validation_enforces_duration) {
     return TEST_PASSED;
 }
 
-int main(void) {
+TEST_CASE(sketch_quantiles_within_relative_accuracy) {
+    QuantileSketch sketch;
+    double value = 0.0;
+
+    monitor_sketch_init(&sketch);
+    for (int i = 1; i <= 1000; i++) {
+        monitor_sketch_add(&sketch, (double)i / 10.0);
+    }
+
+    ASSERT(monitor_sketch_quantile(&sketch, 0.5, &value) == MONITOR_STATUS_OK);
+    ASSERT(fabs(value - 50.0) <= 50.0 * 0.02);
+    ASSERT(monitor_sketch_quantile(&sketch, 0.99, &value) == MONITOR_STATUS_OK);
+    ASSERT(fabs(value - 99.0) <= 99.0 * 0.02);
+    ASSERT(monitor_sketch_quantile(&sketch, 1.0, &value) == MONITOR_STATUS_OK);
+    ASSERT(value == 100.0);
+
+    monitor_sketch_add(&sketch, INFINITY);
+    monitor_sketch_add(&sketch, -INFINITY);
+    monitor_sketch_add(&sketch, NAN);
+    ASSERT(sketch.count == 1000 && sketch.max == 100.0 && sketch.min == 0.1);
+    ASSERT(monitor_sketch_quantile(&sketch, 1.0, &value) == MONITOR_STATUS_OK);
+    ASSERT(value == 100.0);
+    return TEST_PASSED;
+}
+
+BENCH_CASE(sketch_add) {
+    static QuantileSketch sketch;
+
+    monitor_sketch_init(&sketch);
+    bench_reset_timer(bench);
+    for (uint64_t i = 0; i < bench->iterations; i++) {
+        monitor_sketch_add(&sketch, 0.5 + (double)(i % 1000) * 0.1);
+    }
+    BENCH_KEEP(sketch);
+}
+
+TEST_CASE(sketch_merge_matches_single_stream) {
+    static QuantileSketch left;
+    static QuantileSketch right;
+    static QuantileSketch combined;
+    double merged_p90 = 0.0;
+    double combined_p90 = 0.0;
+
+    monitor_sketch_init(&left);
+    monitor_sketch_init(&right);
+    monitor_sketch_init(&combined);
+    for (int i = 0; i < 500; i++) {
+        monitor_sketch_add(&left, (double)i);
+        monitor_sketch_add(&right, (double)(i + 500));
+        monitor_sketch_add(&combined, (double)i);
+        monitor_sketch_add(&combined, (double)(i + 500));
+    }
+
+    ASSERT(monitor_sketch_merge(&left, &right) == MONITOR_STATUS_OK);
+    ASSERT(left.count == combined.count);
+    ASSERT(monitor_sketch_quantile(&left, 0.9, &merged_p90) == MONITOR_STATUS_OK);
+    ASSERT(monitor_sketch_quantile(&combined, 0.9, &combined_p90) == MONITOR_STATUS_OK);
+    ASSERT(merged_p90 == combined_p90);
+    return TEST_PASSED;
+}
+
+TEST_CASE(sketch_encode_round_trips) {
+    static QuantileSketch original;
+    static QuantileSketch decoded;
+    static unsigned char buffer[MONITOR_SKETCH_ENCODED_MAX_SIZE];
+    double expected = 0.0;
+    double actual = 0.0;
+
+    monitor_sketch_init(&original);
+    for (int i = 0; i < 100; i++) {
+        monitor_sketch_add(&original, (double)(i % 7) * 12.5);
+    }
+
+    size_t size = monitor_sketch_encode(&original, buffer, sizeof(buffer));
+    ASSERT(size > 0);
+    ASSERT(monitor_sketch_decode(&decoded, buffer, size) == MONITOR_STATUS_OK);
+    ASSERT(monitor_sketch_quantile(&original, 0.5, &expected) == MONITOR_STATUS_OK);
+    ASSERT(monitor_sketch_quantile(&decoded, 0.5, &actual) == MONITOR_STATUS_OK);
+    ASSERT(expected == actual);
+    ASSERT(monitor_sketch_decode(&decoded, buffer, 10) == MONITOR_STATUS_PARSE_ERROR);
+
+    // Byte 8 is the low byte of the little-endian count; the bins no longer add up to it.
+    buffer[8] = (unsigned char)(buffer[8] - 1U);
+    ASSERT(monitor_sketch_decode(&decoded, buffer, size) == MONITOR_STATUS_PARSE_ERROR);
+    buffer[8] = (unsigned char)(buffer[8] + 2U);
+    ASSERT(monitor_sketch_decode(&decoded, buffer, size) == MONITOR_STATUS_PARSE_ERROR);
+    return TEST_PASSED;
+}
+
+TEST_CASE(sketch_count_saturates_with_bins) {
+    static QuantileSketch left;
+    static QuantileSketch right;
+    static unsigned char buffer[MONITOR_SKETCH_ENCODED_MAX_SIZE];
+    static QuantileSketch decoded;
+
+    monitor_sketch_init(&left);
+    monitor_sketch_add(&left, 5.0);
+    for (size_t i = 0; i < MONITOR_SKETCH_BIN_COUNT; i++) {
+        if (left.bins[i] != 0) {
+            left.bins[i] = UINT32_MAX - 1U;
+        }
+    }
+    left.count = UINT32_MAX - 1U;
+
+    monitor_sketch_add(&left, 5.0);
+    monitor_sketch_add(&left, 5.0);
+    monitor_sketch_add(&left, 0.0);
+    ASSERT(left.count == (uint64_t)UINT32_MAX + 1U && left.zero_count == 1);
+
+    monitor_sketch_init(&right);
+    for (int i = 0; i < 3; i++) {
+        monitor_sketch_add(&right, 5.0);
+    }
+    monitor_sketch_add(&right, 50.0);
+    ASSERT(monitor_sketch_merge(&left, &right) == MONITOR_STATUS_OK);
+    ASSERT(left.count == (uint64_t)UINT32_MAX + 2U);
+
+    size_t size = monitor_sketch_encode(&left, buffer, sizeof(buffer));
+    ASSERT(size > 0);
+    ASSERT(monitor_sketch_decode(&decoded, buffer, size) == MONITOR_STATUS_OK);
+    ASSERT(decoded.count == left.count);
+    return TEST_PASSED;
+}
+
+TEST_CASE(rollup_tiers_answer_from_covering_tier) {
+    static MetricRollup rollup;
+    static RollupBucket buckets[1000];
+    const int64_t end = 7200000;
+    RollupBucket summary;
+    MonitorRollupTier tier = MONITOR_ROLLUP_RAW;
+    size_t count = 0;
+
+    /* Two hours at 100 ms; the value cycles 0..599 once a minute. */
+    monitor_rollup_init(&rollup);
+    for (int64_t i = 0; i < end / 100; i++) {
+        ASSERT(monitor_rollup_add(&rollup, i * 100, (double)(i % 600)) == MONITOR_STATUS_OK);
+    }
+    ASSERT(monitor_rollup_add(&rollup, end - 200, 1.0) == MONITOR_STATUS_RANGE_ERROR);
+    ASSERT(monitor_rollup_add(&rollup, end, NAN) == MONITOR_STATUS_INVALID_ARGUMENT);
+
+    ASSERT(monitor_rollup_query(&rollup, end - 30000, end, buckets, 1000, &count, &tier) == MONITOR_STATUS_OK);
+    ASSERT(tier == MONITOR_ROLLUP_RAW && count == 300 && buckets[0].start_ms == end - 30000);
+
+    /* The raw tier only holds six minutes, so half an hour comes from 10 s buckets. */
+    ASSERT(monitor_rollup_query(&rollup, end - 1800000, end, buckets, 1000, &count, &tier) == MONITOR_STATUS_OK);
+    ASSERT(tier == MONITOR_ROLLUP_10S && count == 180 && buckets[0].count == 100);
+
+    ASSERT(monitor_rollup_query(&rollup, 0, end, buckets, 1000, &count, &tier) == MONITOR_STATUS_OK);
+    ASSERT(tier == MONITOR_ROLLUP_1M && count == 120);
+    ASSERT(buckets[0].min == 0.0 && buckets[0].max == 599.0 && buckets[0].count == 600);
+
+    ASSERT(monitor_rollup_query(&rollup, 0, end, buckets, 1, &count, &tier) == MONITOR_STATUS_RANGE_ERROR);
+    ASSERT(tier == MONITOR_ROLLUP_1H && count == 1 && buckets[0].start_ms == 3600000);
+
+    ASSERT(monitor_rollup_summarize(&rollup, 0, end, &summary, &tier) == MONITOR_STATUS_OK);
+    ASSERT(tier == MONITOR_ROLLUP_1M && summary.count == 72000 && summary.sum / 72000.0 == 299.5);
+    ASSERT(monitor_rollup_summarize(&rollup, end - 60000, end, &summary, &tier) == MONITOR_STATUS_OK);
+    ASSERT(tier == MONITOR_ROLLUP_RAW && summary.count == 600 && summary.max == 599.0);
+    ASSERT(monitor_rollup_summarize(&rollup, end, end + 1000, &summary, NULL) == MONITOR_STATUS_RANGE_ERROR);
+    return TEST_PASSED;
+}
+
+TEST_CASE(sparkline_panel_renders_recent_history) {
+    static HistoryRing cpu;
+    static HistoryRing empty;
+    char line[64];
+    char panel[512];
+    HistoryStats stats;
+
+    monitor_history_init(&cpu);
+    monitor_history_init(&empty);
+    for (int i = 0; i < MONITOR_HISTORY_CAPACITY + 44; i++) {
+        monitor_history_push(&cpu, (double)i);
+    }
+    ASSERT(cpu.count == MONITOR_HISTORY_CAPACITY);
+    ASSERT(monitor_history_stats(&cpu, 10, &stats) == MONITOR_STATUS_OK);
+    ASSERT(stats.count == 10 && stats.min == 290.0 && stats.max == 299.0 && stats.avg == 294.5);
+    ASSERT(monitor_history_stats(&empty, 10, &stats) == MONITOR_STATUS_RANGE_ERROR);
+
+    monitor_history_push(&cpu, 0.0);
+    monitor_history_push(&cpu, 50.0);
+    monitor_history_push(&cpu, 100.0);
+    ASSERT(monitor_sparkline_render(&cpu, 3, 0.0, 100.0, MONITOR_SPARKLINE_ASCII, line, sizeof(line)) == 3);
+    ASSERT(memcmp(line, "_=#", 3) == 0);
+    ASSERT(monitor_sparkline_render(&cpu, 3, 0.0, 100.0, MONITOR_SPARKLINE_UTF8, line, sizeof(line)) == 9);
+    ASSERT(memcmp(line, "\xe2\x96\x81\xe2\x96\x85\xe2\x96\x88", 9) == 0);
+    ASSERT(monitor_sparkline_render(&cpu, 3, 0.0, 100.0, MONITOR_SPARKLINE_UTF8, line, 8) == 0);
+
+    /* Label, 10 glyphs and the statistics fill exactly 61 columns; an empty history draws blanks. */
+    const SparklineRow rows[] = {{"CPU Usage", &cpu, 0.0, 100.0}, {"Idle", &empty, 0.0, 0.0}};
+    size_t length = monitor_sparkline_panel(rows, 2, 61, MONITOR_SPARKLINE_ASCII, panel, sizeof(panel));
+    ASSERT(length == 2 * 62 && panel[61] == '\n' && panel[length] == '\0');
+    ASSERT(strncmp(panel, "CPU Usage      ", 15) == 0);
+    ASSERT(strncmp(panel + 15, "#######_=# min    0.00 avg  222.20 max  299.00\n", 47) == 0);
+    ASSERT(strncmp(panel + 62, "Idle           ", 15) == 0);
+    ASSERT(monitor_sparkline_panel(rows, 2, 51, MONITOR_SPARKLINE_ASCII, panel, sizeof(panel)) == 0);
+    return TEST_PASSED;
+}
+
+BENCH_CASE(sparkline_render_utf8) {
+    static HistoryRing history;
+    char line[3 * MONITOR_HISTORY_CAPACITY];
+
+    monitor_history_init(&history);
+    for (int i = 0; i < MONITOR_HISTORY_CAPACITY; i++) {
+        monitor_history_push(&history, (double)(i % 100));
+    }
+    bench_reset_timer(bench);
+    for (uint64_t i = 0; i < bench->iterations; i++) {
+        size_t length = monitor_sparkline_render(&history,
+                                                 MONITOR_HISTORY_CAPACITY,
+                                                 0.0,
+                                                 100.0,
+                                                 MONITOR_SPARKLINE_UTF8,
+                                                 line,
+                                                 sizeof(line));
+        BENCH_KEEP(length);
+    }
+}
+
+TEST_CASE(alert_hysteresis_suppresses_flapping) {
+    AlertEngine engine;
+    AlertEvent events[4];
+    AlertRule rule = {0, 75.0, 90.0, 5.0, 0, 0};
+    double value = 0.0;
+
+    ASSERT(monitor_alert_engine_init(&engine, 1) == MONITOR_STATUS_OK);
+    ASSERT(monitor_alert_engine_add_rule(&engine, &rule, NULL) == MONITOR_STATUS_OK);
+
+    value = 91.0;
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 0, events, 4) == 1);
+    ASSERT(events[0].level == ALERT_LEVEL_CRITICAL);
+
+    value = 89.0;
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 100, events, 4) == 0);
+    ASSERT(monitor_alert_engine_level(&engine, 0) == ALERT_LEVEL_CRITICAL);
+
+    value = 84.0;
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 200, events, 4) == 1);
+    ASSERT(events[0].level == ALERT_LEVEL_WARNING);
+
+    monitor_alert_engine_free(&engine);
+    return TEST_PASSED;
+}
+
+TEST_CASE(alert_for_window_and_rate_limit) {
+    AlertEngine engine;
+    AlertEvent events[4];
+    AlertRule rule = {0, 75.0, 90.0, 0.0, 1000, 5000};
+    double value = 95.0;
+
+    ASSERT(monitor_alert_engine_init(&engine, 1) == MONITOR_STATUS_OK);
+    ASSERT(monitor_alert_engine_add_rule(&engine, &rule, NULL) == MONITOR_STATUS_OK);
+
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 0, events, 4) == 0);
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 500, events, 4) == 0);
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 1000, events, 4) == 1);
+
+    value = 10.0;
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 1100, events, 4) == 0);
+    ASSERT(monitor_alert_engine_level(&engine, 0) == ALERT_LEVEL_OK);
+    ASSERT(engine.suppressed_notifications == 1);
+
+    /* The recovery is reported once the window reopens, and only once. */
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 5999, events, 4) == 0);
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 6000, events, 4) == 1);
+    ASSERT(events[0].previous_level == ALERT_LEVEL_CRITICAL && events[0].level == ALERT_LEVEL_OK);
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 20000, events, 4) == 0);
+
+    monitor_alert_engine_free(&engine);
+    return TEST_PASSED;
+}
+
+TEST_CASE(alert_for_window_survives_oscillation_across_critical) {
+    AlertEngine engine;
+    AlertEvent events[4];
+    AlertRule rule = {0, 75.0, 90.0, 0.0, 1000, 0};
+    double value = 0.0;
+    size_t emitted = 0;
+
+    ASSERT(monitor_alert_engine_init(&engine, 1) == MONITOR_STATUS_OK);
+    ASSERT(monitor_alert_engine_add_rule(&engine, &rule, NULL) == MONITOR_STATUS_OK);
+
+    /* Swinging 85 <-> 92 is above WARNING the whole time but never CRITICAL for 1000 ms. */
+    for (long long now = 0; now <= 3000; now += 250) {
+        value = (now / 250) % 2 == 0 ? 85.0 : 92.0;
+        size_t count = monitor_alert_engine_evaluate(&engine, &value, 1, now, events, 4);
+        if (now < 1000) {
+            ASSERT(count == 0);
+        } else if (now == 1000) {
+            ASSERT(count == 1 && events[0].level == ALERT_LEVEL_WARNING);
+        }
+        emitted += count;
+    }
+    ASSERT(emitted == 1 && monitor_alert_engine_level(&engine, 0) == ALERT_LEVEL_WARNING);
+
+    /* Held above CRITICAL, it escalates once that level's own window has elapsed. */
+    value = 92.0;
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 3250, events, 4) == 0);
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 4249, events, 4) == 0);
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 4250, events, 4) == 1);
+    ASSERT(events[0].previous_level == ALERT_LEVEL_WARNING && events[0].level == ALERT_LEVEL_CRITICAL);
+
+    /* From OK, a CRITICAL that started mid-window still waits its own for_ms after WARNING fires. */
+    monitor_alert_engine_reset(&engine);
+    value = 80.0;
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 0, events, 4) == 0);
+    value = 95.0;
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 500, events, 4) == 0);
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 1000, events, 4) == 1);
+    ASSERT(events[0].level == ALERT_LEVEL_WARNING);
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 1499, events, 4) == 0);
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 1500, events, 4) == 1);
+    ASSERT(events[0].level == ALERT_LEVEL_CRITICAL);
+
+    monitor_alert_engine_free(&engine);
+    return TEST_PASSED;
+}
+
+TEST_CASE(alert_state_carries_into_a_rebuilt_engine) {
+    AlertEngine before;
+    AlertEngine after;
+    AlertEvent events[4];
+    AlertRule rule = {0, 75.0, 90.0, 5.0, 0, 0};
+    AlertRule other_metric = {1, 75.0, 90.0, 5.0, 0, 0};
+    double value = 95.0;
+
+    ASSERT(monitor_alert_engine_init(&before, 1) == MONITOR_STATUS_OK);
+    ASSERT(monitor_alert_engine_add_rule(&before, &rule, NULL) == MONITOR_STATUS_OK);
+    ASSERT(monitor_alert_engine_evaluate(&before, &value, 1, 0, events, 4) == 1);
+
+    /* A reload rebuilds the rules; an active CRITICAL continues instead of firing again. */
+    rule.warning_threshold = 70.0;
+    ASSERT(monitor_alert_engine_init(&after, 2) == MONITOR_STATUS_OK);
+    ASSERT(monitor_alert_engine_add_rule(&after, &rule, NULL) == MONITOR_STATUS_OK);
+    ASSERT(monitor_alert_engine_add_rule(&after, &other_metric, NULL) == MONITOR_STATUS_OK);
+    ASSERT(monitor_alert_engine_carry_state(&after, 0, &before, 0) == MONITOR_STATUS_OK);
+    ASSERT(monitor_alert_engine_carry_state(&after, 1, &before, 0) == MONITOR_STATUS_UNSUPPORTED);
+    ASSERT(monitor_alert_engine_carry_state(&after, 2, &before, 0) == MONITOR_STATUS_INVALID_ARGUMENT);
+    ASSERT(monitor_alert_engine_level(&after, 0) == ALERT_LEVEL_CRITICAL);
+    ASSERT(monitor_alert_engine_level(&after, 1) == ALERT_LEVEL_OK);
+    ASSERT(monitor_alert_engine_evaluate(&after, &value, 1, 100, events, 4) == 0);
+
+    value = 10.0;
+    ASSERT(monitor_alert_engine_evaluate(&after, &value, 1, 200, events, 4) == 1);
+    ASSERT(events[0].previous_level == ALERT_LEVEL_CRITICAL && events[0].level == ALERT_LEVEL_OK);
+
+    monitor_alert_engine_free(&before);
+    monitor_alert_engine_free(&after);
+    return TEST_PASSED;
+}
+
+TEST_CASE(alert_defers_changes_inside_notify_window) {
+    AlertEngine engine;
+    AlertEvent events[4];
+    AlertRule rule = {0, 75.0, 90.0, 5.0, 0, 60000};
+    double value = 80.0;
+
+    ASSERT(monitor_alert_engine_init(&engine, 1) == MONITOR_STATUS_OK);
+    ASSERT(monitor_alert_engine_add_rule(&engine, &rule, NULL) == MONITOR_STATUS_OK);
+
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 0, events, 4) == 1);
+    ASSERT(events[0].level == ALERT_LEVEL_WARNING);
+
+    value = 95.0;
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 5000, events, 4) == 0);
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 30000, events, 4) == 0);
+    ASSERT(engine.suppressed_notifications == 1);
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 60000, events, 4) == 1);
+    ASSERT(events[0].previous_level == ALERT_LEVEL_WARNING && events[0].level == ALERT_LEVEL_CRITICAL);
+    ASSERT(events[0].value == 95.0);
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 120000, events, 4) == 0);
+
+    /* A change undone inside the window leaves nothing to report. */
+    value = 80.0;
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 70000, events, 4) == 0);
+    value = 95.0;
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 80000, events, 4) == 0);
+    ASSERT(monitor_alert_engine_evaluate(&engine, &value, 1, 200000, events, 4) == 0);
+    ASSERT(engine.suppressed_notifications == 2);
+
+    monitor_alert_engine_free(&engine);
+    return TEST_PASSED;
+}
+
+/* Deterministic noise in [-1, 1). */
+static double anomaly_noise(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return (double)(*state >> 8) / (double)(1u << 23) - 1.0;
+}
+
+TEST_CASE(anomaly_detector_flags_spikes_shifts_and_seasons) {
+    enum { PERIOD_SAMPLES = 240, BUMP_SLOT = 5 };
+    const int64_t step_ms = 1000;
+    char storage[2 * MONITOR_OUTPUT_MAX_RECORD_BYTES];
+    char line[512] = {0};
+    AnomalyDetector detector;
+    AnomalyParams params;
+    AnomalyEvent events[1];
+    OutputWriter writer;
+    uint32_t noise = 1;
+    int64_t now = 0;
+    double value = 0.0;
+    size_t count = 0;
+
+    monitor_anomaly_default_params(&params);
+    params.season_ms = PERIOD_SAMPLES * step_ms;
+    ASSERT(monitor_anomaly_init(&detector, 1, &params) == MONITOR_STATUS_OK);
+
+    /* A +20 bump in the same slot every period is flagged the first time only. */
+    unsigned long long first_period_anomalies = 0;
+    for (int period = 0; period < 4; period++) {
+        for (int i = 0; i < PERIOD_SAMPLES; i++) {
+            bool bump = i * MONITOR_ANOMALY_SEASON_SLOTS / PERIOD_SAMPLES == BUMP_SLOT;
+            value = 50.0 + anomaly_noise(&noise) + (bump ? 20.0 : 0.0);
+            count = monitor_anomaly_update(&detector, &value, 1, now, events, 1);
+            now += step_ms;
+            ASSERT(period == 0 || count == 0);
+        }
+        if (period == 0) {
+            first_period_anomalies = detector.anomalies;
+        }
+    }
+    ASSERT(first_period_anomalies >= 1 && detector.anomalies == first_period_anomalies);
+
+    value = 80.0;
+    ASSERT(monitor_anomaly_update(&detector, &value, 1, now, events, 1) == 1);
+    ASSERT(events[0].flags == ANOMALY_SPIKE && events[0].score > params.threshold);
+    ASSERT(fabs(events[0].expected - 50.0) < 2.0);
+    ASSERT(monitor_anomaly_flags(&detector, 0) == ANOMALY_SPIKE);
+    for (int i = 0; i < 3; i++) {
+        now += step_ms;
+        value = 50.0 + anomaly_noise(&noise);
+        ASSERT(monitor_anomaly_update(&detector, &value, 1, now, events, 1) == 0);
+    }
+
+    /* A sustained shift is flagged for a few samples, then becomes the new baseline. */
+    uint32_t shift_flags = ANOMALY_NONE;
+    for (int i = 0; i < 30; i++) {
+        now += step_ms;
+        value = 65.0 + anomaly_noise(&noise);
+        count = monitor_anomaly_update(&detector, &value, 1, now, events, 1);
+        ASSERT(i < 4 || count == 0);
+        shift_flags |= count > 0 ? events[0].flags : ANOMALY_NONE;
+    }
+    ASSERT(shift_flags & ANOMALY_SHIFT_UP);
+
+    value = NAN;
+    uint32_t samples = detector.models[0].samples;
+    ASSERT(monitor_anomaly_update(&detector, &value, 1, now, events, 1) == 0);
+    ASSERT(detector.models[0].samples == samples);
+    monitor_anomaly_reset(&detector);
+    ASSERT(detector.models[0].samples == 0 && detector.anomalies == 0);
+    monitor_anomaly_free(&detector);
+
+    AnomalyEvent spike = {MONITOR_METRIC_CPU_PERCENT, ANOMALY_SPIKE, 80.0, 50.0, 6.0};
+    HealthRecord record = {1000, "web", 80.0, 50.0, 1.5, 3.0, "OK", "OK", false, 0.0, 0.0, &spike, 1,
+                           false, 0, 0, 0};
+    FILE* sink = tmpfile();
+    ASSERT(sink != NULL);
+    ASSERT(monitor_output_init(&writer, storage, sizeof(storage), fileno(sink), MONITOR_OUTPUT_JSON, 1) ==
+           MONITOR_STATUS_OK);
+    ASSERT(monitor_output_write(&writer, &record) == MONITOR_STATUS_OK);
+    ASSERT(monitor_output_init(&writer, storage, sizeof(storage), fileno(sink), MONITOR_OUTPUT_CSV, 1) ==
+           MONITOR_STATUS_OK);
+    ASSERT(monitor_output_write(&writer, &record) == MONITOR_STATUS_OK);
+    rewind(sink);
+    ASSERT(fgets(line, sizeof(line), sink) != NULL);
+    ASSERT(strstr(line, ",\"anomalies\":[{\"metric\":\"cpu_percent\",\"kind\":\"spike\",\"expected\":50.00,"
+                        "\"z\":6.00}]}\n") != NULL);
+    ASSERT(fgets(line, sizeof(line), sink) != NULL && strstr(line, ",anomalies") != NULL);
+    ASSERT(fgets(line, sizeof(line), sink) != NULL);
+    ASSERT(strcmp(line, "1000,web,80.00,50.00,1.50,3.00,OK,OK,cpu_percent:spike\n") == 0);
+    fclose(sink);
+    return TEST_PASSED;
+}
+
+BENCH_CASE(anomaly_update_64_metrics) {
+    enum { METRICS = 64 };
+    AnomalyDetector detector;
+    AnomalyEvent events[METRICS];
+    double values[METRICS];
+    uint32_t noise = 1;
+
+    if (monitor_anomaly_init(&detector, METRICS, NULL) != MONITOR_STATUS_OK) {
+        return;
+    }
+    bench_reset_timer(bench);
+    for (uint64_t i = 0; i < bench->iterations; i++) {
+        for (size_t m = 0; m < METRICS; m++) {
+            values[m] = 50.0 + anomaly_noise(&noise);
+        }
+        size_t count = monitor_anomaly_update(&detector, values, METRICS, (int64_t)i * 1000, events, METRICS);
+        BENCH_KEEP(count);
+    }
+    monitor_anomaly_free(&detector);
+}
+
+TEST_CASE(log_records_render_as_json) {
+    char line[512] = {0};
+    FILE* sink = tmpfile();
+    ASSERT(sink != NULL);
+
+    monitor_log_set_streams(sink, sink);
+    monitor_log_set_format(MONITOR_LOG_FORMAT_JSON);
+    ASSERT(monitor_log_start() == MONITOR_STATUS_OK);
+
+    MonitorLogArg args[2] = {monitor_log_int(3), monitor_log_string("disk \"a\"")};
+    monitor_log_write(MONITOR_LOG_WARNING, "retry {} on {}", args, 2);
+    monitor_log_stop();
+
+    rewind(sink);
+    ASSERT(fgets(line, sizeof(line), sink) != NULL);
+    ASSERT(strstr(line, "\"level\":\"WARN\"") != NULL);
+    ASSERT(strstr(line, "\"msg\":\"retry 3 on disk \\\"a\\\"\"") != NULL);
+    ASSERT(strstr(line, "\"args\":[3,") != NULL);
+
+    monitor_log_set_streams(NULL, NULL);
+    monitor_log_set_format(MONITOR_LOG_FORMAT_TEXT);
+    fclose(sink);
+    return TEST_PASSED;
+}
+
+static void* log_one_record(void* arg) {
+    MonitorLogArg value = monitor_log_int((long long)(intptr_t)arg);
+    monitor_log_write(MONITOR_LOG_INFO, "worker {}", &value, 1);
+    return NULL;
+}
+
+TEST_CASE(log_rings_are_reused_after_thread_exit) {
+    enum { THREADS = 32 };
+    char line[256];
+    int lines = 0;
+    FILE* sink = tmpfile();
+    ASSERT(sink != NULL);
+
+    monitor_log_set_streams(sink, sink);
+    ASSERT(monitor_log_start() == MONITOR_STATUS_OK);
+    size_t rings_before = monitor_log_ring_count();
+    for (intptr_t i = 0; i < THREADS; i++) {
+        pthread_t thread;
+        ASSERT(pthread_create(&thread, NULL, log_one_record, (void*)i) == 0);
+        ASSERT(pthread_join(thread, NULL) == 0);
+    }
+    ASSERT(monitor_log_ring_count() <= rings_before + 1);
+    monitor_log_stop();
+
+    rewind(sink);
+    while (fgets(line, sizeof(line), sink)) {
+        lines += strstr(line, "[INFO] worker ") != NULL;
+    }
+    ASSERT(lines == THREADS);
+    ASSERT(monitor_log_dropped() == 0);
+
+    monitor_log_set_streams(NULL, NULL);
+    fclose(sink);
+    return TEST_PASSED;
+}
+
+TEST_CASE(format_fixed_rounds_without_printf) {
+    char out[32] = {0};
+    size_t length = monitor_format_fixed(out, sizeof(out), 12.345, 2);
+    ASSERT(length == 5 && memcmp(out, "12.35", 5) == 0);
+    length = monitor_format_fixed(out, sizeof(out), -0.004, 2);
+    ASSERT(length == 4 && memcmp(out, "0.00", 4) == 0);
+    length = monitor_format_fixed(out, sizeof(out), -7.5, 1);
+    ASSERT(length == 4 && memcmp(out, "-7.5", 4) == 0);
+    ASSERT(monitor_format_fixed(out, 3, 100.0, 2) == 0);
+    return TEST_PASSED;
+}
+
+BENCH_CASE(format_fixed_two_decimals) {
+    char out[32];
+    double value = 0.0;
+
+    for (uint64_t i = 0; i < bench->iterations; i++) {
+        size_t length = monitor_format_fixed(out, sizeof(out), value, 2);
+        BENCH_KEEP(length);
+        value += 0.37;
+    }
+}
+
+TEST_CASE(output_writer_renders_json_and_csv) {
+    char storage[2 * MONITOR_OUTPUT_MAX_RECORD_BYTES];
+    char line[512] = {0};
+    OutputWriter writer;
+    HealthRecord record = {1000, "web,\"1\"", 5.0, 50.125, 1.5, 3.0, "OK", "WARNING", false, 0.0, 0.0, NULL, 0,
+                           false, 0, 0, 0};
+    FILE* sink = tmpfile();
+    ASSERT(sink != NULL);
+
+    ASSERT(monitor_output_init(&writer, storage, sizeof(storage), fileno(sink), MONITOR_OUTPUT_JSON, 4) ==
+           MONITOR_STATUS_OK);
+    ASSERT(monitor_output_write(&writer, &record) == MONITOR_STATUS_OK);
+    ASSERT(writer.flushes == 0);
+
+    ASSERT(monitor_output_flush(&writer) == MONITOR_STATUS_OK);
+    ASSERT(monitor_output_init(&writer, storage, sizeof(storage), fileno(sink), MONITOR_OUTPUT_CSV, 1) ==
+           MONITOR_STATUS_OK);
+    ASSERT(monitor_output_write(&writer, &record) == MONITOR_STATUS_OK);
+
+    rewind(sink);
+    ASSERT(fgets(line, sizeof(line), sink) != NULL);
+    ASSERT(strcmp(line, "{\"timestamp_ms\":1000,\"server\":\"web,\\\"1\\\"\",\"cpu_percent\":5.00,"
+                        "\"ram_percent\":50.13,\"ram_used_gb\":1.50,\"ram_total_gb\":3.00,"
+                        "\"cpu_alert\":\"OK\",\"ram_alert\":\"WARNING\"}\n") == 0);
+    ASSERT(fgets(line, sizeof(line), sink) != NULL);
+    ASSERT(strncmp(line, "timestamp_ms,server,", 20) == 0);
+    ASSERT(fgets(line, sizeof(line), sink) != NULL);
+    ASSERT(strcmp(line, "1000,\"web,\"\"1\"\"\",5.00,50.13,1.50,3.00,OK,WARNING,\n") == 0);
+
+    /* Optional column groups: self stats, then the probe cache counters. */
+    record.has_self_stats = true;
+    record.self_collect_us = 12.5;
+    record.self_tick_us = 40.0;
+    record.has_probe_cache = true;
+    record.probe_cache_hits = 7;
+    record.probe_cache_misses = 3;
+    record.probe_coalesced = 18446744073709551615ULL;
+    fclose(sink);
+    sink = tmpfile();
+    ASSERT(sink != NULL);
+    ASSERT(monitor_output_init(&writer, storage, sizeof(storage), fileno(sink), MONITOR_OUTPUT_JSON, 1) ==
+           MONITOR_STATUS_OK);
+    ASSERT(monitor_output_write(&writer, &record) == MONITOR_STATUS_OK);
+    ASSERT(monitor_output_init(&writer, storage, sizeof(storage), fileno(sink), MONITOR_OUTPUT_CSV, 1) ==
+           MONITOR_STATUS_OK);
+    ASSERT(monitor_output_write(&writer, &record) == MONITOR_STATUS_OK);
+
+    rewind(sink);
+    ASSERT(fgets(line, sizeof(line), sink) != NULL);
+    ASSERT(strstr(line, "\"ram_alert\":\"WARNING\",\"self_collect_us\":12.50,\"self_tick_us\":40.00,"
+                        "\"probe_cache_hits\":7,\"probe_cache_misses\":3,"
+                        "\"probe_coalesced\":18446744073709551615}\n") != NULL);
+    ASSERT(fgets(line, sizeof(line), sink) != NULL);
+    ASSERT(strcmp(line, "timestamp_ms,server,cpu_percent,ram_percent,ram_used_gb,ram_total_gb,cpu_alert,ram_alert,"
+                        "anomalies,self_collect_us,self_tick_us,probe_cache_hits,probe_cache_misses,"
+                        "probe_coalesced\n") == 0);
+    ASSERT(fgets(line, sizeof(line), sink) != NULL);
+    ASSERT(strcmp(line, "1000,\"web,\"\"1\"\"\",5.00,50.13,1.50,3.00,OK,WARNING,,12.50,40.00,7,3,"
+                        "18446744073709551615\n") == 0);
+
+    fclose(sink);
+    return TEST_PASSED;
+}
+
+TEST_CASE(output_writer_survives_oversized_records_and_short_writes) {
+    static char storage[16 * 1024];
+    static char received[128 * 1024];
+    char long_name[MONITOR_OUTPUT_MAX_RECORD_BYTES + 16];
+    char chunk[4096];
+    char line[512] = {0};
+    OutputWriter writer;
+    HealthRecord record = {0, long_name, 5.0, 50.0, 1.5, 3.0, "OK", "OK", false, 0.0, 0.0, NULL, 0,
+                           false, 0, 0, 0};
+    int fds[2];
+    size_t prefill = 0;
+    size_t length = 0;
+    ssize_t count = 0;
+
+    /* A record too large to render is rejected without using up the CSV header. */
+    memset(long_name, 'x', sizeof(long_name) - 1);
+    long_name[sizeof(long_name) - 1] = '\0';
+    FILE* sink = tmpfile();
+    ASSERT(sink != NULL);
+    ASSERT(monitor_output_init(&writer, storage, sizeof(storage), fileno(sink), MONITOR_OUTPUT_CSV, 1) ==
+           MONITOR_STATUS_OK);
+    ASSERT(monitor_output_write(&writer, &record) == MONITOR_STATUS_RANGE_ERROR);
+    ASSERT(writer.length == 0 && !writer.header_written);
+    record.server = "web";
+    ASSERT(monitor_output_write(&writer, &record) == MONITOR_STATUS_OK);
+    rewind(sink);
+    ASSERT(fgets(line, sizeof(line), sink) != NULL);
+    ASSERT(strncmp(line, "timestamp_ms,server,", 20) == 0);
+    ASSERT(fgets(line, sizeof(line), sink) != NULL);
+    ASSERT(strncmp(line, "0,web,", 6) == 0);
+    fclose(sink);
+
+    /* A full non-blocking pipe with one page free takes part of a flush, then fails it. */
+    ASSERT(pipe(fds) == 0);
+    ASSERT(fcntl(fds[1], F_SETFL, O_NONBLOCK) == 0);
+    ASSERT(fcntl(fds[0], F_SETFL, O_NONBLOCK) == 0);
+    memset(chunk, '#', sizeof(chunk));
+    while ((count = write(fds[1], chunk, sizeof(chunk))) > 0) {
+        prefill += (size_t)count;
+    }
+    ASSERT(errno == EAGAIN && prefill > 0);
+    ASSERT(read(fds[0], chunk, sizeof(chunk)) == (ssize_t)sizeof(chunk));
+
+    ASSERT(monitor_output_init(&writer, storage, sizeof(storage), fds[1], MONITOR_OUTPUT_JSON, 1000) ==
+           MONITOR_STATUS_OK);
+    for (long long i = 0; i < 40; i++) {
+        record.timestamp_ms = i;
+        ASSERT(monitor_output_write(&writer, &record) == MONITOR_STATUS_OK);
+    }
+    size_t buffered = writer.length;
+    ASSERT(buffered > sizeof(chunk));
+    ASSERT(monitor_output_flush(&writer) == MONITOR_STATUS_IO_ERROR);
+    ASSERT(writer.length > 0 && writer.length < buffered);
+
+    /* Once the reader drains the pipe, the retry resumes where the short write stopped. */
+    while ((count = read(fds[0], received + length, sizeof(received) - length)) > 0) {
+        length += (size_t)count;
+    }
+    ASSERT(monitor_output_flush(&writer) == MONITOR_STATUS_OK);
+    while ((count = read(fds[0], received + length, sizeof(received) - length)) > 0) {
+        length += (size_t)count;
+    }
+    close(fds[0]);
+    close(fds[1]);
+
+    ASSERT(length == prefill - sizeof(chunk) + buffered);
+    const char* cursor = received + prefill - sizeof(chunk);
+    for (long long i = 0; i < 40; i++) {
+        char expected[32];
+        int prefix = snprintf(expected, sizeof(expected), "{\"timestamp_ms\":%lld,", i);
+        ASSERT(strncmp(cursor, expected, (size_t)prefix) == 0);
+        cursor = memchr(cursor, '\n', (size_t)(received + length - cursor));
+        ASSERT(cursor != NULL);
+        cursor++;
+    }
+    ASSERT(cursor == received + length);
+    return TEST_PASSED;
+}
+
+TEST_CASE(meminfo_parser_fills_every_key) {
+    static const char* keys[] = {
+        "MemTotal", "MemFree", "MemAvailable", "Buffers", "Cached", "SwapCached", "Active",
+        "Inactive", "SwapTotal", "SwapFree", "Dirty", "Writeback", "AnonPages", "Mapped",
+        "Shmem", "Slab", "SReclaimable", "SUnreclaim", "CommitLimit", "Committed_AS",
+        "AnonHugePages", "ShmemHugePages", "HugePages_Total", "HugePages_Free", "HugePages_Rsvd",
+        "HugePages_Surp", "Hugepagesize", "Hugetlb"
+    };
+    const size_t key_count = sizeof(keys) / sizeof(keys[0]);
+    char text[4096];
+    size_t length = 0;
+    MemoryBreakdown breakdown;
+    MemoryUsage usage;
+
+    ASSERT(sizeof(MemoryBreakdown) == key_count * sizeof(unsigned long long));
+    length += (size_t)snprintf(text + length, sizeof(text) - length, "Active(anon):  999 kB\nZswap: 7 kB\n");
+    for (size_t i = 0; i < key_count; i++) {
+        length += (size_t)snprintf(text + length, sizeof(text) - length, "%s:%*s%zu kB\n", keys[i], 8, "", (i + 1) * 1000);
+    }
+    length += (size_t)snprintf(text + length, sizeof(text) - length, "DirectMap4k:   12 kB");
+
+    ASSERT(monitor_parse_meminfo(text, length, &breakdown) == MONITOR_STATUS_OK);
+    const unsigned long long* fields = (const unsigned long long*)(const void*)&breakdown;
+    for (size_t i = 0; i < key_count; i++) {
+        ASSERT(fields[i] == (i + 1) * 1000);
+    }
+
+    const char legacy[] = "MemTotal: 4000 kB\nMemFree: 1000 kB\nBuffers: 500 kB\nCached: 500 kB\n";
+    ASSERT(monitor_parse_meminfo(legacy, sizeof(legacy) - 1, &breakdown) == MONITOR_STATUS_OK);
+    ASSERT(monitor_memory_usage_from_breakdown(&breakdown, &usage) == MONITOR_STATUS_OK);
+    ASSERT(usage.usage_percent == 50.0);
+    ASSERT(monitor_parse_meminfo("Bogus: 1 kB\n", 12, &breakdown) == MONITOR_STATUS_PARSE_ERROR);
+    return TEST_PASSED;
+}
+
+TEST_CASE(profile_scopes_merge_into_snapshot) {
+    static ProfileScopeStats merged[MONITOR_PROFILE_SCOPE_COUNT];
+    double p50 = 0.0;
+
+    monitor_profile_reset();
+    for (uint64_t i = 1; i <= 100; i++) {
+        monitor_profile_record(MONITOR_PROFILE_COLLECT, i * 1000);
+    }
+    monitor_profile_record(MONITOR_PROFILE_RENDER, 2500);
+
+    ASSERT(monitor_profile_last_ns(MONITOR_PROFILE_COLLECT) == 100000);
+    ASSERT(monitor_profile_snapshot(merged, MONITOR_PROFILE_SCOPE_COUNT) == MONITOR_STATUS_OK);
+    ASSERT(merged[MONITOR_PROFILE_COLLECT].count == 100);
+    ASSERT(merged[MONITOR_PROFILE_COLLECT].max_ns == 100000);
+    ASSERT(merged[MONITOR_PROFILE_COLLECT].total_ns == 5050000);
+    ASSERT(merged[MONITOR_PROFILE_RENDER].count == 1);
+    ASSERT(merged[MONITOR_PROFILE_TICK].count == 0);
+    ASSERT(monitor_sketch_quantile(&merged[MONITOR_PROFILE_COLLECT].sketch, 0.5, &p50) == MONITOR_STATUS_OK);
+    ASSERT(fabs(p50 - 50.0) <= 50.0 * 0.02);
+    ASSERT(strcmp(monitor_profile_scope_name(MONITOR_PROFILE_SLEEP), "sleep") == 0);
+
+    monitor_profile_reset();
+    ASSERT(monitor_profile_snapshot(merged, MONITOR_PROFILE_SCOPE_COUNT) == MONITOR_STATUS_OK);
+    ASSERT(merged[MONITOR_PROFILE_COLLECT].count == 0);
+    return TEST_PASSED;
+}
+
+static void* profile_one_section(void* arg) {
+    (void)arg;
+    monitor_profile_record(MONITOR_PROFILE_PROBES, 1000);
+    return NULL;
+}
+
+TEST_CASE(profile_slots_are_reused_after_thread_exit) {
+    enum { THREADS = MONITOR_PROFILE_MAX_THREADS * 2 };
+    static ProfileScopeStats merged[MONITOR_PROFILE_SCOPE_COUNT];
+
+    monitor_profile_reset();
+    for (int i = 0; i < THREADS; i++) {
+        pthread_t thread;
+        ASSERT(pthread_create(&thread, NULL, profile_one_section, NULL) == 0);
+        ASSERT(pthread_join(thread, NULL) == 0);
+    }
+
+    ASSERT(monitor_profile_snapshot(merged, MONITOR_PROFILE_SCOPE_COUNT) == MONITOR_STATUS_OK);
+    ASSERT(merged[MONITOR_PROFILE_PROBES].count == THREADS);
+    ASSERT(merged[MONITOR_PROFILE_PROBES].total_ns == THREADS * 1000ULL);
+    return TEST_PASSED;
+}
+
+static int fail_setup(void** context) {
+    (void)context;
+    return -1;
+}
+
+static int fail_call(void* context) {
+    (void)context;
+    return -1;
+}
+
+static const SyscallBenchResult* find_syscall_result(const SyscallBenchResult* results,
+                                                     size_t count,
+                                                     const char* name) {
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(results[i].name, name) == 0) {
+            return &results[i];
+        }
+    }
+    return NULL;
+}
+
+TEST_CASE(syscall_bench_reports_per_call_percentiles) {
+    SyscallBenchResult results[16];
+
+    register_default_syscall_benches();
+    register_default_syscall_benches();
+    register_syscall_bench(0, "setup fails", fail_setup, fail_call, NULL);
+    register_syscall_bench(0, "call fails", NULL, fail_call, NULL);
+    size_t count = run_syscall_benches(200, results, 16);
+    ASSERT(count == 8);
+
+    const char* names[] = {"getpid", "clock_gettime", "pread /proc/stat", "openat+close", "epoll_wait"};
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        const SyscallBenchResult* result = find_syscall_result(results, count, names[i]);
+        ASSERT(result != NULL);
+        ASSERT(!result->skipped && result->errors == 0 && result->calls == 200);
+        ASSERT(result->p50_ns <= result->p90_ns && result->p90_ns <= result->p99_ns);
+        ASSERT(result->p99_ns <= result->max_ns * 1.02);
+        ASSERT(result->max_ns > 0.0);
+    }
+    /* The kernel formats /proc/stat on every read, which no sane host does faster than getpid. */
+    ASSERT(find_syscall_result(results, count, "pread /proc/stat")->p50_ns >
+           find_syscall_result(results, count, "getpid")->p50_ns);
+    ASSERT(find_syscall_result(results, count, "setup fails")->skipped);
+    ASSERT(find_syscall_result(results, count, "call fails")->errors == 200);
+    ASSERT(run_syscall_benches(10, results, 2) == 2);
+    return TEST_PASSED;
+}
+
+TEST_CASE(probe_parse_splits_quoted_words) {
+    MonitorProbeCommand command;
+    MonitorConfig config;
+    char too_many[128] = {0};
+
+    ASSERT(monitor_probe_parse("  sh  -c 'echo  a' \"b c\"d ", &command) == MONITOR_STATUS_OK);
+    ASSERT(command.argc == 4);
+    ASSERT(strcmp(command.argv[0], "sh") == 0 && strcmp(command.argv[2], "echo  a") == 0);
+    ASSERT(strcmp(command.argv[3], "b cd") == 0 && command.argv[4] == NULL);
+    ASSERT(monitor_probe_parse("echo 'open", &command) == MONITOR_STATUS_PARSE_ERROR);
+    ASSERT(monitor_probe_parse("   ", &command) == MONITOR_STATUS_PARSE_ERROR);
+    for (size_t i = 0; i <= MONITOR_PROBE_MAX_ARGS; i++) {
+        strcat(too_many, "a ");
+    }
+    ASSERT(monitor_probe_parse(too_many, &command) == MONITOR_STATUS_RANGE_ERROR);
+
+    monitor_config_init(&config);
+    ASSERT(monitor_config_add_probe(&config, "echo \"open") == MONITOR_STATUS_PARSE_ERROR);
+    for (size_t i = 0; i < MONITOR_MAX_PROBES; i++) {
+        ASSERT(monitor_config_add_probe(&config, "true") == MONITOR_STATUS_OK);
+    }
+    ASSERT(monitor_config_add_probe(&config, "true") == MONITOR_STATUS_RANGE_ERROR);
+    ASSERT(config.probe_count == MONITOR_MAX_PROBES);
+    return TEST_PASSED;
+}
+
+TEST_CASE(probe_engine_captures_output_limits_and_timeouts) {
+    const MonitorProbeLimits limits = {.open_files = 64, .disable_core_dumps = true};
+    MonitorProbeEngine engine;
+    MonitorProbeResult result;
+    size_t first = 0;
+    size_t second = 0;
+
+    ASSERT(monitor_probe_engine_init(&engine, &limits, "/nonexistent-cgroup") == MONITOR_STATUS_IO_ERROR);
+    ASSERT(monitor_probe_engine_init(&engine, &limits, NULL) == MONITOR_STATUS_OK);
+    ASSERT(monitor_probe_prepare(&engine, "sh -c 'exit 0'", &first) == MONITOR_STATUS_OK);
+    ASSERT(monitor_probe_prepare(&engine, " sh  -c \"exit 0\"", &second) == MONITOR_STATUS_OK);
+    ASSERT(first == second && engine.count == 1);
+    ASSERT(monitor_probe_prepare(&engine, "no-such-probe-binary", &second) == MONITOR_STATUS_IO_ERROR);
+
+    ASSERT(monitor_probe_run(&engine, first, 2000, &result) == MONITOR_STATUS_OK);
+    ASSERT(monitor_probe_succeeded(&result) && result.stdout_length == 0);
+
+    ASSERT(monitor_probe_run_command(&engine, "sh -c 'printf out; printf err >&2; exit 3'", 2000, &result) ==
+           MONITOR_STATUS_OK);
+    ASSERT(result.exit_code == 3 && !monitor_probe_succeeded(&result));
+    ASSERT(strcmp(result.stdout_text, "out") == 0 && strcmp(result.stderr_text, "err") == 0);
+
+    ASSERT(monitor_probe_run_command(&engine, "sh -c 'ulimit -n; ulimit -c'", 2000, &result) == MONITOR_STATUS_OK);
+    ASSERT(strcmp(result.stdout_text, "64\n0\n") == 0);
+
+    ASSERT(monitor_probe_run_command(&engine, "head -c 5000 /dev/zero", 2000, &result) == MONITOR_STATUS_OK);
+    ASSERT(result.exit_code == 0 && result.truncated && result.stdout_length == MONITOR_PROBE_OUTPUT_BYTES);
+
+    ASSERT(monitor_probe_run_command(&engine, "sleep 5", 100, &result) == MONITOR_STATUS_OK);
+    ASSERT(result.timed_out && result.signal == SIGKILL && !monitor_probe_succeeded(&result));
+    ASSERT(result.duration_ns >= 100000000ULL && result.duration_ns < 2000000000ULL);
+
+    /* Signals are blocked only across the spawn: the probe starts unmasked and the caller's mask is restored. */
+    sigset_t blocked;
+    sigset_t saved;
+    sigset_t after;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGUSR2);
+    ASSERT(pthread_sigmask(SIG_BLOCK, &blocked, &saved) == 0);
+    ASSERT(monitor_probe_run_command(&engine, "grep SigBlk /proc/self/status", 2000, &result) == MONITOR_STATUS_OK);
+    ASSERT(pthread_sigmask(SIG_SETMASK, &saved, &after) == 0);
+    ASSERT(strstr(result.stdout_text, "0000000000000000") != NULL);
+    ASSERT(sigismember(&after, SIGUSR2) == 1 && sigismember(&after, SIGTERM) == sigismember(&saved, SIGTERM));
+
+    ASSERT(atomic_load(&engine.launches) == 6 && atomic_load(&engine.timeouts) == 1);
+    ASSERT(monitor_probe_run(&engine, engine.count, 100, &result) == MONITOR_STATUS_INVALID_ARGUMENT);
+    monitor_probe_engine_free(&engine);
+    ASSERT(engine.null_fd == -1 && engine.cgroup_fd == -1);
+    monitor_probe_engine_free(&engine);
+    return TEST_PASSED;
+}
+
+typedef struct {
+    MonitorProbeEngine* engine;
+    size_t id;
+    MonitorProbeResult result;
+    MonitorStatus status;
+} SharedProbeCall;
+
+static void* run_shared_probe(void* arg) {
+    SharedProbeCall* call = arg;
+    call->status = monitor_probe_run_shared(call->engine, call->id, 5000, 0, &call->result);
+    return NULL;
+}
+
+TEST_CASE(probe_shared_runs_coalesce_and_cache) {
+    static SharedProbeCall calls[4];
+    static MonitorProbeResult cached;
+    pthread_t threads[4];
+    MonitorProbeEngine engine;
+    MonitorProbeCounters counters;
+    size_t id = 0;
+
+    ASSERT(monitor_probe_engine_init(&engine, NULL, NULL) == MONITOR_STATUS_OK);
+    ASSERT(monitor_probe_prepare(&engine, "sh -c 'sleep 0.3; echo $$'", &id) == MONITOR_STATUS_OK);
+    for (size_t i = 0; i < 4; i++) {
+        calls[i] = (SharedProbeCall){.engine = &engine, .id = id};
+        ASSERT(pthread_create(&threads[i], NULL, run_shared_probe, &calls[i]) == 0);
+    }
+    size_t shared = 0;
+    for (size_t i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+        ASSERT(calls[i].status == MONITOR_STATUS_OK && monitor_probe_succeeded(&calls[i].result));
+        ASSERT(strcmp(calls[i].result.stdout_text, calls[0].result.stdout_text) == 0);
+        shared += calls[i].result.shared;
+    }
+    monitor_probe_counters(&engine, &counters);
+    ASSERT(shared == 3 && counters.launches == 1 && counters.cache_misses == 1 && counters.coalesced == 3);
+
+    ASSERT(monitor_probe_run_shared(&engine, id, 5000, 60000, &cached) == MONITOR_STATUS_OK);
+    ASSERT(cached.shared && strcmp(cached.stdout_text, calls[0].result.stdout_text) == 0);
+    ASSERT(monitor_probe_run_shared(&engine, id, 5000, 0, &cached) == MONITOR_STATUS_OK);
+    ASSERT(!cached.shared && strcmp(cached.stdout_text, calls[0].result.stdout_text) != 0);
+
+    monitor_probe_counters(&engine, &counters);
+    ASSERT(counters.launches == 2 && counters.cache_hits == 1 && counters.cache_misses == 2);
+    ASSERT(monitor_probe_run_shared(&engine, id, 5000, -1, &cached) == MONITOR_STATUS_INVALID_ARGUMENT);
+    monitor_probe_engine_free(&engine);
+    return TEST_PASSED;
+}
+
+static size_t count_threads(void) {
+    char line[128];
+    size_t threads = 0;
+    FILE* status = fopen("/proc/self/status", "r");
+    while (status && fgets(line, sizeof(line), status)) {
+        if (strncmp(line, "Threads:", 8) == 0) {
+            threads = (size_t)strtoul(line + 8, NULL, 10);
+        }
+    }
+    if (status) {
+        fclose(status);
+    }
+    return threads;
+}
+
+TEST_CASE(probe_batches_run_on_fixed_workers) {
+    static MonitorProbeResult results[5];
+    const char* commands[] = {"sh -c 'sleep 0.2; echo 0'", "sh -c 'sleep 0.2; echo 1'",
+                              "sh -c 'sleep 0.2; echo 2'", "sh -c 'sleep 0.2; echo 3'"};
+    MonitorStatus statuses[5];
+    MonitorProbeEngine engine;
+    MonitorProbeCounters counters;
+    size_t ids[5];
+
+    ASSERT(monitor_probe_engine_init(&engine, NULL, NULL) == MONITOR_STATUS_OK);
+    for (size_t i = 0; i < 4; i++) {
+        ASSERT(monitor_probe_prepare(&engine, commands[i], &ids[i]) == MONITOR_STATUS_OK);
+    }
+    ids[4] = ids[0];
+    ASSERT(monitor_probe_engine_start_workers(&engine, 3) == MONITOR_STATUS_OK && engine.worker_count == 3);
+    size_t threads = count_threads();
+
+    for (int round = 0; round < 3; round++) {
+        uint64_t start = monitor_profile_now_ns();
+        monitor_probe_run_batch(&engine, ids, 5, 5000, 0, results, statuses);
+        ASSERT(monitor_profile_now_ns() - start < 700000000ULL);
+        for (size_t i = 0; i < 5; i++) {
+            char expected[4] = {(char)('0' + i % 4), '\n', '\0'};
+            ASSERT(statuses[i] == MONITOR_STATUS_OK && strcmp(results[i].stdout_text, expected) == 0);
+        }
+        ASSERT(count_threads() == threads);
+    }
+    monitor_probe_counters(&engine, &counters);
+    ASSERT(counters.launches + counters.coalesced == 15 && counters.launches >= 12);
+
+    monitor_probe_engine_free(&engine);
+    ASSERT(count_threads() == threads - 3);
+    return TEST_PASSED;
+}
+
+TEST_CASE(daemon_config_reload_and_event_loop) {
+    char program[] = "server_monitor";
+    char daemon_flag[] = "--daemon";
+    char iterations_flag[] = "--iterations";
+    char iterations_value[] = "3";
+    char* daemon_argv[] = {program, daemon_flag};
+    char* invalid_argv[] = {program, daemon_flag, iterations_flag, iterations_value};
+    MonitorConfigSnapshot* snapshot = NULL;
+    MonitorEventLoop loop;
+    MonitorEventType event = MONITOR_EVENT_STOP;
+
+    setenv("SHM_INTERVAL_MS", "250", 1);
+    ASSERT(monitor_config_load(2, daemon_argv, &snapshot, NULL, 0) == MONITOR_STATUS_OK);
+    ASSERT(snapshot->config.daemon && snapshot->config.non_interactive && snapshot->config.interval_ms == 250);
+    monitor_config_snapshot_free(snapshot);
+    unsetenv("SHM_INTERVAL_MS");
+    ASSERT(monitor_config_load(4, invalid_argv, &snapshot, NULL, 0) == MONITOR_STATUS_INVALID_ARGUMENT);
+
+    ASSERT(monitor_event_loop_init(&loop) == MONITOR_STATUS_OK);
+    ASSERT(monitor_event_loop_arm(&loop, 100) == MONITOR_STATUS_OK);
+    ASSERT(monitor_event_loop_wait(&loop, &event) == MONITOR_STATUS_OK && event == MONITOR_EVENT_TICK);
+    raise(SIGHUP);
+    ASSERT(monitor_event_loop_wait(&loop, &event) == MONITOR_STATUS_OK && event == MONITOR_EVENT_RELOAD);
+    raise(SIGTERM);
+    ASSERT(monitor_event_loop_wait(&loop, &event) == MONITOR_STATUS_OK && event == MONITOR_EVENT_STOP);
+    ASSERT(monitor_event_loop_wait(&loop, &event) == MONITOR_STATUS_OK && event == MONITOR_EVENT_TICK);
+    ASSERT(loop.ticks == 2);
+    monitor_event_loop_close(&loop);
+    return TEST_PASSED;
+}
+
+TEST_CASE(config_file_compiles_validated_snapshot) {
+    static const char text[] =
+        "; comment\n"
+        "[monitor]\n"
+        "server = \"edge;7#a\" ; the quotes keep ';' and '#'\n"
+        "interval_ms = 500   ; inline comment\n"
+        "output_batch = 4 # hash comment\n"
+        "self_stats = true\n"
+        "\n"
+        "[alert.api-cpu]\n"
+        "metric = cpu_percent\n"
+        "warning = 70\n"
+        "critical = 90\n"
+        "notify = oncall\n"
+        "[alert.db-ram]\n"
+        "metric = ram_used_gb\n"
+        "warning = 12\n"
+        "critical = 14\n"
+        "hysteresis = 1\n"
+        "notify = oncall\n";
+    static const char duplicate[] = "[alert.a]\nmetric = cpu_percent\n[alert.a]\n";
+    static const char unknown[] = "[monitor]\ninterval_ms = 500\ncolour = red\n";
+    static const char inverted[] = "[alert.bad]\nmetric = ram_percent\nwarning = 95\ncritical = 90\n";
+    MonitorConfig config;
+    ConfigRules rules;
+    MonitorConfigSnapshot* snapshot = NULL;
+    MonitorConfigStore store;
+    char error[128] = {0};
+
+    monitor_config_init(&config);
+    monitor_config_rules_init(&rules);
+    ASSERT(monitor_config_parse_ini(text, sizeof(text) - 1, &config, &rules, error, sizeof(error)) ==
+           MONITOR_STATUS_OK);
+    ASSERT(monitor_config_snapshot_create(&config, &rules, &snapshot, error, sizeof(error)) == MONITOR_STATUS_OK);
+    monitor_config_rules_free(&rules);
+
+    ASSERT(strcmp(snapshot->config.server_name, "edge;7#a") == 0);
+    ASSERT(snapshot->config.output_batch == 4);
+    ASSERT(snapshot->config.interval_ms == 500 && snapshot->config.self_stats);
+    ASSERT(snapshot->rule_count == 2);
+    ASSERT(strcmp(snapshot->rule_names[1], "db-ram") == 0);
+    ASSERT(snapshot->rules[1].metric == MONITOR_METRIC_RAM_USED_GB);
+    ASSERT(snapshot->rules[0].min_notify_interval_ms == snapshot->config.alert_interval_ms);
+    ASSERT(snapshot->rule_notify[0] == snapshot->rule_notify[1]);
+    ASSERT(strcmp(snapshot->rule_notify[0], "oncall") == 0);
+
+    monitor_config_rules_init(&rules);
+    ASSERT(monitor_config_parse_ini(duplicate, sizeof(duplicate) - 1, &config, &rules, error, sizeof(error)) ==
+           MONITOR_STATUS_INVALID_ARGUMENT);
+    ASSERT(strcmp(error, "line 3: duplicate alert 'a'") == 0);
+    monitor_config_rules_free(&rules);
+
+    monitor_config_rules_init(&rules);
+    ASSERT(monitor_config_parse_ini(unknown, sizeof(unknown) - 1, &config, &rules, error, sizeof(error)) ==
+           MONITOR_STATUS_PARSE_ERROR);
+    ASSERT(strcmp(error, "line 3: unknown key 'colour'") == 0);
+    monitor_config_rules_free(&rules);
+
+    /* strtod() reads these, but a NaN threshold would slip past every comparison. */
+    static const char* const non_finite[] = {"nan", "NAN", "inf", "-inf", "infinity", "nan(1)", "1e999"};
+    for (size_t i = 0; i < sizeof(non_finite) / sizeof(non_finite[0]); i++) {
+        char bad[96];
+        int length = snprintf(bad, sizeof(bad), "[alert.x]\nmetric = cpu_percent\nwarning = %s\n", non_finite[i]);
+        monitor_config_rules_init(&rules);
+        ASSERT(monitor_config_parse_ini(bad, (size_t)length, &config, &rules, error, sizeof(error)) ==
+               MONITOR_STATUS_PARSE_ERROR);
+        ASSERT(strcmp(error, "line 3: invalid value for 'warning'") == 0);
+        monitor_config_rules_free(&rules);
+    }
+    monitor_config_rules_init(&rules);
+    ASSERT(monitor_config_parse_ini(inverted, sizeof(inverted) - 1, &config, &rules, error, sizeof(error)) ==
+           MONITOR_STATUS_OK);
+    rules.rules[0].warning_threshold = NAN;
+    MonitorConfigSnapshot* not_finite = NULL;
+    ASSERT(monitor_config_snapshot_create(&config, &rules, &not_finite, error, sizeof(error)) ==
+           MONITOR_STATUS_RANGE_ERROR);
+    ASSERT(not_finite == NULL && strcmp(error, "alert 'bad' needs finite thresholds") == 0);
+    monitor_config_rules_free(&rules);
+
+    MonitorConfigSnapshot* rejected = NULL;
+    monitor_config_rules_init(&rules);
+    ASSERT(monitor_config_parse_ini(inverted, sizeof(inverted) - 1, &config, &rules, error, sizeof(error)) ==
+           MONITOR_STATUS_OK);
+    ASSERT(monitor_config_snapshot_create(&config, &rules, &rejected, error, sizeof(error)) ==
+           MONITOR_STATUS_RANGE_ERROR);
+    ASSERT(rejected == NULL);
+    monitor_config_rules_free(&rules);
+
+    monitor_config_store_init(&store);
+    ASSERT(monitor_config_store_publish(&store, snapshot) == MONITOR_STATUS_OK);
+    ASSERT(monitor_config_store_acquire(&store) == snapshot);
+    for (size_t i = 0; i < MONITOR_CONFIG_MAX_RETIRED; i++) {
+        MonitorConfigSnapshot* next = NULL;
+        ASSERT(monitor_config_snapshot_create(&config, NULL, &next, NULL, 0) == MONITOR_STATUS_OK);
+        ASSERT(monitor_config_store_publish(&store, next) == MONITOR_STATUS_OK);
+    }
+    ASSERT(store.retired_count == MONITOR_CONFIG_MAX_RETIRED);
+    ASSERT(monitor_config_snapshot_create(&config, NULL, &snapshot, NULL, 0) == MONITOR_STATUS_OK);
+    ASSERT(monitor_config_store_publish(&store, snapshot) == MONITOR_STATUS_RANGE_ERROR);
+    monitor_config_store_quiescent(&store);
+    ASSERT(monitor_config_store_publish(&store, snapshot) == MONITOR_STATUS_OK);
+    ASSERT(store.retired_count == 1 && monitor_config_store_acquire(&store) == snapshot);
+    monitor_config_store_free(&store);
+    return TEST_PASSED;
+}
+
+TEST_CASE(shm_seqlock_publishes_latest_sample) {
+    char name[MONITOR_SHM_MAX_NAME];
+    MonitorShmWriter writer;
+    MonitorShmReader reader;
+    MonitorShmSample sample;
+    MonitorShmSample read_back;
+    uint64_t sequence = 1;
+
+    snprintf(name, sizeof(name), "/shm_test_%ld", (long)getpid());
+    ASSERT(monitor_shm_validate_name("no-slash") == MONITOR_STATUS_INVALID_ARGUMENT);
+    ASSERT(monitor_shm_validate_name("/a/b") == MONITOR_STATUS_INVALID_ARGUMENT);
+    ASSERT(monitor_shm_reader_open(&reader, name) == MONITOR_STATUS_IO_ERROR);
+
+    ASSERT(monitor_shm_writer_open(&writer, name) == MONITOR_STATUS_OK);
+    ASSERT(monitor_shm_reader_open(&reader, name) == MONITOR_STATUS_OK);
+    ASSERT(monitor_shm_read(&reader, &read_back, &sequence) == MONITOR_STATUS_OK && sequence == 0);
+
+    memset(&sample, 0, sizeof(sample));
+    snprintf(sample.server, sizeof(sample.server), "%s", "edge-7");
+    for (int i = 1; i <= 3; i++) {
+        sample.cpu_percent = 10.0 * i;
+        sample.ram_alert_level = ALERT_LEVEL_WARNING;
+        monitor_shm_publish(&writer, &sample);
+    }
+    ASSERT(monitor_shm_read(&reader, &read_back, &sequence) == MONITOR_STATUS_OK);
+    ASSERT(sequence == 3 && read_back.cpu_percent == 30.0);
+    ASSERT(strcmp(read_back.server, "edge-7") == 0 && read_back.ram_alert_level == ALERT_LEVEL_WARNING);
+    ASSERT(reader.retries == 0);
+    monitor_shm_reader_close(&reader);
+
+    writer.layout->version = MONITOR_SHM_VERSION + 1;
+    ASSERT(monitor_shm_reader_open(&reader, name) == MONITOR_STATUS_UNSUPPORTED);
+    writer.layout->version = MONITOR_SHM_VERSION;
+
+    ASSERT(monitor_shm_reader_open(&reader, name) == MONITOR_STATUS_OK);
+    monitor_shm_writer_close(&writer);
+    ASSERT(monitor_shm_read(&reader, &read_back, NULL) == MONITOR_STATUS_IO_ERROR);
+    monitor_shm_reader_close(&reader);
+    ASSERT(monitor_shm_reader_open(&reader, name) == MONITOR_STATUS_IO_ERROR);
+    return TEST_PASSED;
+}
+
+static void write_fixture(const char* dir, const char* name, const char* contents) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE* file = fopen(path, "w");
+    if (file) {
+        fputs(contents, file);
+        fclose(file);
+    }
+}
+
+static void remove_fixture(const char* dir, const char* name) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    unlink(path);
+}
+
+TEST_CASE(cgroup_reads_limits_and_falls_back) {
+    char root[] = "/tmp/shm_cgroup_XXXXXX";
+    char group[64];
+    const char* files[] = {"memory.current", "memory.max", "cpu.stat", "io.stat"};
+    CgroupSet set;
+    MemoryUsage usage = {14.0, 16.0, 87.5};
+
+    ASSERT(mkdtemp(root) != NULL);
+    snprintf(group, sizeof(group), "%s/app", root);
+    ASSERT(mkdir(group, 0700) == 0);
+    write_fixture(group, "memory.current", "536870912\n");
+    write_fixture(group, "memory.max", "1073741824\n");
+    write_fixture(group, "cpu.stat", "usage_usec 1500\nuser_usec 1000\nsystem_usec 500\nnr_periods 4\n"
+                                     "nr_throttled 2\nthrottled_usec 75\n");
+    write_fixture(group, "io.stat", "8:0 rbytes=100 wbytes=200 rios=1 wios=2 dbytes=0 dios=0\n"
+                                    "8:16 rbytes=50 wbytes=0 rios=3 wios=0 dbytes=0 dios=0\n");
+
+    ASSERT(monitor_cgroup_set_init(&set, root, 4) == MONITOR_STATUS_OK);
+    ASSERT(monitor_cgroup_set_add(&set, "/app", NULL) == MONITOR_STATUS_OK);
+    ASSERT(monitor_cgroup_set_add(&set, "/", NULL) == MONITOR_STATUS_OK);
+    ASSERT(monitor_cgroup_set_read_all(&set) == 2);
+
+    const CgroupStats* app = &set.stats[0];
+    ASSERT(app->has_memory && app->memory_limited && app->memory_max == 1073741824ULL);
+    ASSERT(app->cpu_usage_usec == 1500 && app->cpu_nr_throttled == 2 && app->cpu_throttled_usec == 75);
+    ASSERT(app->io_read_bytes == 150 && app->io_write_bytes == 200 && app->io_read_ops == 4);
+    ASSERT(!set.stats[1].has_memory && !set.stats[1].has_cpu);
+
+    ASSERT(monitor_cgroup_apply_memory_limit(app, &usage) == MONITOR_STATUS_OK);
+    ASSERT(usage.total_gb == 1.0 && usage.used_gb == 0.5 && usage.usage_percent == 50.0);
+    ASSERT(monitor_cgroup_apply_memory_limit(&set.stats[1], &usage) == MONITOR_STATUS_UNSUPPORTED);
+
+    monitor_cgroup_set_free(&set);
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        remove_fixture(group, files[i]);
+    }
+    rmdir(group);
+    rmdir(root);
+    return TEST_PASSED;
+}
+
+TEST_CASE(read_batch_matches_sequential_reads) {
+    char root[] = "/tmp/shm_batch_XXXXXX";
+    char group[64];
+    const char* files[] = {"memory.current", "memory.max", "cpu.stat"};
+    const MonitorReadBackend backends[] = {MONITOR_READ_BACKEND_IO_URING, MONITOR_READ_BACKEND_PREAD};
+
+    ASSERT(mkdtemp(root) != NULL);
+    snprintf(group, sizeof(group), "%s/app", root);
+    ASSERT(mkdir(group, 0700) == 0);
+    write_fixture(group, "cpu.stat", "usage_usec 1500\nnr_throttled 2\nthrottled_usec 75\n");
+
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+        ReadBatch batch;
+        CgroupHandle handle;
+        CgroupReadSlots slots;
+        CgroupStats batched;
+        CgroupStats direct;
+        CpuTracker tracker = {0, 0, false};
+        size_t stat_slot = 0;
+        double cpu = -1.0;
+
+        write_fixture(group, "memory.current", "536870912\n");
+        write_fixture(group, "memory.max", "max\n");
+        if (monitor_read_batch_init(&batch, backends[b]) == MONITOR_STATUS_UNSUPPORTED) {
+            continue;
+        }
+        ASSERT(batch.backend == backends[b]);
+        ASSERT(monitor_read_batch_add(&batch, "/proc/stat", 4096, &stat_slot) == MONITOR_STATUS_OK);
+        ASSERT(monitor_read_batch_add(&batch, "/proc/no_such_file", 64, NULL) == MONITOR_STATUS_UNSUPPORTED);
+        ASSERT(monitor_cgroup_open(&handle, root, "/app") == MONITOR_STATUS_OK);
+        ASSERT(monitor_cgroup_batch_add(&handle, &batch, &slots) == MONITOR_STATUS_OK);
+        ASSERT(slots.memory_current != MONITOR_CGROUP_NO_SLOT && slots.io_stat == MONITOR_CGROUP_NO_SLOT);
+        ASSERT(batch.count == 4);
+
+        ASSERT(monitor_read_batch_run(&batch) == MONITOR_STATUS_OK);
+        ASSERT(batch.backend == backends[b]);
+        ASSERT(monitor_cpu_usage_from_stat(&tracker, monitor_read_batch_data(&batch, stat_slot, NULL), &cpu) ==
+               MONITOR_STATUS_OK);
+        ASSERT(tracker.has_prev && cpu == 0.0);
+        ASSERT(monitor_cgroup_parse_batch(&batch, &slots, &batched) == MONITOR_STATUS_OK);
+        ASSERT(monitor_cgroup_read(&handle, &direct) == MONITOR_STATUS_OK);
+        ASSERT(memcmp(&batched, &direct, sizeof(batched)) == 0);
+        ASSERT(batched.has_memory && !batched.memory_limited && batched.cpu_throttled_usec == 75 && !batched.has_io);
+
+        /* The files stay open; each run re-reads them from offset 0. */
+        write_fixture(group, "memory.current", "1024\n");
+        write_fixture(group, "memory.max", "2048\n");
+        ASSERT(monitor_read_batch_run(&batch) == MONITOR_STATUS_OK);
+        ASSERT(monitor_cgroup_parse_batch(&batch, &slots, &batched) == MONITOR_STATUS_OK);
+        ASSERT(batched.memory_current == 1024 && batched.memory_limited && batched.memory_max == 2048);
+        ASSERT(batch.runs == 2);
+        if (backends[b] == MONITOR_READ_BACKEND_IO_URING) {
+            ASSERT(batch.syscalls == 2);
+        }
+
+        monitor_cgroup_close(&handle);
+        monitor_read_batch_free(&batch);
+    }
+
+    /* AUTO alternates both paths while calibrating, then settles on one. */
+    ReadBatch batch;
+    size_t stat_slot = 0;
+    ASSERT(monitor_read_batch_init(&batch, MONITOR_READ_BACKEND_AUTO) == MONITOR_STATUS_OK);
+    ASSERT(monitor_read_batch_add(&batch, "/proc/stat", 4096, &stat_slot) == MONITOR_STATUS_OK);
+    for (unsigned run = 0; run < 2 * MONITOR_READ_CALIBRATION_RUNS; run++) {
+        ASSERT(monitor_read_batch_run(&batch) == MONITOR_STATUS_OK);
+        ASSERT(strncmp(monitor_read_batch_data(&batch, stat_slot, NULL), "cpu ", 4) == 0);
+    }
+    ASSERT(!batch.calibrating && batch.backend != MONITOR_READ_BACKEND_AUTO);
+    ASSERT(monitor_read_batch_run(&batch) == MONITOR_STATUS_OK);
+    monitor_read_batch_free(&batch);
+
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        remove_fixture(group, files[i]);
+    }
+    rmdir(group);
+    rmdir(root);
+    return TEST_PASSED;
+}
+
+static atomic_bool threads_test_stop;
+
+static void* spin_thread(void* arg) {
+    volatile unsigned long long* counter = arg;
+    while (!atomic_load(&threads_test_stop)) {
+        (*counter)++;
+    }
+    return NULL;
+}
+
+static void* idle_thread(void* arg) {
+    const struct timespec pause = {0, 1000000};
+    (void)arg;
+    while (!atomic_load(&threads_test_stop)) {
+        nanosleep(&pause, NULL);
+    }
+    return NULL;
+}
+
+static void spin_for_ms(long ms) {
+    struct timespec start;
+    struct timespec now;
+    const struct timespec pause = {0, 5000000};
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        nanosleep(&pause, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000 < ms);
+}
+
+TEST_CASE(threads_rank_busiest_and_recycle_exited) {
+    const MonitorThreadsBackend backends[] = {MONITOR_THREADS_BACKEND_PROCFS, MONITOR_THREADS_BACKEND_TASKSTATS};
+
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+        static ThreadTracker tracker;
+        volatile unsigned long long counter = 0;
+        pthread_t spinner;
+        pthread_t idler;
+
+        if (monitor_threads_init(&tracker, backends[b]) == MONITOR_STATUS_UNSUPPORTED) {
+            continue;
+        }
+        ASSERT(tracker.backend == backends[b]);
+        ASSERT(monitor_threads_watch(&tracker, -1) == MONITOR_STATUS_INVALID_ARGUMENT);
+        ASSERT(monitor_threads_watch(&tracker, (int)getpid()) == MONITOR_STATUS_OK);
+        ASSERT(monitor_threads_watch(&tracker, (int)getpid()) == MONITOR_STATUS_OK && tracker.pid_count == 1);
+
+        atomic_store(&threads_test_stop, false);
+        ASSERT(pthread_create(&spinner, NULL, spin_thread, (void*)&counter) == 0);
+        ASSERT(pthread_create(&idler, NULL, idle_thread, NULL) == 0);
+
+        /* The first sample is the baseline; the second ranks the spinning thread first. */
+        ASSERT(monitor_threads_sample(&tracker) == MONITOR_STATUS_OK);
+        ASSERT(tracker.top_count == 0 && tracker.threads >= 3);
+        spin_for_ms(200);
+        ASSERT(monitor_threads_sample(&tracker) == MONITOR_STATUS_OK);
+        ASSERT(tracker.top_count >= 2);
+        ASSERT(tracker.top[0].pid == (int32_t)getpid() && tracker.top[0].tid != (int32_t)getpid());
+        ASSERT(tracker.top[0].cpu_percent > 20.0 && tracker.top[0].cpu_percent >= tracker.top[1].cpu_percent);
+        ASSERT(tracker.tracked == tracker.threads);
+
+        if (tracker.backend == MONITOR_THREADS_BACKEND_TASKSTATS) {
+            /* Replies the tracker cannot use must not make live threads look exited. */
+            size_t tracked = tracker.tracked;
+            uint16_t family = tracker.family_id;
+            tracker.family_id = (uint16_t)(family + 1000U);
+            ASSERT(monitor_threads_sample(&tracker) == MONITOR_STATUS_OK);
+            ASSERT(tracker.threads == 0 && tracker.tracked == tracked);
+            tracker.family_id = family;
+            spin_for_ms(100);
+            ASSERT(monitor_threads_sample(&tracker) == MONITOR_STATUS_OK);
+            ASSERT(tracker.top_count >= 2 && tracker.top[0].tid != (int32_t)getpid());
+            ASSERT(tracker.top[0].cpu_percent > 20.0 && tracker.top[0].cpu_percent < 150.0);
+        }
+
+        size_t before = tracker.threads;
+        atomic_store(&threads_test_stop, true);
+        pthread_join(spinner, NULL);
+        pthread_join(idler, NULL);
+        ASSERT(monitor_threads_sample(&tracker) == MONITOR_STATUS_OK);
+        ASSERT(tracker.threads == before - 2 && tracker.tracked == tracker.threads);
+        monitor_threads_free(&tracker);
+    }
+    return TEST_PASSED;
+}
+
+static int runner_passes(void) {
+    return TEST_PASSED;
+}
+
+static int runner_fails(void) {
+    ASSERT(runner_passes() != TEST_PASSED);
+    return TEST_PASSED;
+}
+
+static int runner_aborts(void) {
+    abort();
+}
+
+static int runner_hangs(void) {
+    pause();
+    return TEST_PASSED;
+}
+
+/* Nested runners report through stdout, which belongs to the outer runner. */
+static int silence_stdout(void) {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) {
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    }
+    return saved;
+}
+
+static void restore_stdout(int saved) {
+    fflush(stdout);
+    if (saved >= 0) {
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+    }
+}
+
+static bool file_contains(const char* path, const char* needle) {
+    char text[4096] = {0};
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    size_t length = fread(text, 1, sizeof(text) - 1, file);
+    fclose(file);
+    text[length] = '\0';
+    return strstr(text, needle) != NULL;
+}
+
+TEST_CASE(test_runner_isolates_crashes_and_timeouts) {
+    TestCase cases[] = {
+        {"passes", runner_passes},
+        {"fails", runner_fails},
+        {"aborts", runner_aborts},
+        {"hangs", runner_hangs},
+        {"filtered_out", runner_passes},
+    };
+    TestResult results[5];
+    TestRunOptions options;
+    char junit[] = "/tmp/shm_junit_XXXXXX";
+    char json[] = "/tmp/shm_json_XXXXXX";
+
+    ASSERT(test_matches_filter("alert_for_window", "sketch,alert_*"));
+    ASSERT(test_matches_filter("alert_for_window", "for_win"));
+    ASSERT(!test_matches_filter("alert_for_window", "sketch"));
+
+    int saved_stdout = silence_stdout();
+    test_run_options_init(&options);
+    options.jobs = 4;
+    options.timeout_ms = 200;
+    options.filter = "passes,fails,aborts,hangs";
+    int failed = run_tests(cases, 5, &options, results);
+
+    int junit_fd = mkstemp(junit);
+    int json_fd = mkstemp(json);
+    char* argv[] = {"runner", "--jobs", "2", "--filter", "passes,fails", "--junit", junit, "--json", json, NULL};
+    int status = run_test_suite_main(cases, 5, 9, argv);
+    restore_stdout(saved_stdout);
+
+    ASSERT(failed == 3);
+    ASSERT(results[0].outcome == TEST_OUTCOME_PASSED && results[0].max_rss_kib > 0);
+    ASSERT(results[1].outcome == TEST_OUTCOME_FAILED);
+    ASSERT(results[1].output && strstr(results[1].output, "Assertion failed") != NULL);
+    ASSERT(results[2].outcome == TEST_OUTCOME_CRASHED && results[2].signal == SIGABRT);
+    ASSERT(results[3].outcome == TEST_OUTCOME_TIMED_OUT && results[3].wall_ms >= 200.0);
+    ASSERT(results[4].outcome == TEST_OUTCOME_SKIPPED);
+    free_test_results(results, 5);
+
+    ASSERT(junit_fd >= 0 && json_fd >= 0 && status == 1);
+    close(junit_fd);
+    close(json_fd);
+    ASSERT(file_contains(junit, "tests=\"5\" failures=\"1\" errors=\"0\" skipped=\"3\""));
+    ASSERT(file_contains(junit, "<testcase classname=\"runner\" name=\"fails\""));
+    ASSERT(file_contains(json, "{\"name\":\"passes\",\"outcome\":\"passed\""));
+    ASSERT(file_contains(json, "\"outcome\":\"skipped\""));
+    unlink(junit);
+    unlink(json);
+    return TEST_PASSED;
+}
+
+static void spin_bench(BenchState* bench) {
+    volatile uint64_t sum = 0;
+    for (uint64_t i = 0; i < bench->iterations; i++) {
+        sum += i;
+    }
+}
+
+TEST_CASE(bench_runner_scales_and_flags_regressions) {
+    BenchCase cases[] = {{"spin", spin_bench}, {"filtered_out", spin_bench}};
+    BenchResult results[2];
+    BenchRunOptions options;
+    char baseline[] = "/tmp/shm_baseline_XXXXXX";
+    char saved[] = "/tmp/shm_saved_XXXXXX";
+    int baseline_fd = mkstemp(baseline);
+    int saved_fd = mkstemp(saved);
+
+    ASSERT(baseline_fd >= 0 && saved_fd >= 0);
+    ASSERT(write(baseline_fd, "# name median_ns mad_ns\nspin 0.001 0\n", 37) == 37);
+    close(baseline_fd);
+    close(saved_fd);
+
+    bench_run_options_init(&options);
+    options.samples = 9;
+    options.min_sample_ms = 1;
+    options.warmup_ms = 0;
+    options.filter = "spin";
+    options.baseline_path = baseline;
+    options.save_path = saved;
+
+    int saved_stdout = silence_stdout();
+    int regressions = run_benches(cases, 2, &options, results);
+    restore_stdout(saved_stdout);
+
+    ASSERT(regressions == 1 && results[0].regressed && results[0].baseline_ns == 0.001);
+    ASSERT(results[0].iterations > 1 && results[0].samples == 9);
+    ASSERT(results[0].min_ns <= results[0].median_ns && results[0].median_ns <= results[0].p90_ns);
+    ASSERT(results[0].p90_ns <= results[0].p99_ns && results[0].p99_ns <= results[0].max_ns);
+    ASSERT(results[0].mad_ns >= 0.0 && results[1].skipped);
+    ASSERT(file_contains(saved, "spin ") && !file_contains(saved, "filtered_out"));
+
+    /* Against its own medians with a generous threshold, the run passes. */
+    options.baseline_path = saved;
+    options.save_path = NULL;
+    options.threshold_percent = 1000.0;
+    options.quiet = true;
+    ASSERT(run_benches(cases, 2, &options, results) == 0 && results[0].baseline_ns > 0.0);
+    options.baseline_path = "/nonexistent/baseline";
+    ASSERT(run_benches(cases, 2, &options, results) == -1);
+
+    unlink(baseline);
+    unlink(saved);
+    return TEST_PASSED;
+}
+
+static void* allocate_in_thread(void* arg) {
+    for (int i = 0; i < 10; i++) {
+        void* volatile block = malloc(64);
+        free(block);
+    }
+    return arg;
+}
+
+TEST_CASE(alloc_profiler_counts_scopes_threads_and_sites) {
+    AllocScope outer;
+    AllocScope inner;
+    AllocCounters before;
+    AllocCounters after;
+    AllocSite sites[4];
+    pthread_t thread;
+
+    alloc_scope_begin(&outer);
+    void* volatile first = malloc(1000);
+    alloc_scope_begin(&inner);
+    void* volatile second = calloc(10, 100);
+    first = realloc(first, 5000);
+    free(second);
+    alloc_scope_end(&inner);
+    free(first);
+    alloc_scope_end(&outer);
+
+    ASSERT(inner.counters.allocations == 1 && inner.counters.reallocations == 1 && inner.counters.frees == 1);
+    ASSERT(inner.peak_bytes >= 5000 && inner.counters.bytes_in_use >= 4000);
+    ASSERT(outer.counters.allocations == 2 && outer.counters.frees == 2 && outer.counters.bytes_in_use == 0);
+    ASSERT(outer.peak_bytes >= 6000);
+
+    /* strdup() allocates inside libc, so its free must not show up as one either. */
+    char* copy = strdup("allocated by libc");
+    ASSERT(copy != NULL);
+    alloc_scope_begin(&inner);
+    free(copy);
+    alloc_scope_end(&inner);
+    ASSERT(inner.counters.frees == 0 && inner.counters.bytes_in_use == 0);
+
+    /* Counters are per thread; the totals see every thread. */
+    alloc_profile_totals(&before);
+    alloc_scope_begin(&outer);
+    ASSERT(pthread_create(&thread, NULL, allocate_in_thread, NULL) == 0);
+    ASSERT(pthread_join(thread, NULL) == 0);
+    alloc_scope_end(&outer);
+    alloc_profile_totals(&after);
+    ASSERT(outer.counters.allocations == 0);
+    ASSERT(after.allocations - before.allocations >= 10 && after.frees - before.frees >= 10);
+
+    alloc_profile_reset_sites();
+    alloc_profile_set_sample_period(1);
+    for (int i = 0; i < 5; i++) {
+        void* volatile block = malloc(32);
+        free(block);
+    }
+    alloc_profile_set_sample_period(0);
+    size_t count = alloc_profile_sites(sites, 4);
+    ASSERT(count >= 1 && sites[0].samples >= 5 && sites[0].bytes >= 5 * 32 && sites[0].depth > 0);
+    alloc_profile_reset_sites();
+    ASSERT(alloc_profile_sites(sites, 4) == 0);
+    return TEST_PASSED;
+}
+
+typedef struct {
+    int pid;
+    char name[24];
+} PoolRecord;
+
+TEST_CASE(arena_and_pool_recycle_without_the_heap) {
+    MonitorArena arena;
+    MonitorPool pool;
+    PoolRecord* records[4] = {NULL};
+    AllocScope scope;
+
+    ASSERT(monitor_arena_init(&arena, 1024) == MONITOR_STATUS_OK);
+    ASSERT(monitor_pool_init(&pool, sizeof(PoolRecord), 3) == MONITOR_STATUS_OK);
+
+    /* After init, a tick's worth of scratch and record churn never reaches malloc. */
+    alloc_scope_begin(&scope);
+    for (int tick = 0; tick < 100; tick++) {
+        char* line = monitor_arena_alloc(&arena, 100, 1);
+        double* values = monitor_arena_alloc(&arena, 8 * sizeof(double), 0);
+        ASSERT(line && values && ((uintptr_t)values % _Alignof(max_align_t)) == 0);
+        size_t mark = monitor_arena_mark(&arena);
+        ASSERT(monitor_arena_alloc(&arena, 500, 8) != NULL);
+        monitor_arena_rewind(&arena, mark);
+        ASSERT(arena.used == mark);
+
+        records[tick % 3] = monitor_pool_acquire(&pool);
+        ASSERT(records[tick % 3] != NULL && records[tick % 3]->pid == 0);
+        records[tick % 3]->pid = tick;
+        monitor_pool_release(&pool, records[tick % 3]);
+        monitor_arena_reset(&arena);
+    }
+    alloc_scope_end(&scope);
+    ASSERT(scope.counters.allocations == 0 && scope.counters.frees == 0);
+    ASSERT(arena.used == 0 && arena.high_water >= 100 + 64 + 500 && arena.high_water <= 1024);
+    ASSERT(pool.in_use == 0 && pool.high_water == 1);
+
+    ASSERT(monitor_arena_alloc(&arena, 1000, 1) != NULL);
+    ASSERT(monitor_arena_alloc(&arena, 100, 1) == NULL && arena.failures == 1);
+    ASSERT(monitor_arena_alloc(&arena, 1, 3) == NULL && arena.failures == 2);
+
+    for (int i = 0; i < 3; i++) {
+        records[i] = monitor_pool_acquire(&pool);
+        ASSERT(records[i] != NULL);
+    }
+    ASSERT(monitor_pool_acquire(&pool) == NULL && pool.failures == 1 && pool.high_water == 3);
+    PoolRecord outsider;
+    monitor_pool_release(&pool, &outsider);
+    ASSERT(pool.in_use == 3 && pool.bad_releases == 1);
+    monitor_pool_release(&pool, records[1]);
+    ASSERT(monitor_pool_acquire(&pool) == records[1]);
+
+    /* A second release of the same record must not put it on the free list twice. */
+    monitor_pool_release(&pool, records[2]);
+    monitor_pool_release(&pool, records[2]);
+    ASSERT(pool.in_use == 2 && pool.bad_releases == 2);
+    ASSERT(monitor_pool_acquire(&pool) == records[2]);
+    ASSERT(monitor_pool_acquire(&pool) == NULL && pool.in_use == 3);
+
+    monitor_arena_free(&arena);
+    monitor_pool_free(&pool);
+    return TEST_PASSED;
+}
+
+/* Everything sample_tick() runs once warmed up must stay off the heap. */
+TEST_CASE(hot_paths_do_not_allocate) {
+    static QuantileSketch sketch;
+    static HistoryRing history;
+    char storage[2 * MONITOR_OUTPUT_MAX_RECORD_BYTES];
+    char panel[1024];
+    AlertEngine engine;
+    AlertEvent alert_events[4];
+    AlertRule rule = {0, 75.0, 90.0, 5.0, 0, 0};
+    AnomalyDetector detector;
+    AnomalyEvent anomaly_events[MONITOR_METRIC_COUNT];
+    OutputWriter writer;
+    double values[MONITOR_METRIC_COUNT] = {50.0, 60.0, 3.0};
+    AnomalyEvent spike = {0, ANOMALY_SPIKE, 80.0, 50.0, 6.0};
+    HealthRecord record = {1000, "web", 80.0, 50.0, 1.5, 3.0, "OK", "OK", false, 0.0, 0.0, &spike, 1,
+                           false, 0, 0, 0};
+    const char meminfo[] = "MemTotal: 16384 kB\nMemFree: 1024 kB\nMemAvailable: 8192 kB\n";
+    MemoryBreakdown memory;
+    int sink = open("/dev/null", O_WRONLY);
+
+    ASSERT(sink >= 0);
+    ASSERT(monitor_alert_engine_init(&engine, 1) == MONITOR_STATUS_OK);
+    ASSERT(monitor_alert_engine_add_rule(&engine, &rule, NULL) == MONITOR_STATUS_OK);
+    ASSERT(monitor_anomaly_init(&detector, MONITOR_METRIC_COUNT, NULL) == MONITOR_STATUS_OK);
+    ASSERT(monitor_output_init(&writer, storage, sizeof(storage), sink, MONITOR_OUTPUT_JSON, 1) ==
+           MONITOR_STATUS_OK);
+    monitor_sketch_init(&sketch);
+    monitor_history_init(&history);
+    const SparklineRow row = {"CPU Usage", &history, 0.0, 100.0};
+
+    for (int64_t tick = 0; tick < 100; tick++) {
+        values[0] = 50.0 + (double)(tick % 7);
+        ASSERT_NO_ALLOCATIONS(monitor_alert_engine_evaluate(&engine, values, 1, tick * 1000, alert_events, 4));
+        ASSERT_NO_ALLOCATIONS(monitor_anomaly_update(&detector, values, MONITOR_METRIC_COUNT, tick * 1000,
+                                                     anomaly_events, MONITOR_METRIC_COUNT));
+        ASSERT_NO_ALLOCATIONS(monitor_sketch_add(&sketch, values[0]));
+        ASSERT_NO_ALLOCATIONS(monitor_history_push(&history, values[0]));
+        ASSERT_NO_ALLOCATIONS(monitor_output_write(&writer, &record));
+        ASSERT_NO_ALLOCATIONS(monitor_parse_meminfo(meminfo, sizeof(meminfo) - 1, &memory));
+    }
+    ASSERT_NO_ALLOCATIONS(monitor_sparkline_panel(&row, 1, 80, MONITOR_SPARKLINE_UTF8, panel, sizeof(panel)));
+
+    monitor_alert_engine_free(&engine);
+    monitor_anomaly_free(&detector);
+    close(sink);
+    return TEST_PASSED;
+}
+
+static void* read_error_timestamp(void* arg) {
+    *(uint64_t*)arg = monitor_error_last()->timestamp_ns;
+    return NULL;
+}
+
+TEST_CASE(status_message_renders_error_context) {
+    const char bad_total[] = "MemFree: 10 kB\nMemTotal: abc\n";
+    const char no_total[] = "MemFree: 10 kB\n";
+    char root[] = "/tmp/shm_errors_XXXXXX";
+    char group[64];
+    char expected[128];
+    CpuTracker tracker = {0, 0, false};
+    MemoryBreakdown memory;
+    CgroupHandle handle;
+    CgroupStats stats;
+    pthread_t thread;
+    uint64_t other_timestamp = 1;
+    double cpu = 0.0;
+
+    monitor_error_clear();
+    ASSERT(strcmp(monitor_status_message(MONITOR_STATUS_PARSE_ERROR), "parse error") == 0);
+
+    ASSERT(monitor_cpu_usage_from_stat(&tracker, "cpu  x", &cpu) == MONITOR_STATUS_PARSE_ERROR);
+    ASSERT(strcmp(monitor_status_message(MONITOR_STATUS_PARSE_ERROR), "parse error in /proc/stat at line 1, byte 0") ==
+           0);
+    /* A different status does not borrow the record. */
+    ASSERT(strcmp(monitor_status_message(MONITOR_STATUS_IO_ERROR), "I/O error") == 0);
+
+    ASSERT(monitor_parse_meminfo(bad_total, sizeof(bad_total) - 1, &memory) == MONITOR_STATUS_PARSE_ERROR);
+    ASSERT(monitor_error_last()->line == 2 && monitor_error_last()->offset == 25);
+    ASSERT(strcmp(monitor_error_last()->path, "/proc/meminfo") == 0);
+    ASSERT(monitor_parse_meminfo(no_total, sizeof(no_total) - 1, &memory) == MONITOR_STATUS_PARSE_ERROR);
+    ASSERT(monitor_error_last()->line == 2 && monitor_error_last()->offset == (long)(sizeof(no_total) - 1));
+
+    ASSERT(monitor_error_set(MONITOR_STATUS_IO_ERROR, ENOENT, "/x", 0, -1) == MONITOR_STATUS_IO_ERROR);
+    ASSERT(strstr(monitor_status_message(MONITOR_STATUS_IO_ERROR), "I/O error in /x: ") != NULL);
+    ASSERT(strstr(monitor_status_message(MONITOR_STATUS_IO_ERROR), strerror(ENOENT)) != NULL);
+
+    /* The record is per thread. */
+    ASSERT(pthread_create(&thread, NULL, read_error_timestamp, &other_timestamp) == 0);
+    ASSERT(pthread_join(thread, NULL) == 0);
+    ASSERT(other_timestamp == 0 && monitor_error_last()->timestamp_ns != 0);
+
+    ASSERT(mkdtemp(root) != NULL);
+    snprintf(group, sizeof(group), "%s/app", root);
+    ASSERT(mkdir(group, 0700) == 0);
+    write_fixture(group, "cpu.stat", "usage_usec 1500\nnr_throttled x\n");
+    ASSERT(monitor_cgroup_open(&handle, root, "/app") == MONITOR_STATUS_OK);
+    ASSERT(monitor_cgroup_read(&handle, &stats) == MONITOR_STATUS_PARSE_ERROR);
+    /* Cgroup files are named by their full path, not the bare file name. */
+    snprintf(expected, sizeof(expected), "%s/cpu.stat", group);
+    ASSERT(strcmp(monitor_error_last()->path, expected) == 0 && monitor_error_last()->line == 2);
+    snprintf(expected, sizeof(expected), "in %s/cpu.stat at line 2", group);
+    ASSERT(strstr(monitor_status_message(MONITOR_STATUS_PARSE_ERROR), expected) != NULL);
+    monitor_cgroup_close(&handle);
+    remove_fixture(group, "cpu.stat");
+    rmdir(group);
+    rmdir(root);
+
+    monitor_error_clear();
+    ASSERT(strcmp(monitor_status_message(MONITOR_STATUS_PARSE_ERROR), "parse error") == 0);
+    monitor_error_clear();
+    ASSERT(monitor_error_last()->timestamp_ns == 0);
+    return TEST_PASSED;
+}
+
+int main(int argc, char** argv) {
     TestCase tests[] = {
         parse_int_range_accepts_valid_test_case,
         parse_int_range_rejects_partial_test_case,
         parse_int_range_rejects_out_of_range_test_case,
         config_validation_enforces_duration_test_case,
+        sketch_quantiles_within_relative_accuracy_test_case,
+        sketch_merge_matches_single_stream_test_case,
+        sketch_encode_round_trips_test_case,
+        sketch_count_saturates_with_bins_test_case,
+        rollup_tiers_answer_from_covering_tier_test_case,
+        sparkline_panel_renders_recent_history_test_case,
+        alert_hysteresis_suppresses_flapping_test_case,
+        alert_for_window_and_rate_limit_test_case,
+        alert_for_window_survives_oscillation_across_critical_test_case,
+        alert_state_carries_into_a_rebuilt_engine_test_case,
+        alert_defers_changes_inside_notify_window_test_case,
+        anomaly_detector_flags_spikes_shifts_and_seasons_test_case,
+        log_records_render_as_json_test_case,
+        log_rings_are_reused_after_thread_exit_test_case,
+        format_fixed_rounds_without_printf_test_case,
+        output_writer_renders_json_and_csv_test_case,
+        output_writer_survives_oversized_records_and_short_writes_test_case,
+        cgroup_reads_limits_and_falls_back_test_case,
+        meminfo_parser_fills_every_key_test_case,
+        profile_scopes_merge_into_snapshot_test_case,
+        profile_slots_are_reused_after_thread_exit_test_case,
+        syscall_bench_reports_per_call_percentiles_test_case,
+        probe_parse_splits_quoted_words_test_case,
+        probe_engine_captures_output_limits_and_timeouts_test_case,
+        probe_shared_runs_coalesce_and_cache_test_case,
+        probe_batches_run_on_fixed_workers_test_case,
+        daemon_config_reload_and_event_loop_test_case,
+        config_file_compiles_validated_snapshot_test_case,
+        shm_seqlock_publishes_latest_sample_test_case,
+        read_batch_matches_sequential_reads_test_case,
+        threads_rank_busiest_and_recycle_exited_test_case,
+        test_runner_isolates_crashes_and_timeouts_test_case,
+        bench_runner_scales_and_flags_regressions_test_case,
+        alloc_profiler_counts_scopes_threads_and_sites_test_case,
+        arena_and_pool_recycle_without_the_heap_test_case,
+        hot_paths_do_not_allocate_test_case,
+        status_message_renders_error_context_test_case,
+    };
+    BenchCase benches[] = {
+        sketch_add_bench_case,
+        sparkline_render_utf8_bench_case,
+        anomaly_update_64_metrics_bench_case,
+        format_fixed_two_decimals_bench_case,
     };
 
-    run_test_suite(tests, sizeof(tests) / sizeof(TestCase));
-    return 0;
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        return run_bench_suite_main(benches, sizeof(benches) / sizeof(BenchCase), argc, argv);
+    }
+    return run_test_suite_main(tests, sizeof(tests) / sizeof(TestCase), argc, argv);
 }
@@ -1,6 +1,16 @@
+#define _GNU_SOURCE
+
 #include "syscall_test.h"
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "monitor_profile.h"
+#include "monitor_sketch.h"
 
 #define MAX_SYSCALL_TESTS 256
 static SyscallTest syscall_tests[MAX_SYSCALL_TESTS];
@@ -46,3 +56,247 @@ int run_syscall_tests() {
     
     return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+
+#define MAX_SYSCALL_BENCHES 256
+#define TIMER_CALIBRATION_ROUNDS 1000
+#define PROC_READ_BYTES 4096
+static SyscallBench syscall_benches[MAX_SYSCALL_BENCHES];
+static int num_benches = 0;
+
+void register_syscall_bench(uint32_t syscall_num,
+                            const char* name,
+                            int (*setup)(void** context),
+                            int (*call)(void* context),
+                            void (*teardown)(void* context)) {
+    if (num_benches >= MAX_SYSCALL_BENCHES) {
+        fprintf(stderr, "Too many syscall benchmarks registered\n");
+        exit(EXIT_FAILURE);
+    }
+
+    syscall_benches[num_benches] = (SyscallBench){
+        .syscall_num = syscall_num,
+        .name = name,
+        .setup = setup,
+        .call = call,
+        .teardown = teardown
+    };
+    num_benches++;
+}
+
+typedef struct {
+    int fd;
+    char buffer[PROC_READ_BYTES];
+} ProcReadContext;
+
+static int open_proc_file(const char* path, void** context) {
+    ProcReadContext* read_context = malloc(sizeof(ProcReadContext));
+    if (!read_context) {
+        return -1;
+    }
+
+    read_context->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (read_context->fd < 0) {
+        free(read_context);
+        return -1;
+    }
+    *context = read_context;
+    return 0;
+}
+
+static int open_proc_stat(void** context) {
+    return open_proc_file("/proc/stat", context);
+}
+
+static int open_proc_meminfo(void** context) {
+    return open_proc_file("/proc/meminfo", context);
+}
+
+static void close_proc_file(void* context) {
+    ProcReadContext* read_context = context;
+    close(read_context->fd);
+    free(read_context);
+}
+
+/* The same read the monitor makes every tick: the kernel regenerates the text on each pread. */
+static int bench_pread(void* context) {
+    ProcReadContext* read_context = context;
+    return pread(read_context->fd, read_context->buffer, sizeof(read_context->buffer), 0) < 0 ? -1 : 0;
+}
+
+/* glibc no longer caches getpid(), but going through syscall() makes the kernel entry certain. */
+static int bench_getpid(void* context) {
+    (void)context;
+    return syscall(SYS_getpid) < 0 ? -1 : 0;
+}
+
+/* Normally served by the vDSO without entering the kernel; a slow result points at the clocksource. */
+static int bench_clock_gettime(void* context) {
+    struct timespec ts;
+    (void)context;
+    return clock_gettime(CLOCK_MONOTONIC, &ts);
+}
+
+static int bench_openat_close(void* context) {
+    (void)context;
+    int fd = openat(AT_FDCWD, "/proc/self/stat", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    return close(fd);
+}
+
+static int open_epoll(void** context) {
+    int* fd = malloc(sizeof(int));
+    if (!fd) {
+        return -1;
+    }
+
+    *fd = epoll_create1(EPOLL_CLOEXEC);
+    if (*fd < 0) {
+        free(fd);
+        return -1;
+    }
+    *context = fd;
+    return 0;
+}
+
+static void close_epoll(void* context) {
+    close(*(int*)context);
+    free(context);
+}
+
+static int bench_epoll_wait(void* context) {
+    struct epoll_event event;
+    return epoll_wait(*(int*)context, &event, 1, 0) < 0 ? -1 : 0;
+}
+
+#ifdef SYS_epoll_wait
+#define EPOLL_WAIT_SYSCALL SYS_epoll_wait
+#else
+#define EPOLL_WAIT_SYSCALL SYS_epoll_pwait
+#endif
+
+/* Registers the calls one monitor tick is made of; safe to call more than once. */
+void register_default_syscall_benches(void) {
+    static bool registered = false;
+    if (registered) {
+        return;
+    }
+    registered = true;
+
+    register_syscall_bench(SYS_getpid, "getpid", NULL, bench_getpid, NULL);
+    register_syscall_bench(SYS_clock_gettime, "clock_gettime", NULL, bench_clock_gettime, NULL);
+    register_syscall_bench(SYS_pread64, "pread /proc/stat", open_proc_stat, bench_pread, close_proc_file);
+    register_syscall_bench(SYS_pread64, "pread /proc/meminfo", open_proc_meminfo, bench_pread, close_proc_file);
+    register_syscall_bench(SYS_openat, "openat+close", NULL, bench_openat_close, NULL);
+    register_syscall_bench(EPOLL_WAIT_SYSCALL, "epoll_wait", open_epoll, bench_epoll_wait, close_epoll);
+}
+
+static double timer_overhead_ns(void) {
+    uint64_t best = UINT64_MAX;
+
+    for (int i = 0; i < TIMER_CALIBRATION_ROUNDS; i++) {
+        uint64_t start = monitor_profile_now_ns();
+        uint64_t elapsed = monitor_profile_now_ns() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return (double)best;
+}
+
+static void run_syscall_bench(const SyscallBench* bench,
+                              size_t calls,
+                              double overhead_ns,
+                              QuantileSketch* sketch,
+                              SyscallBenchResult* result) {
+    void* context = NULL;
+
+    *result = (SyscallBenchResult){
+        .name = bench->name,
+        .syscall_num = bench->syscall_num,
+        .calls = calls,
+        .timer_overhead_ns = overhead_ns
+    };
+    if (bench->setup && bench->setup(&context) != 0) {
+        result->skipped = true;
+        return;
+    }
+
+    for (size_t i = 0; i < SYSCALL_BENCH_WARMUP_CALLS; i++) {
+        (void)bench->call(context);
+    }
+
+    monitor_sketch_init(sketch);
+    for (size_t i = 0; i < calls; i++) {
+        uint64_t start = monitor_profile_now_ns();
+        int status = bench->call(context);
+        double elapsed = (double)(monitor_profile_now_ns() - start) - overhead_ns;
+
+        monitor_sketch_add(sketch, elapsed > 0.0 ? elapsed : 0.0);
+        if (status != 0) {
+            result->errors++;
+        }
+    }
+    if (bench->teardown) {
+        bench->teardown(context);
+    }
+
+    result->mean_ns = calls > 0 ? sketch->sum / (double)calls : 0.0;
+    result->max_ns = calls > 0 ? sketch->max : 0.0;
+    monitor_sketch_quantile(sketch, 0.50, &result->p50_ns);
+    monitor_sketch_quantile(sketch, 0.90, &result->p90_ns);
+    monitor_sketch_quantile(sketch, 0.99, &result->p99_ns);
+}
+
+/**
+ * Times every registered benchmark in registration order.
+ *
+ * @param calls Timed calls per benchmark.
+ * @param results Receives one entry per benchmark, skipped ones included.
+ * @param capacity Entries available in results.
+ * @return Number of results written.
+ */
+size_t run_syscall_benches(size_t calls, SyscallBenchResult* results, size_t capacity) {
+    QuantileSketch sketch;
+    double overhead_ns = timer_overhead_ns();
+    size_t count = 0;
+
+    for (int i = 0; i < num_benches && count < capacity; i++) {
+        run_syscall_bench(&syscall_benches[i], calls, overhead_ns, &sketch, &results[count]);
+        count++;
+    }
+    return count;
+}
+
+void print_syscall_bench_results(FILE* out, const SyscallBenchResult* results, size_t count) {
+    if (count == 0) {
+        return;
+    }
+
+    fprintf(out,
+            "Syscall cost (%zu calls each, ns/call, %.0f ns timer overhead removed):\n",
+            results[0].calls,
+            results[0].timer_overhead_ns);
+    fprintf(out, "  %-20s %9s %9s %9s %9s %9s\n", "syscall", "mean", "p50", "p90", "p99", "max");
+    for (size_t i = 0; i < count; i++) {
+        const SyscallBenchResult* result = &results[i];
+        if (result->skipped) {
+            fprintf(out, "  %-20s skipped: setup failed\n", result->name);
+            continue;
+        }
+        fprintf(out,
+                "  %-20s %9.1f %9.1f %9.1f %9.1f %9.1f",
+                result->name,
+                result->mean_ns,
+                result->p50_ns,
+                result->p90_ns,
+                result->p99_ns,
+                result->max_ns);
+        if (result->errors > 0) {
+            fprintf(out, "  (%zu errors)", result->errors);
+        }
+        fprintf(out, "\n");
+    }
+    fflush(out);
+}
@@ -1,7 +1,10 @@
 #ifndef OS_SYSCALL_TEST_H
 #define OS_SYSCALL_TEST_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
 typedef struct {
     uint32_t syscall_num;
@@ -12,4 +15,47 @@ typedef struct {
 void register_syscall_test(uint32_t syscall_num, const char* name, int (*test_function)());
 int run_syscall_tests();
 
+/*
+ * Syscall latency harness. A registered benchmark makes one call N times
+ * after a short warm-up; each call is timed on its own with the profiler
+ * clock, the cheapest empty timing pair is subtracted, and the samples go
+ * into a QuantileSketch so tail percentiles survive without keeping N
+ * samples. setup and teardown are optional and run outside the timed
+ * region, e.g. to open the file a pread benchmark reads. call returns 0 on
+ * success; failures are still timed and counted in errors.
+ */
+#define SYSCALL_BENCH_DEFAULT_CALLS 10000
+#define SYSCALL_BENCH_WARMUP_CALLS 16
+
+typedef struct {
+    uint32_t syscall_num;
+    const char* name;
+    int (*setup)(void** context);
+    int (*call)(void* context);
+    void (*teardown)(void* context);
+} SyscallBench;
+
+typedef struct {
+    const char* name;
+    uint32_t syscall_num;
+    size_t calls;
+    size_t errors;
+    bool skipped;
+    double mean_ns;
+    double p50_ns;
+    double p90_ns;
+    double p99_ns;
+    double max_ns;
+    double timer_overhead_ns;
+} SyscallBenchResult;
+
+void register_syscall_bench(uint32_t syscall_num,
+                            const char* name,
+                            int (*setup)(void** context),
+                            int (*call)(void* context),
+                            void (*teardown)(void* context));
+void register_default_syscall_benches(void);
+size_t run_syscall_benches(size_t calls, SyscallBenchResult* results, size_t capacity);
+void print_syscall_bench_results(FILE* out, const SyscallBenchResult* results, size_t count);
+
 #endif // OS_SYSCALL_TEST_H
@@ -1,22 +1,993 @@
+#define _GNU_SOURCE
+
 #include "test_framework.h"
 
+#include <errno.h>
+#include <fnmatch.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
 jmp_buf test_env;
 int tests_passed = 0;
 int tests_failed = 0;
+static const void* volatile bench_sink;
+
+enum {
+    DEFAULT_TIMEOUT_MS = 60000,
+    READ_CHUNK = 4096,
+    DEFAULT_BENCH_SAMPLES = 30,
+    DEFAULT_BENCH_SAMPLE_MS = 10,
+    DEFAULT_BENCH_WARMUP_MS = 100,
+    DEFAULT_BENCH_THRESHOLD_PERCENT = 10,
+    BENCH_NAME_SIZE = 128
+};
+
+typedef struct {
+    int index;
+    pid_t pid;
+    int fd;
+    int64_t start_ns;
+    bool killed;
+} RunningTest;
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static double timeval_ms(struct timeval tv) {
+    return (double)tv.tv_sec * 1000.0 + (double)tv.tv_usec / 1000.0;
+}
+
+void test_run_options_init(TestRunOptions* options) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    memset(options, 0, sizeof(*options));
+    options->jobs = cpus > 0 ? (int)cpus : 1;
+    options->timeout_ms = DEFAULT_TIMEOUT_MS;
+    options->isolate = true;
+}
+
+static void print_usage(const char* program) {
+    printf("Usage: %s [options]\n", program);
+    printf("  -j, --jobs N        Tests run at once (default: online CPUs)\n");
+    printf("  --filter PATTERNS   Comma-separated globs or substrings of test names\n");
+    printf("  --timeout-ms MS     Kill a test after MS milliseconds; 0 disables (default: %d)\n", DEFAULT_TIMEOUT_MS);
+    printf("  --junit PATH        Write a JUnit XML report\n");
+    printf("  --json PATH         Write a JSON report\n");
+    printf("  --no-fork           Run tests serially in this process (for debuggers)\n");
+    printf("  --list              Print the matching test names and exit\n");
+    printf("  --quiet             Print failures and the summary only\n");
+}
+
+static bool parse_count(const char* text, int min, int* out) {
+    char* end = NULL;
+    errno = 0;
+    long value = text ? strtol(text, &end, 10) : 0;
+    if (!text || end == text || *end != '\0' || errno != 0 || value < min || value > 1000000) {
+        return false;
+    }
+    *out = (int)value;
+    return true;
+}
+
+/**
+ * Parses runner flags into options; the test binary takes no others.
+ *
+ * @return 0 to run the tests, 1 when --help was printed, -1 on a bad argument.
+ */
+int test_run_options_parse(TestRunOptions* options, int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "-j") == 0 || strcmp(arg, "--jobs") == 0) {
+            if (!parse_count(value, 1, &options->jobs)) {
+                fprintf(stderr, "%s expects a positive count\n", arg);
+                return -1;
+            }
+            i++;
+        } else if (strcmp(arg, "--timeout-ms") == 0) {
+            if (!parse_count(value, 0, &options->timeout_ms)) {
+                fprintf(stderr, "%s expects milliseconds\n", arg);
+                return -1;
+            }
+            i++;
+        } else if (strcmp(arg, "--filter") == 0 || strcmp(arg, "--junit") == 0 || strcmp(arg, "--json") == 0) {
+            if (!value) {
+                fprintf(stderr, "%s expects a value\n", arg);
+                return -1;
+            }
+            const char** target = strcmp(arg, "--filter") == 0  ? &options->filter
+                                  : strcmp(arg, "--junit") == 0 ? &options->junit_path
+                                                                : &options->json_path;
+            *target = value;
+            i++;
+        } else if (strcmp(arg, "--no-fork") == 0) {
+            options->isolate = false;
+        } else if (strcmp(arg, "--list") == 0) {
+            options->list_only = true;
+        } else if (strcmp(arg, "--quiet") == 0) {
+            options->quiet = true;
+        } else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Each comma-separated pattern matches as a glob or, failing that, as a substring. */
+bool test_matches_filter(const char* name, const char* filter) {
+    if (!filter || *filter == '\0') {
+        return true;
+    }
+
+    char pattern[256];
+    const char* cursor = filter;
+    while (*cursor) {
+        size_t length = strcspn(cursor, ",");
+        if (length > 0 && length < sizeof(pattern)) {
+            memcpy(pattern, cursor, length);
+            pattern[length] = '\0';
+            if (fnmatch(pattern, name, 0) == 0 || strstr(name, pattern) != NULL) {
+                return true;
+            }
+        }
+        cursor += length;
+        if (*cursor == ',') {
+            cursor++;
+        }
+    }
+    return false;
+}
+
+static int run_in_process(TestCase* test) {
+    if (setjmp(test_env) != 0) {
+        return TEST_FAILED;
+    }
+    return test->test_func() == TEST_PASSED ? TEST_PASSED : TEST_FAILED;
+}
+
+static void append_output(TestResult* result, const char* data, size_t size) {
+    char* grown = realloc(result->output, result->output_size + size + 1);
+    if (!grown) {
+        return;
+    }
+    memcpy(grown + result->output_size, data, size);
+    result->output = grown;
+    result->output_size += size;
+    result->output[result->output_size] = '\0';
+}
+
+static bool start_child(TestCase* test, TestResult* result, RunningTest* running) {
+    int fds[2];
+
+    if (pipe(fds) != 0) {
+        append_output(result, "pipe() failed\n", 14);
+        return false;
+    }
+
+    /* Anything still buffered would otherwise be flushed again by the child. */
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        append_output(result, "fork() failed\n", 14);
+        return false;
+    }
+
+    if (pid == 0) {
+        setpgid(0, 0);
+        close(fds[0]);
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(fds[1], STDERR_FILENO);
+        close(fds[1]);
+        int status = run_in_process(test);
+        fflush(stdout);
+        exit(status);
+    }
+
+    /* Set on both sides so a timeout can kill the test's own children too. */
+    setpgid(pid, pid);
+    close(fds[1]);
+    running->pid = pid;
+    running->fd = fds[0];
+    running->start_ns = now_ns();
+    running->killed = false;
+    return true;
+}
+
+static void finish_child(const RunningTest* running, TestResult* result) {
+    struct rusage usage;
+    int status = 0;
+
+    memset(&usage, 0, sizeof(usage));
+    while (wait4(running->pid, &status, 0, &usage) < 0 && errno == EINTR) {
+    }
+
+    result->wall_ms = (double)(now_ns() - running->start_ns) / 1e6;
+    result->cpu_ms = timeval_ms(usage.ru_utime) + timeval_ms(usage.ru_stime);
+    result->max_rss_kib = usage.ru_maxrss;
+    if (running->killed) {
+        result->outcome = TEST_OUTCOME_TIMED_OUT;
+    } else if (WIFSIGNALED(status)) {
+        result->outcome = TEST_OUTCOME_CRASHED;
+        result->signal = WTERMSIG(status);
+    } else {
+        result->outcome = WIFEXITED(status) && WEXITSTATUS(status) == 0 ? TEST_OUTCOME_PASSED : TEST_OUTCOME_FAILED;
+    }
+}
+
+static void print_result(const TestResult* result, const TestRunOptions* options) {
+    bool passed = result->outcome == TEST_OUTCOME_PASSED;
+
+    if (result->outcome == TEST_OUTCOME_SKIPPED || (options->quiet && passed)) {
+        return;
+    }
+    if (options->isolate) {
+        printf("Running test: %s\n", result->name);
+        if (result->output_size > 0) {
+            fwrite(result->output, 1, result->output_size, stdout);
+        }
+    }
+
+    switch (result->outcome) {
+    case TEST_OUTCOME_PASSED:
+        printf("  PASSED");
+        break;
+    case TEST_OUTCOME_FAILED:
+        printf("  FAILED");
+        break;
+    case TEST_OUTCOME_CRASHED:
+        printf("  CRASHED: signal %d (%s)", result->signal, strsignal(result->signal));
+        break;
+    case TEST_OUTCOME_TIMED_OUT:
+        printf("  TIMED OUT after %d ms", options->timeout_ms);
+        break;
+    case TEST_OUTCOME_SKIPPED:
+        break;
+    }
+    printf(" (%.1f ms wall, %.1f ms cpu, %.1f MiB peak RSS)\n",
+           result->wall_ms,
+           result->cpu_ms,
+           (double)result->max_rss_kib / 1024.0);
+    fflush(stdout);
+}
+
+static void run_serial(TestCase* tests, int count, const TestRunOptions* options, TestResult* results) {
+    for (int i = 0; i < count; i++) {
+        TestResult* result = &results[i];
+        struct rusage before;
+        struct rusage after;
+
+        if (!test_matches_filter(tests[i].name, options->filter)) {
+            continue;
+        }
+        if (!options->quiet) {
+            printf("Running test: %s\n", tests[i].name);
+        }
+        getrusage(RUSAGE_SELF, &before);
+        int64_t start = now_ns();
+        int status = run_in_process(&tests[i]);
+        result->wall_ms = (double)(now_ns() - start) / 1e6;
+        getrusage(RUSAGE_SELF, &after);
+        result->cpu_ms = timeval_ms(after.ru_utime) + timeval_ms(after.ru_stime) - timeval_ms(before.ru_utime) -
+                         timeval_ms(before.ru_stime);
+        result->max_rss_kib = after.ru_maxrss;
+        result->outcome = status == TEST_PASSED ? TEST_OUTCOME_PASSED : TEST_OUTCOME_FAILED;
+        print_result(result, options);
+    }
+}
+
+static void run_forked(TestCase* tests, int count, const TestRunOptions* options, TestResult* results) {
+    int jobs = options->jobs < count ? options->jobs : count;
+    RunningTest* running = calloc((size_t)jobs, sizeof(RunningTest));
+    struct pollfd* fds = calloc((size_t)jobs, sizeof(struct pollfd));
+    int active = 0;
+    int next = 0;
+
+    if (!running || !fds) {
+        fprintf(stderr, "Out of memory starting the test runner\n");
+        free(running);
+        free(fds);
+        return;
+    }
+
+    while (next < count || active > 0) {
+        while (active < jobs && next < count) {
+            int index = next++;
+            if (!test_matches_filter(tests[index].name, options->filter)) {
+                continue;
+            }
+            running[active].index = index;
+            if (start_child(&tests[index], &results[index], &running[active])) {
+                active++;
+            } else {
+                results[index].outcome = TEST_OUTCOME_FAILED;
+                print_result(&results[index], options);
+            }
+        }
+        if (active == 0) {
+            continue;
+        }
+
+        int timeout = -1;
+        int64_t now = now_ns();
+        for (int j = 0; j < active; j++) {
+            fds[j].fd = running[j].fd;
+            fds[j].events = POLLIN;
+            fds[j].revents = 0;
+            if (options->timeout_ms > 0 && !running[j].killed) {
+                int64_t left_ns = running[j].start_ns + (int64_t)options->timeout_ms * 1000000LL - now;
+                int left_ms = left_ns > 0 ? (int)(left_ns / 1000000LL) + 1 : 0;
+                timeout = timeout < 0 || left_ms < timeout ? left_ms : timeout;
+            }
+        }
+        if (poll(fds, (nfds_t)active, timeout) < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+
+        now = now_ns();
+        for (int j = active - 1; j >= 0; j--) {
+            TestResult* result = &results[running[j].index];
+            bool done = false;
+
+            if (fds[j].revents != 0) {
+                char chunk[READ_CHUNK];
+                ssize_t n = read(running[j].fd, chunk, sizeof(chunk));
+                if (n > 0) {
+                    append_output(result, chunk, (size_t)n);
+                } else if (n == 0 || errno != EINTR) {
+                    done = true;
+                }
+            }
+            if (!done && options->timeout_ms > 0 && !running[j].killed &&
+                now - running[j].start_ns >= (int64_t)options->timeout_ms * 1000000LL) {
+                kill(-running[j].pid, SIGKILL);
+                running[j].killed = true;
+            }
+            if (done) {
+                close(running[j].fd);
+                finish_child(&running[j], result);
+                print_result(result, options);
+                running[j] = running[--active];
+            }
+        }
+    }
+
+    free(running);
+    free(fds);
+}
+
+/**
+ * Runs the tests matching options->filter; the rest are reported as
+ * skipped. results must hold count entries and is filled in test order.
+ *
+ * @return Number of tests that did not pass, skipped ones excluded.
+ */
+int run_tests(TestCase* tests, int count, const TestRunOptions* options, TestResult* results) {
+    int failed = 0;
+
+    for (int i = 0; i < count; i++) {
+        memset(&results[i], 0, sizeof(results[i]));
+        results[i].name = tests[i].name;
+        results[i].outcome = TEST_OUTCOME_SKIPPED;
+    }
+
+    if (options->isolate) {
+        run_forked(tests, count, options, results);
+    } else {
+        run_serial(tests, count, options, results);
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (results[i].outcome == TEST_OUTCOME_PASSED) {
+            tests_passed++;
+        } else if (results[i].outcome != TEST_OUTCOME_SKIPPED) {
+            tests_failed++;
+            failed++;
+        }
+    }
+    return failed;
+}
+
+void free_test_results(TestResult* results, int count) {
+    for (int i = 0; results && i < count; i++) {
+        free(results[i].output);
+        results[i].output = NULL;
+        results[i].output_size = 0;
+    }
+}
+
+static const char* outcome_name(TestOutcome outcome) {
+    switch (outcome) {
+    case TEST_OUTCOME_PASSED:
+        return "passed";
+    case TEST_OUTCOME_FAILED:
+        return "failed";
+    case TEST_OUTCOME_CRASHED:
+        return "crashed";
+    case TEST_OUTCOME_TIMED_OUT:
+        return "timed_out";
+    case TEST_OUTCOME_SKIPPED:
+        return "skipped";
+    }
+    return "unknown";
+}
+
+static void write_xml_text(FILE* out, const char* text, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        unsigned char c = (unsigned char)text[i];
+        switch (c) {
+        case '&':
+            fputs("&amp;", out);
+            break;
+        case '<':
+            fputs("&lt;", out);
+            break;
+        case '>':
+            fputs("&gt;", out);
+            break;
+        case '"':
+            fputs("&quot;", out);
+            break;
+        default:
+            /* XML 1.0 has no escape for other control characters. */
+            if (c >= 0x20 || c == '\n' || c == '\t' || c == '\r') {
+                fputc(c, out);
+            }
+            break;
+        }
+    }
+}
+
+static void write_json_text(FILE* out, const char* text, size_t size) {
+    fputc('"', out);
+    for (size_t i = 0; i < size; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if (c == '\n') {
+            fputs("\\n", out);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static bool write_junit(const char* path,
+                        const char* suite,
+                        const TestResult* results,
+                        int count,
+                        const TestRunOptions* options,
+                        double wall_ms) {
+    FILE* out = fopen(path, "w");
+    int failures = 0;
+    int errors = 0;
+    int skipped = 0;
+
+    if (!out) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        failures += results[i].outcome == TEST_OUTCOME_FAILED;
+        errors += results[i].outcome == TEST_OUTCOME_CRASHED || results[i].outcome == TEST_OUTCOME_TIMED_OUT;
+        skipped += results[i].outcome == TEST_OUTCOME_SKIPPED;
+    }
+
+    fprintf(out, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuite name=\"");
+    write_xml_text(out, suite, strlen(suite));
+    fprintf(out,
+            "\" tests=\"%d\" failures=\"%d\" errors=\"%d\" skipped=\"%d\" time=\"%.3f\">\n",
+            count,
+            failures,
+            errors,
+            skipped,
+            wall_ms / 1000.0);
+    for (int i = 0; i < count; i++) {
+        const TestResult* result = &results[i];
+        fprintf(out, "  <testcase classname=\"");
+        write_xml_text(out, suite, strlen(suite));
+        fprintf(out, "\" name=\"");
+        write_xml_text(out, result->name, strlen(result->name));
+        fprintf(out, "\" time=\"%.6f\">\n", result->wall_ms / 1000.0);
+        switch (result->outcome) {
+        case TEST_OUTCOME_FAILED:
+            fprintf(out, "    <failure message=\"assertion failed\"/>\n");
+            break;
+        case TEST_OUTCOME_CRASHED:
+            fprintf(out, "    <error message=\"killed by signal %d\"/>\n", result->signal);
+            break;
+        case TEST_OUTCOME_TIMED_OUT:
+            fprintf(out, "    <error message=\"timed out after %d ms\"/>\n", options->timeout_ms);
+            break;
+        case TEST_OUTCOME_SKIPPED:
+            fprintf(out, "    <skipped/>\n");
+            break;
+        case TEST_OUTCOME_PASSED:
+            break;
+        }
+        if (result->output_size > 0) {
+            fprintf(out, "    <system-out>");
+            write_xml_text(out, result->output, result->output_size);
+            fprintf(out, "</system-out>\n");
+        }
+        fprintf(out, "  </testcase>\n");
+    }
+    fprintf(out, "</testsuite>\n");
+    return fclose(out) == 0;
+}
+
+static bool write_json(const char* path,
+                       const char* suite,
+                       const TestResult* results,
+                       int count,
+                       const TestRunOptions* options,
+                       double wall_ms) {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        return false;
+    }
+
+    fprintf(out, "{\"suite\":");
+    write_json_text(out, suite, strlen(suite));
+    fprintf(out, ",\"jobs\":%d,\"isolated\":%s,\"wall_ms\":%.3f,\"tests\":[", options->jobs,
+            options->isolate ? "true" : "false", wall_ms);
+    for (int i = 0; i < count; i++) {
+        const TestResult* result = &results[i];
+        fprintf(out, "%s{\"name\":", i > 0 ? "," : "");
+        write_json_text(out, result->name, strlen(result->name));
+        fprintf(out,
+                ",\"outcome\":\"%s\",\"signal\":%d,\"wall_ms\":%.3f,\"cpu_ms\":%.3f,\"max_rss_kib\":%ld,\"output\":",
+                outcome_name(result->outcome),
+                result->signal,
+                result->wall_ms,
+                result->cpu_ms,
+                result->max_rss_kib);
+        write_json_text(out, result->output ? result->output : "", result->output_size);
+        fputc('}', out);
+    }
+    fprintf(out, "]}\n");
+    return fclose(out) == 0;
+}
+
+/**
+ * Entry point for test binaries: parses runner flags from argv, runs the
+ * matching tests, prints the summary and writes any requested reports.
+ *
+ * @return Process exit status: 0 when every test ran passed, 1 on
+ *         failures, 2 on a bad argument or report that could not be written.
+ */
+int run_test_suite_main(TestCase* tests, int count, int argc, char** argv) {
+    TestRunOptions options;
+    const char* suite = "tests";
+
+    test_run_options_init(&options);
+    int parsed = test_run_options_parse(&options, argc, argv);
+    if (parsed != 0) {
+        return parsed > 0 ? 0 : 2;
+    }
+    if (argc > 0 && argv[0]) {
+        const char* slash = strrchr(argv[0], '/');
+        suite = slash ? slash + 1 : argv[0];
+    }
+
+    if (options.list_only) {
+        for (int i = 0; i < count; i++) {
+            if (test_matches_filter(tests[i].name, options.filter)) {
+                printf("%s\n", tests[i].name);
+            }
+        }
+        return 0;
+    }
+
+    TestResult* results = calloc(count > 0 ? (size_t)count : 1, sizeof(TestResult));
+    if (!results) {
+        fprintf(stderr, "Out of memory starting the test runner\n");
+        return 2;
+    }
 
-void run_test_suite(TestCase* tests, int count) {
     printf("Starting test suite...\n");
-    
+    int64_t start = now_ns();
+    int failed = run_tests(tests, count, &options, results);
+    double wall_ms = (double)(now_ns() - start) / 1e6;
+
+    int passed = 0;
+    int skipped = 0;
     for (int i = 0; i < count; i++) {
-        RUN_TEST(tests[i]);
+        passed += results[i].outcome == TEST_OUTCOME_PASSED;
+        skipped += results[i].outcome == TEST_OUTCOME_SKIPPED;
     }
-    
     printf("\nTest results:\n");
-    printf("  Passed: %d\n", tests_passed);
-    printf("  Failed: %d\n", tests_failed);
-    printf("  Total:  %d\n", tests_passed + tests_failed);
-    
-    if (tests_failed > 0) {
+    printf("  Passed: %d\n", passed);
+    printf("  Failed: %d\n", failed);
+    if (skipped > 0) {
+        printf("  Skipped: %d\n", skipped);
+    }
+    printf("  Total:  %d\n", passed + failed);
+    if (options.isolate) {
+        int jobs = options.jobs < count ? options.jobs : count;
+        printf("  Wall:   %.1f ms on %d job%s\n", wall_ms, jobs, jobs == 1 ? "" : "s");
+    } else {
+        printf("  Wall:   %.1f ms in process\n", wall_ms);
+    }
+
+    int status = failed > 0 ? 1 : 0;
+    if (options.junit_path && !write_junit(options.junit_path, suite, results, count, &options, wall_ms)) {
+        fprintf(stderr, "Failed to write %s\n", options.junit_path);
+        status = 2;
+    }
+    if (options.json_path && !write_json(options.json_path, suite, results, count, &options, wall_ms)) {
+        fprintf(stderr, "Failed to write %s\n", options.json_path);
+        status = 2;
+    }
+
+    free_test_results(results, count);
+    free(results);
+    return status;
+}
+
+void bench_keep(const void* value) {
+    bench_sink = value;
+}
+
+void bench_reset_timer(BenchState* bench) {
+    bench->start_ns = now_ns();
+}
+
+void bench_run_options_init(BenchRunOptions* options) {
+    memset(options, 0, sizeof(*options));
+    options->samples = DEFAULT_BENCH_SAMPLES;
+    options->min_sample_ms = DEFAULT_BENCH_SAMPLE_MS;
+    options->warmup_ms = DEFAULT_BENCH_WARMUP_MS;
+    options->cpu = -1;
+    options->threshold_percent = DEFAULT_BENCH_THRESHOLD_PERCENT;
+}
+
+static void print_bench_usage(const char* program) {
+    printf("Usage: %s --bench [options]\n", program);
+    printf("  --filter PATTERNS    Comma-separated globs or substrings of benchmark names\n");
+    printf("  --samples N          Timed samples per benchmark (default: %d)\n", DEFAULT_BENCH_SAMPLES);
+    printf("  --min-sample-ms MS   Iterations scale until a sample takes MS (default: %d)\n", DEFAULT_BENCH_SAMPLE_MS);
+    printf("  --warmup-ms MS       Untimed runs before sampling (default: %d)\n", DEFAULT_BENCH_WARMUP_MS);
+    printf("  --cpu N              Pin to CPU N (default: the CPU the runner starts on)\n");
+    printf("  --baseline PATH      Compare medians against a saved baseline\n");
+    printf("  --threshold-pct P    Median slowdown that counts as a regression (default: %d)\n",
+           DEFAULT_BENCH_THRESHOLD_PERCENT);
+    printf("  --save-baseline PATH Write this run's medians as a baseline\n");
+    printf("  --quiet              Print regressions only\n");
+}
+
+/**
+ * Parses benchmark runner flags into options. A leading --bench, which
+ * selects benchmarks over tests, is accepted and ignored.
+ *
+ * @return 0 to run, 1 when --help was printed, -1 on a bad argument.
+ */
+int bench_run_options_parse(BenchRunOptions* options, int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        int* count = strcmp(arg, "--samples") == 0         ? &options->samples
+                     : strcmp(arg, "--min-sample-ms") == 0 ? &options->min_sample_ms
+                     : strcmp(arg, "--warmup-ms") == 0     ? &options->warmup_ms
+                     : strcmp(arg, "--cpu") == 0           ? &options->cpu
+                                                           : NULL;
+        const char** path = strcmp(arg, "--filter") == 0          ? &options->filter
+                            : strcmp(arg, "--baseline") == 0      ? &options->baseline_path
+                            : strcmp(arg, "--save-baseline") == 0 ? &options->save_path
+                                                                  : NULL;
+
+        if (count) {
+            if (!parse_count(value, count == &options->samples ? 1 : 0, count)) {
+                fprintf(stderr, "%s expects a number\n", arg);
+                return -1;
+            }
+            i++;
+        } else if (path) {
+            if (!value) {
+                fprintf(stderr, "%s expects a value\n", arg);
+                return -1;
+            }
+            *path = value;
+            i++;
+        } else if (strcmp(arg, "--threshold-pct") == 0) {
+            int percent = 0;
+            if (!parse_count(value, 0, &percent)) {
+                fprintf(stderr, "%s expects a percentage\n", arg);
+                return -1;
+            }
+            options->threshold_percent = percent;
+            i++;
+        } else if (strcmp(arg, "--quiet") == 0) {
+            options->quiet = true;
+        } else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            print_bench_usage(argv[0]);
+            return 1;
+        } else if (strcmp(arg, "--bench") != 0) {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted values. */
+static double percentile(const double* sorted, int count, double fraction) {
+    double exact = fraction * count;
+    int rank = (int)exact;
+    rank += rank < exact;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static double median(const double* sorted, int count) {
+    return count % 2 ? sorted[count / 2] : (sorted[count / 2 - 1] + sorted[count / 2]) / 2.0;
+}
+
+static double time_iterations(const BenchCase* bench_case, uint64_t iterations) {
+    BenchState bench = {iterations, now_ns()};
+    bench_case->bench_func(&bench);
+    return (double)(now_ns() - bench.start_ns);
+}
+
+/* Fills result from samples; the scratch array is reordered. */
+static void summarize(BenchResult* result, double* samples, double* scratch, int count) {
+    qsort(samples, (size_t)count, sizeof(double), compare_doubles);
+    result->median_ns = median(samples, count);
+    result->min_ns = samples[0];
+    result->p90_ns = percentile(samples, count, 0.90);
+    result->p99_ns = percentile(samples, count, 0.99);
+    result->max_ns = samples[count - 1];
+    for (int i = 0; i < count; i++) {
+        double deviation = samples[i] - result->median_ns;
+        scratch[i] = deviation < 0.0 ? -deviation : deviation;
+    }
+    qsort(scratch, (size_t)count, sizeof(double), compare_doubles);
+    result->mad_ns = median(scratch, count);
+    result->samples = count;
+}
+
+static void run_bench(const BenchCase* bench_case,
+                      const BenchRunOptions* options,
+                      double* samples,
+                      double* scratch,
+                      BenchResult* result) {
+    const double target_ns = (double)options->min_sample_ms * 1e6;
+    const int64_t warmup_end = now_ns() + (int64_t)options->warmup_ms * 1000000LL;
+    uint64_t iterations = 1;
+
+    /* Calibration runs count towards the warm-up. */
+    for (;;) {
+        double elapsed = time_iterations(bench_case, iterations);
+        if (elapsed >= target_ns || iterations >= UINT64_C(1) << 40) {
+            break;
+        }
+        double scale = elapsed > 0.0 ? target_ns * 1.2 / elapsed : 100.0;
+        scale = scale < 2.0 ? 2.0 : scale > 100.0 ? 100.0 : scale;
+        iterations = (uint64_t)((double)iterations * scale);
+    }
+    while (now_ns() < warmup_end) {
+        time_iterations(bench_case, iterations);
+    }
+
+    for (int i = 0; i < options->samples; i++) {
+        samples[i] = time_iterations(bench_case, iterations) / (double)iterations;
+    }
+    result->iterations = iterations;
+    summarize(result, samples, scratch, options->samples);
+}
+
+typedef struct {
+    char name[BENCH_NAME_SIZE];
+    double median_ns;
+} BaselineEntry;
+
+/* Baselines are "name median_ns mad_ns" lines; '#' starts a comment. */
+static int load_baseline(const char* path, BaselineEntry** out) {
+    FILE* file = fopen(path, "r");
+    BaselineEntry* entries = NULL;
+    int count = 0;
+    char line[512];
+
+    *out = NULL;
+    if (!file) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), file)) {
+        BaselineEntry entry;
+        if (line[0] == '#' || sscanf(line, "%127s %lf", entry.name, &entry.median_ns) != 2) {
+            continue;
+        }
+        BaselineEntry* grown = realloc(entries, (size_t)(count + 1) * sizeof(BaselineEntry));
+        if (!grown) {
+            break;
+        }
+        entries = grown;
+        entries[count++] = entry;
+    }
+    fclose(file);
+    *out = entries;
+    return count;
+}
+
+static bool save_baseline(const char* path, const BenchResult* results, int count) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "# name median_ns mad_ns\n");
+    for (int i = 0; i < count; i++) {
+        if (!results[i].skipped) {
+            fprintf(file, "%s %.3f %.3f\n", results[i].name, results[i].median_ns, results[i].mad_ns);
+        }
+    }
+    return fclose(file) == 0;
+}
+
+static void print_bench_result(const BenchResult* result, const BenchRunOptions* options) {
+    if (options->quiet && !result->regressed) {
+        return;
+    }
+    printf("%-40s %12.1f ns/op  MAD %8.1f  p90 %10.1f  p99 %10.1f  (%llu ops x %d)",
+           result->name,
+           result->median_ns,
+           result->mad_ns,
+           result->p90_ns,
+           result->p99_ns,
+           (unsigned long long)result->iterations,
+           result->samples);
+    if (result->baseline_ns > 0.0) {
+        printf("  %+.1f%% vs baseline%s",
+               (result->median_ns / result->baseline_ns - 1.0) * 100.0,
+               result->regressed ? "  REGRESSION" : "");
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+static void pin_cpu(int cpu) {
+    cpu_set_t set;
+
+    if (cpu < 0) {
+        cpu = sched_getcpu();
+    }
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return;
+    }
+    CPU_ZERO(&set);
+    CPU_SET((size_t)cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        fprintf(stderr, "Could not pin to CPU %d; timings may be noisier\n", cpu);
+    }
+}
+
+/**
+ * Runs the benchmarks matching options->filter on one pinned CPU, in this
+ * process. A benchmark regresses when its median exceeds the baseline's by
+ * more than options->threshold_percent; benchmarks missing from the
+ * baseline are reported without a comparison.
+ *
+ * @return Number of regressions, or -1 when a baseline file could not be
+ *         read or written.
+ */
+int run_benches(BenchCase* benches, int count, const BenchRunOptions* options, BenchResult* results) {
+    BaselineEntry* baseline = NULL;
+    int baseline_count = 0;
+    int regressions = 0;
+    double* samples = calloc((size_t)options->samples, sizeof(double));
+    double* scratch = calloc((size_t)options->samples, sizeof(double));
+
+    if (!samples || !scratch) {
+        free(samples);
+        free(scratch);
+        return -1;
+    }
+    if (options->baseline_path) {
+        baseline_count = load_baseline(options->baseline_path, &baseline);
+        if (baseline_count < 0) {
+            free(samples);
+            free(scratch);
+            return -1;
+        }
+    }
+
+    pin_cpu(options->cpu);
+    for (int i = 0; i < count; i++) {
+        BenchResult* result = &results[i];
+
+        memset(result, 0, sizeof(*result));
+        result->name = benches[i].name;
+        if (!test_matches_filter(benches[i].name, options->filter)) {
+            result->skipped = true;
+            continue;
+        }
+
+        run_bench(&benches[i], options, samples, scratch, result);
+        for (int b = 0; b < baseline_count; b++) {
+            if (strcmp(baseline[b].name, result->name) == 0) {
+                result->baseline_ns = baseline[b].median_ns;
+                result->regressed =
+                    result->median_ns > result->baseline_ns * (1.0 + options->threshold_percent / 100.0);
+                regressions += result->regressed;
+                break;
+            }
+        }
+        print_bench_result(result, options);
+    }
+
+    free(baseline);
+    free(samples);
+    free(scratch);
+    if (options->save_path && !save_baseline(options->save_path, results, count)) {
+        return -1;
+    }
+    return regressions;
+}
+
+/**
+ * Entry point for `--bench`: parses benchmark flags, runs the matching
+ * benchmarks and compares or saves baselines.
+ *
+ * @return Process exit status: 0 without regressions, 1 with regressions,
+ *         2 on a bad argument or baseline file.
+ */
+int run_bench_suite_main(BenchCase* benches, int count, int argc, char** argv) {
+    BenchRunOptions options;
+
+    bench_run_options_init(&options);
+    int parsed = bench_run_options_parse(&options, argc, argv);
+    if (parsed != 0) {
+        return parsed > 0 ? 0 : 2;
+    }
+
+    BenchResult* results = calloc(count > 0 ? (size_t)count : 1, sizeof(BenchResult));
+    if (!results) {
+        fprintf(stderr, "Out of memory starting the benchmark runner\n");
+        return 2;
+    }
+
+    int regressions = run_benches(benches, count, &options, results);
+    free(results);
+    if (regressions < 0) {
+        fprintf(stderr, "Failed to read or write the baseline file\n");
+        return 2;
+    }
+    if (options.baseline_path) {
+        printf("\n%d regression%s beyond %.0f%%\n",
+               regressions,
+               regressions == 1 ? "" : "s",
+               options.threshold_percent);
+    }
+    return regressions > 0 ? 1 : 0;
+}
+
+void run_test_suite(TestCase* tests, int count) {
+    if (run_test_suite_main(tests, count, 0, NULL) != 0) {
         exit(EXIT_FAILURE);
     }
 }
@@ -1,11 +1,17 @@
 #ifndef OS_TEST_FRAMEWORK_H
 #define OS_TEST_FRAMEWORK_H
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <setjmp.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define TEST_PASSED 0
 #define TEST_FAILED 1
 
@@ -43,6 +49,115 @@ extern int tests_failed;
         } \
     } while (0)
 
+typedef enum {
+    TEST_OUTCOME_PASSED = 0,
+    TEST_OUTCOME_FAILED,
+    TEST_OUTCOME_CRASHED,
+    TEST_OUTCOME_TIMED_OUT,
+    TEST_OUTCOME_SKIPPED
+} TestOutcome;
+
+/*
+ * By default every test runs in its own forked child, up to `jobs` at a
+ * time, so a crash or hang fails that test alone. A child's stdout and
+ * stderr are captured and printed in one piece once it finishes, and its
+ * CPU time and peak RSS come from wait4().
+ */
+typedef struct {
+    int jobs;
+    int timeout_ms;
+    const char* filter;
+    const char* junit_path;
+    const char* json_path;
+    bool isolate;
+    bool list_only;
+    bool quiet;
+} TestRunOptions;
+
+typedef struct {
+    const char* name;
+    TestOutcome outcome;
+    int signal;
+    double wall_ms;
+    double cpu_ms;
+    long max_rss_kib;
+    char* output;
+    size_t output_size;
+} TestResult;
+
+/*
+ * Benchmarks live next to the tests they measure. The body repeats the
+ * work bench->iterations times; the runner scales the count until one
+ * sample takes at least min_sample_ms, warms up, then reports the median,
+ * MAD and percentiles of ns per iteration over `samples` runs. Work done
+ * before bench_reset_timer() is not timed.
+ */
+typedef struct {
+    uint64_t iterations;
+    int64_t start_ns;
+} BenchState;
+
+typedef struct {
+    const char* name;
+    void (*bench_func)(BenchState* bench);
+} BenchCase;
+
+typedef struct {
+    int samples;
+    int min_sample_ms;
+    int warmup_ms;
+    int cpu;
+    double threshold_percent;
+    const char* filter;
+    const char* baseline_path;
+    const char* save_path;
+    bool quiet;
+} BenchRunOptions;
+
+typedef struct {
+    const char* name;
+    bool skipped;
+    bool regressed;
+    uint64_t iterations;
+    int samples;
+    double median_ns;
+    double mad_ns;
+    double min_ns;
+    double p90_ns;
+    double p99_ns;
+    double max_ns;
+    double baseline_ns;
+} BenchResult;
+
+#define BENCH_CASE(name) \
+    void name##_bench(BenchState* bench); \
+    BenchCase name##_bench_case = {#name, name##_bench}; \
+    void name##_bench(BenchState* bench)
+
+/* Makes the compiler assume value is read, so the work producing it is kept. */
+#if defined(__GNUC__)
+#define BENCH_KEEP(value) __asm__ volatile("" : : "g"(&(value)) : "memory")
+#else
+#define BENCH_KEEP(value) bench_keep(&(value))
+#endif
+
 void run_test_suite(TestCase* tests, int count);
+void test_run_options_init(TestRunOptions* options);
+int test_run_options_parse(TestRunOptions* options, int argc, char** argv);
+bool test_matches_filter(const char* name, const char* filter);
+int run_tests(TestCase* tests, int count, const TestRunOptions* options, TestResult* results);
+void free_test_results(TestResult* results, int count);
+int run_test_suite_main(TestCase* tests, int count, int argc, char** argv);
+
+void bench_keep(const void* value);
+void bench_reset_timer(BenchState* bench);
+void bench_run_options_init(BenchRunOptions* options);
+int bench_run_options_parse(BenchRunOptions* options, int argc, char** argv);
+int run_benches(BenchCase* benches, int count, const BenchRunOptions* options, BenchResult* results);
+int run_bench_suite_main(BenchCase* benches, int count, int argc, char** argv);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif // OS_TEST_FRAMEWORK_H